@@ -167,6 +167,37 @@ namespace vc4c
          * NOTE: Setting this to a large value might lead to very long compilation times.
          */
         unsigned maxCommonExpressionDinstance = 64;
+
+        /*
+         * The number of instructions to search for the optimal pairing of ADD and MUL ALU instructions to be combined.
+         *
+         * NOTE: The optimal pairing is searched exhaustively, so values larger than 16 are not supported.
+         */
+        unsigned combineWindowSize = 8;
+
+        /*
+         * The maximum size (in bytes) of a read-only memory area to be cached in VPM, 0 disables the VPM read cache.
+         *
+         * NOTE: The VPM read cache is only used for the optimization level FULL (-O3).
+         */
+        unsigned vpmReadCacheSize = 2048;
+
+        /*
+         * The maximum size (in bytes) of the part of a global memory area accessed by a single work-group to be
+         * transferred from/to VPM in a single block DMA, 0 disables the coalescing of work-group memory accesses.
+         *
+         * NOTE: The coalescing of work-group memory accesses is only applied for the optimization level FULL (-O3).
+         */
+        unsigned vpmWorkGroupCacheSize = 1024;
+
+        /*
+         * The number of VPM buffers for every block of global memory accessed by a work-group (see
+         * vpmWorkGroupCacheSize), if all work-groups are executed in a loop. With 2 buffers, the block of the next
+         * work-group is loaded by the first work-item while the other work-items already execute the current
+         * work-group. Only blocks which are never written are double-buffered. Values other than 1 and 2 are treated
+         * as 2.
+         */
+        unsigned vpmWorkGroupBuffers = 1;
     };
 
     /*
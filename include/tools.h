@@ -33,6 +33,68 @@ namespace vc4c
             std::array<uint32_t, 3> globalOffsets = {{0, 0, 0}};
         };
 
+        /*
+         * Configuration of the latencies and throughput of the periphery modelled by the emulator.
+         *
+         * All values are given in QPU cycles. The defaults are derived from the Broadcom specification and the
+         * measured VPM/DMA timings (see doc/TODO.txt).
+         */
+        struct TimingModel
+        {
+            /*
+             * The fixed number of cycles between writing the DMA load address and the DMA load being finished
+             */
+            uint32_t dmaLoadLatency = 6;
+            /*
+             * The fixed number of cycles between writing the DMA store address and the DMA store being finished
+             */
+            uint32_t dmaStoreLatency = 10;
+            /*
+             * The minimum number of cycles a single row of a DMA transfer takes
+             */
+            uint32_t dmaCyclesPerRow = 2;
+            /*
+             * The number of bytes a DMA transfer moves per cycle, zero for unlimited bandwidth
+             */
+            uint32_t dmaBytesPerCycle = 16;
+            /*
+             * Whether DMA transfers of different QPUs are executed one after the other (since there is only a single
+             * DMA engine shared by all QPUs) instead of overlapping
+             */
+            bool serializeDMATransfers = true;
+            /*
+             * The minimum number of cycles between writing the TMU address and the TMU load signal not stalling, if all
+             * loaded data is found in the TMU cache
+             */
+            uint32_t tmuLatency = 9;
+            /*
+             * The additional cycles for a TMU load missing the TMU cache but hitting the L2 cache
+             */
+            uint32_t tmuCacheMissPenalty = 3;
+            /*
+             * The additional cycles for a TMU load also missing the L2 cache and therefore reading from RAM
+             *
+             * NOTE: Together with the TMU latency and the TMU cache miss penalty, this gives the 20 cycles for a TMU
+             * load from RAM.
+             */
+            uint32_t l2CacheMissPenalty = 8;
+            /*
+             * The configuration of the TMU caches (one per TMU per slice) and the L2 cache (shared by all QPUs).
+             *
+             * The sizes are given in bytes, the associativity in number of ways. The defaults model the 4KB TMU caches
+             * and the 128KB L2 cache of the VideoCore IV with 64 byte cache lines.
+             */
+            uint32_t cacheLineSize = 64;
+            uint32_t tmuCacheSize = 4 * 1024;
+            uint32_t tmuCacheAssociativity = 4;
+            uint32_t l2CacheSize = 128 * 1024;
+            uint32_t l2CacheAssociativity = 4;
+            /*
+             * The number of cycles between writing the VPM read setup and the first value being available
+             */
+            uint32_t vpmReadLatency = 3;
+        };
+
         /*
          * Data container for all configuration required to emulate a kernel-execution
          */
@@ -63,6 +125,17 @@ namespace vc4c
              * The maximum number of cycles to execute before terminating the emulation
              */
             uint32_t maxEmulationCycles = std::numeric_limits<uint32_t>::max();
+            /*
+             * The number of host threads to emulate independent work-groups with, zero to use all hardware threads
+             *
+             * NOTE: Only kernels reading the group IDs from the UNIFORMs (i.e. compiled without the work-group loop
+             * optimization) can be emulated in parallel, since otherwise a single execution runs all work-groups.
+             */
+            uint32_t numEmulationThreads = 1;
+            /*
+             * The timing model to calculate the stalls of accessing the periphery with
+             */
+            TimingModel timing;
             /*
              * The path to dump the contents of the memory into
              */
@@ -71,6 +144,52 @@ namespace vc4c
              * The path to dump the results of the instrumentation
              */
             std::string instrumentationDump;
+            /*
+             * The paths to write the hot-spot report (with the annotated disassembly) and the profile in the
+             * callgrind format into
+             */
+            std::string profileReport;
+            std::string profileCallgrind;
+            /*
+             * The path to write the execution trace (QPU states, DMA transfers, mutex and semaphore accesses) in the
+             * Chrome trace-event format into, e.g. for viewing in chrome://tracing or the Perfetto UI
+             */
+            std::string traceFile;
+            /*
+             * The path to the hexadecimal compiler output (with assembler code) of the emulated module. If set, its
+             * comments (e.g. the basic block labels) are used to decorate the hot-spot profile
+             */
+            std::string decoratedModule;
+            /*
+             * The path to a checkpoint to restore the emulation state from, which needs to be written by a previous
+             * emulation of the same kernel with the same parameters and work-group configuration. The emulation then
+             * continues (deterministically) at the cycle of the checkpoint, e.g. to replay only the part after the
+             * checkpoint with additional instrumentation, profiling or tracing.
+             *
+             * NOTE: The instrumentation results and the cache statistics only cover the cycles emulated after the
+             * checkpoint.
+             */
+            std::string restoreCheckpoint;
+            /*
+             * Stops the emulation before emulating the given cycle or before any QPU executes the instruction with
+             * the given index (relative to the start of the kernel, not checked for the first emulated cycle)
+             */
+            uint32_t stopCycle = std::numeric_limits<uint32_t>::max();
+            Optional<uint32_t> stopInstruction;
+            /*
+             * The path to write the checkpoint of the emulation state into when the emulation is stopped
+             *
+             * NOTE: Checkpoints and stopping the emulation are only supported for kernels emulated in a single
+             * execution, i.e. not for independently emulated work-groups.
+             */
+            std::string checkpointFile;
+            /*
+             * Whether to skip the cycles all QPUs are stalled for (e.g. waiting for TMU loads or DMA transfers) at
+             * once. Disabling this emulates every single stalled cycle, which gives the same results, only slower.
+             *
+             * NOTE: Disabling the skipping is only supported for kernels emulated in a single execution.
+             */
+            bool skipStalledCycles = true;
 
             explicit EmulationData() = default;
 
@@ -132,10 +251,25 @@ namespace vc4c
              * The maximum number of cycles to execute before terminating the emulation
              */
             uint32_t maxEmulationCycles = std::numeric_limits<uint32_t>::max();
+            /*
+             * The timing model to calculate the stalls of accessing the periphery with
+             */
+            TimingModel timing;
             /*
              * The path to dump the results of the instrumentation
              */
             std::string instrumentationDump;
+            /*
+             * The paths to write the hot-spot report (with the annotated disassembly) and the profile in the
+             * callgrind format into
+             */
+            std::string profileReport;
+            std::string profileCallgrind;
+            /*
+             * The path to write the execution trace (QPU states, DMA transfers, mutex and semaphore accesses) in the
+             * Chrome trace-event format into, e.g. for viewing in chrome://tracing or the Perfetto UI
+             */
+            std::string traceFile;
 
             LowLevelEmulationData(const std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>& buffers,
                 uint64_t* startAddress, uint32_t numInstructions, const std::vector<uint32_t>& uniformAddresses,
@@ -147,6 +281,33 @@ namespace vc4c
             }
         };
 
+        /*
+         * The statistics of the simulated TMU and L2 caches, counted per accessed cache line
+         */
+        struct CacheStatistics
+        {
+            /*
+             * The number of cache line accesses hitting the TMU cache
+             */
+            unsigned numTMUCacheHits;
+            /*
+             * The number of cache line accesses missing the TMU cache (including the L2 cache misses)
+             */
+            unsigned numTMUCacheMisses;
+            /*
+             * The number of cache line accesses missing both the TMU and the L2 cache
+             */
+            unsigned numL2CacheMisses;
+            /*
+             * The number of cycles the TMU loads take longer due to cache misses
+             */
+            unsigned numMissPenaltyCycles;
+
+            CacheStatistics& operator+=(const CacheStatistics& other);
+
+            std::string to_string() const;
+        };
+
         /*
          * Contains the result of the automatic instrumentation taking place inside the emulator for a single
          * instruction
@@ -180,11 +341,27 @@ namespace vc4c
              * access or periphery)
              */
             unsigned numStalls;
+            /*
+             * Splits the stalls above by their cause: waiting for TMU loads, DMA loads, DMA stores, VPM reads, the
+             * hardware mutex or semaphores
+             */
+            unsigned numTMUStalls;
+            unsigned numDMALoadStalls;
+            unsigned numDMAStoreStalls;
+            unsigned numVPMStalls;
+            unsigned numMutexStalls;
+            unsigned numSemaphoreStalls;
+            /*
+             * The cache statistics for the TMU loads of the address written by this instruction
+             */
+            CacheStatistics cacheStatistics;
             /*
              * Counts the total number, this instruction was executed
              */
             unsigned numExecutions;
 
+            InstrumentationResult& operator+=(const InstrumentationResult& other);
+
             std::string to_string() const;
         };
 
@@ -202,6 +379,15 @@ namespace vc4c
              * execution limit (false)
              */
             bool executionSuccessful = false;
+            /*
+             * Whether the emulation was stopped at the stop cycle or instruction before completing the execution
+             */
+            bool executionStopped = false;
+            /*
+             * The number of cycles the emulation took. For independently emulated work-groups, this is the sum of the
+             * cycles of all work-groups
+             */
+            uint64_t numCycles = 0;
             /*
              * The final contents of the parameter passed to the emulation (e.g. for output-parameter).
              */
@@ -211,6 +397,12 @@ namespace vc4c
              * the indices of the instruction in the executed kernel
              */
             std::vector<InstrumentationResult> instrumentation{};
+            /*
+             * The cache statistics of the TMU loads from the buffers of the parameters (with the same indices as the
+             * parameters, empty for direct parameters) and from the global data
+             */
+            std::vector<CacheStatistics> parameterCacheStatistics{};
+            CacheStatistics globalDataCacheStatistics{};
         };
 
         /*
@@ -227,6 +419,11 @@ namespace vc4c
              * execution limit (false)
              */
             bool executionSuccessful = false;
+            /*
+             * The number of cycles the emulation took. For independently emulated work-groups, this is the sum of the
+             * cycles of all work-groups
+             */
+            uint64_t numCycles = 0;
             /*
              * The instrumentation result for the emulation run. The indices of the instrumentation result correspond to
              * the indices of the instruction in the executed kernel
@@ -234,6 +431,99 @@ namespace vc4c
             std::vector<InstrumentationResult> instrumentation{};
         };
 
+        /*
+         * A single configuration of a batch emulation: a kernel compiled with the given options, which is emulated for
+         * all combinations of the given parameter sets and work-group configurations
+         */
+        struct BatchConfiguration
+        {
+            /*
+             * The input file to compile (e.g. OpenCL C source) or the already compiled module
+             */
+            std::string inputFile;
+            /*
+             * The options to compile the input with, both the options of the compiler itself (e.g. optimization
+             * flags) and the options passed to the pre-compiler. Ignored for already compiled modules
+             */
+            std::string compilationOptions;
+            /*
+             * The name of the kernel to emulate, can be empty for modules with a single kernel
+             */
+            std::string kernelName;
+            /*
+             * The named parameter sets to run the kernel with, in the same format as EmulationData#parameter
+             */
+            std::vector<std::pair<std::string, std::vector<std::pair<uint32_t, Optional<std::vector<uint32_t>>>>>>
+                parameterSets;
+            /*
+             * The work-group configurations to run the kernel with
+             */
+            std::vector<WorkGroupConfig> workGroups;
+            /*
+             * The maximum number of cycles to execute a single run before terminating it
+             */
+            uint32_t maxEmulationCycles = std::numeric_limits<uint32_t>::max();
+            /*
+             * The timing model to calculate the stalls of accessing the periphery with
+             */
+            TimingModel timing;
+        };
+
+        /*
+         * The result of a single run of a batch emulation
+         */
+        struct BatchResult
+        {
+            /*
+             * The indices of the configuration, of its parameter set and of its work-group configuration of this run
+             */
+            std::size_t configurationIndex;
+            std::size_t parameterSetIndex;
+            std::size_t workGroupIndex;
+            /*
+             * Whether the emulation completed within the cycle limit
+             */
+            bool executionSuccessful = false;
+            /*
+             * The error compiling the configuration or emulating the run, empty on success
+             */
+            std::string error;
+            /*
+             * The number of cycles of the run, see EmulationResult#numCycles
+             */
+            uint64_t numCycles = 0;
+            /*
+             * The number of instructions in the kernel code and the number of instructions executed (excluding the
+             * stalled cycles) and stalled cycles, summed up over all QPUs
+             */
+            std::size_t numInstructions = 0;
+            uint64_t numExecutedInstructions = 0;
+            uint64_t numStallCycles = 0;
+            /*
+             * The checksums (64-bit FNV-1a) of the final contents of all parameters (zero for direct parameters), e.g.
+             * to compare the output of different configurations
+             */
+            std::vector<uint64_t> checksums;
+        };
+
+        /*
+         * Runs all combinations of the given batch configurations and returns the results in the order of the
+         * configurations, parameter sets and work-group configurations.
+         *
+         * Each configuration is compiled once, the single runs are emulated in parallel on the given number of host
+         * threads (zero for all hardware threads). Errors are reported in the result of the affected runs.
+         */
+        std::vector<BatchResult> emulateBatch(
+            const std::vector<BatchConfiguration>& configurations, uint32_t numThreads = 0);
+
+        /*
+         * Writes the results of the batch emulation as CSV table or JSON array into the given stream
+         */
+        void writeBatchResultsCSV(std::ostream& output, const std::vector<BatchConfiguration>& configurations,
+            const std::vector<BatchResult>& results);
+        void writeBatchResultsJSON(std::ostream& output, const std::vector<BatchConfiguration>& configurations,
+            const std::vector<BatchResult>& results);
+
         /*
          * Runs the emulation and returns the result.
          *
@@ -112,8 +112,8 @@ std::size_t Compiler::convert()
     const auto f = [&codeGen](Method* kernelFunc) -> void { codeGen.toMachineCode(*kernelFunc); };
     ThreadPool{"CodeGenerator"}.scheduleAll<Method*>(kernels, f);
 
-    // TODO could discard unused globals
-    // since they are exported, they are still in the intermediate code, even if not used (e.g. optimized away)
+    // NOTE: globals not accessed by any kernel are already discarded in the normalization (see compactGlobalData), but
+    // globals whose accesses are optimized away afterwards are still written, since their addresses are already fixed
 
     // code generation
     std::size_t bytesWritten = codeGen.writeOutput(output);
@@ -62,6 +62,11 @@ bool CompoundConstant::isZeroInitializer() const
     return true;
 }
 
+bool CompoundConstant::operator==(const CompoundConstant& other) const
+{
+    return type == other.type && elements == other.elements;
+}
+
 Optional<Literal> CompoundConstant::getScalar() const noexcept
 {
     if(auto lit = VariantNamespace::get_if<Literal>(&elements))
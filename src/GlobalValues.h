@@ -62,6 +62,11 @@ namespace vc4c
 
         std::string to_string(bool withContent = false) const;
 
+        /*
+         * Two compound constants are equal, if they have the same type and all their elements are equal
+         */
+        bool operator==(const CompoundConstant& other) const;
+
         DataType type;
 
     private:
@@ -35,6 +35,12 @@ namespace vc4c
          * The global data within this module
          */
         StableList<Global> globalData;
+        /*
+         * The global data removed from the global data segment, since it is not accessed by any kernel.
+         *
+         * These objects are still kept alive, since they might be referenced by not in-lined functions.
+         */
+        StableList<Global> discardedGlobalData;
         /*
          * The module's methods
          */
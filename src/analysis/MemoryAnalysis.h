@@ -32,7 +32,9 @@ namespace vc4c
             // keep in RAM/global data segment, read via TMU
             RAM_LOAD_TMU,
             // keep in RAM/global data segment, access via VPM
-            RAM_READ_WRITE_VPM
+            RAM_READ_WRITE_VPM,
+            // keep in RAM/global data segment, prefetch once into VPM and read from VPM
+            RAM_READ_CACHED_VPM
         };
 
         /**
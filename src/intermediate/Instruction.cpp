@@ -65,6 +65,8 @@ std::string intermediate::toString(const InstructionDecorations decoration)
         res.append("exact ");
     if(has_flag(decoration, InstructionDecorations::LOOP_INVARIANT))
         res.append("invariant ");
+    if(has_flag(decoration, InstructionDecorations::ASYNCHRONOUS_COPY))
+        res.append("async ");
     return res.substr(0, res.empty() ? 0 : res.size() - 1);
 }
 LCOV_EXCL_STOP
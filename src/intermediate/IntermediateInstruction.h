@@ -83,7 +83,10 @@ namespace vc4c
             // inside the loop. I.e. an instruction which calculates the same result for every loop iteration.
             // NOTE: The invariance marker does not distinguish between nested loops, so an instruction invariant for a
             // nested loop might not be invariant for its parent loop!
-            LOOP_INVARIANT = 1u << 24u
+            LOOP_INVARIANT = 1u << 24u,
+            // A memory copy which does not need to be finished directly after the instruction, but only at the next
+            // synchronization point, e.g. the DMA transfers for async_work_group_copy().
+            ASYNCHRONOUS_COPY = 1u << 25u
         };
 
         std::string toString(InstructionDecorations decoration);
@@ -211,6 +211,9 @@ static IntrinsicFunction intrinsifyDMAAccess(DMAAccess access, bool setMutex)
                     << logging::endl);
             it.emplace(new MemoryInstruction(MemoryOperation::COPY, Value(callSite->assertArgument(0)),
                 Value(callSite->assertArgument(1)), callSite->getArgument(2).value_or(INT_ONE), setMutex));
+            // The DMA copy is only used by the standard-library to implement async_work_group_(strided_)copy(), which
+            // only needs to be completed at the next wait_group_events()
+            it->addDecorations(InstructionDecorations::ASYNCHRONOUS_COPY);
             it.nextInBlock();
             break;
         }
@@ -67,6 +67,20 @@ static void printHelp()
               << "\tThe maximum number of iterations to repeat the optimizations in" << std::endl;
     std::cout << "\t--fcommon-subexpression-threshold=" << defaultConfig.additionalOptions.maxCommonExpressionDinstance
               << "\tThe maximum distance for two common subexpressions to be combined" << std::endl;
+    std::cout << "\t--fcombine-window=" << defaultConfig.additionalOptions.combineWindowSize
+              << "\tThe number of instructions to search for the optimal pairing of ALU instructions (at most 16)"
+              << std::endl;
+    std::cout << "\t--fvpm-read-cache-size=" << defaultConfig.additionalOptions.vpmReadCacheSize
+              << "\tThe maximum size in bytes of read-only memory to be cached in VPM (for -O3), 0 to disable"
+              << std::endl;
+    std::cout << "\t--fvpm-work-group-cache-size=" << defaultConfig.additionalOptions.vpmWorkGroupCacheSize
+              << "\tThe maximum size in bytes of global memory accessed by a work-group to be transferred in a single "
+                 "DMA (for -O3), 0 to disable"
+              << std::endl;
+    std::cout << "\t--fvpm-work-group-buffers=" << defaultConfig.additionalOptions.vpmWorkGroupBuffers
+              << "\tThe number of VPM buffers per global memory block accessed by a work-group, 2 to load the next "
+                 "work-group's read-only data while executing the current one"
+              << std::endl;
 
     std::cout << "options:" << std::endl;
     std::cout << "\t--kernel-info\t\tWrite the kernel-info meta-data (as required by VC4CL run-time, default)"
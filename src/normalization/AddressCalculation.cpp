@@ -26,6 +26,8 @@ MemoryAccessType normalization::toMemoryAccessType(periphery::VPMUsage usage)
     case periphery::VPMUsage::REGISTER_SPILLING:
     case periphery::VPMUsage::STACK:
         return MemoryAccessType::VPM_PER_QPU;
+    case periphery::VPMUsage::READ_CACHE:
+        return MemoryAccessType::RAM_READ_CACHED_VPM;
     }
     throw CompilationError(CompilationStep::NORMALIZER,
         "Unknown VPM usage type to map to memory type: ", std::to_string(static_cast<int>(usage)));
@@ -64,6 +66,62 @@ InstructionWalker normalization::insertAddressToOffset(InstructionWalker it, Met
     return it;
 }
 
+static Optional<int32_t> getConstantOffsetPart(const Value& val)
+{
+    if(auto lit = val.getLiteralValue())
+        return lit->signedInt();
+    if(auto writer = val.getSingleWriter())
+    {
+        auto offset = writer->precalculate(8).first;
+        if(offset && offset->getLiteralValue())
+            return offset->getLiteralValue()->signedInt();
+    }
+    return {};
+}
+
+Optional<unsigned> normalization::getConstantAddressOffset(const Local* baseAddress, const Value& ptrValue)
+{
+    if(ptrValue.hasLocal(baseAddress))
+        return 0u;
+    auto loc = ptrValue.checkLocal();
+    if(!loc)
+        return {};
+    // for stores, the store itself is also a write instruction. Any other memory instruction (e.g. loading the pointer
+    // from memory, copying or filling memory) actually changes the value
+    const LocalUser* writer = nullptr;
+    for(auto user : loc->getUsers(LocalUse::Type::WRITER))
+    {
+        auto mem = dynamic_cast<const MemoryInstruction*>(user);
+        if(mem && mem->op == MemoryOperation::WRITE && mem->getDestination().hasLocal(loc) &&
+            !mem->getSource().hasLocal(loc))
+            continue;
+        if(writer || user->hasConditionalExecution())
+            return {};
+        writer = user;
+    }
+    if(!writer)
+        return {};
+    if(auto move = dynamic_cast<const MoveOperation*>(writer))
+    {
+        if(dynamic_cast<const VectorRotation*>(move))
+            return {};
+        return getConstantAddressOffset(baseAddress, move->getSource());
+    }
+    auto op = dynamic_cast<const Operation*>(writer);
+    if(!op || op->op != OP_ADD || !op->getSecondArg())
+        return {};
+    for(const auto& args : {std::make_pair(op->getFirstArg(), op->assertArgument(1)),
+            std::make_pair(op->assertArgument(1), op->getFirstArg())})
+    {
+        auto offset = getConstantOffsetPart(args.second);
+        if(!offset || *offset < 0)
+            continue;
+        if(auto baseOffset = getConstantAddressOffset(baseAddress, args.first))
+            return *baseOffset + static_cast<unsigned>(*offset);
+    }
+    return {};
+}
+
 InstructionWalker normalization::insertAddressToStackOffset(InstructionWalker it, Method& method, Value& out,
     const Local* baseAddress, MemoryAccessType type, const MemoryInstruction* mem, const Value& ptrValue)
 {
@@ -132,6 +190,95 @@ InstructionWalker normalization::insertAddressToWorkItemSpecificOffset(
     return it;
 }
 
+static bool isWorkGroupUniformBuiltin(const Local* local)
+{
+    return local->name == Method::WORK_DIMENSIONS || local->name == Method::LOCAL_SIZES ||
+        local->name == Method::NUM_GROUPS_X || local->name == Method::NUM_GROUPS_Y ||
+        local->name == Method::NUM_GROUPS_Z || local->name == Method::GROUP_ID_X || local->name == Method::GROUP_ID_Y ||
+        local->name == Method::GROUP_ID_Z || local->name == Method::GLOBAL_OFFSET_X ||
+        local->name == Method::GLOBAL_OFFSET_Y || local->name == Method::GLOBAL_OFFSET_Z ||
+        local->name == Method::GLOBAL_DATA_ADDRESS;
+}
+
+// the maximum number of instructions to follow back for re-calculating a work-group uniform value
+static constexpr unsigned MAX_RECALCULATION_DEPTH = 8;
+
+static const IntermediateInstruction* getRecalculatableWriter(const Value& val)
+{
+    auto writer = val.getSingleWriter();
+    if(!writer || writer->hasConditionalExecution() || writer->hasSideEffects() || writer->hasPackMode() ||
+        writer->hasUnpackMode())
+        return nullptr;
+    if(dynamic_cast<const Operation*>(writer))
+        return writer;
+    if(dynamic_cast<const MoveOperation*>(writer) && !dynamic_cast<const VectorRotation*>(writer))
+        return writer;
+    return nullptr;
+}
+
+static bool canRecalculate(const Value& val, unsigned depth)
+{
+    if(val.checkLiteral() || val.checkImmediate())
+        return true;
+    auto loc = val.checkLocal();
+    if(!loc)
+        return false;
+    if(loc->is<Parameter>() || isWorkGroupUniformBuiltin(loc))
+        return true;
+    auto writer = getRecalculatableWriter(val);
+    if(!writer || depth >= MAX_RECALCULATION_DEPTH)
+        return false;
+    return std::all_of(writer->getArguments().begin(), writer->getArguments().end(),
+        [&](const Value& arg) -> bool { return canRecalculate(arg, depth + 1); });
+}
+
+bool normalization::canRecalculateWorkGroupUniformValue(const Value& val)
+{
+    return canRecalculate(val, 0);
+}
+
+static Value recalculate(InstructionWalker& it, Method& method, const Value& val, FastMap<const Local*, Value>& cache)
+{
+    auto loc = val.checkLocal();
+    if(!loc)
+        return val;
+    // check the cache first to also apply the replacements of built-in values
+    auto cacheIt = cache.find(loc);
+    if(cacheIt != cache.end())
+        return cacheIt->second;
+    if(loc->is<Parameter>() || isWorkGroupUniformBuiltin(loc))
+        return val;
+    auto writer = getRecalculatableWriter(val);
+    if(!writer)
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Cannot re-calculate work-group uniform value", val.to_string());
+    auto copy = method.addNewLocal(val.type, loc->name);
+    if(auto op = dynamic_cast<const Operation*>(writer))
+    {
+        auto arg0 = recalculate(it, method, op->getFirstArg(), cache);
+        if(auto secondArg = op->getSecondArg())
+        {
+            auto arg1 = recalculate(it, method, *secondArg, cache);
+            it.emplace(new Operation(op->op, copy, arg0, arg1));
+        }
+        else
+            it.emplace(new Operation(op->op, copy, arg0));
+    }
+    else
+        it.emplace(new MoveOperation(copy, recalculate(it, method, writer->assertArgument(0), cache)));
+    it->addDecorations(writer->decoration);
+    it.nextInBlock();
+    cache.emplace(loc, copy);
+    return copy;
+}
+
+InstructionWalker normalization::insertRecalculateWorkGroupUniformValue(
+    InstructionWalker it, Method& method, Value& out, const Value& val, FastMap<const Local*, Value> replacements)
+{
+    out = recalculate(it, method, val, replacements);
+    return it;
+}
+
 bool LocalUsageOrdering::operator()(const Local* l1, const Local* l2) const
 {
     // prefer more usages over less usages
@@ -38,6 +38,14 @@ namespace vc4c
         NODISCARD InstructionWalker insertAddressToOffset(InstructionWalker it, Method& method, Value& out,
             const Local* baseAddress, const intermediate::MemoryInstruction* mem, const Value& ptrValue);
 
+        /*
+         * Determines the byte offset of the address (e.g. an index chain) relative to the given base address, if the
+         * offset is known at compile-time.
+         *
+         * Returns (char*)address - (char*)baseAddress or an empty value, if the offset depends on run-time values
+         */
+        Optional<unsigned> getConstantAddressOffset(const Local* baseAddress, const Value& ptrValue);
+
         /*
          * Converts an address (e.g. an index-chain) and a base-address to the offset of the vector denoting the element
          * accessed by the index-chain. In addition to #insertAddressToOffset, this function also handles multiple
@@ -75,6 +83,26 @@ namespace vc4c
         NODISCARD InstructionWalker insertAddressToWorkItemSpecificOffset(
             InstructionWalker it, Method& method, Value& out, MemoryAccessRange& range);
 
+        /*
+         * Returns whether the given work-group uniform value can be re-calculated at any point in the kernel, e.g. at
+         * the beginning of the kernel before it is originally calculated.
+         *
+         * This is the case, if the value only depends on constants, parameters and the work-group uniform built-in
+         * values (e.g. the group ID or the local size) via simple arithmetic operations.
+         */
+        bool canRecalculateWorkGroupUniformValue(const Value& val);
+
+        /*
+         * Inserts the instructions to re-calculate the given work-group uniform value at the given position.
+         *
+         * The optional replacements are used instead of the original values of the given locals, e.g. to calculate
+         * the value for another work-group by replacing the group IDs.
+         *
+         * NOTE: The value needs to be re-calculatable as determined by #canRecalculateWorkGroupUniformValue
+         */
+        NODISCARD InstructionWalker insertRecalculateWorkGroupUniformValue(InstructionWalker it, Method& method,
+            Value& out, const Value& val, FastMap<const Local*, Value> replacements = {});
+
         struct LocalUsageOrdering
         {
             bool operator()(const Local* l1, const Local* l2) const;
@@ -798,6 +798,452 @@ void normalization::resolveStackAllocation(
  */
 /* clang-format on */
 
+// the semaphore used to signal the availability of the prefetched VPM read cache and work-group blocks to the other
+// work-items
+static constexpr Semaphore READ_CACHE_SEMAPHORE = Semaphore::BARRIER_SFU_SLICE_3;
+// the semaphore used to signal the first work-item that the other work-items finished accessing the work-group blocks
+static constexpr Semaphore WORK_GROUP_BLOCK_SEMAPHORE = Semaphore::BARRIER_SFU_SLICE_2;
+// The barrier() implementation of the VC4CL standard library uses the semaphores with the local ID of the work-items,
+// so the semaphores used here must not be in this range.
+static_assert(static_cast<unsigned>(READ_CACHE_SEMAPHORE) >= NUM_QPUS &&
+        static_cast<unsigned>(WORK_GROUP_BLOCK_SEMAPHORE) >= NUM_QPUS &&
+        READ_CACHE_SEMAPHORE != WORK_GROUP_BLOCK_SEMAPHORE,
+    "The semaphores used for VPM caching collide with the barrier semaphores");
+
+/*
+ * Returns whether the memory area is accessed by the work-group as a block of RAM cached in VPM, see
+ * #checkWorkGroupBlockAccess
+ */
+static bool isWorkGroupBlock(const MemoryInfo& info)
+{
+    return info.type == MemoryAccessType::VPM_SHARED_ACCESS && info.ranges && info.area && info.area->isPacked;
+}
+
+/*
+ * Returns the number of bytes of the block of RAM accessed by the work-group, which is the maximum offset accessed
+ */
+static unsigned getWorkGroupBlockSize(const MemoryInfo& info)
+{
+    int64_t maxOffset = 0;
+    for(const auto& range : *info.ranges)
+        maxOffset = std::max(maxOffset, range.offsetRange.maxValue);
+    return (static_cast<unsigned>(maxOffset) + 1 /* bounds are inclusive */) * static_cast<unsigned>(sizeof(uint32_t));
+}
+
+/*
+ * Returns whether the block of RAM accessed by the work-group is written by any work-item and therefore needs to be
+ * written back
+ */
+static bool isWrittenWorkGroupBlock(const MemoryInfo& info)
+{
+    return isWorkGroupBlock(info) && info.writtenRange;
+}
+
+/*
+ * Returns the size in bytes of a single buffer of a double-buffered block of RAM accessed by the work-group. The
+ * buffers start at new rows, see #checkWorkGroupBlockAccess
+ */
+static unsigned getWorkGroupBufferSize(const MemoryInfo& info)
+{
+    // a VPM row contains 16 32-bit words
+    static constexpr unsigned ROW_SIZE = NATIVE_VECTOR_SIZE * sizeof(uint32_t);
+    return ((getWorkGroupBlockSize(info) + ROW_SIZE - 1) / ROW_SIZE) * ROW_SIZE;
+}
+
+/*
+ * Calculates the address of the block of RAM accessed by the current work-group, which is the base address plus the
+ * work-group uniform part of all accesses.
+ *
+ * If group IDs are given, the address of the block of the work-group with these IDs is calculated instead.
+ */
+static InstructionWalker insertWorkGroupBlockAddress(Method& method, InstructionWalker it, Value& out,
+    const MemoryInfo& info, const FastMap<const Local*, Value>& groupIds = {})
+{
+    out = info.local->createReference();
+    for(const auto& part : info.ranges->front().groupUniformAddressParts)
+    {
+        Value offset = UNDEFINED_VALUE;
+        it = insertRecalculateWorkGroupUniformValue(it, method, offset, part.first, groupIds);
+        offset = assign(it, TYPE_INT32, "%block_offset") = (offset << 2_val, part.second);
+        out = assign(it, out.type, "%block_address") = out + offset;
+    }
+    return it;
+}
+
+/*
+ * Calculates the offsets of the buffers used by the current work-group for all double-buffered blocks of RAM accessed
+ * by the work-group.
+ *
+ * The buffers alternate between consecutive work-groups (in the order of the work-group loop), so the buffer is
+ * selected by the parity of the linear work-group index. Since the parity of a sum (product) is the XOR (AND) of the
+ * parities of the operands, this does not require any multiplication:
+ * parity(x + nx * (y + ny * z)) = parity(x) ^ (parity(nx) & (parity(y) ^ (parity(ny) & parity(z))))
+ */
+static InstructionWalker insertWorkGroupBufferOffsets(
+    Method& method, InstructionWalker it, const SortedMap<const Local*, const MemoryInfo*, LocalUsageOrdering>& blocks)
+{
+    auto groupIdX = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_X)->createReference();
+    auto groupIdY = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Y)->createReference();
+    auto groupIdZ = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Z)->createReference();
+    auto numGroupsX = method.findOrCreateLocal(TYPE_INT32, Method::NUM_GROUPS_X)->createReference();
+    auto numGroupsY = method.findOrCreateLocal(TYPE_INT32, Method::NUM_GROUPS_Y)->createReference();
+
+    auto parity = assign(it, TYPE_INT32, "%group_parity") = numGroupsY & groupIdZ;
+    parity = assign(it, TYPE_INT32, "%group_parity") = groupIdY ^ parity;
+    parity = assign(it, TYPE_INT32, "%group_parity") = numGroupsX & parity;
+    parity = assign(it, TYPE_INT32, "%group_parity") = groupIdX ^ parity;
+    parity = assign(it, TYPE_INT32, "%group_parity") = parity & INT_ONE;
+    // 0 for even, all bits set for odd work-groups
+    auto mask = assign(it, TYPE_INT32, "%buffer_mask") = INT_ZERO - parity;
+    for(const auto& pair : blocks)
+    {
+        if(!pair.second->isDoubleBuffered)
+            continue;
+        Value bufferSize(Literal(getWorkGroupBufferSize(*pair.second)), TYPE_INT32);
+        assign(it, getWorkGroupBufferOffset(method, *pair.second)) =
+            (mask & bufferSize, InstructionDecorations::UNSIGNED_RESULT);
+    }
+    return it;
+}
+
+/*
+ * Starts loading the double-buffered blocks of RAM for the next work-group (in the order of the work-group loop, see
+ * optimizations::addWorkGroupLoop) into the buffers not used by the current work-group.
+ *
+ * The last DMA load is not waited for, it is finished in the background while the current work-group is executed and
+ * only waited for before the next work-group starts accessing the blocks. The last work-group loads the blocks of the
+ * first work-group, which are never used, to not access any memory outside of the buffers.
+ */
+static InstructionWalker insertNextWorkGroupPrefetch(
+    Method& method, InstructionWalker it, const SortedMap<const Local*, const MemoryInfo*, LocalUsageOrdering>& blocks)
+{
+    auto groupIdX = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_X);
+    auto groupIdY = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Y);
+    auto groupIdZ = method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Z);
+    auto numGroupsX = method.findOrCreateLocal(TYPE_INT32, Method::NUM_GROUPS_X)->createReference();
+    auto numGroupsY = method.findOrCreateLocal(TYPE_INT32, Method::NUM_GROUPS_Y)->createReference();
+    auto numGroupsZ = method.findOrCreateLocal(TYPE_INT32, Method::NUM_GROUPS_Z)->createReference();
+
+    // the next work-group increments the x dimension and carries over into the y and z dimensions
+    auto nextIdX = assign(it, TYPE_INT32, "%next_group_id_x") = groupIdX->createReference() + INT_ONE;
+    auto incrementedIdY = assign(it, TYPE_INT32, "%next_group_id_y") = groupIdY->createReference() + INT_ONE;
+    auto incrementedIdZ = assign(it, TYPE_INT32, "%next_group_id_z") = groupIdZ->createReference() + INT_ONE;
+    auto nextIdY = assign(it, TYPE_INT32, "%next_group_id_y") = groupIdY->createReference();
+    auto nextIdZ = assign(it, TYPE_INT32, "%next_group_id_z") = groupIdZ->createReference();
+
+    auto cond = assignNop(it) = as_unsigned{nextIdX} == as_unsigned{numGroupsX};
+    assign(it, nextIdX) = (INT_ZERO, cond);
+    assign(it, nextIdY) = (incrementedIdY, cond);
+    cond = assignNop(it) = as_unsigned{nextIdY} == as_unsigned{numGroupsY};
+    assign(it, nextIdY) = (INT_ZERO, cond);
+    assign(it, nextIdZ) = (incrementedIdZ, cond);
+    cond = assignNop(it) = as_unsigned{nextIdZ} == as_unsigned{numGroupsZ};
+    assign(it, nextIdZ) = (INT_ZERO, cond);
+
+    FastMap<const Local*, Value> nextGroupIds{{groupIdX, nextIdX}, {groupIdY, nextIdY}, {groupIdZ, nextIdZ}};
+    for(const auto& pair : blocks)
+    {
+        if(!pair.second->isDoubleBuffered)
+            continue;
+        Value address = UNDEFINED_VALUE;
+        it = insertWorkGroupBlockAddress(method, it, address, *pair.second, nextGroupIds);
+        auto bufferSize = getWorkGroupBufferSize(*pair.second);
+        auto nextOffset = assign(it, TYPE_INT32, "%next_buffer_offset") =
+            (Value(Literal(bufferSize), TYPE_INT32) - getWorkGroupBufferOffset(method, *pair.second),
+                InstructionDecorations::UNSIGNED_RESULT);
+        auto numBytes = getWorkGroupBlockSize(*pair.second);
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Prefetching " << numBytes << " bytes block of '" << pair.first->to_string()
+                << "' accessed by the next work-group into VPM: " << pair.second->area->to_string() << logging::endl);
+        it = method.vpm->insertPrefetchRAM(method, it, address, *pair.second->area, numBytes, true, nextOffset);
+    }
+    return it;
+}
+
+/*
+ * Inserts the prefetching of all memory areas cached in the VPM read cache as well as the loading of the blocks of RAM
+ * accessed by the work-group at the beginning of the kernel.
+ *
+ * If the work-group size is fixed, only the first work-item of the work-group loads the data and then signals the
+ * other work-items that the data is available:
+ *
+ * %vpm_cache_check:
+ *   - if local_id == 0 then br %vpm_cache_load
+ * %vpm_cache_wait:
+ *   - decrement semaphore
+ *   - br %start_of_kernel
+ * %vpm_cache_load:
+ *   - prefetch data into VPM
+ *   - increment semaphore (work-group size - 1) times
+ * %start_of_kernel:
+ *   [original kernel code]
+ *
+ * Otherwise every work-item prefetches the data itself. Since all work-items load the same data and the cache is
+ * never written to afterwards, it does not matter if the data is overwritten by another work-item.
+ *
+ * If the blocks of RAM accessed by the work-group are double-buffered, only the first work-group loads its blocks
+ * itself, all other work-groups use the blocks already loaded by the previous work-group:
+ *
+ * %vpm_cache_check:
+ *   - calculate buffer offsets
+ *   - if local_id == 0 then br %vpm_cache_load
+ * %vpm_cache_wait:
+ *   [...]
+ * %vpm_cache_load:
+ *   - if not first work-group then br %vpm_cache_prefetched
+ * %vpm_cache_load_first:
+ *   - load blocks into VPM
+ * %vpm_cache_prefetched:
+ *   - prefetch other data into VPM
+ *   - increment semaphore (work-group size - 1) times
+ *   - load the blocks of the next work-group into the other buffers
+ * %start_of_kernel:
+ *   [original kernel code]
+ */
+static void insertVPMCachePrefetch(Method& method, const FastMap<const Local*, MemoryInfo>& infos)
+{
+    SortedMap<const Local*, const MemoryInfo*, LocalUsageOrdering> cachedAreas;
+    bool hasDoubleBuffers = false;
+    for(const auto& info : infos)
+    {
+        if(info.second.type == MemoryAccessType::RAM_READ_CACHED_VPM || isWorkGroupBlock(info.second))
+        {
+            cachedAreas.emplace(info.first, &info.second);
+            hasDoubleBuffers = hasDoubleBuffers || (isWorkGroupBlock(info.second) && info.second.isDoubleBuffered);
+        }
+    }
+    if(cachedAreas.empty())
+        return;
+
+    // loads either only the double-buffered or all other areas
+    auto insertPrefetches = [&](InstructionWalker it, bool doubleBuffered) -> InstructionWalker {
+        for(const auto& pair : cachedAreas)
+        {
+            if((isWorkGroupBlock(*pair.second) && pair.second->isDoubleBuffered) != doubleBuffered)
+                continue;
+            if(isWorkGroupBlock(*pair.second))
+            {
+                if(auto param = pair.first->as<Parameter>())
+                    const_cast<Parameter*>(param)->decorations =
+                        add_flag(param->decorations, ParameterDecorations::INPUT);
+                Value address = UNDEFINED_VALUE;
+                it = insertWorkGroupBlockAddress(method, it, address, *pair.second);
+                auto numBytes = getWorkGroupBlockSize(*pair.second);
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Loading " << numBytes << " bytes block of '" << pair.first->to_string()
+                        << "' accessed by work-group into VPM: " << pair.second->area->to_string() << logging::endl);
+                it = method.vpm->insertPrefetchRAM(method, it, address, *pair.second->area, numBytes, true,
+                    doubleBuffered ? getWorkGroupBufferOffset(method, *pair.second) : INT_ZERO);
+                continue;
+            }
+            auto numBytes = getStaticMemorySize(pair.first);
+            if(!numBytes)
+                throw CompilationError(CompilationStep::NORMALIZER,
+                    "Cannot prefetch memory area with unknown size into VPM", pair.first->to_string());
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Prefetching " << *numBytes << " bytes of '" << pair.first->to_string()
+                    << "' into VPM read cache: " << pair.second->area->to_string() << logging::endl);
+            it = method.vpm->insertPrefetchRAM(
+                method, it, pair.first->createReference(), *pair.second->area, *numBytes, true);
+        }
+        return it;
+    };
+
+    auto& bodyBlock = *method.begin();
+    const auto numWorkItems = method.metaData.isWorkGroupSizeSet() ? method.metaData.getWorkGroupSize() : 0u;
+    if(!hasDoubleBuffers && (numWorkItems <= 1 || numWorkItems > NUM_QPUS))
+    {
+        insertPrefetches(bodyBlock.walk().nextInBlock(), false);
+        return;
+    }
+
+    // NOTE: double-buffered blocks require a fixed work-group size of at most the number of QPUs
+    InstructionWalker checkIt;
+    InstructionWalker waitIt;
+    if(numWorkItems > 1)
+    {
+        checkIt = method.emplaceLabel(
+            bodyBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_check").local()));
+        waitIt = method.emplaceLabel(
+            bodyBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_wait").local()));
+    }
+    auto loadIt = method.emplaceLabel(
+        bodyBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_load").local()));
+
+    if(numWorkItems > 1)
+    {
+        // all local IDs are packed into a single value, so the first work-item is the one with all IDs set to zero
+        auto localIds = method.findOrCreateLocal(TYPE_INT32, Method::LOCAL_IDS)->createReference();
+        checkIt.nextInBlock();
+        if(hasDoubleBuffers)
+            checkIt = insertWorkGroupBufferOffsets(method, checkIt, cachedAreas);
+        auto cond = assignNop(checkIt) = as_unsigned{localIds} == as_unsigned{INT_ZERO};
+        auto condValue = method.addNewLocal(TYPE_BOOL, "%vpm_cache_leader");
+        assign(checkIt, condValue) = (BOOL_TRUE, cond);
+        assign(checkIt, condValue) = (BOOL_TRUE ^ BOOL_TRUE, cond.invert());
+        checkIt.emplace(new Branch(loadIt.getBasicBlock()->getLabel()->getLabel(), COND_ZERO_CLEAR, condValue));
+
+        waitIt.nextInBlock();
+        waitIt.emplace(new SemaphoreAdjustment(READ_CACHE_SEMAPHORE, false));
+        waitIt.nextInBlock();
+        waitIt.emplace(new Branch(bodyBlock.getLabel()->getLabel(), COND_ALWAYS, BOOL_TRUE));
+    }
+
+    loadIt.nextInBlock();
+    if(hasDoubleBuffers)
+    {
+        if(numWorkItems <= 1)
+            loadIt = insertWorkGroupBufferOffsets(method, loadIt, cachedAreas);
+        auto loadFirstIt = method.emplaceLabel(
+            bodyBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_load_first").local()));
+        auto prefetchedIt = method.emplaceLabel(
+            bodyBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_prefetched").local()));
+
+        // the work-group loop starts with all group IDs set to zero
+        auto groupIds = assign(loadIt, TYPE_INT32, "%group_ids") =
+            method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_X)->createReference() |
+            method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Y)->createReference();
+        groupIds = assign(loadIt, TYPE_INT32, "%group_ids") =
+            groupIds | method.findOrCreateLocal(TYPE_INT32, Method::GROUP_ID_Z)->createReference();
+        auto cond = assignNop(loadIt) = as_unsigned{groupIds} == as_unsigned{INT_ZERO};
+        auto condValue = method.addNewLocal(TYPE_BOOL, "%vpm_cache_prefetched");
+        assign(loadIt, condValue) = (BOOL_TRUE, cond.invert());
+        assign(loadIt, condValue) = (BOOL_TRUE ^ BOOL_TRUE, cond);
+        loadIt.emplace(new Branch(prefetchedIt.getBasicBlock()->getLabel()->getLabel(), COND_ZERO_CLEAR, condValue));
+
+        insertPrefetches(loadFirstIt.nextInBlock(), true);
+
+        loadIt = prefetchedIt.nextInBlock();
+    }
+    loadIt = insertPrefetches(loadIt, false);
+    for(unsigned i = 1; i < numWorkItems; ++i)
+    {
+        loadIt.emplace(new SemaphoreAdjustment(READ_CACHE_SEMAPHORE, true));
+        loadIt.nextInBlock();
+    }
+    if(hasDoubleBuffers)
+        loadIt = insertNextWorkGroupPrefetch(method, loadIt, cachedAreas);
+}
+
+/*
+ * Inserts the writing back of the blocks of RAM accessed by the work-group from VPM at the end of the kernel.
+ *
+ * Only blocks written by any work-item are written back and only the rows containing written words.
+ *
+ * Since the blocks are shared by all work-items of the group, the first work-item waits for all other work-items to
+ * finish their accesses before writing the data back. This is also done if all blocks are only read, since in the
+ * work-group loop, the first work-item would otherwise overwrite the blocks with the data of the next work-group while
+ * the other work-items still access them:
+ *
+ * %vpm_cache_store_check:
+ *   - if local_id == 0 then br %vpm_cache_store
+ * %vpm_cache_done:
+ *   - increment semaphore
+ *   - br %end_of_function
+ * %vpm_cache_store:
+ *   - decrement semaphore (work-group size - 1) times
+ *   - write written data back to RAM
+ * %end_of_function:
+ *   [...]
+ *
+ * NOTE: The work-group size is required to be fixed, see #checkWorkGroupBlockAccess
+ */
+static void insertWorkGroupBlockWriteBack(Method& method, const FastMap<const Local*, MemoryInfo>& infos)
+{
+    SortedMap<const Local*, const MemoryInfo*, LocalUsageOrdering> blocks;
+    for(const auto& info : infos)
+    {
+        if(isWorkGroupBlock(info.second))
+            blocks.emplace(info.first, &info.second);
+    }
+    if(blocks.empty())
+        return;
+
+    auto lastBlock = method.findBasicBlock(method.findLocal(BasicBlock::LAST_BLOCK));
+    if(!lastBlock)
+        throw CompilationError(CompilationStep::NORMALIZER, "Failed to find the default last block");
+    const auto numWorkItems = method.metaData.getWorkGroupSize();
+
+    auto storeIt = method.emplaceLabel(
+        lastBlock->walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_store").local()));
+    auto& storeBlock = *storeIt.getBasicBlock();
+    if(numWorkItems > 1)
+    {
+        auto checkIt = method.emplaceLabel(
+            storeBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_store_check").local()));
+        // all returns need to execute the write-back too
+        lastBlock->forPredecessors([&](InstructionWalker walker) {
+            auto branch = walker.get<Branch>();
+            if(branch && branch->getTarget() == lastBlock->getLabel()->getLabel())
+            {
+                // need to reset the instruction to correctly update the CFG
+                walker.reset((new Branch(checkIt.getBasicBlock()->getLabel()->getLabel(), branch->conditional,
+                                  branch->getCondition()))
+                                 ->copyExtrasFrom(branch));
+            }
+        });
+        auto doneIt = method.emplaceLabel(
+            storeBlock.walk(), new BranchLabel(*method.addNewLocal(TYPE_LABEL, "", "%vpm_cache_done").local()));
+
+        auto localIds = method.findOrCreateLocal(TYPE_INT32, Method::LOCAL_IDS)->createReference();
+        checkIt.nextInBlock();
+        auto cond = assignNop(checkIt) = as_unsigned{localIds} == as_unsigned{INT_ZERO};
+        auto condValue = method.addNewLocal(TYPE_BOOL, "%vpm_cache_leader");
+        assign(checkIt, condValue) = (BOOL_TRUE, cond);
+        assign(checkIt, condValue) = (BOOL_TRUE ^ BOOL_TRUE, cond.invert());
+        checkIt.emplace(new Branch(storeBlock.getLabel()->getLabel(), COND_ZERO_CLEAR, condValue));
+
+        doneIt.nextInBlock();
+        doneIt.emplace(new SemaphoreAdjustment(WORK_GROUP_BLOCK_SEMAPHORE, true));
+        doneIt.nextInBlock();
+        doneIt.emplace(new Branch(lastBlock->getLabel()->getLabel(), COND_ALWAYS, BOOL_TRUE));
+
+        storeIt.nextInBlock();
+        for(unsigned i = 1; i < numWorkItems; ++i)
+        {
+            storeIt.emplace(new SemaphoreAdjustment(WORK_GROUP_BLOCK_SEMAPHORE, false));
+            storeIt.nextInBlock();
+        }
+    }
+    else
+        storeIt.nextInBlock();
+
+    // a VPM row contains 16 32-bit words
+    static constexpr unsigned ROW_SIZE = NATIVE_VECTOR_SIZE * sizeof(uint32_t);
+    for(const auto& pair : blocks)
+    {
+        // blocks which are only read do not need to be written back
+        if(!isWrittenWorkGroupBlock(*pair.second))
+            continue;
+        if(auto param = pair.first->as<Parameter>())
+            const_cast<Parameter*>(param)->decorations = add_flag(param->decorations, ParameterDecorations::OUTPUT);
+        // only write back the rows containing written words, to not overwrite memory only read by this work-group
+        const auto& writtenRange = *pair.second->writtenRange;
+        auto startOffset = static_cast<unsigned>(writtenRange.minValue * sizeof(uint32_t) / ROW_SIZE * ROW_SIZE);
+        auto numBytes = static_cast<unsigned>(
+            (writtenRange.maxValue + 1 /* bounds are inclusive */) * static_cast<int64_t>(sizeof(uint32_t)) -
+            startOffset);
+
+        Value address = UNDEFINED_VALUE;
+        storeIt = insertWorkGroupBlockAddress(method, storeIt, address, *pair.second);
+        Value bufferOffset =
+            pair.second->isDoubleBuffered ? getWorkGroupBufferOffset(method, *pair.second) : INT_ZERO;
+        if(startOffset != 0)
+        {
+            address = assign(storeIt, address.type, "%block_address") =
+                address + Value(Literal(startOffset), TYPE_INT32);
+            bufferOffset = assign(storeIt, TYPE_INT32, "%block_offset") =
+                (bufferOffset + Value(Literal(startOffset), TYPE_INT32), InstructionDecorations::UNSIGNED_RESULT);
+        }
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Writing back " << numBytes << " bytes at offset " << startOffset << " of block of '"
+                << pair.first->to_string() << "' accessed by work-group from VPM: " << pair.second->area->to_string()
+                << logging::endl);
+        storeIt = method.vpm->insertWriteBackRAM(
+            method, storeIt, address, *pair.second->area, numBytes, true, bufferOffset);
+    }
+}
+
 void normalization::mapMemoryAccess(const Module& module, Method& method, const Configuration& config)
 {
     /*
@@ -862,12 +1308,168 @@ void normalization::mapMemoryAccess(const Module& module, Method& method, const
         // TODO mark local for prefetch/write-back (if necessary)
     }
 
+    insertVPMCachePrefetch(method, infos);
+    insertWorkGroupBlockWriteBack(method, infos);
+
     method.vpm->dumpUsage();
 
     // TODO move this to optimization?
     combineVPMAccess(affectedBlocks, method);
 
-    // TODO clean up no longer used (all kernels!) globals and stack allocations
+    // TODO clean up no longer used stack allocations
+}
+
+/*
+ * Returns whether the given instruction (and all instructions using values derived from its result) use the given
+ * address (a global or a value derived from the address of a global) only to access the memory it points to.
+ *
+ * Any other use, e.g. comparing the address, storing it into memory or calculating the distance to another address,
+ * makes the address observable, in which case the global cannot share its memory with another global.
+ */
+static bool isOnlyUsedAsAddress(
+    const IntermediateInstruction& inst, const Local* address, FastSet<const Local*>& derived)
+{
+    if(inst.doesSetFlag())
+        return false;
+    if(auto mem = dynamic_cast<const MemoryInstruction*>(&inst))
+    {
+        // the address may be read from, written to or copied from, but must not be the data written to memory
+        bool isWrite = mem->op == MemoryOperation::WRITE || mem->op == MemoryOperation::FILL;
+        bool isData = isWrite && mem->getSource().hasLocal(address);
+        return !isData && !mem->getNumEntries().hasLocal(address);
+    }
+    auto out = inst.getOutput();
+    if(!out)
+        return false;
+    if(auto reg = out->checkRegister())
+        // the address is used to load from or store to memory via the TMU or DMA
+        return *reg == REG_TMU0_ADDRESS || *reg == REG_TMU1_ADDRESS || *reg == REG_VPM_DMA_LOAD_ADDR ||
+            *reg == REG_VPM_DMA_STORE_ADDR;
+    auto outLocal = out->checkLocal();
+    if(!outLocal || outLocal->residesInMemory())
+        return false;
+    auto move = dynamic_cast<const MoveOperation*>(&inst);
+    auto op = dynamic_cast<const Operation*>(&inst);
+    if(op && (op->op == OP_ADD || (op->op == OP_SUB && op->getFirstArg().hasLocal(address))))
+    {
+        // the offset added to the address must not be an address itself
+        auto offset = op->getFirstArg().hasLocal(address) ? op->getSecondArg() : Optional<Value>(op->getFirstArg());
+        auto offsetLocal = offset ? offset->checkLocal() : nullptr;
+        if(!offset || offset->type.getPointerType() ||
+            (offsetLocal && (offsetLocal->residesInMemory() || derived.find(offsetLocal) != derived.end())))
+            return false;
+    }
+    else if(!move || !move->isSimpleMove())
+        return false;
+
+    if(!derived.emplace(outLocal).second)
+        // already checked (or currently checking) the uses of the derived address
+        return true;
+    bool onlyAddress = true;
+    outLocal->forUsers(LocalUse::Type::READER, [&](const LocalUser* user) {
+        onlyAddress = onlyAddress && isOnlyUsedAsAddress(*user, outLocal, derived);
+    });
+    return onlyAddress;
+}
+
+void normalization::compactGlobalData(Module& module)
+{
+    // 1. determine the globals whose address can be observed by any kernel
+    FastSet<const Global*> observedGlobals;
+    for(Method* kernel : module.getKernels())
+    {
+        for(auto it = kernel->walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+        {
+            if(!it.has())
+                continue;
+            for(const auto& arg : it->getArguments())
+            {
+                auto global = arg.checkLocal() ? arg.local()->as<Global>() : nullptr;
+                FastSet<const Local*> derivedAddresses;
+                if(global && !isOnlyUsedAsAddress(*it.get(), global, derivedAddresses))
+                    observedGlobals.emplace(global);
+            }
+        }
+    }
+
+    // 2. determine the constant globals which have the same content as a previous constant global. Only globals whose
+    // addresses cannot be observed can be merged, since distinct objects are required to have distinct addresses
+    FastMap<const Global*, Global*> duplicateGlobals;
+    for(auto it = module.globalData.begin(); it != module.globalData.end(); ++it)
+    {
+        if(!it->isConstant || observedGlobals.find(&*it) != observedGlobals.end())
+            continue;
+        for(auto other = module.globalData.begin(); other != it; ++other)
+        {
+            if(other->isConstant && other->type == it->type && other->initialValue == it->initialValue &&
+                duplicateGlobals.find(&*other) == duplicateGlobals.end() &&
+                observedGlobals.find(&*other) == observedGlobals.end())
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Merging constant global '" << it->name << "' with global of same content: " << other->name
+                        << logging::endl);
+                duplicateGlobals.emplace(&*it, &*other);
+                break;
+            }
+        }
+    }
+
+    // 3. collect all globals accessed by any kernel and redirect accesses to merged globals
+    FastSet<const Global*> usedGlobals;
+    for(Method* kernel : module.getKernels())
+    {
+        for(auto it = kernel->walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+        {
+            if(!it.has())
+                continue;
+            for(std::size_t i = 0; i < it->getArguments().size(); ++i)
+            {
+                const Value arg = it->assertArgument(i);
+                auto global = arg.checkLocal() ? arg.local()->as<Global>() : nullptr;
+                if(global == nullptr)
+                    continue;
+                auto dupIt = duplicateGlobals.find(global);
+                if(dupIt != duplicateGlobals.end())
+                {
+                    it->setArgument(i, Value(dupIt->second, arg.type));
+                    global = dupIt->second;
+                }
+                usedGlobals.emplace(global);
+            }
+            if(auto out = it->checkOutputLocal())
+            {
+                if(auto global = out->as<Global>())
+                    usedGlobals.emplace(global);
+            }
+        }
+    }
+
+    // 4. move all globals not accessed by any kernel out of the global data segment.
+    // The objects are spliced into another list to not invalidate any remaining references
+    auto it = module.globalData.begin();
+    while(it != module.globalData.end())
+    {
+        if(usedGlobals.find(&*it) == usedGlobals.end())
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Removing global not accessed by any kernel from global data: " << it->to_string()
+                    << logging::endl);
+            auto next = std::next(it);
+            module.discardedGlobalData.splice(module.discardedGlobalData.end(), module.globalData, it);
+            it = next;
+        }
+        else
+            ++it;
+    }
+
+    // 5. order the remaining globals by descending alignment to minimize the padding between them.
+    // Sorting the list keeps all element addresses valid and is stable for globals of the same alignment
+    module.globalData.sort([](const Global& first, const Global& second) -> bool {
+        return first.type.getPointerType()->getAlignment() > second.type.getPointerType()->getAlignment();
+    });
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Global data segment compacted to " << module.globalData.size() << " globals with "
+            << module.getGlobalDataOffset(nullptr).value_or(0) << " bytes" << logging::endl);
 }
 
 /*
@@ -47,6 +47,18 @@ namespace vc4c
          * This optimization-step also contains most of the optimizations for accessing VPM/RAM.
          */
         void mapMemoryAccess(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Compacts the global data segment of the module:
+         * - constant globals with the same type and content are merged into a single global, if their addresses
+         *   are only used to access their contents (e.g. never compared or stored)
+         * - globals which are not accessed by any kernel are removed from the global data segment
+         * - the remaining globals are ordered to reduce the padding required for their alignment
+         *
+         * NOTE: This step needs to run after the memory accesses of all kernels are mapped and before any address of a
+         * global is calculated (see #accessGlobalData), since it modifies the layout of the global data segment
+         */
+        void compactGlobalData(Module& module);
     } // namespace normalization
 } // namespace vc4c
 
@@ -7,10 +7,13 @@
 #include "MemoryMappings.h"
 
 #include "../GlobalValues.h"
+#include "../Module.h"
 #include "../Profiler.h"
+#include "../analysis/ControlFlowGraph.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "../intermediate/operators.h"
+#include "../optimization/Optimizer.h"
 #include "../periphery/VPM.h"
 #include "log.h"
 
@@ -28,13 +31,14 @@ static MemoryInfo canLowerToSharedVPMArea(Method& method, const Local* baseAddr,
 static MemoryInfo canMapToTMUReadOnly(Method& method, const Local* baseAddr, MemoryAccess& access);
 static MemoryInfo canMapToDMAReadWrite(Method& method, const Local* baseAddr, MemoryAccess& access);
 
-static constexpr MappingCheck CHECKS[6] = {
+static constexpr MappingCheck CHECKS[7] = {
     canLowerToRegisterReadOnly,  /* QPU_REGISTER_READONLY */
     canLowerToRegisterReadWrite, /* QPU_REGISTER_READWRITE */
     canLowerToPrivateVPMArea,    /* VPM_PER_QPU */
     canLowerToSharedVPMArea,     /* VPM_SHARED_ACCESS */
     canMapToTMUReadOnly,         /* RAM_LOAD_TMU */
-    canMapToDMAReadWrite         /* RAM_READ_WRITE_VPM */
+    canMapToDMAReadWrite,        /* RAM_READ_WRITE_VPM */
+    canMapToTMUReadOnly          /* RAM_READ_CACHED_VPM */
 };
 
 MemoryInfo normalization::checkMemoryMapping(Method& method, const Local* baseAddr, MemoryAccess& access)
@@ -95,6 +99,98 @@ static Optional<DataType> convertSmallArrayToRegister(const Local* local)
     return {};
 }
 
+// the maximum number of separate locals a private memory area is split into, to not increase register pressure too much
+static constexpr std::size_t MAX_SCALAR_REPLACEMENTS = 2 * NATIVE_VECTOR_SIZE;
+
+/*
+ * Determines the types of the elements a private memory area can be split into (scalar replacement of aggregates),
+ * indexed by their byte offset.
+ *
+ * This is the case if the address of the memory area does not escape (e.g. is not stored or compared) and all accesses
+ * are single reads/writes of simple types at offsets known at compile-time, which do not partially overlap.
+ *
+ * Since this changes which (and how many) registers are used by the kernel, it is only applied for full optimizations.
+ */
+static Optional<SortedMap<unsigned, DataType>> determineScalarReplacements(
+    const Method& method, const Local* baseAddr, const MemoryAccess& access)
+{
+    if(method.module.compilationConfig.optimizationLevel < OptimizationLevel::FULL ||
+        !baseAddr->is<StackAllocation>())
+        return {};
+
+    // check that the address (or any address derived from it) is only used to access the memory
+    FastSet<const Local*> addresses{baseAddr};
+    std::vector<const Local*> pendingAddresses{baseAddr};
+    while(!pendingAddresses.empty())
+    {
+        auto address = pendingAddresses.back();
+        pendingAddresses.pop_back();
+        for(const auto& user : address->getUsers())
+        {
+            if(dynamic_cast<const LifetimeBoundary*>(user.first))
+                continue;
+            // memory instructions are checked independent of whether they read or write the address (e.g. the
+            // destination of a memory copy or fill)
+            if(auto mem = dynamic_cast<const MemoryInstruction*>(user.first))
+            {
+                if(mem->op == MemoryOperation::READ && mem->getSource().hasLocal(address) &&
+                    !mem->getDestination().hasLocal(address))
+                    continue;
+                if(mem->op == MemoryOperation::WRITE && mem->getDestination().hasLocal(address) &&
+                    !mem->getSource().hasLocal(address))
+                    continue;
+                return {};
+            }
+            if(!user.second.readsLocal())
+                continue;
+            auto op = dynamic_cast<const Operation*>(user.first);
+            auto move = dynamic_cast<const MoveOperation*>(user.first);
+            auto output = user.first->checkOutputLocal();
+            if(output && ((op && op->op == OP_ADD) || (move && !dynamic_cast<const VectorRotation*>(move))))
+            {
+                if(addresses.emplace(output).second)
+                    pendingAddresses.push_back(output);
+                continue;
+            }
+            return {};
+        }
+    }
+
+    SortedMap<unsigned, DataType> elements;
+    for(auto it : access.accessInstructions)
+    {
+        auto mem = it.get<const MemoryInstruction>();
+        if(!mem || (mem->op != MemoryOperation::READ && mem->op != MemoryOperation::WRITE) ||
+            mem->getNumEntries() != INT_ONE)
+            return {};
+        const auto& address = mem->op == MemoryOperation::READ ? mem->getSource() : mem->getDestination();
+        const auto& valueType = mem->op == MemoryOperation::READ ? mem->getDestination().type : mem->getSource().type;
+        if(!valueType.isSimpleType())
+            return {};
+        auto offset = getConstantAddressOffset(baseAddr, address);
+        if(!offset)
+            return {};
+        auto elemIt = elements.emplace(*offset, valueType).first;
+        if(elemIt->second != valueType)
+            // the same memory is accessed as different types
+            return {};
+    }
+    if(elements.empty() || elements.size() > MAX_SCALAR_REPLACEMENTS)
+        return {};
+
+    // check that the accessed elements do not overlap
+    unsigned nextFreeOffset = 0;
+    for(const auto& element : elements)
+    {
+        if(element.first < nextFreeOffset)
+            return {};
+        nextFreeOffset = element.first + element.second.getInMemoryWidth();
+    }
+    if(nextFreeOffset > baseAddr->type.getElementType().getInMemoryWidth())
+        return {};
+    return elements;
+}
+
 static bool isMemoryOnlyRead(const Local* local)
 {
     auto base = local->getBase(true);
@@ -636,9 +732,34 @@ std::pair<MemoryAccessMap, FastSet<InstructionWalker>> normalization::determineM
         it.nextInMethod();
     }
 
+    for(auto& entry : mapping)
+    {
+        if(entry.second.preferred != MemoryAccessType::QPU_REGISTER_READWRITE &&
+            determineScalarReplacements(method, entry.first, entry.second))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Stack value '" << entry.first->to_string()
+                    << "' will be split into separate registers for all accessed elements" << logging::endl);
+            entry.second.fallback = entry.second.preferred;
+            entry.second.preferred = MemoryAccessType::QPU_REGISTER_READWRITE;
+        }
+    }
+
     return std::make_pair(std::move(mapping), std::move(allWalkers));
 }
 
+Optional<unsigned> normalization::getStaticMemorySize(const Local* baseAddr)
+{
+    if(auto global = baseAddr->as<Global>())
+        return global->initialValue.type.getInMemoryWidth();
+    if(auto param = baseAddr->as<Parameter>())
+    {
+        if(param->maxByteOffset < std::numeric_limits<unsigned>::max())
+            return static_cast<unsigned>(param->maxByteOffset);
+    }
+    return {};
+}
+
 static MemoryInfo canLowerToRegisterReadOnly(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
     // a) the global is a constant scalar/vector which fits into a single register
@@ -680,7 +801,20 @@ static MemoryInfo canLowerToRegisterReadWrite(Method& method, const Local* baseA
         return MemoryInfo{baseAddr, MemoryAccessType::QPU_REGISTER_READWRITE, nullptr, {},
             method.addNewLocal(baseAddr->type, "%lowered_stack")};
     }
-    // b) the private memory is small enough to be rewritten to fit into a single register (e.g. int[4])
+    // b) all accesses to the private memory have constant offsets, so every accessed element can be mapped to its own
+    // register (scalar replacement of aggregates)
+    if(auto elements = determineScalarReplacements(method, baseAddr, access))
+    {
+        if(auto stackAllocation = baseAddr->as<StackAllocation>())
+            const_cast<StackAllocation*>(stackAllocation)->isLowered = true;
+        FastMap<unsigned, Value> replacements;
+        replacements.reserve(elements->size());
+        for(const auto& element : *elements)
+            replacements.emplace(element.first, method.addNewLocal(element.second, "%lowered_stack"));
+        return MemoryInfo{baseAddr, MemoryAccessType::QPU_REGISTER_READWRITE, nullptr, {}, NO_VALUE, {}, false,
+            std::move(replacements)};
+    }
+    // c) the private memory is small enough to be rewritten to fit into a single register (e.g. int[4])
     auto convertedType = convertSmallArrayToRegister(baseAddr);
     if(convertedType)
     {
@@ -695,12 +829,107 @@ static MemoryInfo canLowerToRegisterReadWrite(Method& method, const Local* baseA
     return checkMemoryMapping(method, baseAddr, access);
 }
 
+/*
+ * Determines the range of the program in which the contents of the given memory area are used.
+ *
+ * Since the work-items of a work-group run in parallel on different QPUs and might execute different parts of the
+ * program at the same time, memory shared by all work-items is live during the whole kernel execution, unless there is
+ * only a single work-item per work-group.
+ */
+static periphery::VPMLiveRange determineVPMLiveRange(Method& method, const MemoryAccess& access, bool isSharedMemory)
+{
+    const auto& sizes = method.metaData.workGroupSizes;
+    if(isSharedMemory &&
+        (!method.metaData.isWorkGroupSizeSet() ||
+            !std::all_of(sizes.begin(), sizes.end(), [](uint32_t u) -> bool { return u <= 1; })))
+        return periphery::WHOLE_KERNEL_LIVE_RANGE;
+    if(access.accessInstructions.empty())
+        return periphery::WHOLE_KERNEL_LIVE_RANGE;
+
+    FastMap<const IntermediateInstruction*, unsigned> positions;
+    FastMap<const BasicBlock*, periphery::VPMLiveRange> blockRanges;
+    unsigned index = 0;
+    for(auto& block : method)
+    {
+        const unsigned blockStart = index;
+        for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has())
+                positions.emplace(it.get(), index);
+            ++index;
+        }
+        blockRanges.emplace(&block, periphery::VPMLiveRange{blockStart, index > blockStart ? index - 1 : blockStart});
+    }
+
+    periphery::VPMLiveRange range{std::numeric_limits<unsigned>::max(), 0};
+    FastSet<const BasicBlock*> accessBlocks;
+    for(auto it : access.accessInstructions)
+    {
+        auto pos = positions.find(it.get());
+        if(pos == positions.end())
+            return periphery::WHOLE_KERNEL_LIVE_RANGE;
+        range.first = std::min(range.first, pos->second);
+        range.last = std::max(range.last, pos->second);
+        accessBlocks.emplace(it.getBasicBlock());
+    }
+
+    // if the memory is accessed inside of a loop, its contents need to be kept for the whole loop, since the next
+    // iteration might read the values written in the previous one
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        if(std::none_of(loop.begin(), loop.end(),
+               [&](const CFGNode* node) -> bool { return accessBlocks.find(node->key) != accessBlocks.end(); }))
+            continue;
+        for(const auto* node : loop)
+        {
+            const auto& blockRange = blockRanges.at(node->key);
+            range.first = std::min(range.first, blockRange.first);
+            range.last = std::max(range.last, blockRange.last);
+        }
+    }
+    return range;
+}
+
+/*
+ * Returns whether all accesses to the memory area are single scalar reads (and writes, if allowed) of up to 32-bit.
+ *
+ * Only these accesses can be handled by the packed VPM areas, since they can be mapped to accessing a single word.
+ */
+static bool hasOnlyScalarWordAccesses(const MemoryAccess& access, bool allowWrites)
+{
+    return std::all_of(
+        access.accessInstructions.begin(), access.accessInstructions.end(), [&](InstructionWalker it) -> bool {
+            auto mem = it.get<const intermediate::MemoryInstruction>();
+            if(!mem || mem->getNumEntries() != INT_ONE)
+                return false;
+            if(mem->op == MemoryOperation::READ)
+                return mem->getDestination().type.getVectorWidth() == 1 &&
+                    mem->getDestination().type.getInMemoryWidth() <= sizeof(uint32_t);
+            if(mem->op == MemoryOperation::WRITE && allowWrites)
+                return mem->getSource().type.getVectorWidth() == 1 &&
+                    mem->getSource().type.getInMemoryWidth() <= sizeof(uint32_t);
+            return false;
+        });
+}
+
+/*
+ * Returns the number of bytes required to store the memory area packed into 32-bit words
+ */
+static unsigned getPackedSize(const Local* baseAddr)
+{
+    auto numBytes = baseAddr->type.getElementType().getInMemoryWidth();
+    return numBytes + (sizeof(uint32_t) - numBytes % sizeof(uint32_t)) % sizeof(uint32_t);
+}
+
 static MemoryInfo canLowerToPrivateVPMArea(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
-    // FIXME enable once storing with element (non-vector) offset into VPM is implemented
+    // FIXME enable once storing with element (non-vector) offset into VPM is implemented. The packed per-QPU areas
+    // (see VPM#addPackedArea) support single scalar accesses, but are not yet tested for private arrays.
     // Retest: OpenCL-CTS/vload_private, OpenCL_CTS/vstore_private, emulate-memory
     auto area = static_cast<periphery::VPMArea*>(nullptr);
-    // TODO method.vpm->addArea(baseAddr, baseAddr->type.getElementType(), true, method.metaData.getWorkGroupSize());
+    // TODO if(hasOnlyScalarWordAccesses(access, true))
+    //  area = method.vpm->addPackedArea(baseAddr, getPackedSize(baseAddr), true, NUM_QPUS,
+    //      determineVPMLiveRange(method, access, false));
     if(area)
     {
         // mark stack allocation as lowered to VPM to skip reserving a stack area
@@ -717,7 +946,11 @@ static MemoryInfo canLowerToPrivateVPMArea(Method& method, const Local* baseAddr
 
 static MemoryInfo canLowerToSharedVPMArea(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
-    auto area = method.vpm->addArea(baseAddr, baseAddr->type.getElementType(), false);
+    auto liveRange = determineVPMLiveRange(method, access, true);
+    auto area = method.vpm->addArea(baseAddr, baseAddr->type.getElementType(), false, NUM_QPUS, liveRange);
+    if(!area && hasOnlyScalarWordAccesses(access, true))
+        // the unpacked layout requires a whole row per element, try to fit the data by packing it into 32-bit words
+        area = method.vpm->addPackedArea(baseAddr, getPackedSize(baseAddr), false, NUM_QPUS, liveRange);
     if(area)
         return MemoryInfo{
             baseAddr, MemoryAccessType::VPM_SHARED_ACCESS, area, {}, NO_VALUE, convertSmallArrayToRegister(baseAddr)};
@@ -727,10 +960,74 @@ static MemoryInfo canLowerToSharedVPMArea(Method& method, const Local* baseAddr,
     return checkMemoryMapping(method, baseAddr, access);
 }
 
+// the minimum number of reads (outside of loops) for the prefetching into the VPM read cache to pay off
+static constexpr std::size_t MIN_VPM_CACHE_READS = 4;
+
+static bool mayBeAliased(const Method& method, const Local* baseAddr);
+
+/*
+ * Returns the number of bytes to be cached in VPM, if the read-only memory area is small enough and read often enough
+ * to prefetch it completely into VPM once and then read the values from VPM instead of accessing the RAM for every
+ * read.
+ *
+ * NOTE: Only constant memory and memory which cannot be accessed via any other pointer is cached, since a write via an
+ * aliasing pointer would not update the cached copy.
+ */
+static Optional<unsigned> determineReadCacheSize(Method& method, const Local* baseAddr, const MemoryAccess& access)
+{
+    const auto& config = method.module.compilationConfig;
+    // the prefetching changes the VPM layout and the code executed at kernel start, so only apply it for full
+    // optimizations
+    const auto maxCacheSize = config.additionalOptions.vpmReadCacheSize;
+    if(maxCacheSize == 0 || config.optimizationLevel < OptimizationLevel::FULL || !isMemoryOnlyRead(baseAddr))
+        return {};
+
+    // the memory might be written via another pointer, which would not update the cached copy. Constant memory is
+    // never modified during the kernel execution
+    auto global = baseAddr->as<Global>();
+    auto pointerType = baseAddr->type.getPointerType();
+    bool isConstant =
+        (global && global->isConstant) || (pointerType && pointerType->addressSpace == AddressSpace::CONSTANT);
+    if(!isConstant && mayBeAliased(method, baseAddr))
+        return {};
+
+    // the memory footprint needs to be known at compile-time
+    auto numBytes = getStaticMemorySize(baseAddr);
+    if(!numBytes || *numBytes == 0 || *numBytes > maxCacheSize || *numBytes % sizeof(uint32_t) != 0)
+        return {};
+
+    // we only support single scalar reads, everything else (e.g. vector loads, copies) would need to be handled via RAM
+    // anyway
+    if(!hasOnlyScalarWordAccesses(access, false))
+        return {};
+    bool isReadInLoop = false;
+    FastSet<const BasicBlock*> loopBlocks;
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        for(const auto* node : loop)
+            loopBlocks.emplace(node->key);
+    }
+    for(auto it : access.accessInstructions)
+        isReadInLoop = isReadInLoop || loopBlocks.find(it.getBasicBlock()) != loopBlocks.end();
+    if(!isReadInLoop && access.accessInstructions.size() < MIN_VPM_CACHE_READS)
+        return {};
+    return numBytes;
+}
+
 static MemoryInfo canMapToTMUReadOnly(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
-    // TODO for better performance, the TMU flag should alternate in according to the order of usage (first read use
-    // TMU0, second read use TMU1, ...)
+    if(auto cacheSize = determineReadCacheSize(method, baseAddr, access))
+    {
+        if(auto area = method.vpm->addReadCacheArea(baseAddr, *cacheSize))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Caching " << *cacheSize << " bytes of read-only memory in VPM: " << baseAddr->to_string()
+                    << logging::endl);
+            return MemoryInfo{baseAddr, MemoryAccessType::RAM_READ_CACHED_VPM, area};
+        }
+    }
+    // alternate the TMUs between the memory areas, independent loads issued together are additionally re-distributed
+    // to the TMUs in order of usage by the ScheduleTMULoads optimization
     static thread_local bool tmuFlag = true;
     tmuFlag = !tmuFlag;
     return MemoryInfo{baseAddr, MemoryAccessType::RAM_LOAD_TMU, nullptr, {}, {}, {}, tmuFlag};
@@ -738,6 +1035,10 @@ static MemoryInfo canMapToTMUReadOnly(Method& method, const Local* baseAddr, Mem
 
 static const periphery::VPMArea* checkCacheMemoryAccessRanges(
     Method& method, const Local* baseAddr, FastAccessList<MemoryAccessRange>& accesRanges);
+static const periphery::VPMArea* checkWorkGroupBlockAccess(
+    Method& method, const Local* baseAddr, const MemoryAccess& access, FastAccessList<MemoryAccessRange>& accessRanges);
+static bool isWorkGroupBlockDoubleBuffered(const Method& method, const FastAccessList<MemoryAccessRange>& accessRanges);
+static Optional<analysis::IntegerRange> determineWrittenRange(const FastAccessList<MemoryAccessRange>& accessRanges);
 
 static MemoryInfo canMapToDMAReadWrite(Method& method, const Local* baseAddr, MemoryAccess& access)
 {
@@ -755,6 +1056,19 @@ static MemoryInfo canMapToDMAReadWrite(Method& method, const Local* baseAddr, Me
             return MemoryInfo{baseAddr, MemoryAccessType::VPM_SHARED_ACCESS, area, std::move(ranges)};
         }
     }
+    else if(!ranges.empty())
+    {
+        if(auto area = checkWorkGroupBlockAccess(method, baseAddr, access, ranges))
+        {
+            // the part of the memory accessed by the work-group is loaded into VPM at the start of the kernel and
+            // written back at the end (see #insertVPMCachePrefetch and #insertWorkGroupBlockWriteBack)
+            auto writtenRange = determineWrittenRange(ranges);
+            MemoryInfo info{baseAddr, MemoryAccessType::VPM_SHARED_ACCESS, area, std::move(ranges)};
+            info.isDoubleBuffered = isWorkGroupBlockDoubleBuffered(method, *info.ranges);
+            info.writtenRange = writtenRange;
+            return info;
+        }
+    }
     return MemoryInfo{baseAddr, MemoryAccessType::RAM_READ_WRITE_VPM};
 }
 
@@ -867,3 +1181,144 @@ static const periphery::VPMArea* checkCacheMemoryAccessRanges(
     }
     return vpmArea;
 }
+
+/*
+ * Returns whether the block of RAM accessed by the work-group with the given accesses is double-buffered in VPM.
+ *
+ * Since the block of the next work-group is loaded while the current one is executed, this requires all work-groups to
+ * be executed in a single kernel execution (see optimizations::addWorkGroupLoop). Also, the block of the next
+ * work-group is loaded before the current work-group writes back its block, so only blocks which are never written can
+ * be double-buffered.
+ */
+static bool isWorkGroupBlockDoubleBuffered(const Method& method, const FastAccessList<MemoryAccessRange>& accessRanges)
+{
+    static const std::string workGroupLoopPass = "loop-work-groups";
+    const auto& config = method.module.compilationConfig;
+    if(config.additionalOptions.vpmWorkGroupBuffers < 2 || determineWrittenRange(accessRanges) ||
+        config.additionalDisabledOptimizations.find(workGroupLoopPass) != config.additionalDisabledOptimizations.end())
+        return false;
+    return config.additionalEnabledOptimizations.find(workGroupLoopPass) !=
+        config.additionalEnabledOptimizations.end() ||
+        optimizations::Optimizer::getPasses(config.optimizationLevel).count(workGroupLoopPass) != 0;
+}
+
+/*
+ * Returns whether the memory object might be accessed via another pointer parameter too, in which case caching its
+ * contents in VPM could lead to stale data being read or written.
+ */
+static bool mayBeAliased(const Method& method, const Local* baseAddr)
+{
+    auto param = baseAddr->as<Parameter>();
+    if(!param)
+        // globals can be accessed via any pointer parameter too
+        return true;
+    if(has_flag(param->decorations, ParameterDecorations::RESTRICT))
+        return false;
+    return std::any_of(method.parameters.begin(), method.parameters.end(), [&](const Parameter& other) -> bool {
+        return &other != param && other.type.getPointerType() &&
+            other.type.getPointerType()->addressSpace != AddressSpace::PRIVATE &&
+            other.type.getPointerType()->addressSpace != AddressSpace::LOCAL;
+    });
+}
+
+/*
+ * Checks whether the accesses of all work-items of a work-group to the given memory object (in RAM) can be coalesced
+ * into a single block DMA load at the beginning and a single block DMA store at the end of the work-group execution.
+ *
+ * This is the case, if every access is a scalar 32-bit access of the form base + ((uniform + dynamic) << 2), the
+ * work-group uniform part is the same for all accesses (and can be re-calculated at the start of the kernel) and the
+ * range of the dynamic part is small enough to fit into a packed VPM area.
+ */
+static const periphery::VPMArea* checkWorkGroupBlockAccess(
+    Method& method, const Local* baseAddr, const MemoryAccess& access, FastAccessList<MemoryAccessRange>& accessRanges)
+{
+    const auto& config = method.module.compilationConfig;
+    // this adds synchronization between the work-items and changes the VPM layout, so only apply it for full
+    // optimizations
+    const auto maxBlockSize = config.additionalOptions.vpmWorkGroupCacheSize;
+    if(maxBlockSize == 0 || config.optimizationLevel < OptimizationLevel::FULL)
+        return nullptr;
+    // the synchronization of the work-items requires them to be executed on different QPUs at the same time
+    const auto numWorkItems = method.metaData.isWorkGroupSizeSet() ? method.metaData.getWorkGroupSize() : 0u;
+    if(numWorkItems == 0 || numWorkItems > NUM_QPUS || !method.findLocal(BasicBlock::LAST_BLOCK))
+        return nullptr;
+    if(mayBeAliased(method, baseAddr))
+        return nullptr;
+
+    // all accesses need to be 32-bit words, since the write-back stores the whole block, whole words need to be
+    // written, otherwise we could not mask the bytes not written
+    if(!hasOnlyScalarWordAccesses(access, true) ||
+        !std::all_of(access.accessInstructions.begin(), access.accessInstructions.end(), [](InstructionWalker it) {
+            auto mem = it.get<const intermediate::MemoryInstruction>();
+            auto& val = mem->op == MemoryOperation::READ ? mem->getDestination() : mem->getSource();
+            return val.type.getInMemoryWidth() == sizeof(uint32_t);
+        }))
+        return nullptr;
+    if(!std::all_of(accessRanges.begin(), accessRanges.end(), [](const MemoryAccessRange& range) -> bool {
+           return !range.constantOffset && range.typeSizeShift && !range.dynamicAddressParts.empty() &&
+               (*range.typeSizeShift)->assertArgument(1).getLiteralValue() &&
+               (*range.typeSizeShift)->assertArgument(1).getLiteralValue()->unsignedInt() == 2u;
+       }))
+        return nullptr;
+
+    bool allUniformPartsEqual;
+    analysis::IntegerRange offsetRange;
+    std::tie(allUniformPartsEqual, offsetRange) = checkWorkGroupUniformParts(accessRanges);
+    // the dynamic offset is directly used as offset into the VPM area, so it cannot be negative
+    if(!allUniformPartsEqual || offsetRange.minValue < 0 || offsetRange.maxValue < offsetRange.minValue ||
+        offsetRange.maxValue >= maxBlockSize)
+        return nullptr;
+    const auto& uniformParts = accessRanges.front().groupUniformAddressParts;
+    if(!std::all_of(uniformParts.begin(), uniformParts.end(),
+           [](const std::pair<Value, InstructionDecorations>& part) -> bool {
+               return canRecalculateWorkGroupUniformValue(part.first);
+           }))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Cannot coalesce work-group accesses to " << baseAddr->to_string()
+                << ", since the work-group uniform address cannot be calculated at the start of the kernel"
+                << logging::endl);
+        return nullptr;
+    }
+
+    auto numBytes = (static_cast<unsigned>(offsetRange.maxValue) + 1 /* bounds are inclusive */) * sizeof(uint32_t);
+    if(numBytes > maxBlockSize)
+        return nullptr;
+    auto areaSize = static_cast<unsigned>(numBytes);
+    if(isWorkGroupBlockDoubleBuffered(method, accessRanges))
+    {
+        // reserve 2 buffers, each starting at a new row (of 16 32-bit words), so the buffers can be selected by the
+        // row of the DMA setup
+        static constexpr unsigned ROW_SIZE = NATIVE_VECTOR_SIZE * sizeof(uint32_t);
+        areaSize = 2 * ((areaSize + ROW_SIZE - 1) / ROW_SIZE) * ROW_SIZE;
+    }
+    auto area = method.vpm->addPackedArea(baseAddr, areaSize, false);
+    if(area)
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Coalescing accesses of work-group to " << baseAddr->to_string() << " into block of " << numBytes
+                << " bytes in VPM: " << area->to_string() << logging::endl);
+    return area;
+}
+
+/*
+ * Returns the range of word offsets into the block of RAM accessed by the work-group which are written by any of the
+ * given accesses or an empty optional, if the block is only read.
+ *
+ * NOTE: This needs to be called after the access ranges were adjusted by #checkWorkGroupUniformParts and before the
+ * memory instructions are lowered.
+ */
+static Optional<analysis::IntegerRange> determineWrittenRange(const FastAccessList<MemoryAccessRange>& accessRanges)
+{
+    Optional<analysis::IntegerRange> writtenRange;
+    for(const auto& range : accessRanges)
+    {
+        auto mem = range.addressWrite.get<const intermediate::MemoryInstruction>();
+        if(mem && mem->op == MemoryOperation::READ)
+            continue;
+        if(!writtenRange)
+            writtenRange = range.offsetRange;
+        writtenRange->minValue = std::min(writtenRange->minValue, range.offsetRange.minValue);
+        writtenRange->maxValue = std::max(writtenRange->maxValue, range.offsetRange.maxValue);
+    }
+    return writtenRange;
+}
@@ -40,13 +40,15 @@ static InstructionWalker lowerMemoryWriteToVPM(Method& method, InstructionWalker
     const MemoryInfo& srcInfo, const MemoryInfo& destInfo);
 static InstructionWalker loadMemoryViaTMU(Method& method, InstructionWalker it, MemoryInstruction* mem,
     const MemoryInfo& srcInfo, const MemoryInfo& destInfo);
+static InstructionWalker loadMemoryFromVPMReadCache(Method& method, InstructionWalker it, MemoryInstruction* mem,
+    const MemoryInfo& srcInfo, const MemoryInfo& destInfo);
 static InstructionWalker accessMemoryInRAMViaVPM(Method& method, InstructionWalker it, MemoryInstruction* mem,
     const MemoryInfo& srcInfo, const MemoryInfo& destInfo);
 static InstructionWalker mapMemoryCopy(Method& method, InstructionWalker it, MemoryInstruction* mem,
     const MemoryInfo& srcInfo, const MemoryInfo& destInfo);
 
 /* clang-format off */
-static constexpr MemoryMapper MAPPERS[6][4] = {
+static constexpr MemoryMapper MAPPERS[7][4] = {
     /* READ,                         WRITE,                          COPY (from),                   FILL */
     {lowerMemoryReadOnlyToRegister,  invalidMapping,                 lowerMemoryReadOnlyToRegister, invalidMapping},                 /* QPU_REGISTER_READONLY */
     {lowerMemoryReadWriteToRegister, lowerMemoryReadWriteToRegister, lowerMemoryCopyToRegister,     lowerMemoryReadWriteToRegister}, /* QPU_REGISTER_READWRITE */
@@ -54,6 +56,7 @@ static constexpr MemoryMapper MAPPERS[6][4] = {
     {lowerMemoryReadToVPM,           lowerMemoryWriteToVPM,          mapMemoryCopy,                 lowerMemoryWriteToVPM},          /* VPM_SHARED_ACCESS */
     {loadMemoryViaTMU,               invalidMapping,                 mapMemoryCopy,                 invalidMapping},                 /* RAM_LOAD_TMU */
     {accessMemoryInRAMViaVPM,        accessMemoryInRAMViaVPM,        mapMemoryCopy,                 accessMemoryInRAMViaVPM},        /* RAM_READ_WRITE_VPM */
+    {loadMemoryFromVPMReadCache,     invalidMapping,                 invalidMapping,                invalidMapping},                 /* RAM_READ_CACHED_VPM */
 };
 /* clang-format on */
 
@@ -65,21 +68,31 @@ std::string MemoryInfo::to_string() const
     case MemoryAccessType::QPU_REGISTER_READONLY:
         return "read-only register " + mappedRegisterOrConstant.to_string();
     case MemoryAccessType::QPU_REGISTER_READWRITE:
+        if(!scalarReplacements.empty())
+            return std::to_string(scalarReplacements.size()) + " separate registers";
         return "register " + mappedRegisterOrConstant.to_string();
     case MemoryAccessType::VPM_PER_QPU:
         return "private VPM area " + (area ? area->to_string() : "(null)");
     case MemoryAccessType::VPM_SHARED_ACCESS:
-        return "shared VPM area " + (area ? area->to_string() : "(null)");
+        return "shared VPM area " + (area ? area->to_string() : "(null)") +
+            (isDoubleBuffered ? " (double-buffered)" : "");
     case MemoryAccessType::RAM_LOAD_TMU:
         return "read-only memory access via TMU" + std::string(tmuFlag ? "1" : "0");
     case MemoryAccessType::RAM_READ_WRITE_VPM:
         return "read-write memory access via VPM" + (area ? " (cached in" + area->to_string() + ")" : "");
+    case MemoryAccessType::RAM_READ_CACHED_VPM:
+        return "read-only memory access via VPM read cache " + (area ? area->to_string() : "(null)");
     }
     throw CompilationError(
         CompilationStep::NORMALIZER, "Unhandled memory info type", std::to_string(static_cast<uint32_t>(type)));
 }
 LCOV_EXCL_STOP
 
+Value normalization::getWorkGroupBufferOffset(Method& method, const MemoryInfo& info)
+{
+    return method.findOrCreateLocal(TYPE_INT32, info.local->name + ".buffer_offset")->createReference();
+}
+
 InstructionWalker normalization::mapMemoryAccess(Method& method, InstructionWalker it,
     intermediate::MemoryInstruction* mem, const MemoryInfo& srcInfo, const MemoryInfo& destInfo)
 {
@@ -233,6 +246,27 @@ static InstructionWalker lowerMemoryReadWriteToRegister(
     Method& method, InstructionWalker it, MemoryInstruction* mem, const MemoryInfo& srcInfo, const MemoryInfo& destInfo)
 {
     const auto& loweredInfo = mem->op == MemoryOperation::READ ? srcInfo : destInfo;
+    if(!loweredInfo.scalarReplacements.empty())
+    {
+        // the aggregate is split into separate locals for all accessed elements
+        const auto& address = mem->op == MemoryOperation::READ ? mem->getSource() : mem->getDestination();
+        auto offset = getConstantAddressOffset(loweredInfo.local, address);
+        auto replacementIt =
+            offset ? loweredInfo.scalarReplacements.find(*offset) : loweredInfo.scalarReplacements.end();
+        if(replacementIt == loweredInfo.scalarReplacements.end())
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Failed to find register for memory access to split private memory", mem->to_string());
+        if(mem->op == MemoryOperation::READ)
+            it.reset(new MoveOperation(mem->getDestination(), replacementIt->second));
+        else if(mem->op == MemoryOperation::WRITE)
+            it.reset(new MoveOperation(replacementIt->second, mem->getSource()));
+        else
+            throw CompilationError(CompilationStep::NORMALIZER,
+                "Unhandled case of lowering memory access to split private memory", mem->to_string());
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Replaced access to split stack allocation with: " << it->to_string() << logging::endl);
+        return it;
+    }
     if(!loweredInfo.mappedRegisterOrConstant)
         throw CompilationError(CompilationStep::NORMALIZER,
             "Cannot map memory location to register without mapping register specified", mem->to_string());
@@ -350,7 +384,10 @@ static InstructionWalker insertToInVPMAreaOffset(Method& method, InstructionWalk
         if(range == info.ranges->end())
             throw CompilationError(CompilationStep::NORMALIZER,
                 "Failed to find memory access range for VPM cached memory access", mem->to_string());
-        return insertAddressToWorkItemSpecificOffset(it, method, out, const_cast<MemoryAccessRange&>(*range));
+        it = insertAddressToWorkItemSpecificOffset(it, method, out, const_cast<MemoryAccessRange&>(*range));
+        if(info.isDoubleBuffered)
+            out = assign(it, out.type, "%vpm_buffer_offset") = out + getWorkGroupBufferOffset(method, info);
+        return it;
     }
     return insertAddressToStackOffset(it, method, out, info.local, info.type, mem, ptrValue);
 }
@@ -380,11 +417,31 @@ static InstructionWalker lowerMemoryReadToVPM(
         CPPLOG_LAZY(logging::Level::DEBUG,
             log << "Lowering read of shared local memory into VPM: " << mem->to_string() << logging::endl);
 
+    // The VPM read and write setups are separate for every QPU, so only accesses to rows shared with other QPUs need to
+    // be guarded. Rows reserved for a single QPU can be accessed without acquiring the hardware mutex.
+    const bool useMutex = mem->guardAccess && srcInfo.type != MemoryAccessType::VPM_PER_QPU;
     Value inAreaOffset = UNDEFINED_VALUE;
+    if(srcInfo.area->isPacked)
+    {
+        // packed areas are addressed by the byte offset into the object, the per-QPU offset is applied in the VPM.
+        // For blocks of RAM accessed by the work-group, the offset is relative to the work-group uniform address
+        if(srcInfo.ranges)
+            it = insertToInVPMAreaOffset(method, it, inAreaOffset, srcInfo, mem, mem->getSource());
+        else
+            it = insertAddressToOffset(it, method, inAreaOffset, srcInfo.local, mem, mem->getSource());
+        if(mem->op == MemoryOperation::READ)
+        {
+            it = method.vpm->insertReadPackedVPM(
+                method, it, mem->getDestination(), *srcInfo.area, useMutex, inAreaOffset);
+            return it.erase();
+        }
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Unhandled case to lower reading of memory into packed VPM", mem->to_string());
+    }
     it = insertToInVPMAreaOffset(method, it, inAreaOffset, srcInfo, mem, mem->getSource());
     if(mem->op == MemoryOperation::READ)
     {
-        it = method.vpm->insertReadVPM(method, it, mem->getDestination(), srcInfo.area, mem->guardAccess, inAreaOffset);
+        it = method.vpm->insertReadVPM(method, it, mem->getDestination(), srcInfo.area, useMutex, inAreaOffset);
         return it.erase();
     }
     throw CompilationError(
@@ -407,11 +464,30 @@ static InstructionWalker lowerMemoryWriteToVPM(
         CPPLOG_LAZY(logging::Level::DEBUG,
             log << "Lowering write to shared local memory into VPM: " << mem->to_string() << logging::endl);
 
+    // rows reserved for a single QPU can be accessed without acquiring the hardware mutex, see #lowerMemoryReadToVPM
+    const bool useMutex = mem->guardAccess && destInfo.type != MemoryAccessType::VPM_PER_QPU;
     Value inAreaOffset = UNDEFINED_VALUE;
+    if(destInfo.area->isPacked)
+    {
+        // packed areas are addressed by the byte offset into the object, the per-QPU offset is applied in the VPM.
+        // For blocks of RAM accessed by the work-group, the offset is relative to the work-group uniform address
+        if(destInfo.ranges)
+            it = insertToInVPMAreaOffset(method, it, inAreaOffset, destInfo, mem, mem->getDestination());
+        else
+            it = insertAddressToOffset(it, method, inAreaOffset, destInfo.local, mem, mem->getDestination());
+        if(mem->op == MemoryOperation::WRITE)
+        {
+            it = method.vpm->insertWritePackedVPM(
+                method, it, mem->getSource(), *destInfo.area, useMutex, inAreaOffset);
+            return it.erase();
+        }
+        throw CompilationError(
+            CompilationStep::NORMALIZER, "Unhandled case to lower writing of memory into packed VPM", mem->to_string());
+    }
     it = insertToInVPMAreaOffset(method, it, inAreaOffset, destInfo, mem, mem->getDestination());
     if(mem->op == MemoryOperation::WRITE)
     {
-        it = method.vpm->insertWriteVPM(method, it, mem->getSource(), destInfo.area, mem->guardAccess, inAreaOffset);
+        it = method.vpm->insertWriteVPM(method, it, mem->getSource(), destInfo.area, useMutex, inAreaOffset);
         return it.erase();
     }
     if(mem->op == MemoryOperation::FILL)
@@ -435,7 +511,7 @@ static InstructionWalker lowerMemoryWriteToVPM(
             it = insertToInVPMAreaOffset(method, it, inAreaOffset, destInfo, mem, mem->getDestination());
             // 3. write vector to VPM
             auto vpmTypeSize = Literal(vpmType.first.getInMemoryWidth());
-            if(mem->guardAccess)
+            if(useMutex)
             {
                 it.emplace(new MutexLock(MutexAccess::LOCK));
                 it.nextInBlock();
@@ -446,7 +522,7 @@ static InstructionWalker lowerMemoryWriteToVPM(
                 byteOffset = assign(it, TYPE_INT32) = inAreaOffset + byteOffset;
                 it = method.vpm->insertWriteVPM(method, it, fillVector, destInfo.area, false, byteOffset);
             }
-            if(mem->guardAccess)
+            if(useMutex)
             {
                 it.emplace(new MutexLock(MutexAccess::RELEASE));
                 it.nextInBlock();
@@ -466,6 +542,22 @@ static InstructionWalker lowerMemoryWriteToVPM(
  *
  * NOTE: Memory locations loaded via TMU MUST NOT be written to by the same kernel (even on a different QPU)!
  */
+static InstructionWalker loadMemoryFromVPMReadCache(
+    Method& method, InstructionWalker it, MemoryInstruction* mem, const MemoryInfo& srcInfo, const MemoryInfo& destInfo)
+{
+    if(mem->op != MemoryOperation::READ || !srcInfo.area)
+        throw CompilationError(CompilationStep::NORMALIZER, "Invalid access to VPM read cache", mem->to_string());
+    // the whole memory area is prefetched into the VPM read cache, see #insertVPMCachePrefetch
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Loading from read-only memory cached in VPM: " << mem->to_string() << logging::endl);
+    Value inAreaOffset = UNDEFINED_VALUE;
+    it = insertAddressToOffset(it, method, inAreaOffset, srcInfo.local, mem, mem->getSource());
+    // the cache is never written after the initial prefetch and the VPM read setup is separate for every QPU, so
+    // there is no need to acquire the VPM mutex
+    it = method.vpm->insertReadPackedVPM(method, it, mem->getDestination(), *srcInfo.area, false, inAreaOffset);
+    return it.erase();
+}
+
 static InstructionWalker loadMemoryViaTMU(
     Method& method, InstructionWalker it, MemoryInstruction* mem, const MemoryInfo& srcInfo, const MemoryInfo& destInfo)
 {
@@ -574,6 +666,75 @@ static InstructionWalker accessMemoryInRAMViaVPM(
     return it.erase();
 }
 
+/*
+ * Returns whether a pending asynchronous DMA transfer needs to be finished before the given instruction is executed.
+ *
+ * This is the case for any other memory access, any mutex lock or release (the transfer must not outlive the critical
+ * section it was started in) or synchronization (e.g. the barrier inserted for wait_group_events()) as well as any
+ * instruction accessing the hardware periphery.
+ */
+static bool requiresFinishedDMATransfer(const IntermediateInstruction& inst)
+{
+    if(dynamic_cast<const MutexLock*>(&inst))
+        // the transfer needs to be finished before the mutex is released, otherwise another QPU could start a new DMA
+        // transfer (or change the VPM contents) while this one is still running
+        return true;
+    if(dynamic_cast<const MemoryInstruction*>(&inst) || dynamic_cast<const MethodCall*>(&inst) ||
+        dynamic_cast<const MemoryBarrier*>(&inst))
+        return true;
+    // setting flags does not affect the transfer
+    return remove_flag(inst.getSideEffects(), SideEffectType::FLAGS) != SideEffectType::NONE;
+}
+
+/*
+ * For asynchronous copies (async_work_group_copy()), the DMA transfer is already started by writing the memory
+ * address. Only the waiting for the DMA to finish is moved down to the next instruction which needs the transfer to be
+ * finished (or the end of the block), so the transfer runs in the background of the following calculations.
+ *
+ * If the transfer is guarded by the hardware mutex, the mutex release is moved down together with the wait. This way,
+ * no other QPU can start a DMA transfer or access the VPM before this transfer is finished, while this QPU can already
+ * execute the following calculations.
+ *
+ * NOTE: The given iterator needs to point to the memory instruction which was mapped to the DMA transfer.
+ */
+static void deferDMAWait(InstructionWalker it, const Register& waitRegister)
+{
+    auto waitIt = it.copy().previousInBlock();
+    while(!waitIt.isStartOfBlock() && !(waitIt.has() && waitIt->readsRegister(waitRegister)))
+        waitIt.previousInBlock();
+    if(!waitIt.has() || !waitIt->readsRegister(waitRegister))
+        return;
+    auto releaseIt = waitIt.copy().nextInBlock();
+    while(releaseIt != it && !releaseIt.has())
+        releaseIt.nextInBlock();
+    auto mutex = releaseIt != it ? releaseIt.get<MutexLock>() : nullptr;
+    if(mutex && mutex->locksMutex())
+        // the DMA access is followed by another critical section, we cannot defer the wait over it
+        return;
+    auto insertIt = it.copy().nextInBlock();
+    while(!insertIt.isEndOfBlock())
+    {
+        if(insertIt.has() && (insertIt.get<Branch>() || requiresFinishedDMATransfer(*insertIt.get())))
+            break;
+        insertIt.nextInBlock();
+    }
+    if(insertIt.copy().previousInBlock() == it)
+        // nothing to defer the wait over
+        return;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Deferring wait for asynchronous DMA transfer" << (mutex ? " and mutex release" : "")
+            << " to: " << (insertIt.isEndOfBlock() ? "end of block" : insertIt->to_string()) << logging::endl);
+    if(mutex)
+    {
+        auto releaseInst = releaseIt.release();
+        releaseIt.erase();
+        insertIt.emplace(releaseInst);
+    }
+    auto waitInst = waitIt.release();
+    waitIt.erase();
+    insertIt.emplace(waitInst);
+}
+
 static InstructionWalker mapMemoryCopy(
     Method& method, InstructionWalker it, MemoryInstruction* mem, const MemoryInfo& srcInfo, const MemoryInfo& destInfo)
 {
@@ -693,6 +854,8 @@ static InstructionWalker mapMemoryCopy(
         it = method.vpm->insertWriteRAM(method, it,
             Value(mem->getDestination().local(), vpmRowType.value_or(mem->getDestinationElementType())),
             vpmRowType.value_or(mem->getSourceElementType()), srcInfo.area, mem->guardAccess, inAreaOffset, numEntries);
+        if(mem->hasDecoration(InstructionDecorations::ASYNCHRONOUS_COPY))
+            deferDMAWait(it, REG_VPM_DMA_STORE_WAIT);
         return it.erase();
     }
     else if(srcInRAM && destInVPM)
@@ -706,6 +869,8 @@ static InstructionWalker mapMemoryCopy(
             Value(mem->getSource().local(), vpmRowType.value_or(mem->getSourceElementType())),
             vpmRowType.value_or(mem->getDestinationElementType()), destInfo.area, mem->guardAccess, inAreaOffset,
             numEntries);
+        if(mem->hasDecoration(InstructionDecorations::ASYNCHRONOUS_COPY))
+            deferDMAWait(it, REG_VPM_DMA_LOAD_WAIT);
         return it.erase();
     }
     else if(srcInRAM && destInRAM)
@@ -37,6 +37,14 @@ namespace vc4c
             Optional<DataType> convertedRegisterType = {};
             // flags which TMU to be used for reading
             bool tmuFlag = false;
+            // for aggregates split into separate locals (scalar replacement), the local for every accessed byte offset
+            FastMap<unsigned, Value> scalarReplacements = {};
+            // for blocks of RAM accessed by the work-group, whether the VPM area contains two buffers used by
+            // alternating work-groups, see #getWorkGroupBufferOffset
+            bool isDoubleBuffered = false;
+            // for blocks of RAM accessed by the work-group, the range of word offsets (relative to the block start)
+            // written by any work-item. Not set if the block is only read.
+            Optional<analysis::IntegerRange> writtenRange = {};
 
             std::string to_string() const;
         };
@@ -71,6 +79,22 @@ namespace vc4c
          */
         MemoryInfo checkMemoryMapping(Method& method, const Local* baseAddr, MemoryAccess& access);
 
+        /*
+         * Returns the size in bytes of the memory area referenced by the given local, if it is known at compile-time.
+         *
+         * This is the case for globals and for parameters with a known number of dereferenceable bytes.
+         */
+        Optional<unsigned> getStaticMemorySize(const Local* baseAddr);
+
+        /*
+         * Returns the local containing the byte offset into the VPM area of the buffer used by the current work-group
+         * for the given double-buffered block of RAM accessed by the work-group.
+         *
+         * The buffer is alternated for every work-group, so the block for the next work-group can be loaded while the
+         * current work-group is still running.
+         */
+        Value getWorkGroupBufferOffset(Method& method, const MemoryInfo& info);
+
         /*
          * Maps the given memory access instruction to hardware instructions according to the given source and
          * destination information.
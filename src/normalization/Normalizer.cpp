@@ -182,8 +182,25 @@ void Normalizer::normalize(Module& module) const
             kernel.countInstructions(), vc4c::profiler::COUNTER_NORMALIZATION + 4);
     }
     // 3. run other normalization steps on kernel functions
+    FastMap<const Method*, std::size_t> numInstructions;
+    for(const Method* kernelFunc : kernels)
+        numInstructions.emplace(kernelFunc, kernelFunc->countInstructions());
     const auto f = [&module, this](Method* kernelFunc) -> void { normalizeMethod(module, *kernelFunc); };
     ThreadPool{"Normalization"}.scheduleAll<Method*>(kernels, f);
+    // 4. remove unused and duplicate globals from the global data segment.
+    // This needs to run after the memory accesses of all kernels are mapped, but before the addresses are calculated
+    logging::logLazy(logging::Level::DEBUG, []() {
+        logging::debug() << logging::endl;
+        logging::debug() << "Running pass: CompactGlobalData" << logging::endl;
+    });
+    PROFILE_START(CompactGlobalData);
+    compactGlobalData(module);
+    PROFILE_END(CompactGlobalData);
+    // 5. map the global data and stack accesses to their addresses and run the remaining normalization steps
+    const auto g = [&module, &numInstructions, this](Method* kernelFunc) -> void {
+        mapMethodAddresses(module, *kernelFunc, numInstructions.at(kernelFunc));
+    };
+    ThreadPool{"Normalization"}.scheduleAll<Method*>(kernels, g);
 }
 
 void Normalizer::adjust(Module& module) const
@@ -198,7 +215,6 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
 {
     CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
     CPPLOG_LAZY(logging::Level::INFO, log << "Running normalization passes for: " << method.name << logging::endl);
-    std::size_t numInstructions = method.countInstructions();
 
     PROFILE_START(NormalizationPasses);
 
@@ -221,6 +237,17 @@ void Normalizer::normalizeMethod(Module& module, Method& method) const
     mapMemoryAccess(module, method, config);
     PROFILE_END(MapMemoryAccess);
 
+    PROFILE_END(NormalizationPasses);
+}
+
+void Normalizer::mapMethodAddresses(Module& module, Method& method, std::size_t numInstructions) const
+{
+    CPPLOG_LAZY(logging::Level::DEBUG, log << "-----" << logging::endl);
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Running address normalization passes for: " << method.name << logging::endl);
+
+    PROFILE_START(NormalizationPasses);
+
     // calculate current/final stack offsets after lowering stack-accesses
     method.calculateStackOffsets();
 
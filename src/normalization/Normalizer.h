@@ -8,6 +8,7 @@
 
 #include "config.h"
 
+#include <cstddef>
 #include <functional>
 
 namespace vc4c
@@ -58,12 +59,18 @@ namespace vc4c
             Configuration config;
 
             /*
-             * Runs all registered normalization steps on the given method.
+             * Runs all registered normalization steps up to (and including) the mapping of memory accesses on the given
+             * method.
+             */
+            void normalizeMethod(Module& module, Method& method) const;
+            /*
+             * Runs the remaining normalization steps, which map the stack and global data accesses to their final
+             * addresses, on the given method.
              *
              * After this function has returned, it is guaranteed, that all remaining instructions within the method are
              * normalized (e.g. return true for #isNormalized()).
              */
-            void normalizeMethod(Module& module, Method& method) const;
+            void mapMethodAddresses(Module& module, Method& method, std::size_t numInstructions) const;
             void adjustMethod(Module& module, Method& method) const;
         };
     } /* namespace normalization */
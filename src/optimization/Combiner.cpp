@@ -423,209 +423,438 @@ static const std::vector<MergeCondition> mergeConditions = {
         return true;
     }};
 
+/*
+ * Returns the instruction which will be executed directly after the combination of the two given instructions, when
+ * the combined instruction is placed at the position of the first one
+ */
+static InstructionWalker findFollowingInstruction(InstructionWalker it, InstructionWalker nextIt)
+{
+    auto checkIt = it.copy().nextInBlock();
+    while(!checkIt.isEndOfBlock() && (checkIt == nextIt || !checkIt.has()))
+        checkIt.nextInBlock();
+    return checkIt;
+}
+
+/*
+ * Checks whether the two instructions can be combined into a single instruction placed at the position of the first
+ * instruction, taking into account the instructions directly preceding and following the combined instruction
+ */
+static bool canCombine(InstructionWalker it, InstructionWalker nextIt, const Configuration& config)
+{
+    Operation* op = it.get<Operation>();
+    MoveOperation* move = it.get<MoveOperation>();
+    Operation* nextOp = nextIt.get<Operation>();
+    MoveOperation* nextMove = nextIt.get<MoveOperation>();
+    if((op == nullptr && move == nullptr) || (nextOp == nullptr && nextMove == nullptr))
+        return false;
+    IntermediateInstruction* instr = it.get();
+    IntermediateInstruction* nextInstr = nextIt.get();
+    //- combine add/mul instructions, where:
+    /*
+     * - combined instructions use at least 2 accumulators, or share getSource()-registers, so that only
+     * 2 getSource() registers are required
+     * - the instructions do not depend one-on-another (e.g. out of first is in of second)
+     * - both instructions write to different locals (or to same local and have inverted conditions)
+     * - MUL instruction does not set flags (otherwise flags would be applied for ADD output)
+     * - only one instruction uses a literal (or the literal is the same)
+     * - both set signals (including immediate ALU operation)
+     * For now, may be removed (with exceptions):
+     * - neither of these instructions read/write from special registers
+     *   otherwise this could cause reading two UNIFORMS at once / writing VPM/VPM_ADDR at once
+     */
+    // TODO a written-to register MUST not be read in the next instruction (check instruction
+    // before/after combined) (unless within local range)
+    bool conditionsMet = std::all_of(mergeConditions.begin(), mergeConditions.end(),
+        [op, nextOp, move, nextMove](
+            const MergeCondition& cond) -> bool { return cond(op, nextOp, move, nextMove); });
+    if(instr->checkOutputLocal() && nextInstr->checkOutputLocal())
+    {
+        // extra check, only combine writes to the same local, if local is only used within the next
+        // instruction  this is required, since we cannot write to a physical register from both ALUs,
+        // so the local needs to be on an accumulator
+        if(instr->getOutput()->local() == nextInstr->getOutput()->local() &&
+            (it.copy().nextInBlock() != nextIt ||
+                !nextIt.getBasicBlock()->isLocallyLimited(
+                    nextIt, instr->getOutput()->local(), config.additionalOptions.accumulatorThreshold)))
+            conditionsMet = false;
+    }
+    if(instr->checkOutputLocal() || nextInstr->checkOutputLocal())
+    {
+        // also check that if the next instruction is a vector rotation, neither of the locals is being
+        // rotated there  since vector rotations can't rotate vectors which have been written in the
+        // instruction directly preceding it (true for both full-vector and per-quad rotations)
+        auto checkIt = findFollowingInstruction(it, nextIt);
+        if(!checkIt.isEndOfBlock() && checkIt.get<VectorRotation>())
+        {
+            const Value& src = checkIt.get<VectorRotation>()->getSource();
+            if(instr->checkOutputLocal() && instr->getOutput() == src)
+                conditionsMet = false;
+            if(nextInstr->checkOutputLocal() && nextInstr->getOutput() == src)
+                conditionsMet = false;
+        }
+        // the next instruction MUST NOT unpack a value written to in one of the combined instructions
+        // equally, neither of the combined instructions is allowed to pack a value read in the
+        // following instructions
+        if(!checkIt.isEndOfBlock())
+        {
+            if(checkIt->unpackMode.hasEffect())
+            {
+                if(std::any_of(checkIt->getArguments().begin(), checkIt->getArguments().end(),
+                       [instr, nextInstr](const Value& val) -> bool {
+                           return val.checkLocal() &&
+                               (instr->writesLocal(val.local()) || nextInstr->writesLocal(val.local()));
+                       }))
+                {
+                    conditionsMet = false;
+                }
+            }
+            if(instr->packMode.hasEffect() && instr->checkOutputLocal() &&
+                checkIt->readsLocal(instr->getOutput()->local()))
+                conditionsMet = false;
+            if(nextInstr->packMode.hasEffect() && nextInstr->checkOutputLocal() &&
+                checkIt->readsLocal(nextInstr->getOutput()->local()))
+                conditionsMet = false;
+        }
+        // run previous checks also for the previous (before instr) instruction
+        // this time with inverted checks (since the order is inverted)
+        checkIt = it.copy().previousInBlock();
+        if(!checkIt.isStartOfBlock() && checkIt->checkOutputLocal())
+        {
+            if(checkIt->packMode.hasEffect() &&
+                (instr->readsLocal(checkIt->getOutput()->local()) ||
+                    nextInstr->readsLocal(checkIt->getOutput()->local())))
+                conditionsMet = false;
+            if(instr->unpackMode.hasEffect() && instr->readsLocal(checkIt->getOutput()->local()))
+                conditionsMet = false;
+            if(nextInstr->unpackMode.hasEffect() && nextInstr->readsLocal(checkIt->getOutput()->local()))
+                conditionsMet = false;
+        }
+    }
+    return conditionsMet;
+}
+
+/*
+ * Combines the two instructions into a single instruction executed on both ALUs. The combined instruction replaces the
+ * first instruction, the second instruction is removed.
+ */
+static bool combineInstructions(InstructionWalker it, InstructionWalker nextIt)
+{
+    Operation* op = it.get<Operation>();
+    MoveOperation* move = it.get<MoveOperation>();
+    Operation* nextOp = nextIt.get<Operation>();
+    MoveOperation* nextMove = nextIt.get<MoveOperation>();
+    IntermediateInstruction* instr = it.get();
+    IntermediateInstruction* nextInstr = nextIt.get();
+
+    // move supports both ADD and MUL ALU
+    // if merge, make "move" to other op-code or x x / v8max x x
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Merging instructions " << instr->to_string() << " and " << nextInstr->to_string() << logging::endl);
+    if(op != nullptr && nextOp != nullptr)
+    {
+        it.reset(
+            new CombinedOperation(dynamic_cast<Operation*>(it.release()), dynamic_cast<Operation*>(nextIt.release())));
+        nextIt.erase();
+    }
+    else if(op != nullptr && nextMove != nullptr)
+    {
+        Operation* newMove = nextMove->combineWith(op->op);
+        if(newMove != nullptr)
+        {
+            newMove->copyExtrasFrom(nextMove);
+            it.reset(new CombinedOperation(dynamic_cast<Operation*>(it.release()), newMove));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << nextMove->to_string()
+                            << "' with: " << op->to_string() << logging::endl;
+    }
+    else if(move != nullptr && nextOp != nullptr)
+    {
+        Operation* newMove = move->combineWith(nextOp->op);
+        if(newMove != nullptr)
+        {
+            newMove->copyExtrasFrom(move);
+            it.reset(new CombinedOperation(newMove, dynamic_cast<Operation*>(nextIt.release())));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << move->to_string()
+                            << "' with: " << nextOp->to_string() << logging::endl;
+    }
+    else if(move != nullptr && nextMove != nullptr)
+    {
+        bool firstOnMul = (move->packMode.hasEffect() && move->packMode.supportsMulALU()) ||
+            (nextMove->packMode.hasEffect() && !nextMove->packMode.supportsMulALU()) || nextMove->doesSetFlag();
+        Operation* newMove0 = move->combineWith(firstOnMul ? OP_ADD : OP_MUL24);
+        Operation* newMove1 = nextMove->combineWith(firstOnMul ? OP_MUL24 : OP_ADD);
+        if(newMove0 != nullptr && newMove1 != nullptr)
+        {
+            newMove0->copyExtrasFrom(move);
+            newMove1->copyExtrasFrom(nextMove);
+            it.reset(new CombinedOperation(newMove0, newMove1));
+            nextIt.erase();
+        }
+        else
+            logging::warn() << "Error combining move-operation '" << move->to_string()
+                            << "' with: " << nextMove->to_string() << logging::endl;
+    }
+    else
+        throw CompilationError(CompilationStep::OPTIMIZER, "Unhandled combination, type",
+            (instr->to_string() + ", ") + nextInstr->to_string());
+    if(it.get<CombinedOperation>() != nullptr)
+    {
+        // move instruction usable on both ALUs to the free ALU
+        CombinedOperation* comb = it.get<CombinedOperation>();
+        if(comb->getFirstOp()->op.runsOnAddALU() && comb->getFirstOp()->op.runsOnMulALU())
+        {
+            OpCode code = comb->getFirstOp()->op;
+            if(comb->getSecondOP()->op.runsOnAddALU())
+                code.opAdd = 0;
+            else // by default (e.g. both run on both ALUs), map to ADD ALU
+                code.opMul = 0;
+            dynamic_cast<Operation*>(comb->op1.get())->op = code;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Fixing operation available on both ALUs to " << (code.opAdd == 0 ? "MUL" : "ADD")
+                    << " ALU: " << comb->op1->to_string() << logging::endl);
+        }
+        if(comb->getSecondOP()->op.runsOnAddALU() && comb->getSecondOP()->op.runsOnMulALU())
+        {
+            OpCode code = comb->getSecondOP()->op;
+            if(comb->getFirstOp()->op.runsOnMulALU())
+                code.opMul = 0;
+            else // by default (e.g. both run on both ALUs), map to MUL ALU
+                code.opAdd = 0;
+            dynamic_cast<Operation*>(comb->op2.get())->op = code;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Fixing operation available on both ALUs to " << (code.opAdd == 0 ? "MUL" : "ADD")
+                    << " ALU: " << comb->op2->to_string() << logging::endl);
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Returns whether the given instruction is within the fixed delay of a preceding instruction (e.g. writing the SFU or
+ * setting up VPM reads). Removing such an instruction would shorten the delay and violate the hardware constraints.
+ */
+static bool isWithinFixedDelay(InstructionWalker it)
+{
+    // SFU results are available in the 3rd instruction, VPM reads after 3 instructions
+    static constexpr unsigned MAX_FIXED_DELAY = 3;
+    unsigned numInstructions = 0;
+    auto checkIt = it.copy().previousInBlock();
+    while(!checkIt.isStartOfBlock() && numInstructions < MAX_FIXED_DELAY)
+    {
+        if(checkIt.has() && checkIt->mapsToASMInstruction())
+        {
+            if(checkIt->writesRegister(REG_SFU_EXP2) || checkIt->writesRegister(REG_SFU_LOG2) ||
+                checkIt->writesRegister(REG_SFU_RECIP) || checkIt->writesRegister(REG_SFU_RECIP_SQRT) ||
+                checkIt->writesRegister(REG_VPM_IN_SETUP) || checkIt->writesRegister(REG_VPM_OUT_SETUP))
+                return true;
+            ++numInstructions;
+        }
+        checkIt.previousInBlock();
+    }
+    return false;
+}
+
+/*
+ * Returns whether the instruction accesses any register or triggers a signal, in which case it has to be executed at
+ * its original position
+ */
+static bool accessesRegisterOrSignal(const IntermediateInstruction* instr)
+{
+    return instr->signal != SIGNAL_NONE || instr->checkOutputRegister() ||
+        std::any_of(instr->getArguments().begin(), instr->getArguments().end(),
+            [](const Value& arg) -> bool { return arg.checkRegister(); });
+}
+
+/*
+ * Returns whether the instruction can be moved over the other instruction without changing the semantics of the
+ * program
+ */
+static bool canBeMovedOver(const IntermediateInstruction* instr, const IntermediateInstruction* other)
+{
+    if(auto comb = dynamic_cast<const CombinedOperation*>(other))
+        // the instructions in between might already have been combined
+        return (!comb->op1 || canBeMovedOver(instr, comb->op1.get())) &&
+            (!comb->op2 || canBeMovedOver(instr, comb->op2.get()));
+    if(dynamic_cast<const Nop*>(other) || dynamic_cast<const Branch*>(other) ||
+        dynamic_cast<const BranchLabel*>(other) || dynamic_cast<const MemoryBarrier*>(other))
+        // don't move over delays or control-flow
+        return false;
+    // accesses to the periphery (TMU, SFU, VPM, semaphores, mutex, UNIFORMs), reads of accumulators written by signals
+    // (e.g. r4) and the signals themselves (e.g. thread switches) are never reordered
+    if(accessesRegisterOrSignal(instr) || other->signal != SIGNAL_NONE ||
+        remove_flag(other->getSideEffects(), SideEffectType::FLAGS) != SideEffectType::NONE)
+        return false;
+    if((instr->hasConditionalExecution() && other->doesSetFlag()) ||
+        (instr->doesSetFlag() && (other->hasConditionalExecution() || other->doesSetFlag())))
+        return false;
+    if(instr->checkOutputLocal() &&
+        (other->readsLocal(instr->getOutput()->local()) || other->writesLocal(instr->getOutput()->local())))
+        return false;
+    return std::none_of(instr->getArguments().begin(), instr->getArguments().end(),
+        [other](const Value& arg) -> bool { return arg.checkLocal() && other->writesLocal(arg.local()); });
+}
+
+/*
+ * Checks whether the second instruction can be moved directly after the first one to be combined with it
+ */
+static bool canBeMovedUpTo(InstructionWalker it, InstructionWalker nextIt)
+{
+    if(it.copy().nextInBlock() == nextIt)
+        return !isWithinFixedDelay(nextIt);
+    auto checkIt = it.copy().nextInBlock();
+    while(checkIt != nextIt)
+    {
+        if(checkIt.has() && !canBeMovedOver(nextIt.get(), checkIt.get()))
+            return false;
+        checkIt.nextInBlock();
+    }
+    // removing the instruction must not create a read-after-write not handled before
+    auto prevIt = nextIt.copy().previousInBlock();
+    auto followIt = nextIt.copy().nextInBlock();
+    if(prevIt.has() && prevIt->checkOutputLocal() && !followIt.isEndOfBlock() && followIt.has() &&
+        followIt->readsLocal(prevIt->getOutput()->local()))
+        return false;
+    return !isWithinFixedDelay(nextIt);
+}
+
+// the maximum size of the window to find the optimal pairing in, limited by the size of the solver table
+static constexpr unsigned MAX_COMBINATION_WINDOW = 16;
+
+/*
+ * Exact solver for the maximum matching of combinable instructions within a window.
+ *
+ * Returns the best rating (number of combined pairs, preferring pairs close together) for the given set of already
+ * assigned instructions and stores the selected partner of every instruction.
+ */
+static int findBestPairing(const std::vector<std::vector<bool>>& combinable, uint32_t assignedMask,
+    std::vector<int>& cache, std::vector<int>& selection)
+{
+    const auto numInstructions = static_cast<unsigned>(combinable.size());
+    if(assignedMask == (1u << numInstructions) - 1u)
+        return 0;
+    if(cache[assignedMask] >= 0)
+        return cache[assignedMask];
+    unsigned first = 0;
+    while(assignedMask & (1u << first))
+        ++first;
+    // leave the first unassigned instruction on its own
+    int bestRating = findBestPairing(combinable, assignedMask | (1u << first), cache, selection);
+    int bestPartner = -1;
+    for(unsigned second = first + 1; second < numInstructions; ++second)
+    {
+        if((assignedMask & (1u << second)) || !combinable[first][second])
+            continue;
+        // every combined pair saves one instruction, moving instructions is only used as tie-breaker
+        int rating = static_cast<int>(MAX_COMBINATION_WINDOW) * 2 - static_cast<int>(second - first) +
+            findBestPairing(combinable, assignedMask | (1u << first) | (1u << second), cache, selection);
+        if(rating > bestRating)
+        {
+            bestRating = rating;
+            bestPartner = static_cast<int>(second);
+        }
+    }
+    cache[assignedMask] = bestRating;
+    selection[assignedMask] = bestPartner;
+    return bestRating;
+}
+
+/*
+ * Finds the optimal pairing of the instructions in the given window and combines them.
+ *
+ * Returns whether the last instruction of the window was combined
+ */
+static bool combineWindow(const std::vector<InstructionWalker>& window, const Configuration& config, bool& hasChanged)
+{
+    const auto numInstructions = window.size();
+    std::vector<std::vector<bool>> combinable(numInstructions, std::vector<bool>(numInstructions, false));
+    bool anyCombinable = false;
+    for(std::size_t first = 0; first < numInstructions; ++first)
+    {
+        for(std::size_t second = first + 1; second < numInstructions; ++second)
+        {
+            combinable[first][second] =
+                canCombine(window[first], window[second], config) && canBeMovedUpTo(window[first], window[second]);
+            anyCombinable = anyCombinable || combinable[first][second];
+        }
+    }
+    if(!anyCombinable)
+        return false;
+
+    std::vector<int> cache(1u << numInstructions, -1);
+    std::vector<int> selection(1u << numInstructions, -1);
+    findBestPairing(combinable, 0, cache, selection);
+
+    // reconstruct the selected pairs
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    uint32_t assignedMask = 0;
+    while(assignedMask != (1u << numInstructions) - 1u)
+    {
+        unsigned first = 0;
+        while(assignedMask & (1u << first))
+            ++first;
+        auto partner = selection[assignedMask];
+        assignedMask |= 1u << first;
+        if(partner >= 0)
+        {
+            pairs.emplace_back(first, static_cast<std::size_t>(partner));
+            assignedMask |= 1u << static_cast<unsigned>(partner);
+        }
+    }
+
+    bool lastCombined = false;
+    for(const auto& pair : pairs)
+    {
+        // the surrounding instructions might have changed by previous combinations, so re-check the context and
+        // whether the instructions in between (which might be combined now) still allow the move
+        if(canCombine(window[pair.first], window[pair.second], config) &&
+            canBeMovedUpTo(window[pair.first], window[pair.second]) &&
+            combineInstructions(window[pair.first], window[pair.second]))
+        {
+            hasChanged = true;
+            lastCombined = lastCombined || pair.second == numInstructions - 1;
+        }
+    }
+    return lastCombined;
+}
+
 bool optimizations::combineOperations(const Module& module, Method& method, const Configuration& config)
 {
     // TODO can combine operation x and y if y is something like (result of x & 0xFF/0xFFFF) -> pack-mode
+    if(config.additionalOptions.combineWindowSize > MAX_COMBINATION_WINDOW)
+        logging::warn() << "Window size for combining instructions of " << config.additionalOptions.combineWindowSize
+                        << " is not supported, using the maximum of " << MAX_COMBINATION_WINDOW << " instead"
+                        << logging::endl;
+    const auto windowSize = std::max(2u, std::min(config.additionalOptions.combineWindowSize, MAX_COMBINATION_WINDOW));
     bool hasChanged = false;
     for(BasicBlock& bb : method)
     {
         auto it = bb.walk();
-        while(!it.isEndOfBlock() && !it.copy().nextInBlock().isEndOfBlock())
+        while(!it.isEndOfBlock())
         {
-            MoveOperation* move = it.get<MoveOperation>();
-            if(move != nullptr)
+            // collect the ALU instructions within the window of the next few instructions
+            const auto windowStart = it;
+            std::vector<InstructionWalker> window;
+            unsigned numInstructions = 0;
+            while(!it.isEndOfBlock() && numInstructions < windowSize)
             {
-                //- remove moves where getSource() is not written to afterwards -> set destination = getSource()
-                // rewrite all following instructions using the original destination
+                if(it.has() && it->mapsToASMInstruction())
+                    ++numInstructions;
+                if(it.get<Operation>() || it.get<MoveOperation>())
+                    window.push_back(it);
+                it.nextInBlock();
             }
-            Operation* op = it.get<Operation>();
-            if(op != nullptr || move != nullptr)
-            {
-                IntermediateInstruction* instr = it.get();
-                auto nextIt = it.copy().nextInBlock();
-                Operation* nextOp = nextIt.get<Operation>();
-                MoveOperation* nextMove = nextIt.get<MoveOperation>();
-                if(nextOp != nullptr || nextMove != nullptr)
-                {
-                    IntermediateInstruction* nextInstr = nextIt.get();
-                    //- combine add/mul instructions, where:
-                    /*
-                     * - combined instructions use at least 2 accumulators, or share getSource()-registers, so that only
-                     * 2 getSource() registers are required
-                     * - the instructions do not depend one-on-another (e.g. out of first is in of second)
-                     * - both instructions write to different locals (or to same local and have inverted conditions)
-                     * - MUL instruction does not set flags (otherwise flags would be applied for ADD output)
-                     * - only one instruction uses a literal (or the literal is the same)
-                     * - both set signals (including immediate ALU operation)
-                     * For now, may be removed (with exceptions):
-                     * - neither of these instructions read/write from special registers
-                     *   otherwise this could cause reading two UNIFORMS at once / writing VPM/VPM_ADDR at once
-                     */
-                    // TODO a written-to register MUST not be read in the next instruction (check instruction
-                    // before/after combined) (unless within local range)
-                    bool conditionsMet = std::all_of(mergeConditions.begin(), mergeConditions.end(),
-                        [op, nextOp, move, nextMove](
-                            const MergeCondition& cond) -> bool { return cond(op, nextOp, move, nextMove); });
-                    if(instr->checkOutputLocal() && nextInstr->checkOutputLocal())
-                    {
-                        // extra check, only combine writes to the same local, if local is only used within the next
-                        // instruction  this is required, since we cannot write to a physical register from both ALUs,
-                        // so the local needs to be on an accumulator
-                        if(instr->getOutput()->local() == nextInstr->getOutput()->local() &&
-                            !nextIt.getBasicBlock()->isLocallyLimited(
-                                nextIt, instr->getOutput()->local(), config.additionalOptions.accumulatorThreshold))
-                            conditionsMet = false;
-                    }
-                    if(instr->checkOutputLocal() || nextInstr->checkOutputLocal())
-                    {
-                        // also check that if the next instruction is a vector rotation, neither of the locals is being
-                        // rotated there  since vector rotations can't rotate vectors which have been written in the
-                        // instruction directly preceding it (true for both full-vector and per-quad rotations)
-                        auto checkIt = nextIt.copy().nextInBlock();
-                        if(!checkIt.isEndOfBlock() && checkIt.get<VectorRotation>())
-                        {
-                            const Value& src = checkIt.get<VectorRotation>()->getSource();
-                            if(instr->checkOutputLocal() && instr->getOutput() == src)
-                                conditionsMet = false;
-                            if(nextInstr->checkOutputLocal() && nextInstr->getOutput() == src)
-                                conditionsMet = false;
-                        }
-                        // the next instruction MUST NOT unpack a value written to in one of the combined instructions
-                        // equally, neither of the combined instructions is allowed to pack a value read in the
-                        // following instructions
-                        if(!checkIt.isEndOfBlock())
-                        {
-                            if(checkIt->unpackMode.hasEffect())
-                            {
-                                if(std::any_of(checkIt->getArguments().begin(), checkIt->getArguments().end(),
-                                       [instr, nextInstr](const Value& val) -> bool {
-                                           return val.checkLocal() &&
-                                               (instr->writesLocal(val.local()) || nextInstr->writesLocal(val.local()));
-                                       }))
-                                {
-                                    conditionsMet = false;
-                                }
-                            }
-                            if(instr->packMode.hasEffect() && instr->checkOutputLocal() &&
-                                checkIt->readsLocal(instr->getOutput()->local()))
-                                conditionsMet = false;
-                            if(nextInstr->packMode.hasEffect() && nextInstr->checkOutputLocal() &&
-                                checkIt->readsLocal(nextInstr->getOutput()->local()))
-                                conditionsMet = false;
-                        }
-                        // run previous checks also for the previous (before instr) instruction
-                        // this time with inverted checks (since the order is inverted)
-                        checkIt = it.copy().previousInBlock();
-                        if(!checkIt.isStartOfBlock() && checkIt->checkOutputLocal())
-                        {
-                            if(checkIt->packMode.hasEffect() &&
-                                (instr->readsLocal(checkIt->getOutput()->local()) ||
-                                    nextInstr->readsLocal(checkIt->getOutput()->local())))
-                                conditionsMet = false;
-                            if(instr->unpackMode.hasEffect() && instr->readsLocal(checkIt->getOutput()->local()))
-                                conditionsMet = false;
-                            if(nextInstr->unpackMode.hasEffect() &&
-                                nextInstr->readsLocal(checkIt->getOutput()->local()))
-                                conditionsMet = false;
-                        }
-                    }
-
-                    if(conditionsMet)
-                    {
-                        hasChanged = true;
-                        // move supports both ADD and MUL ALU
-                        // if merge, make "move" to other op-code or x x / v8max x x
-                        CPPLOG_LAZY(logging::Level::DEBUG,
-                            log << "Merging instructions " << instr->to_string() << " and " << nextInstr->to_string()
-                                << logging::endl);
-                        if(op != nullptr && nextOp != nullptr)
-                        {
-                            it.reset(new CombinedOperation(
-                                dynamic_cast<Operation*>(it.release()), dynamic_cast<Operation*>(nextIt.release())));
-                            nextIt.erase();
-                        }
-                        else if(op != nullptr && nextMove != nullptr)
-                        {
-                            Operation* newMove = nextMove->combineWith(op->op);
-                            if(newMove != nullptr)
-                            {
-                                newMove->copyExtrasFrom(nextMove);
-                                it.reset(new CombinedOperation(dynamic_cast<Operation*>(it.release()), newMove));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << nextMove->to_string()
-                                                << "' with: " << op->to_string() << logging::endl;
-                        }
-                        else if(move != nullptr && nextOp != nullptr)
-                        {
-                            Operation* newMove = move->combineWith(nextOp->op);
-                            if(newMove != nullptr)
-                            {
-                                newMove->copyExtrasFrom(move);
-                                it.reset(new CombinedOperation(newMove, dynamic_cast<Operation*>(nextIt.release())));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << move->to_string()
-                                                << "' with: " << nextOp->to_string() << logging::endl;
-                        }
-                        else if(move != nullptr && nextMove != nullptr)
-                        {
-                            bool firstOnMul = (move->packMode.hasEffect() && move->packMode.supportsMulALU()) ||
-                                (nextMove->packMode.hasEffect() && !nextMove->packMode.supportsMulALU()) ||
-                                nextMove->doesSetFlag();
-                            Operation* newMove0 = move->combineWith(firstOnMul ? OP_ADD : OP_MUL24);
-                            Operation* newMove1 = nextMove->combineWith(firstOnMul ? OP_MUL24 : OP_ADD);
-                            if(newMove0 != nullptr && newMove1 != nullptr)
-                            {
-                                newMove0->copyExtrasFrom(move);
-                                newMove1->copyExtrasFrom(nextMove);
-                                it.reset(new CombinedOperation(newMove0, newMove1));
-                                nextIt.erase();
-                            }
-                            else
-                                logging::warn() << "Error combining move-operation '" << move->to_string()
-                                                << "' with: " << nextMove->to_string() << logging::endl;
-                        }
-                        else
-                            throw CompilationError(CompilationStep::OPTIMIZER, "Unhandled combination, type",
-                                (instr->to_string() + ", ") + nextInstr->to_string());
-                        if(it.get<CombinedOperation>() != nullptr)
-                        {
-                            // move instruction usable on both ALUs to the free ALU
-                            CombinedOperation* comb = it.get<CombinedOperation>();
-                            if(comb->getFirstOp()->op.runsOnAddALU() && comb->getFirstOp()->op.runsOnMulALU())
-                            {
-                                OpCode code = comb->getFirstOp()->op;
-                                if(comb->getSecondOP()->op.runsOnAddALU())
-                                    code.opAdd = 0;
-                                else // by default (e.g. both run on both ALUs), map to ADD ALU
-                                    code.opMul = 0;
-                                dynamic_cast<Operation*>(comb->op1.get())->op = code;
-                                CPPLOG_LAZY(logging::Level::DEBUG,
-                                    log << "Fixing operation available on both ALUs to "
-                                        << (code.opAdd == 0 ? "MUL" : "ADD") << " ALU: " << comb->op1->to_string()
-                                        << logging::endl);
-                            }
-                            if(comb->getSecondOP()->op.runsOnAddALU() && comb->getSecondOP()->op.runsOnMulALU())
-                            {
-                                OpCode code = comb->getSecondOP()->op;
-                                if(comb->getFirstOp()->op.runsOnMulALU())
-                                    code.opMul = 0;
-                                else // by default (e.g. both run on both ALUs), map to MUL ALU
-                                    code.opAdd = 0;
-                                dynamic_cast<Operation*>(comb->op2.get())->op = code;
-                                CPPLOG_LAZY(logging::Level::DEBUG,
-                                    log << "Fixing operation available on both ALUs to "
-                                        << (code.opAdd == 0 ? "MUL" : "ADD") << " ALU: " << comb->op2->to_string()
-                                        << logging::endl);
-                            }
-                        }
-                    }
-                }
-            }
-            it.nextInBlock();
+            if(window.size() < 2)
+                continue;
+            // if the last instruction of the window was not combined, it can still be combined with the instructions
+            // of the next window
+            if(!combineWindow(window, config, hasChanged) && window.back() != windowStart && !it.isEndOfBlock())
+                it = window.back();
         }
     }
 
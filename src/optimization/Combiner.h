@@ -54,6 +54,11 @@ namespace vc4c
          * instruction is not read in second one)
          * - Both instructions write to the same output but with inverted conditions (see example)
          *
+         * The instructions to combine do not need to be adjacent. Within a window of instructions (see
+         * OptimizationOptions#combineWindowSize), the pairing combining the most instructions is selected by an exact
+         * search over all possible pairings. The second instruction of a pair is moved up to the first one, if it does
+         * not depend on any instruction in between.
+         *
          * Example (source taken from #combineSelectionWithZero):
          *   %5 = %11 (ifz)
          *   %5 = xor %11, %11 (ifzc)
@@ -11,6 +11,7 @@
 #include "../analysis/ControlFlowGraph.h"
 #include "../analysis/ControlFlowLoop.h"
 #include "../analysis/DataDependencyGraph.h"
+#include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/Helper.h"
 #include "../intermediate/TypeConversions.h"
 #include "../intermediate/VectorHelper.h"
@@ -23,6 +24,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <limits>
 #include <numeric>
 #include <queue>
 
@@ -128,13 +130,7 @@ static Optional<unsigned> calculateIterationCount(
     return {};
 }
 
-/*
- * For now uses a very simple algorithm:
- * - checks the maximum vector-width used inside the loop
- * - tries to find an optimal factor, which never exceeds 16 elements and divides the number of iterations equally
- */
-static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& loop,
-    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue)
+static unsigned char determineMaximumTypeWidth(const ControlFlowLoop& loop)
 {
     unsigned char maxTypeWidth = 1;
     InstructionWalker it = loop.front()->key->walk();
@@ -151,6 +147,18 @@ static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& lo
     CPPLOG_LAZY(logging::Level::DEBUG,
         log << "Found maximum used vector-width of " << static_cast<unsigned>(maxTypeWidth) << " elements"
             << logging::endl);
+    return maxTypeWidth;
+}
+
+/*
+ * For now uses a very simple algorithm:
+ * - checks the maximum vector-width used inside the loop
+ * - tries to find an optimal factor, which never exceeds 16 elements and divides the number of iterations equally
+ */
+static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& loop,
+    const InductionVariable& inductionVariable, Literal lowerBound, Literal upperBound, Literal stepValue)
+{
+    unsigned char maxTypeWidth = determineMaximumTypeWidth(loop);
 
     // the number of iterations from the bounds depends on the iteration operation
     auto iterations = calculateIterationCount(inductionVariable, lowerBound, upperBound, stepValue);
@@ -173,6 +181,22 @@ static Optional<unsigned> determineVectorizationFactor(const ControlFlowLoop& lo
     return factor;
 }
 
+/*
+ * For loops with an iteration count only known at run-time, the iterations cannot be divided equally, so the biggest
+ * power of two fitting into 16 SIMD-elements is selected and the remaining iterations are handled separately.
+ */
+static unsigned determineRuntimeVectorizationFactor(const ControlFlowLoop& loop)
+{
+    unsigned maxFactor = 16 / determineMaximumTypeWidth(loop);
+    unsigned factor = 1;
+    while(factor * 2 <= maxFactor)
+        factor *= 2;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Determined possible vectorization-factor of " << factor << " for run-time iteration count"
+            << logging::endl);
+    return factor;
+}
+
 /*
  * On the cost-side, we have (as increments):
  * - instructions inserted to construct vectors from scalars
@@ -704,6 +728,514 @@ static void vectorize(ControlFlowLoop& loop, InductionVariable& inductionVariabl
         log << "Vectorization done, changed " << numVectorized << " instructions!" << logging::endl);
 }
 
+/*
+ * The handling of the iterations not filling a whole vector for loops with an iteration count only known at run-time
+ */
+enum class RemainderHandling
+{
+    // the iteration count is known at compile-time and a multiple of the vectorization factor
+    NONE,
+    // the vectorized loop runs for all iterations, the SIMD elements exceeding the iteration count in the last
+    // iteration are masked out
+    MASKED,
+    // the vectorized loop only runs for whole vectors, the remaining iterations are executed by a copy of the original
+    // scalar loop
+    SCALAR_EPILOGUE
+};
+
+/*
+ * Information about a loop with an upper bound only known at run-time
+ */
+struct RuntimeLoopBounds
+{
+    // the upper bound the induction step is compared against
+    Value upperBound;
+    // whether the loop is repeated while the induction step is less than or equal to (instead of less than) the bound
+    bool isLessEquals;
+    // whether the induction step is compared unsigned against the bound
+    bool isUnsigned;
+    // the instructions inside the loop comparing the induction step with the upper bound
+    FastAccessList<InstructionWalker> comparisons;
+    // the basic blocks of the loop in the order of the method, starting with the loop header
+    FastAccessList<BasicBlock*> blocks;
+    // the single block entering the loop
+    BasicBlock* predecessor;
+    // the single block the loop exits into
+    BasicBlock* successor;
+    // the locals written inside of the loop
+    FastSet<const Local*> writtenLocals;
+    // the locals written inside of the loop, whose values are carried over into the next iteration
+    FastSet<const Local*> carriedLocals;
+    // the locals written inside of the loop, which are read after the loop
+    FastSet<const Local*> liveOutLocals;
+};
+
+// Since the iteration count is unknown, the assumed number of iterations to weigh per-iteration costs against one-time
+// costs
+static constexpr int ESTIMATED_RUNTIME_ITERATIONS = 64;
+// the comparison, the boolean branch condition, the branch and its delays
+static constexpr int COST_BOUNDS_CHECK = 9;
+// setting the flags, the two conditional moves and the inversion of the mask
+static constexpr int COST_CREATE_MASK = 4;
+// the two masking operations and the combination of the old and new values
+static constexpr int COST_MASK_VALUE = 3;
+// the replication of the first address and the masking of the address
+static constexpr int COST_MASK_ADDRESS = 2 + COST_MASK_VALUE;
+
+static Optional<RuntimeLoopBounds> analyzeRuntimeBounds(Method& method, const ControlFlowLoop& loop,
+    const FastAccessList<ControlFlowLoop>& loops, const InductionVariable& inductionVariable, Literal stepValue)
+{
+    const char* comparison = inductionVariable.repeatCondition->first;
+    const Value& upperBound = inductionVariable.repeatCondition->second;
+    if(inductionVariable.inductionStep->op != OP_ADD || stepValue.signedInt() != 1 || !upperBound.checkLocal())
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Run-time iteration counts are only supported for loops incrementing by one: "
+                << inductionVariable.inductionStep->to_string() << logging::endl);
+        return {};
+    }
+    bool isLessEquals = comparison == intermediate::COMP_SIGNED_LE || comparison == intermediate::COMP_UNSIGNED_LE;
+    if(!isLessEquals && comparison != intermediate::COMP_SIGNED_LT && comparison != intermediate::COMP_UNSIGNED_LT)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Unsupported comparison for run-time iteration count: " << comparison << logging::endl);
+        return {};
+    }
+    if(std::any_of(
+           loops.begin(), loops.end(), [&](const ControlFlowLoop& other) -> bool { return loop.includes(other); }))
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Run-time iteration counts are not supported for loops containing other loops" << logging::endl);
+        return {};
+    }
+
+    auto header = loop.getHeader();
+    auto predecessors = loop.findPredecessors();
+    auto successors = loop.findSuccessors();
+    if(header == nullptr || predecessors.size() != 1 || successors.size() != 1)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Run-time iteration counts are only supported for loops with a single entry and exit"
+                << logging::endl);
+        return {};
+    }
+
+    bool isUnsigned = comparison == intermediate::COMP_UNSIGNED_LE || comparison == intermediate::COMP_UNSIGNED_LT;
+    RuntimeLoopBounds bounds{upperBound, isLessEquals, isUnsigned, {}, {}, predecessors.front()->key,
+        successors.front()->key, {}, {}, {}};
+    // the blocks of the loop need to be consecutive to be able to insert the code handling the remainder after them
+    bool isConsecutive = true;
+    bool previousInLoop = false;
+    for(auto& block : method)
+    {
+        bool inLoop =
+            std::any_of(loop.begin(), loop.end(), [&](const CFGNode* node) -> bool { return node->key == &block; });
+        if(inLoop && !previousInLoop && !bounds.blocks.empty())
+            isConsecutive = false;
+        if(inLoop)
+            bounds.blocks.push_back(&block);
+        previousInLoop = inLoop;
+    }
+    // the loop is entered directly from the predecessor and only exited from its last block
+    bool isEnteredDirectly = true;
+    bounds.predecessor->forSuccessiveBlocks(
+        [&](BasicBlock& successor) { isEnteredDirectly = isEnteredDirectly && &successor == header->key; });
+    bool isExitedFromTail = true;
+    for(auto block : bounds.blocks)
+    {
+        if(block != bounds.blocks.back())
+            block->forSuccessiveBlocks(
+                [&](BasicBlock& successor) { isExitedFromTail = isExitedFromTail && &successor != bounds.successor; });
+    }
+    if(!isConsecutive || bounds.blocks.front() != header->key || !isEnteredDirectly || !isExitedFromTail)
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Unsupported control-flow for loop with run-time iteration count" << logging::endl);
+        return {};
+    }
+
+    const Local* stepLocal = inductionVariable.inductionStep->checkOutputLocal();
+    for(auto block : bounds.blocks)
+    {
+        for(auto it = block->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has() || it.get<intermediate::BranchLabel>() || it.get<intermediate::Branch>())
+                continue;
+            if(auto loc = it->checkOutputLocal())
+                bounds.writtenLocals.emplace(loc);
+            if(stepLocal && it->readsLocal(stepLocal) && it->readsLocal(upperBound.local()))
+                bounds.comparisons.emplace_back(it);
+        }
+    }
+    if(bounds.comparisons.empty() || bounds.writtenLocals.find(inductionVariable.local) == bounds.writtenLocals.end())
+    {
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Failed to find comparison of induction variable with run-time upper bound: "
+                << upperBound.to_string() << logging::endl);
+        return {};
+    }
+
+    analysis::GlobalLivenessAnalysis liveness;
+    liveness(method);
+    for(auto loc : liveness.getLocalAnalysis(*header->key).getStartResult())
+    {
+        if(bounds.writtenLocals.find(loc) != bounds.writtenLocals.end())
+            bounds.carriedLocals.emplace(loc);
+    }
+    for(auto loc : liveness.getLocalAnalysis(*bounds.successor).getStartResult())
+    {
+        if(bounds.writtenLocals.find(loc) != bounds.writtenLocals.end())
+            bounds.liveOutLocals.emplace(loc);
+    }
+    return bounds;
+}
+
+/*
+ * Determines the instructions whose results need to be masked for the SIMD elements exceeding the iteration count,
+ * together with the (previous) value to keep for these elements.
+ *
+ * Returns an empty value if the loop cannot be executed with masked SIMD elements
+ */
+static Optional<FastAccessList<std::pair<const intermediate::IntermediateInstruction*, const Local*>>>
+determineMaskedWriters(
+    const ControlFlowLoop& loop, const RuntimeLoopBounds& bounds, const InductionVariable& inductionVariable)
+{
+    for(auto block : bounds.blocks)
+    {
+        for(auto it = block->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            // memory is written per row, we cannot mask single elements
+            if(it.has() &&
+                (it->writesRegister(REG_VPM_IO) || it->writesRegister(REG_VPM_OUT_SETUP) ||
+                    it->writesRegister(REG_VPM_DMA_STORE_ADDR)))
+                return {};
+        }
+    }
+
+    FastSet<const Local*> maskedLocals;
+    for(auto loc : bounds.carriedLocals)
+        maskedLocals.emplace(loc);
+    for(auto loc : bounds.liveOutLocals)
+        maskedLocals.emplace(loc);
+    maskedLocals.erase(inductionVariable.local);
+    maskedLocals.erase(inductionVariable.inductionStep->checkOutputLocal());
+
+    // the local holding the value of the previous iteration for every masked local. This is the local itself for
+    // locals carried over into the next iteration or the carried local the value is copied into, e.g. for
+    // "%sum.next = %sum + %x" followed by the copy "%sum = %sum.next", the masked elements of %sum.next are set to %sum
+    FastMap<const Local*, const Local*> previousValues;
+    for(auto loc : maskedLocals)
+    {
+        if(bounds.carriedLocals.find(loc) != bounds.carriedLocals.end())
+            previousValues.emplace(loc, loc);
+    }
+    for(auto block : bounds.blocks)
+    {
+        for(auto it = block->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            auto move = it.get<const intermediate::MoveOperation>();
+            auto carriedLocal = move ? move->checkOutputLocal() : nullptr;
+            auto source = move ? move->getSource().checkLocal() : nullptr;
+            if(!carriedLocal || !source || bounds.carriedLocals.find(carriedLocal) == bounds.carriedLocals.end() ||
+                maskedLocals.find(source) == maskedLocals.end() ||
+                bounds.carriedLocals.find(source) != bounds.carriedLocals.end())
+                continue;
+            auto previousIt = previousValues.emplace(source, carriedLocal).first;
+            if(previousIt->second != carriedLocal)
+                // copied into multiple carried locals, we cannot tell which one holds the previous value
+                previousIt->second = nullptr;
+        }
+    }
+
+    FastAccessList<std::pair<const intermediate::IntermediateInstruction*, const Local*>> maskedWriters;
+    for(auto loc : maskedLocals)
+    {
+        auto previousIt = previousValues.find(loc);
+        bool isMaskable = previousIt != previousValues.end() && previousIt->second != nullptr;
+        loc->forUsers(LocalUse::Type::WRITER, [&](const LocalUser* writer) {
+            if(!isMaskable || !loop.findInLoop(writer))
+                return;
+            if(writer->hasConditionalExecution() || writer->doesSetFlag() || writer->hasSideEffects())
+            {
+                isMaskable = false;
+                return;
+            }
+            auto move = dynamic_cast<const intermediate::MoveOperation*>(writer);
+            auto source = move ? move->getSource().checkLocal() : nullptr;
+            auto sourceIt = source ? previousValues.find(source) : previousValues.end();
+            if(sourceIt != previousValues.end() && sourceIt->first != sourceIt->second && sourceIt->second == loc)
+                // copies the already masked value (which keeps the previous value of this local) back
+                return;
+            maskedWriters.emplace_back(writer, previousIt->second);
+        });
+        if(!isMaskable)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Cannot mask the value of local for loop with run-time iteration count: " << loc->to_string()
+                    << logging::endl);
+            return {};
+        }
+    }
+    return maskedWriters;
+}
+
+/*
+ * The values calculated by the vectorized loop can neither be passed on to the scalar epilogue (except the induction
+ * variable) nor be merged with the values of the scalar epilogue after the loop.
+ */
+static bool canUseScalarEpilogue(const RuntimeLoopBounds& bounds, const InductionVariable& inductionVariable)
+{
+    return bounds.liveOutLocals.empty() &&
+        std::all_of(bounds.carriedLocals.begin(), bounds.carriedLocals.end(),
+            [&](const Local* loc) -> bool { return loc == inductionVariable.local; });
+}
+
+/*
+ * On the cost-side, we have for:
+ * - masking: per vector iteration, the creation of the mask, the masking of the TMU addresses and of all values
+ *   carried over into the next iteration or read after the loop
+ * - scalar epilogue: once, the check of the bounds before both loops and on average, half a vector of iterations
+ *   executed by the scalar loop
+ */
+static std::pair<RemainderHandling, int> selectRemainderHandling(const ControlFlowLoop& loop,
+    const RuntimeLoopBounds& bounds, const InductionVariable& inductionVariable, unsigned vectorizationFactor)
+{
+    int numInstructions = 0;
+    int numTMUAddressWrites = 0;
+    for(auto block : bounds.blocks)
+    {
+        numInstructions += static_cast<int>(block->size());
+        for(auto it = block->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has() && (it->writesRegister(REG_TMU0_ADDRESS) || it->writesRegister(REG_TMU1_ADDRESS)))
+                ++numTMUAddressWrites;
+        }
+    }
+
+    int maskedCosts = std::numeric_limits<int>::max();
+    if(auto maskedWriters = determineMaskedWriters(loop, bounds, inductionVariable))
+    {
+        auto numVectorIterations = std::max(1, ESTIMATED_RUNTIME_ITERATIONS / static_cast<int>(vectorizationFactor));
+        maskedCosts = numVectorIterations *
+            (COST_CREATE_MASK + COST_MASK_ADDRESS * numTMUAddressWrites +
+                COST_MASK_VALUE * static_cast<int>(maskedWriters->size()));
+    }
+    int epilogueCosts = std::numeric_limits<int>::max();
+    if(canUseScalarEpilogue(bounds, inductionVariable))
+        // + 1 for calculating the bound of the vectorized loop and + 1 for passing on the induction variable
+        epilogueCosts = 2 * COST_BOUNDS_CHECK + 2 + numInstructions * static_cast<int>(vectorizationFactor - 1) / 2;
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Estimated costs for handling remaining iterations: masked " << maskedCosts << ", scalar epilogue "
+            << epilogueCosts << logging::endl);
+    if(maskedCosts == std::numeric_limits<int>::max() && epilogueCosts == std::numeric_limits<int>::max())
+        return std::make_pair(RemainderHandling::NONE, 0);
+    if(maskedCosts <= epilogueCosts)
+        return std::make_pair(RemainderHandling::MASKED, maskedCosts);
+    return std::make_pair(RemainderHandling::SCALAR_EPILOGUE, epilogueCosts);
+}
+
+/*
+ * Inserts the comparison of the given value against the upper bound of the loop and returns the condition which is
+ * met if the value is within the bound.
+ */
+static ConditionCode insertBoundsComparison(
+    InstructionWalker& it, Value value, Value bound, const RuntimeLoopBounds& bounds)
+{
+    if(bounds.isUnsigned)
+    {
+        // a <u b <=> (a ^ 0x80000000) <s (b ^ 0x80000000)
+        auto signBit = it.getBasicBlock()->getMethod().addNewLocal(TYPE_INT32, "%sign_bit");
+        it.emplace(new intermediate::LoadImmediate(signBit, Literal(0x80000000u)));
+        it.nextInBlock();
+        value = assign(it, value.type, "%bounds_value") = value ^ signBit;
+        bound = assign(it, bound.type, "%bounds_bound") = bound ^ signBit;
+    }
+    if(bounds.isLessEquals)
+        // value <= bound <=> !(bound < value)
+        return (assignNop(it) = as_signed{bound} < as_signed{value}).invert();
+    return assignNop(it) = as_signed{value} < as_signed{bound};
+}
+
+/*
+ * Inserts a branch to the given target which is taken if the given value is not within the upper bound of the loop
+ */
+NODISCARD static InstructionWalker insertBoundsCheck(Method& method, InstructionWalker it, const Value& value,
+    const Value& bound, const RuntimeLoopBounds& bounds, const Local* target)
+{
+    auto isWithinBounds = insertBoundsComparison(it, value, bound, bounds);
+    auto condValue = method.addNewLocal(TYPE_BOOL, "%bounds_check");
+    assign(it, condValue) = (BOOL_TRUE, isWithinBounds);
+    assign(it, condValue) = (BOOL_FALSE, isWithinBounds.invert());
+    it.emplace(new intermediate::Branch(target, COND_ZERO_SET, condValue));
+    it.nextInBlock();
+    return it;
+}
+
+/*
+ * Inserts a copy of the original scalar loop after the loop, which executes the remaining iterations not filling a
+ * whole vector. This needs to be done before the loop is vectorized.
+ *
+ * Returns the (so far empty) block preceding the copied loop and the copy of the induction variable.
+ */
+static std::pair<BasicBlock*, const Local*> insertScalarEpilogue(
+    Method& method, const InductionVariable& inductionVariable, const RuntimeLoopBounds& bounds)
+{
+    BasicBlock* tail = bounds.blocks.back();
+    auto it = method.emplaceLabel(tail->walkEnd(),
+        new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL, "%vector_epilogue").local()));
+    BasicBlock* epilogueBlock = it.getBasicBlock();
+
+    // the locals written inside the loop are replaced to not be affected by the vectorization
+    FastMap<const Local*, const Local*> renamedLocals;
+    for(auto loc : bounds.writtenLocals)
+    {
+        auto copy = method.addNewLocal(loc->type, loc->name + ".epilogue").local();
+        const_cast<std::pair<Local*, int>&>(copy->reference) = loc->reference;
+        renamedLocals.emplace(loc, copy);
+    }
+
+    // create all blocks first to be able to redirect the branches within the loop to the copied blocks
+    FastMap<const Local*, const Local*> renamedLabels;
+    FastAccessList<BasicBlock*> copiedBlocks;
+    BasicBlock* lastBlock = epilogueBlock;
+    for(auto block : bounds.blocks)
+    {
+        auto label = block->getLabel()->getLabel();
+        it = method.emplaceLabel(lastBlock->walkEnd(),
+            new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL, label->name + ".epilogue").local()));
+        lastBlock = it.getBasicBlock();
+        renamedLabels.emplace(label, lastBlock->getLabel()->getLabel());
+        copiedBlocks.push_back(lastBlock);
+    }
+
+    for(std::size_t i = 0; i < bounds.blocks.size(); ++i)
+    {
+        for(it = bounds.blocks[i]->walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(!it.has())
+                continue;
+            std::unique_ptr<intermediate::IntermediateInstruction> copy(it->copyFor(method, ""));
+            for(const auto& pair : copy->getUsedLocals())
+            {
+                auto renamedIt = renamedLocals.find(pair.first);
+                if(renamedIt != renamedLocals.end())
+                    copy->replaceLocal(pair.first, renamedIt->second, pair.second);
+            }
+            if(auto branch = dynamic_cast<const intermediate::Branch*>(copy.get()))
+            {
+                auto labelIt = renamedLabels.find(branch->getTarget());
+                if(labelIt != renamedLabels.end())
+                    copy.reset((new intermediate::Branch(labelIt->second, branch->conditional, branch->getCondition()))
+                                   ->copyExtrasFrom(branch));
+            }
+            copiedBlocks[i]->walkEnd().emplace(copy.release());
+        }
+    }
+
+    // the vectorized loop exits into the epilogue instead of the original successor. This needs to be done after
+    // copying the loop, since the scalar loop still exits into the original successor
+    for(it = tail->walk(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        auto branch = it.get<intermediate::Branch>();
+        if(branch && branch->getTarget() == bounds.successor->getLabel()->getLabel())
+            it.reset((new intermediate::Branch(
+                          epilogueBlock->getLabel()->getLabel(), branch->conditional, branch->getCondition()))
+                         ->copyExtrasFrom(branch));
+    }
+
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Inserted scalar epilogue with " << copiedBlocks.size() << " blocks starting at "
+            << epilogueBlock->getLabel()->getLabel()->name << logging::endl);
+    return std::make_pair(epilogueBlock, renamedLocals.at(inductionVariable.local));
+}
+
+/*
+ * Restricts the vectorized loop to whole vectors of iterations and inserts the checks whether to execute the
+ * vectorized loop and the scalar epilogue at all.
+ */
+static void finishScalarEpilogue(Method& method, const InductionVariable& inductionVariable,
+    const RuntimeLoopBounds& bounds, BasicBlock& epilogueBlock, const Local* epilogueInductionVariable,
+    Literal lowerBound, unsigned vectorizationFactor)
+{
+    // insert before the branch into the loop, if any
+    auto it = bounds.predecessor->walkEnd().previousInBlock();
+    while(it.get<intermediate::Branch>())
+        it.previousInBlock();
+    it.nextInBlock();
+
+    // all elements of the vectorized loop are within the bounds: i + (factor - 1) < bound <=> i < bound - (factor - 1)
+    // The first check does not subtract from the bound, since it might wrap around for unsigned bounds. If the loop is
+    // entered, the bound is large enough to subtract from it.
+    auto vectorBound = assign(it, bounds.upperBound.type, "%vector_bound") =
+        bounds.upperBound - Value(Literal(vectorizationFactor - 1u), TYPE_INT8);
+    it = insertBoundsCheck(method, it,
+        Value(Literal(lowerBound.unsignedInt() + (vectorizationFactor - 1u)), bounds.upperBound.type),
+        bounds.upperBound, bounds, epilogueBlock.getLabel()->getLabel());
+    for(auto comparisonIt : bounds.comparisons)
+        comparisonIt->replaceValue(bounds.upperBound, vectorBound, LocalUse::Type::READER);
+
+    // the scalar epilogue continues with the first iteration not executed by the vectorized loop
+    it = epilogueBlock.walk().nextInBlock();
+    it = insertVectorExtraction(
+        it, method, inductionVariable.local->createReference(), INT_ZERO, epilogueInductionVariable->createReference());
+    it = insertBoundsCheck(method, it, epilogueInductionVariable->createReference(), bounds.upperBound, bounds,
+        bounds.successor->getLabel()->getLabel());
+}
+
+/*
+ * Masks out the SIMD elements exceeding the iteration count for all iterations of the vectorized loop.
+ */
+static void maskRemainder(Method& method, const ControlFlowLoop& loop, const InductionVariable& inductionVariable,
+    const RuntimeLoopBounds& bounds, unsigned vectorizationFactor)
+{
+    auto maskedWriters = determineMaskedWriters(loop, bounds, inductionVariable).value();
+
+    // the elements of the current iteration which would be executed by the scalar loop
+    auto it = bounds.blocks.front()->walk().nextInBlock();
+    auto isWithinBounds =
+        insertBoundsComparison(it, inductionVariable.local->createReference(), bounds.upperBound, bounds);
+    auto maskType = TYPE_INT32.toVectorType(static_cast<unsigned char>(vectorizationFactor));
+    auto mask = method.addNewLocal(maskType, "%vector_mask");
+    assign(it, mask) = (INT_MINUS_ONE, isWithinBounds);
+    assign(it, mask) = (INT_ZERO, isWithinBounds.invert());
+    auto inverseMask = assign(it, maskType, "%vector_mask") = ~mask;
+
+    for(auto block : bounds.blocks)
+    {
+        for(it = block->walk(); !it.isEndOfBlock(); it.nextInBlock())
+        {
+            if(it.has() && (it->writesRegister(REG_TMU0_ADDRESS) || it->writesRegister(REG_TMU1_ADDRESS)) &&
+                it->assertArgument(0).checkLocal())
+            {
+                // the masked elements might point after the end of the buffer, so they load from the address of the
+                // first element instead, which is always within the iteration count
+                auto address = it->assertArgument(0);
+                auto firstAddress = method.addNewLocal(address.type, "%masked_address");
+                it = insertReplication(it, address, firstAddress);
+                auto newPart = assign(it, address.type, "%masked_address") = address & mask;
+                auto previousPart = assign(it, address.type, "%masked_address") = firstAddress & inverseMask;
+                auto maskedAddress = assign(it, address.type, "%masked_address") = newPart | previousPart;
+                it->replaceValue(address, maskedAddress, LocalUse::Type::READER);
+            }
+        }
+    }
+
+    for(const auto& pair : maskedWriters)
+    {
+        auto writerIt = loop.findInLoop(pair.first).value();
+        auto output = writerIt->getOutput().value();
+        auto newValue = method.addNewLocal(output.type, "%masked");
+        writerIt->replaceLocal(output.local(), newValue.local(), LocalUse::Type::WRITER);
+        it = writerIt.nextInBlock();
+        auto newPart = assign(it, output.type, "%masked") = newValue & mask;
+        auto previousPart = assign(it, output.type, "%masked") = pair.second->createReference() & inverseMask;
+        assign(it, output) = newPart | previousPart;
+    }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Masked " << maskedWriters.size() << " values for remaining iterations of loop" << logging::endl);
+}
+
 bool optimizations::vectorizeLoops(const Module& module, Method& method, const Configuration& config)
 {
     // 1. find loops
@@ -713,9 +1245,16 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
 
     // 2. determine data dependencies of loop bodies
     auto dependencyGraph = DataDependencyGraph::createDependencyGraph(method);
+    // the loops with run-time iteration count, which were extended by the handling of the remaining iterations
+    FastAccessList<const ControlFlowLoop*> extendedLoops;
 
     for(auto& loop : loops)
     {
+        if(std::any_of(extendedLoops.begin(), extendedLoops.end(),
+               [&](const ControlFlowLoop* other) -> bool { return loop.includes(*other); }))
+            // the blocks inserted for the inner loop are not part of the loop (or the data dependencies)
+            continue;
+
         // 3. determine operation on iteration variable and bounds
         auto inductionVariable = extractLoopControl(loop, *dependencyGraph);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 333, "Loops found", 1);
@@ -736,10 +1275,10 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
         auto lowerBound = (inductionVariable.initialAssignment->precalculate(4).first & &Value::getLiteralValue);
         auto upperBound = inductionVariable.repeatCondition->second.getLiteralValue();
 
-        if(!lowerBound || !upperBound)
+        if(!lowerBound)
         {
             CPPLOG_LAZY(logging::Level::DEBUG,
-                log << "Upper or lower bound is not a literal value, aborting vectorization!" << logging::endl);
+                log << "Lower bound is not a literal value, aborting vectorization!" << logging::endl);
             continue;
         }
 
@@ -759,9 +1298,25 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
             continue;
         }
 
+        // an upper bound only known at run-time requires the remaining iterations to be handled separately
+        Optional<RuntimeLoopBounds> runtimeBounds;
+        if(!upperBound)
+        {
+            runtimeBounds = analyzeRuntimeBounds(method, loop, loops, inductionVariable, *stepConstant);
+            if(!runtimeBounds)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Upper bound is not a literal value and not supported as run-time bound, aborting "
+                           "vectorization!"
+                        << logging::endl);
+                continue;
+            }
+        }
+
         // 4. determine vectorization factor
-        Optional<unsigned> vectorizationFactor =
-            determineVectorizationFactor(loop, inductionVariable, *lowerBound, *upperBound, *stepConstant);
+        Optional<unsigned> vectorizationFactor = upperBound ?
+            determineVectorizationFactor(loop, inductionVariable, *lowerBound, *upperBound, *stepConstant) :
+            determineRuntimeVectorizationFactor(loop);
         if(!vectorizationFactor)
         {
             CPPLOG_LAZY(logging::Level::DEBUG,
@@ -778,6 +1333,14 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
 
         // 5. cost-benefit calculation
         int rating = calculateCostsVsBenefits(loop, inductionVariable, *dependencyGraph, *vectorizationFactor);
+        RemainderHandling remainderHandling = RemainderHandling::NONE;
+        if(runtimeBounds && rating != std::numeric_limits<int>::min())
+        {
+            auto remainder = selectRemainderHandling(loop, *runtimeBounds, inductionVariable, *vectorizationFactor);
+            remainderHandling = remainder.first;
+            rating = remainderHandling == RemainderHandling::NONE ? std::numeric_limits<int>::min() :
+                                                                    rating - remainder.second;
+        }
         if(rating < 0 /* TODO some positive factor to be required before vectorizing loops? */)
         {
             // vectorization (probably) doesn't pay off
@@ -788,13 +1351,26 @@ bool optimizations::vectorizeLoops(const Module& module, Method& method, const C
         }
 
         // 6. run vectorization
+        std::pair<BasicBlock*, const Local*> epilogue{nullptr, nullptr};
+        if(remainderHandling == RemainderHandling::SCALAR_EPILOGUE)
+            // the scalar loop needs to be copied before it is vectorized
+            epilogue = insertScalarEpilogue(method, inductionVariable, *runtimeBounds);
         vectorize(loop, inductionVariable, method, *dependencyGraph, *vectorizationFactor, *stepConstant);
+        if(remainderHandling == RemainderHandling::SCALAR_EPILOGUE)
+            finishScalarEpilogue(method, inductionVariable, *runtimeBounds, *epilogue.first, epilogue.second,
+                *lowerBound, *vectorizationFactor);
+        else if(remainderHandling == RemainderHandling::MASKED)
+            maskRemainder(method, loop, inductionVariable, *runtimeBounds, *vectorizationFactor);
+        if(runtimeBounds)
+            extendedLoops.push_back(&loop);
         // increasing the iteration step might create a value not fitting into small immediate
         normalization::handleImmediate(
             module, method, loop.findInLoop(inductionVariable.inductionStep).value(), config);
         hasChanged = true;
 
         PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 334, "Vectorization factors", *vectorizationFactor);
+        PROFILE_COUNTER(
+            vc4c::profiler::COUNTER_OPTIMIZATION + 335, "Run-time bound loops vectorized", runtimeBounds ? 1 : 0);
     }
 
     return hasChanged;
@@ -18,6 +18,10 @@ namespace vc4c
         /*
          * Tries to find loops which then can be vectorized by combining multiple iterations into one.
          *
+         * For loops with an upper bound only known at run-time (e.g. a kernel parameter), the iterations not filling a
+         * whole vector are either executed by the vectorized loop with the exceeding SIMD elements masked out or by a
+         * copy of the original scalar loop, whichever is estimated to be cheaper.
+         *
          * NOTE: Currently only works with "standard" for-range loops and needs to be enabled explicitly in the
          * Configuration
          */
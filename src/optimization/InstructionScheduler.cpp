@@ -8,10 +8,14 @@
 
 #include "../InstructionWalker.h"
 #include "../Profiler.h"
+#include "../analysis/ControlFlowGraph.h"
 #include "../analysis/DependencyGraph.h"
+#include "../analysis/LivenessAnalysis.h"
 #include "../intermediate/IntermediateInstruction.h"
 #include "log.h"
 
+#include <algorithm>
+
 using namespace vc4c;
 using namespace vc4c::optimizations;
 
@@ -329,3 +333,317 @@ bool optimizations::reorderInstructions(const Module& module, Method& kernel, co
     }
     return false;
 }
+
+// the factor by which every loop level multiplies the estimated execution frequency of a block
+static constexpr unsigned LOOP_FREQUENCY_FACTOR = 8;
+// the limit for the estimated frequencies to not overflow for deeply nested loops
+static constexpr unsigned MAX_FREQUENCY = 1u << 24u;
+
+using BlockFrequencies = FastMap<const BasicBlock*, unsigned>;
+using Trace = std::vector<BasicBlock*>;
+
+/*
+ * Statically estimates the relative execution frequencies of all blocks, assuming every loop to be executed
+ * LOOP_FREQUENCY_FACTOR times
+ */
+static BlockFrequencies estimateBlockFrequencies(Method& method)
+{
+    BlockFrequencies frequencies;
+    for(BasicBlock& bb : method)
+        frequencies.emplace(&bb, 1);
+    for(const auto& loop : method.getCFG().findLoops(true))
+    {
+        for(const CFGNode* node : loop)
+        {
+            auto& freq = frequencies[node->key];
+            freq = std::min(freq * LOOP_FREQUENCY_FACTOR, MAX_FREQUENCY);
+        }
+    }
+    return frequencies;
+}
+
+/*
+ * Selects the most probably executed successor not yet part of any trace. If the frequencies are equal, the successor
+ * located directly after the block (e.g. the fall-through) is preferred.
+ */
+static BasicBlock* selectTraceSuccessor(BasicBlock& block, const BlockFrequencies& frequencies,
+    const FastMap<const BasicBlock*, std::size_t>& blockIndices, const FastSet<const BasicBlock*>& visitedBlocks)
+{
+    BasicBlock* selected = nullptr;
+    const auto blockIndex = blockIndices.at(&block);
+    block.forSuccessiveBlocks([&](BasicBlock& successor) {
+        if(visitedBlocks.find(&successor) != visitedBlocks.end())
+            return;
+        if(selected == nullptr || frequencies.at(&successor) > frequencies.at(selected) ||
+            (frequencies.at(&successor) == frequencies.at(selected) &&
+                blockIndices.at(&successor) == blockIndex + 1))
+            selected = &successor;
+    });
+    return selected;
+}
+
+/*
+ * Greedily forms traces by starting at the most frequently executed block not yet part of any trace and following its
+ * most frequently executed successors.
+ */
+static std::vector<Trace> formTraces(Method& method, const BlockFrequencies& frequencies)
+{
+    std::vector<BasicBlock*> seeds;
+    FastMap<const BasicBlock*, std::size_t> blockIndices;
+    for(BasicBlock& bb : method)
+    {
+        blockIndices.emplace(&bb, seeds.size());
+        seeds.push_back(&bb);
+    }
+    std::stable_sort(seeds.begin(), seeds.end(), [&](const BasicBlock* one, const BasicBlock* other) -> bool {
+        return frequencies.at(one) > frequencies.at(other);
+    });
+
+    std::vector<Trace> traces;
+    FastSet<const BasicBlock*> visitedBlocks;
+    for(BasicBlock* seed : seeds)
+    {
+        if(visitedBlocks.find(seed) != visitedBlocks.end())
+            continue;
+        Trace trace{seed};
+        visitedBlocks.emplace(seed);
+        while(auto next = selectTraceSuccessor(*trace.back(), frequencies, blockIndices, visitedBlocks))
+        {
+            trace.push_back(next);
+            visitedBlocks.emplace(next);
+        }
+        logging::logLazy(logging::Level::DEBUG, [&](std::wostream& log) {
+            log << "Formed trace: ";
+            for(const BasicBlock* bb : trace)
+                log << bb->getLabel()->getLabel()->name << " ";
+            log << logging::endl;
+        });
+        traces.emplace_back(std::move(trace));
+    }
+    return traces;
+}
+
+/*
+ * Only "pure" calculations which read nothing but locals and literals and have no other effect than writing their
+ * single output local can be moved across blocks
+ */
+static bool isHoistable(const intermediate::IntermediateInstruction* inst)
+{
+    if(!inst->mapsToASMInstruction() || inst->hasSideEffects() || inst->hasConditionalExecution() ||
+        inst->setFlags != SetFlag::DONT_SET || inst->signal != SIGNAL_NONE)
+        return false;
+    if(dynamic_cast<const intermediate::VectorRotation*>(inst) ||
+        (dynamic_cast<const intermediate::Operation*>(inst) == nullptr &&
+            dynamic_cast<const intermediate::MoveOperation*>(inst) == nullptr &&
+            dynamic_cast<const intermediate::LoadImmediate*>(inst) == nullptr))
+        return false;
+    if(!inst->checkOutputLocal() || inst->getOutput()->local()->getSingleWriter() != inst)
+        return false;
+    const Local* out = inst->getOutput()->local();
+    return std::all_of(inst->getArguments().begin(), inst->getArguments().end(), [&](const Value& arg) -> bool {
+        return (arg.checkLocal() && arg.local() != out) || arg.getLiteralValue();
+    });
+}
+
+/*
+ * Returns whether the instruction to be moved accesses any local the other instruction writes or reads the output of
+ * the instruction to be moved
+ */
+static bool hasDependency(
+    const intermediate::IntermediateInstruction* inst, const intermediate::IntermediateInstruction* other)
+{
+    const Local* out = inst->getOutput()->local();
+    if(other->readsLocal(out) || other->writesLocal(out))
+        return true;
+    return std::any_of(inst->getArguments().begin(), inst->getArguments().end(),
+        [&](const Value& arg) -> bool { return arg.checkLocal() && other->writesLocal(arg.local()); });
+}
+
+/*
+ * Returns whether the local is live at the start of any of the successors of the given block except the excluded one,
+ * in which case writing it at the end of the block would change the program semantics
+ */
+static bool isLiveInOtherSuccessor(const BasicBlock& block, const BasicBlock& excludedSuccessor, const Local* local,
+    const analysis::GlobalLivenessAnalysis& liveness)
+{
+    bool isLive = false;
+    block.forSuccessiveBlocks([&](BasicBlock& successor) {
+        if(&successor == &excludedSuccessor)
+            return;
+        const auto& liveLocals = liveness.getLocalAnalysis(successor).getStartResult();
+        isLive = isLive || liveLocals.find(local) != liveLocals.end();
+    });
+    return isLive;
+}
+
+/*
+ * Returns the position before the branches terminating the given block, where any compensation code can be inserted
+ */
+static InstructionWalker findEndOfBlockBody(BasicBlock& block)
+{
+    auto it = block.walkEnd();
+    while(!it.copy().previousInBlock().isStartOfBlock())
+    {
+        auto prev = it.copy().previousInBlock();
+        if(prev.has() && !prev.get<intermediate::Branch>())
+            break;
+        it = prev;
+    }
+    return it;
+}
+
+/*
+ * Checks whether the instruction can be executed at the given position in the given block (instead of at the start of
+ * the successor block)
+ */
+static bool canBeMovedToEndOfBlock(const intermediate::IntermediateInstruction* inst, BasicBlock& block,
+    InstructionWalker position, const BasicBlock& successor, const analysis::GlobalLivenessAnalysis& liveness)
+{
+    for(auto it = position; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(it.has() && hasDependency(inst, it.get()))
+            return false;
+    }
+    return !isLiveInOtherSuccessor(block, successor, inst->getOutput()->local(), liveness);
+}
+
+/*
+ * Finds an instruction at the start of the successor which can replace the NOP at the given position without changing
+ * the semantics of the program or violating any other delays
+ */
+static InstructionWalker findHoistCandidate(Method& method, BasicBlock& block, InstructionWalker nopIt,
+    BasicBlock& successor, const BlockFrequencies& frequencies, const analysis::GlobalLivenessAnalysis& liveness,
+    unsigned searchThreshold)
+{
+    // the NOP may be inserted to split a read-after-write, so we must not read the value written before the NOP
+    auto lastIt = nopIt.copy().previousInBlock();
+    while(!lastIt.isStartOfBlock() && !(lastIt.has() && lastIt->mapsToASMInstruction()))
+        lastIt.previousInBlock();
+    if(lastIt.isStartOfBlock())
+        // the reason for the NOP is in some preceding block, which we do not know
+        return successor.walkEnd();
+    const Local* lastWritten = lastIt->checkOutputLocal() ? lastIt->getOutput()->local() : nullptr;
+
+    // all other predecessors of the successor need compensation code, which only pays off if they are executed more
+    // rarely than the block we move the instruction into
+    FastMap<BasicBlock*, InstructionWalker> compensationPositions;
+    unsigned compensationFrequency = 0;
+    bool canCompensate = true;
+    successor.forPredecessors([&](InstructionWalker it) {
+        BasicBlock* pred = it.getBasicBlock();
+        if(pred == &block || compensationPositions.find(pred) != compensationPositions.end())
+            return;
+        if(pred == &successor)
+            // self-loops are not supported
+            canCompensate = false;
+        compensationPositions.emplace(pred, findEndOfBlockBody(*pred));
+        compensationFrequency += frequencies.at(pred);
+    });
+    if(!canCompensate || (!compensationPositions.empty() && compensationFrequency >= frequencies.at(&block)))
+        return successor.walkEnd();
+
+    const intermediate::IntermediateInstruction* lastChecked = nullptr;
+    FastAccessList<const intermediate::IntermediateInstruction*> skippedInstructions;
+    auto it = successor.walk().nextInBlock();
+    while(!it.isEndOfBlock() && searchThreshold > 0)
+    {
+        --searchThreshold;
+        if(!it.has())
+        {
+            it.nextInBlock();
+            continue;
+        }
+        // Do not look past any delays or instructions accessing registers, since the instructions in between might be
+        // required to fill the delay slots
+        if(it.get<intermediate::Nop>() || it.get<intermediate::Branch>() || it.get<intermediate::MemoryBarrier>() ||
+            it.get<intermediate::MutexLock>() || it.get<intermediate::SemaphoreAdjustment>() ||
+            (it->getOutput() && !it->checkOutputLocal()) ||
+            std::any_of(it->getArguments().begin(), it->getArguments().end(),
+                [](const Value& arg) -> bool { return arg.checkRegister(); }))
+            break;
+        auto candidate = it.get();
+        auto nextIt = it.copy().nextInBlock();
+        while(!nextIt.isEndOfBlock() && !nextIt.has())
+            nextIt.nextInBlock();
+        // removing the instruction must not create a new read-after-write in the successor
+        bool createsReadAfterWrite = lastChecked != nullptr && lastChecked->checkOutputLocal() &&
+            !nextIt.isEndOfBlock() && nextIt->readsLocal(lastChecked->getOutput()->local());
+        if(isHoistable(candidate) && !createsReadAfterWrite &&
+            (lastWritten == nullptr || !candidate->readsLocal(lastWritten)) &&
+            std::none_of(skippedInstructions.begin(), skippedInstructions.end(),
+                [&](const intermediate::IntermediateInstruction* skipped) -> bool {
+                    return hasDependency(candidate, skipped);
+                }) &&
+            canBeMovedToEndOfBlock(candidate, block, nopIt.copy().nextInBlock(), successor, liveness) &&
+            std::all_of(compensationPositions.begin(), compensationPositions.end(),
+                [&](const std::pair<BasicBlock* const, InstructionWalker>& pos) -> bool {
+                    return canBeMovedToEndOfBlock(candidate, *pos.first, pos.second, successor, liveness);
+                }))
+        {
+            // insert compensation code
+            for(auto& pos : compensationPositions)
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Inserting compensation code for moving '" << candidate->to_string() << "' into block "
+                        << pos.first->getLabel()->getLabel()->name << logging::endl);
+                pos.second.emplace(candidate->copyFor(method, ""));
+            }
+            return it;
+        }
+        skippedInstructions.push_back(candidate);
+        if(candidate->mapsToASMInstruction())
+            lastChecked = candidate;
+        it.nextInBlock();
+    }
+    return successor.walkEnd();
+}
+
+/*
+ * Replaces the NOPs in the given block with instructions from the start of the successor
+ *
+ * Since every move (and the accompanying compensation code) changes the live locals at the block boundaries, the
+ * liveness is updated after each move.
+ */
+static unsigned fillDelaysFromSuccessor(Method& method, BasicBlock& block, BasicBlock& successor,
+    const BlockFrequencies& frequencies, analysis::GlobalLivenessAnalysis& liveness, unsigned searchThreshold)
+{
+    unsigned numMoved = 0;
+    for(auto it = block.walk().nextInBlock(); !it.isEndOfBlock(); it.nextInBlock())
+    {
+        auto nop = it.get<const intermediate::Nop>();
+        if(nop == nullptr || nop->hasSideEffects() || nop->type == intermediate::DelayType::THREAD_END ||
+            nop->type == intermediate::DelayType::BRANCH_DELAY)
+            continue;
+        auto candidateIt =
+            findHoistCandidate(method, block, it, successor, frequencies, liveness, searchThreshold);
+        if(candidateIt.isEndOfBlock())
+            continue;
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Moving '" << candidateIt->to_string() << "' from block "
+                << successor.getLabel()->getLabel()->name << " to replace NOP in block "
+                << block.getLabel()->getLabel()->name << logging::endl);
+        it.reset(candidateIt.release());
+        candidateIt.erase();
+        ++numMoved;
+        liveness(method);
+    }
+    return numMoved;
+}
+
+bool optimizations::scheduleTraces(const Module& module, Method& kernel, const Configuration& config)
+{
+    auto frequencies = estimateBlockFrequencies(kernel);
+    auto traces = formTraces(kernel, frequencies);
+    analysis::GlobalLivenessAnalysis liveness;
+    liveness(kernel);
+
+    unsigned numMoved = 0;
+    for(const auto& trace : traces)
+    {
+        for(std::size_t i = 1; i < trace.size(); ++i)
+            numMoved += fillDelaysFromSuccessor(kernel, *trace[i - 1], *trace[i], frequencies, liveness,
+                config.additionalOptions.replaceNopThreshold);
+    }
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 400, "Trace instructions moved", numMoved);
+    return numMoved > 0;
+}
@@ -17,6 +17,36 @@ namespace vc4c
     {
         bool reorderInstructions(const Module& module, Method& kernel, const Configuration& config);
 
+        /*
+         * Schedules instructions across basic block boundaries along the (statically estimated) hot paths of the
+         * control flow.
+         *
+         * Traces are formed by greedily following the successor with the highest estimated execution frequency (blocks
+         * inside of loops are assumed to be executed more often). For every transition within a trace, NOPs at the end
+         * of the predecessor are replaced with independent instructions hoisted from the start of the successor. If the
+         * successor has other predecessors, a copy of the hoisted instruction is inserted at their ends as compensation
+         * code. Hoisting is only done if the moved value is not live in any other successor of the blocks it is moved
+         * into.
+         *
+         * Example:
+         *   label: %a
+         *   sfu_recip = %2
+         *   nop (wait for SFU)
+         *   nop (wait for SFU)
+         *   %4 = mov r4
+         *   label: %b
+         *   %5 = mul24 %6, %7
+         *
+         * is converted to:
+         *   label: %a
+         *   sfu_recip = %2
+         *   %5 = mul24 %6, %7
+         *   nop (wait for SFU)
+         *   %4 = mov r4
+         *   label: %b
+         */
+        bool scheduleTraces(const Module& module, Method& kernel, const Configuration& config);
+
     } /* namespace optimizations */
 } /* namespace vc4c */
 
@@ -17,6 +17,7 @@
 #include "InstructionScheduler.h"
 #include "LocalCompression.h"
 #include "Reordering.h"
+#include "Vectorizer.h"
 #include "log.h"
 
 using namespace vc4c;
@@ -253,6 +254,8 @@ const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
         "merges adjacent basic blocks if there are no other conflicting transitions", OptimizationType::INITIAL),
     OptimizationPass("VectorizeLoops", "vectorize-loops", vectorizeLoops, "vectorizes supported types of loops",
         OptimizationType::INITIAL),
+    OptimizationPass("VectorizeSuperwords", "vectorize-superwords", vectorizeSuperwords,
+        "packs isomorphic independent scalar operations into vector operations", OptimizationType::INITIAL),
     /*
      * The second block executes optimizations only within a single basic block.
      * These optimizations may be executed in a loop until there are not more changes to the instructions
@@ -295,11 +298,19 @@ const std::vector<OptimizationPass> Optimizer::ALL_PASSES = {
     OptimizationPass("CacheAcrossWorkGroup", "work-group-cache", cacheWorkGroupDMAAccess,
         "finds memory access across the work-group which can be cached in VPM to combine the DMA operation (WIP)",
         OptimizationType::FINAL),
+    OptimizationPass("MinimizeMutexSections", "minimize-mutex-sections", minimizeMutexSections,
+        "merges adjacent critical sections and moves independent instructions out of them", OptimizationType::FINAL),
+    OptimizationPass("ScheduleTMULoads", "schedule-tmu-loads", scheduleTMULoads,
+        "issues independent TMU loads ahead and distributes them to both TMUs to hide the memory latency",
+        OptimizationType::FINAL),
     OptimizationPass("InstructionScheduler", "schedule-instructions", reorderInstructions,
         "schedule instructions according to their dependencies within basic blocks (WIP, slow)",
         OptimizationType::FINAL),
     OptimizationPass("ReorderInstructions", "reorder", reorderWithinBasicBlocks,
         "re-order instructions to eliminate more NOPs and stall cycles", OptimizationType::FINAL),
+    OptimizationPass("ScheduleTraces", "schedule-traces", scheduleTraces,
+        "moves instructions across basic blocks along the hot paths to eliminate NOPs not removable within the blocks",
+        OptimizationType::FINAL),
     OptimizationPass("CombineALUIinstructions", "combine", combineOperations,
         "run peep-hole optimization to combine ALU-operations", OptimizationType::FINAL)};
 
@@ -310,9 +321,13 @@ std::set<std::string> Optimizer::getPasses(OptimizationLevel level)
     {
     case OptimizationLevel::FULL:
         passes.emplace("vectorize-loops");
+        passes.emplace("vectorize-superwords");
         passes.emplace("extract-loads-from-loops");
         passes.emplace("schedule-instructions");
+        passes.emplace("schedule-traces");
         passes.emplace("work-group-cache");
+        passes.emplace("minimize-mutex-sections");
+        passes.emplace("schedule-tmu-loads");
         // XXX move CSE to medium? Need to profile performance and re-check all emulation tests with CSE enabled
         passes.emplace("eliminate-common-subexpressions");
         // XXX if tested enough, move to full
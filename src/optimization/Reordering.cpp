@@ -8,6 +8,7 @@
 
 #include "../Profiler.h"
 #include "../intermediate/Helper.h"
+#include "../periphery/TMU.h"
 #include "log.h"
 
 using namespace vc4c;
@@ -414,6 +415,351 @@ bool optimizations::reorderWithinBasicBlocks(const Module& module, Method& metho
     return hasChanged;
 }
 
+// the maximum number of instructions between two critical sections to still merge them
+static constexpr unsigned MAX_MUTEX_GAP = 8;
+// the maximum number of instructions within a critical section to check for moving out of the section
+static constexpr unsigned MAX_MUTEX_SECTION_SEARCH = 64;
+
+static bool isMutexLock(const InstructionWalker& it, bool lock)
+{
+    auto mutex = it.get<const MutexLock>();
+    return mutex && (lock ? mutex->locksMutex() : mutex->releasesMutex());
+}
+
+static bool isSynchronization(const InstructionWalker& it)
+{
+    return it.get<const MutexLock>() || it.get<const SemaphoreAdjustment>() || it.get<const MemoryBarrier>() ||
+        it.get<const Branch>() || it.get<const BranchLabel>();
+}
+
+/*
+ * Only simple calculations on locals can be moved, everything accessing any register (e.g. VPM or DMA setup, reading
+ * VPM), setting or depending on flags, or requiring a specific delay (NOPs, vector rotations) needs to stay in place.
+ */
+static bool canBeMovedOutOfMutexSection(const IntermediateInstruction* inst)
+{
+    if(!inst || !inst->mapsToASMInstruction() || !inst->checkOutputLocal())
+        return false;
+    if(dynamic_cast<const Nop*>(inst) || dynamic_cast<const VectorRotation*>(inst) ||
+        dynamic_cast<const MutexLock*>(inst) || dynamic_cast<const SemaphoreAdjustment*>(inst))
+        return false;
+    if(inst->hasSideEffects() || inst->hasConditionalExecution() || inst->signal != SIGNAL_NONE)
+        return false;
+    return std::none_of(inst->getArguments().begin(), inst->getArguments().end(),
+        [](const Value& arg) -> bool { return arg.checkRegister(); });
+}
+
+static bool isIndependentOf(const IntermediateInstruction* inst, const FastSet<const Local*>& writtenLocals,
+    const FastSet<const Local*>& readLocals)
+{
+    auto out = inst->checkOutputLocal();
+    if(writtenLocals.find(out) != writtenLocals.end() || readLocals.find(out) != readLocals.end())
+        return false;
+    return std::none_of(inst->getArguments().begin(), inst->getArguments().end(), [&](const Value& arg) -> bool {
+        return arg.checkLocal() && writtenLocals.find(arg.local()) != writtenLocals.end();
+    });
+}
+
+static void addAccessedLocals(
+    const IntermediateInstruction* inst, FastSet<const Local*>& writtenLocals, FastSet<const Local*>& readLocals)
+{
+    if(auto out = inst->checkOutputLocal())
+        writtenLocals.emplace(out);
+    for(const auto& arg : inst->getArguments())
+    {
+        if(auto loc = arg.checkLocal())
+            readLocals.emplace(loc);
+    }
+}
+
+/*
+ * Moves all instructions of the critical section which do not depend on the other instructions in the section before
+ * the mutex acquire
+ */
+static std::size_t hoistOutOfMutexSection(InstructionWalker lockIt, InstructionWalker releaseIt)
+{
+    std::size_t numMoved = 0;
+    FastSet<const Local*> writtenLocals;
+    FastSet<const Local*> readLocals;
+    auto it = lockIt.copy().nextInBlock();
+    for(unsigned i = 0; i < MAX_MUTEX_SECTION_SEARCH && !it.isEndOfBlock() && it != releaseIt; ++i)
+    {
+        if(!it.has())
+        {
+            it.nextInBlock();
+            continue;
+        }
+        if(canBeMovedOutOfMutexSection(it.get()) && isIndependentOf(it.get(), writtenLocals, readLocals))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Moving instruction before critical section: " << it->to_string() << logging::endl);
+            lockIt.emplace(it.release());
+            lockIt.nextInBlock();
+            it.erase();
+            ++numMoved;
+            continue;
+        }
+        addAccessedLocals(it.get(), writtenLocals, readLocals);
+        it.nextInBlock();
+    }
+    return numMoved;
+}
+
+/*
+ * Moves all instructions of the critical section which no other instruction in the section depends on after the mutex
+ * release
+ */
+static std::size_t sinkOutOfMutexSection(InstructionWalker lockIt, InstructionWalker releaseIt)
+{
+    std::size_t numMoved = 0;
+    FastSet<const Local*> writtenLocals;
+    FastSet<const Local*> readLocals;
+    auto it = releaseIt.copy().previousInBlock();
+    // instructions are inserted directly after the release in reverse order to retain their original order
+    auto insertIt = releaseIt.copy().nextInBlock();
+    for(unsigned i = 0; i < MAX_MUTEX_SECTION_SEARCH && !it.isStartOfBlock() && it != lockIt; ++i)
+    {
+        if(!it.has())
+        {
+            it.previousInBlock();
+            continue;
+        }
+        // moving backwards, the other instruction reading the output are the instructions after this one
+        if(canBeMovedOutOfMutexSection(it.get()) && isIndependentOf(it.get(), writtenLocals, readLocals))
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Moving instruction after critical section: " << it->to_string() << logging::endl);
+            insertIt.emplace(it.release());
+            it.erase();
+            it.previousInBlock();
+            ++numMoved;
+            continue;
+        }
+        addAccessedLocals(it.get(), writtenLocals, readLocals);
+        it.previousInBlock();
+    }
+    return numMoved;
+}
+
+/*
+ * Removes the mutex release and the following mutex acquire, if there are only a few instructions between them.
+ *
+ * Returns the position after the removed mutex acquire, if the sections were merged
+ */
+static Optional<InstructionWalker> mergeMutexSections(InstructionWalker releaseIt)
+{
+    auto it = releaseIt.copy().nextInBlock();
+    unsigned numInstructions = 0;
+    while(!it.isEndOfBlock() && numInstructions <= MAX_MUTEX_GAP)
+    {
+        if(it.has())
+        {
+            if(isMutexLock(it, true))
+            {
+                CPPLOG_LAZY(logging::Level::DEBUG,
+                    log << "Merging critical sections separated by " << numInstructions << " instructions"
+                        << logging::endl);
+                releaseIt.erase();
+                return it.erase();
+            }
+            if(isSynchronization(it))
+                return {};
+            if(it->mapsToASMInstruction())
+                ++numInstructions;
+        }
+        it.nextInBlock();
+    }
+    return {};
+}
+
+bool optimizations::minimizeMutexSections(const Module& module, Method& method, const Configuration& config)
+{
+    bool hasChanged = false;
+    for(BasicBlock& block : method)
+    {
+        // 1. merge critical sections which are only separated by a few instructions
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has() && isMutexLock(it, false))
+            {
+                if(auto nextIt = mergeMutexSections(it))
+                {
+                    hasChanged = true;
+                    it = *nextIt;
+                    continue;
+                }
+            }
+            it.nextInBlock();
+        }
+
+        // 2. move independent instructions out of the critical sections
+        it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(it.has() && isMutexLock(it, true))
+            {
+                auto releaseIt = it.copy().nextInBlock();
+                while(!releaseIt.isEndOfBlock() && !(releaseIt.has() && isMutexLock(releaseIt, false)))
+                    releaseIt.nextInBlock();
+                if(releaseIt.isEndOfBlock())
+                    // critical section spans multiple blocks
+                    break;
+                auto numMoved = hoistOutOfMutexSection(it, releaseIt) + sinkOutOfMutexSection(it, releaseIt);
+                if(numMoved > 0)
+                {
+                    CPPLOG_LAZY(logging::Level::DEBUG,
+                        log << "Moved " << numMoved << " instructions out of critical section" << logging::endl);
+                    hasChanged = true;
+                }
+                it = releaseIt;
+            }
+            it.nextInBlock();
+        }
+    }
+    return hasChanged;
+}
+
+struct TMULoad
+{
+    // the write of the memory address to the TMU
+    InstructionWalker addressWrite;
+    // the NOP triggering the loading of the result into r4
+    InstructionWalker loadSignal;
+    // the read of the loaded value from r4
+    InstructionWalker resultRead;
+};
+
+static InstructionWalker nextNonEmpty(InstructionWalker it)
+{
+    do
+    {
+        it.nextInBlock();
+    } while(!it.isEndOfBlock() && !it.has());
+    return it;
+}
+
+/*
+ * Finds the general memory lookup via TMU as inserted by periphery#insertReadVectorFromTMU starting at the given
+ * position
+ */
+static Optional<TMULoad> findTMULoad(InstructionWalker it)
+{
+    auto addressWrite = it.get<const MoveOperation>();
+    if(!addressWrite || addressWrite->hasConditionalExecution() || addressWrite->signal != SIGNAL_NONE ||
+        dynamic_cast<const VectorRotation*>(addressWrite))
+        return {};
+    bool isTMU0 = addressWrite->writesRegister(REG_TMU0_ADDRESS);
+    if(!isTMU0 && !addressWrite->writesRegister(REG_TMU1_ADDRESS))
+        return {};
+    auto signalIt = nextNonEmpty(it);
+    if(signalIt.isEndOfBlock() || !signalIt.get<const Nop>() ||
+        signalIt->signal != (isTMU0 ? periphery::TMU0.signal : periphery::TMU1.signal))
+        return {};
+    auto readIt = nextNonEmpty(signalIt);
+    if(readIt.isEndOfBlock() || !readIt.get<const MoveOperation>() || !readIt->readsRegister(REG_TMU_OUT) ||
+        !readIt->checkOutputLocal() || readIt->hasConditionalExecution() || readIt->signal != SIGNAL_NONE ||
+        readIt.get<const VectorRotation>())
+        return {};
+    return TMULoad{it, signalIt, readIt};
+}
+
+/*
+ * Returns whether the instruction prevents the results of the pending TMU loads from being read later
+ */
+static bool conflictsWithPendingTMULoads(const IntermediateInstruction* inst, const FastSet<const Local*>& results)
+{
+    if(inst->signal.triggersReadOfR4() || inst->readsRegister(REG_TMU_OUT) || inst->readsRegister(REG_SFU_OUT) ||
+        (inst->checkOutputRegister() & &Register::isTextureMemoryUnit) ||
+        (inst->checkOutputRegister() & &Register::isSpecialFunctionsUnit) ||
+        (inst->checkOutputRegister() & &Register::triggersReadOfR4))
+        return true;
+    if(dynamic_cast<const Branch*>(inst) || dynamic_cast<const MemoryBarrier*>(inst) ||
+        dynamic_cast<const SemaphoreAdjustment*>(inst) || dynamic_cast<const MutexLock*>(inst))
+        return true;
+    if(inst->checkOutputLocal() && results.find(inst->checkOutputLocal()) != results.end())
+        return true;
+    return std::any_of(inst->getArguments().begin(), inst->getArguments().end(),
+        [&](const Value& arg) -> bool { return arg.checkLocal() && results.find(arg.local()) != results.end(); });
+}
+
+/*
+ * Distributes the loads alternately to the TMUs and moves all result reads behind the last address write
+ */
+static bool pipelineTMULoads(std::vector<TMULoad>& batch)
+{
+    if(batch.size() < 2)
+    {
+        batch.clear();
+        return false;
+    }
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Pipelining " << batch.size() << " TMU loads starting at: " << batch.front().addressWrite->to_string()
+            << logging::endl);
+    for(std::size_t i = 0; i < batch.size(); ++i)
+    {
+        const auto& tmu = i % 2 == 0 ? periphery::TMU0 : periphery::TMU1;
+        auto& load = batch[i];
+        load.addressWrite->setOutput(tmu.getAddress(load.addressWrite->getOutput()->type));
+        load.loadSignal->setSignaling(tmu.signal);
+    }
+    // the results need to be read in the order of the address writes
+    auto insertIt = batch.back().loadSignal;
+    for(std::size_t i = 0; i + 1 < batch.size(); ++i)
+    {
+        insertIt.emplace(batch[i].loadSignal.release());
+        insertIt.nextInBlock();
+        insertIt.emplace(batch[i].resultRead.release());
+        insertIt.nextInBlock();
+        batch[i].loadSignal.erase();
+        batch[i].resultRead.erase();
+    }
+    batch.clear();
+    return true;
+}
+
+bool optimizations::scheduleTMULoads(const Module& module, Method& method, const Configuration& config)
+{
+    bool hasChanged = false;
+    for(BasicBlock& block : method)
+    {
+        std::vector<TMULoad> batch;
+        FastSet<const Local*> pendingResults;
+        auto flushBatch = [&]() {
+            hasChanged = pipelineTMULoads(batch) || hasChanged;
+            pendingResults.clear();
+        };
+
+        auto it = block.walk();
+        while(!it.isEndOfBlock())
+        {
+            if(!it.has())
+            {
+                it.nextInBlock();
+                continue;
+            }
+            if(auto load = findTMULoad(it))
+            {
+                auto result = load->resultRead->checkOutputLocal();
+                // the address might depend on the result of a previous load (e.g. pointer chasing)
+                if(batch.size() >= 2 * periphery::TMU_FIFO_DEPTH ||
+                    conflictsWithPendingTMULoads(load->addressWrite.get(), pendingResults) ||
+                    pendingResults.find(result) != pendingResults.end())
+                    flushBatch();
+                batch.push_back(*load);
+                pendingResults.emplace(result);
+                it = nextNonEmpty(load->resultRead);
+                continue;
+            }
+            if(!batch.empty() && conflictsWithPendingTMULoads(it.get(), pendingResults))
+                flushBatch();
+            it.nextInBlock();
+        }
+        flushBatch();
+    }
+    return hasChanged;
+}
+
 InstructionWalker optimizations::moveRotationSourcesToAccumulators(
     const Module& module, Method& method, InstructionWalker it, const Configuration& config)
 {
@@ -44,6 +44,64 @@ namespace vc4c
          */
         bool reorderWithinBasicBlocks(const Module& module, Method& method, const Configuration& config);
 
+        /*
+         * Reduces the number and length of the critical sections guarded by the hardware mutex within basic blocks.
+         *
+         * Critical sections which are only separated by a few instructions are merged to save the release and
+         * re-acquire of the mutex (and the possible stall waiting for the mutex). Afterwards, all instructions within a
+         * critical section which do not depend on any other instruction within the section (and no instruction within
+         * the section depends on them) are moved out before the acquire or after the release of the mutex.
+         *
+         * Example:
+         *   mutex_acq
+         *   vpm_setup = ...
+         *   %1 = vpm
+         *   mutex_rel
+         *   %2 = add %1, 4
+         *   mutex_acq
+         *   %3 = mul24 %a, %b
+         *   vpm = %2
+         *   mutex_rel
+         *
+         * is converted to:
+         *   %3 = mul24 %a, %b
+         *   mutex_acq
+         *   vpm_setup = ...
+         *   %1 = vpm
+         *   %2 = add %1, 4
+         *   vpm = %2
+         *   mutex_rel
+         */
+        bool minimizeMutexSections(const Module& module, Method& method, const Configuration& config);
+
+        /*
+         * Pipelines independent general memory lookups via the TMUs within basic blocks.
+         *
+         * Instead of waiting for the result of every TMU load before issuing the next one, the addresses of multiple
+         * loads are written before the first result is read, to hide the latency of the memory accesses. The loads of
+         * such a batch are distributed alternately to TMU0 and TMU1 and at most #TMU_FIFO_DEPTH requests are queued
+         * per TMU.
+         *
+         * Example:
+         *   tmu0_s = %addr0
+         *   nop (load_tmu0)
+         *   %1 = r4
+         *   %addr1 = add %addr0, 64
+         *   tmu0_s = %addr1
+         *   nop (load_tmu0)
+         *   %2 = r4
+         *
+         * is converted to:
+         *   tmu0_s = %addr0
+         *   %addr1 = add %addr0, 64
+         *   tmu1_s = %addr1
+         *   nop (load_tmu0)
+         *   %1 = r4
+         *   nop (load_tmu1)
+         *   %2 = r4
+         */
+        bool scheduleTMULoads(const Module& module, Method& method, const Configuration& config);
+
         /*
          * Prevents register-mapping errors by guaranteeing the source of a vector-rotation to be mappable to an
          * accumulator. To do this, long-living used in a vector-rotation are moved to a temporary local which then can
@@ -0,0 +1,622 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "Vectorizer.h"
+
+#include "../InstructionWalker.h"
+#include "../Method.h"
+#include "../Profiler.h"
+#include "../intermediate/Helper.h"
+#include "../intermediate/VectorHelper.h"
+#include "../intermediate/operators.h"
+#include "log.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace vc4c;
+using namespace vc4c::optimizations;
+using namespace vc4c::intermediate;
+using namespace vc4c::operators;
+
+// blocks with more instructions are skipped to limit the compilation time
+static constexpr std::size_t MAX_BLOCK_SIZE = 4096;
+
+// the (estimated) number of instructions required to assemble/extract vector elements, see #insertVectorInsertion and
+// #insertVectorExtraction
+static constexpr int COST_INSERT_ELEMENT = 4;
+static constexpr int COST_INSERT_LITERAL = 2;
+static constexpr int COST_EXTRACT_ELEMENT = 1;
+static constexpr int COST_REPLICATE = 2;
+static constexpr int COST_ASSEMBLE_CONSTANT = 2;
+
+/*
+ * The ways of assembling an operand vector for the leaves of the pack tree
+ */
+enum class OperandSource
+{
+    // the operand is calculated by another pack
+    PACK,
+    // all operands are the same literal value
+    LITERAL,
+    // all operands are the elements of the same vector in the order of the lanes
+    VECTOR,
+    // all operands are the same scalar value which needs to be replicated
+    REPLICATE,
+    // all operands are (different) literal values which can be assembled
+    ASSEMBLE,
+    // all operands need to be inserted into the vector
+    INSERT
+};
+
+/*
+ * A group of isomorphic scalar operations, each calculating the value of a single SIMD element (lane) of the vector
+ * operation replacing them
+ */
+struct SuperwordPack
+{
+    // the scalar operations in the order of the lanes
+    std::vector<InstructionWalker> members;
+    // the packs calculating the operands in the same lane order, if any
+    std::vector<SuperwordPack*> operandPacks;
+    // how to assemble the operand vectors, the value is the vector to read the elements from, if any
+    std::vector<std::pair<OperandSource, Value>> operandSources;
+    // the position (within the block) of the last member, where the vector operation will be inserted
+    std::size_t lastPosition;
+    // whether the scalar results are used outside of the tree of packs and need to be extracted
+    bool isRoot;
+    // the vector output calculated by the vector operation, set on vectorization
+    Value vectorOutput = UNDEFINED_VALUE;
+};
+
+struct BlockInfo
+{
+    std::vector<InstructionWalker> walkers;
+    FastMap<const IntermediateInstruction*, std::size_t> positions;
+    // the pack each instruction is a member of
+    FastMap<const IntermediateInstruction*, SuperwordPack*> packedInstructions;
+    std::vector<std::unique_ptr<SuperwordPack>> packs;
+
+    Optional<std::size_t> getPosition(const IntermediateInstruction* inst) const
+    {
+        auto it = positions.find(inst);
+        if(it != positions.end())
+            return it->second;
+        return {};
+    }
+};
+
+/*
+ * Only simple unconditional ALU operations on scalar locals and literals can be packed
+ */
+static bool isCandidate(const IntermediateInstruction* inst)
+{
+    auto op = dynamic_cast<const Operation*>(inst);
+    if(op == nullptr || op->hasSideEffects() || op->hasConditionalExecution() || op->doesSetFlag() ||
+        op->signal != SIGNAL_NONE || op->hasUnpackMode() || op->hasPackMode())
+        return false;
+    if(!op->checkOutputLocal() || op->getOutput()->local()->getSingleWriter() != op)
+        return false;
+    const DataType type = op->getOutput()->type;
+    if(!type.isScalarType() || type.getPointerType() || !(type.isFloatingType() || type.isIntegralType()))
+        return false;
+    return std::all_of(op->getArguments().begin(), op->getArguments().end(), [](const Value& arg) -> bool {
+        return (arg.checkLocal() && arg.type.isScalarType() && !arg.type.getPointerType()) || arg.getLiteralValue();
+    });
+}
+
+/*
+ * Whether the two operations can be executed as the same vector operation
+ */
+static bool isIsomorphic(const Operation* first, const Operation* second)
+{
+    if(first->op != second->op || first->getOutput()->type != second->getOutput()->type ||
+        first->getArguments().size() != second->getArguments().size())
+        return false;
+    for(std::size_t i = 0; i < first->getArguments().size(); ++i)
+    {
+        if(static_cast<bool>(first->getArgument(i)->getLiteralValue()) !=
+            static_cast<bool>(second->getArgument(i)->getLiteralValue()))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Returns the first position after the given position (within the block) the local is written to
+ */
+static std::size_t findNextWrite(const BlockInfo& info, const Local* local, std::size_t position)
+{
+    std::size_t nextWrite = std::numeric_limits<std::size_t>::max();
+    local->forUsers(LocalUse::Type::WRITER, [&](const LocalUser* user) {
+        auto pos = info.getPosition(user);
+        if(pos && *pos > position)
+            nextWrite = std::min(nextWrite, *pos);
+    });
+    return nextWrite;
+}
+
+/*
+ * Returns the first position within this block the output of the given instruction is read, or SIZE_MAX if there is
+ * no read within this block
+ */
+static std::size_t findFirstRead(const BlockInfo& info, const IntermediateInstruction* inst)
+{
+    std::size_t firstRead = std::numeric_limits<std::size_t>::max();
+    inst->getOutput()->local()->forUsers(LocalUse::Type::READER, [&](const LocalUser* user) {
+        if(auto pos = info.getPosition(user))
+            firstRead = std::min(firstRead, *pos);
+    });
+    return firstRead;
+}
+
+/*
+ * Checks whether the operands of the member are not changed until the vector operation is executed at the given
+ * position
+ */
+static bool hasStableOperands(const BlockInfo& info, InstructionWalker member, std::size_t lastPosition)
+{
+    const auto memberPosition = info.positions.at(member.get());
+    return std::all_of(member->getArguments().begin(), member->getArguments().end(), [&](const Value& arg) -> bool {
+        return !arg.checkLocal() || findNextWrite(info, arg.local(), memberPosition) > lastPosition;
+    });
+}
+
+/*
+ * Returns whether the flags are read after the given position before they are overwritten
+ */
+static bool areFlagsLive(InstructionWalker it)
+{
+    for(; !it.isEndOfBlock(); it.nextInBlock())
+    {
+        if(!it.has())
+            continue;
+        if(it->hasConditionalExecution())
+            return true;
+        if(it->doesSetFlag())
+            return false;
+    }
+    return false;
+}
+
+/*
+ * Returns the container the value is extracted from, if the value was extracted from the SIMD element with the given
+ * index
+ */
+static Optional<Value> getExtractionSource(const BlockInfo& info, const Value& val, unsigned char index)
+{
+    if(!val.checkLocal())
+        return {};
+    auto writer = val.local()->getSingleWriter();
+    if(writer == nullptr || !info.getPosition(writer))
+        return {};
+    if(auto rot = dynamic_cast<const VectorRotation*>(writer))
+    {
+        if(rot->hasConditionalExecution() || !rot->getSource().checkLocal() || !rot->isFullRotationAllowed())
+            return {};
+        // extracting element i is a rotation upwards by 16 - i
+        auto offset = rot->getOffset().checkImmediate() ? rot->getOffset().immediate().getRotationOffset() :
+                                                          Optional<unsigned char>{};
+        if(offset && *offset == (NATIVE_VECTOR_SIZE - index) % NATIVE_VECTOR_SIZE)
+            return rot->getSource();
+        return {};
+    }
+    auto move = dynamic_cast<const MoveOperation*>(writer);
+    if(index == 0 && move && !move->hasConditionalExecution() && !move->hasUnpackMode() && !move->hasPackMode() &&
+        move->getSource().checkLocal() && move->getSource().type.isVectorType())
+        return move->getSource();
+    return {};
+}
+
+static std::pair<OperandSource, Value> determineOperandSource(
+    const BlockInfo& info, const SuperwordPack& pack, std::size_t operandIndex)
+{
+    if(pack.operandPacks[operandIndex] != nullptr)
+        return std::make_pair(OperandSource::PACK, UNDEFINED_VALUE);
+    const Value firstArg = pack.members.front()->assertArgument(operandIndex);
+    bool allSame = std::all_of(pack.members.begin(), pack.members.end(),
+        [&](InstructionWalker it) -> bool { return it->assertArgument(operandIndex) == firstArg; });
+    if(allSame && firstArg.getLiteralValue())
+        return std::make_pair(OperandSource::LITERAL, firstArg);
+    if(allSame)
+        return std::make_pair(OperandSource::REPLICATE, firstArg);
+    if(firstArg.getLiteralValue())
+        return std::make_pair(OperandSource::ASSEMBLE, UNDEFINED_VALUE);
+    if(auto container = getExtractionSource(info, firstArg, 0))
+    {
+        bool isInOrder = true;
+        for(unsigned char i = 0; i < pack.members.size() && isInOrder; ++i)
+        {
+            auto source = getExtractionSource(info, pack.members[i]->assertArgument(operandIndex), i);
+            isInOrder = source && *source == *container &&
+                // the container must not be modified until the vector operation is executed
+                findNextWrite(info, container->local(),
+                    info.positions.at(pack.members[i]->assertArgument(operandIndex).local()->getSingleWriter())) >
+                    pack.lastPosition;
+        }
+        if(isInOrder)
+            return std::make_pair(OperandSource::VECTOR, *container);
+    }
+    return std::make_pair(OperandSource::INSERT, UNDEFINED_VALUE);
+}
+
+static SIMDVector toConstantVector(const SuperwordPack& pack, std::size_t operandIndex)
+{
+    SIMDVector vector;
+    for(std::size_t i = 0; i < pack.members.size(); ++i)
+        vector[i] = *pack.members[i]->assertArgument(operandIndex).getLiteralValue();
+    return vector;
+}
+
+static DataType toVectorType(DataType scalarType, std::size_t numElements)
+{
+    // only use the vector widths supported by OpenCL C
+    for(unsigned char width : {2, 3, 4, 8, 16})
+    {
+        if(width >= numElements)
+            return scalarType.toVectorType(width);
+    }
+    throw CompilationError(
+        CompilationStep::OPTIMIZER, "Invalid number of vector elements for vectorization", std::to_string(numElements));
+}
+
+/*
+ * Tries to create a pack of the operations calculating the given operand of all members of the given pack in the
+ * correct lane order
+ */
+static SuperwordPack* createOperandPack(BlockInfo& info, SuperwordPack& pack, std::size_t operandIndex)
+{
+    std::vector<InstructionWalker> members;
+    members.reserve(pack.members.size());
+    for(InstructionWalker member : pack.members)
+    {
+        const Value& arg = member->assertArgument(operandIndex);
+        if(!arg.checkLocal())
+            return nullptr;
+        auto writer = arg.local()->getSingleWriter();
+        // the result is only used in the pack member which will be replaced, so there is no need for extraction
+        if(writer == nullptr || arg.local()->getUsers(LocalUse::Type::READER).size() != 1 || !isCandidate(writer))
+            return nullptr;
+        auto pos = info.getPosition(writer);
+        if(!pos || *pos >= info.positions.at(member.get()))
+            return nullptr;
+        auto existingPack = info.packedInstructions.find(writer);
+        if(existingPack != info.packedInstructions.end())
+        {
+            // the same operand is used for multiple operands of the pack (e.g. x * x), reuse the existing pack
+            if(existingPack->second->members.size() == pack.members.size() &&
+                existingPack->second->members[members.size()].get() == writer)
+            {
+                members.push_back(existingPack->second->members[members.size()]);
+                continue;
+            }
+            return nullptr;
+        }
+        if(!members.empty() &&
+            (!isIsomorphic(members.front().get<Operation>(), dynamic_cast<const Operation*>(writer)) ||
+                std::any_of(members.begin(), members.end(),
+                    [writer](InstructionWalker other) -> bool { return other.get() == writer; })))
+            return nullptr;
+        members.push_back(info.walkers.at(*pos));
+    }
+    auto existingPack = info.packedInstructions.find(members.front().get());
+    if(existingPack != info.packedInstructions.end())
+        return existingPack->second;
+
+    std::unique_ptr<SuperwordPack> operandPack(new SuperwordPack{members, {}, {}, 0, false});
+    for(auto member : members)
+        operandPack->lastPosition = std::max(operandPack->lastPosition, info.positions.at(member.get()));
+    if(!std::all_of(members.begin(), members.end(), [&](InstructionWalker member) -> bool {
+           return hasStableOperands(info, member, operandPack->lastPosition);
+       }))
+        return nullptr;
+    info.packs.emplace_back(std::move(operandPack));
+    SuperwordPack* result = info.packs.back().get();
+    for(auto member : members)
+        info.packedInstructions.emplace(member.get(), result);
+    return result;
+}
+
+/*
+ * Recursively builds the tree of packs calculating the operands of the given pack and returns the rating, the number
+ * of instructions saved
+ */
+static int buildPackTree(BlockInfo& info, SuperwordPack& pack, std::vector<SuperwordPack*>& treePacks)
+{
+    treePacks.push_back(&pack);
+    // one vector operation replaces all scalar operations
+    int rating = static_cast<int>(pack.members.size()) - 1;
+    const auto numOperands = pack.members.front()->getArguments().size();
+    // the tree might have been built before for this pack, so reset all previous results
+    pack.operandPacks.assign(numOperands, nullptr);
+    pack.operandSources.clear();
+    pack.operandSources.reserve(numOperands);
+    for(std::size_t i = 0; i < numOperands; ++i)
+    {
+        if(auto operandPack = createOperandPack(info, pack, i))
+        {
+            pack.operandPacks[i] = operandPack;
+            pack.operandSources.emplace_back(OperandSource::PACK, UNDEFINED_VALUE);
+            if(std::find(treePacks.begin(), treePacks.end(), operandPack) == treePacks.end())
+                rating += buildPackTree(info, *operandPack, treePacks);
+            continue;
+        }
+        const auto numElements = static_cast<int>(pack.members.size());
+        pack.operandSources.emplace_back(determineOperandSource(info, pack, i));
+        switch(pack.operandSources.back().first)
+        {
+        case OperandSource::PACK:
+        case OperandSource::LITERAL:
+        case OperandSource::VECTOR:
+            break;
+        case OperandSource::REPLICATE:
+            rating -= COST_REPLICATE;
+            break;
+        case OperandSource::ASSEMBLE:
+            rating -= checkVectorCanBeAssembled(toVectorType(pack.members.front()->getOutput()->type,
+                                                    pack.members.size()),
+                          toConstantVector(pack, i)) ?
+                COST_ASSEMBLE_CONSTANT :
+                1 + COST_INSERT_LITERAL * (numElements - 1);
+            break;
+        case OperandSource::INSERT:
+            rating -= 1 + COST_INSERT_ELEMENT * (numElements - 1);
+            break;
+        }
+    }
+    if(pack.isRoot)
+        rating -= COST_EXTRACT_ELEMENT * static_cast<int>(pack.members.size());
+    return rating;
+}
+
+/*
+ * Forms the root packs of independent isomorphic operations whose results are used by other instructions
+ */
+static void createRootPacks(BlockInfo& info, const std::vector<InstructionWalker>& rootCandidates)
+{
+    // the packs currently being filled together with the position before which all members need to be executed
+    std::vector<std::pair<std::unique_ptr<SuperwordPack>, std::size_t>> openPacks;
+    const auto closePack = [&](std::size_t index) {
+        auto& pack = openPacks[index].first;
+        if(pack->members.size() > 1)
+        {
+            for(auto member : pack->members)
+                info.packedInstructions.emplace(member.get(), pack.get());
+            info.packs.emplace_back(std::move(pack));
+        }
+        openPacks.erase(openPacks.begin() + static_cast<std::ptrdiff_t>(index));
+    };
+
+    for(InstructionWalker candidate : rootCandidates)
+    {
+        const auto position = info.positions.at(candidate.get());
+        // close all packs which cannot be extended anymore, since their results are used
+        for(std::size_t i = openPacks.size(); i > 0; --i)
+        {
+            if(openPacks[i - 1].second <= position)
+                closePack(i - 1);
+        }
+        bool inserted = false;
+        for(auto& open : openPacks)
+        {
+            auto& pack = *open.first;
+            if(!isIsomorphic(pack.members.front().get<Operation>(), candidate.get<Operation>()))
+                continue;
+            // all members need to still read the same operands when executed at the position of the new member
+            if(!std::all_of(pack.members.begin(), pack.members.end(),
+                   [&](InstructionWalker member) -> bool { return hasStableOperands(info, member, position); }))
+                continue;
+            pack.members.push_back(candidate);
+            pack.lastPosition = position;
+            open.second = std::min(open.second, findFirstRead(info, candidate.get()));
+            inserted = true;
+            break;
+        }
+        if(!inserted)
+        {
+            openPacks.emplace_back(
+                std::unique_ptr<SuperwordPack>(new SuperwordPack{{candidate}, {}, {}, position, true}),
+                findFirstRead(info, candidate.get()));
+        }
+        for(std::size_t i = 0; i < openPacks.size(); ++i)
+        {
+            if(openPacks[i].first->members.size() == NATIVE_VECTOR_SIZE)
+            {
+                closePack(i);
+                break;
+            }
+        }
+    }
+    while(!openPacks.empty())
+        closePack(openPacks.size() - 1);
+}
+
+/*
+ * Inserts the instructions assembling the operand vector for the given operand of the pack before the given position
+ */
+static InstructionWalker insertOperandVector(
+    Method& method, InstructionWalker it, const SuperwordPack& pack, std::size_t operandIndex, Value& out)
+{
+    const Value firstArg = pack.members.front()->assertArgument(operandIndex);
+    const DataType vectorType = toVectorType(firstArg.type, pack.members.size());
+    const auto& source = pack.operandSources.at(operandIndex);
+    switch(source.first)
+    {
+    case OperandSource::PACK:
+        out = pack.operandPacks[operandIndex]->vectorOutput;
+        return it;
+    case OperandSource::LITERAL:
+    case OperandSource::VECTOR:
+        out = source.second;
+        return it;
+    case OperandSource::REPLICATE:
+        out = method.addNewLocal(vectorType, "%slp_operand");
+        return insertReplication(it, firstArg, out);
+    case OperandSource::ASSEMBLE:
+        out = method.addNewLocal(vectorType, "%slp_operand");
+        if(auto sources = checkVectorCanBeAssembled(vectorType, toConstantVector(pack, operandIndex)))
+            return insertAssembleVector(it, method, out, *std::move(sources));
+        FALL_THROUGH
+    case OperandSource::INSERT:
+        out = method.addNewLocal(vectorType, "%slp_operand");
+        assign(it, out) = firstArg;
+        for(std::size_t i = 1; i < pack.members.size(); ++i)
+            it = insertVectorInsertion(it, method, out, Value(Literal(static_cast<uint32_t>(i)), TYPE_INT8),
+                pack.members[i]->assertArgument(operandIndex));
+        return it;
+    }
+    throw CompilationError(CompilationStep::OPTIMIZER, "Unhandled operand source for vectorization");
+}
+
+/*
+ * Returns the member of the pack executed last within the block, which is replaced by the vector operation
+ */
+static std::vector<InstructionWalker>::iterator findLastMember(const BlockInfo& info, SuperwordPack& pack)
+{
+    return std::max_element(
+        pack.members.begin(), pack.members.end(), [&](InstructionWalker one, InstructionWalker other) -> bool {
+            return info.positions.at(one.get()) < info.positions.at(other.get());
+        });
+}
+
+/*
+ * Checks whether the operand vectors can be assembled at the position of the vector operation without changing the
+ * program semantics
+ */
+static bool canInsertOperands(const BlockInfo& info, SuperwordPack& pack)
+{
+    for(const auto& source : pack.operandSources)
+    {
+        if((source.first == OperandSource::ASSEMBLE || source.first == OperandSource::INSERT) &&
+            areFlagsLive(findLastMember(info, pack)->copy()))
+            // the insertion of single elements overrides the flags
+            return false;
+    }
+    return true;
+}
+
+static void vectorizePack(Method& method, const BlockInfo& info, SuperwordPack& pack)
+{
+    auto lastMember = findLastMember(info, pack);
+    auto it = *lastMember;
+    const Operation* scalarOp = it.get<const Operation>();
+
+    std::vector<Value> operands(pack.operandPacks.size(), UNDEFINED_VALUE);
+    for(std::size_t i = 0; i < operands.size(); ++i)
+        it = insertOperandVector(method, it, pack, i, operands[i]);
+
+    pack.vectorOutput =
+        method.addNewLocal(toVectorType(scalarOp->getOutput()->type, pack.members.size()), "%slp_vector");
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Vectorizing " << pack.members.size() << " operations '" << scalarOp->to_string()
+            << "' into: " << pack.vectorOutput.to_string() << logging::endl);
+    std::vector<Value> scalarOutputs;
+    scalarOutputs.reserve(pack.members.size());
+    for(auto member : pack.members)
+        scalarOutputs.push_back(member->getOutput().value());
+
+    // only keep the decorations which hold for all vector elements
+    auto decorations = scalarOp->decoration;
+    for(auto member : pack.members)
+        decorations = intersect_flags(decorations, member->decoration);
+    if(operands.size() == 1)
+        it.reset((new Operation(scalarOp->op, pack.vectorOutput, operands[0]))->copyExtrasFrom(scalarOp));
+    else
+        it.reset((new Operation(scalarOp->op, pack.vectorOutput, operands[0], operands[1]))->copyExtrasFrom(scalarOp));
+    it->decoration = decorations;
+    it.nextInBlock();
+
+    if(pack.isRoot)
+    {
+        for(std::size_t i = 0; i < scalarOutputs.size(); ++i)
+            it = insertVectorExtraction(
+                it, method, pack.vectorOutput, Value(Literal(static_cast<uint32_t>(i)), TYPE_INT8), scalarOutputs[i]);
+    }
+
+    for(auto member = pack.members.begin(); member != pack.members.end(); ++member)
+    {
+        if(member != lastMember)
+            member->erase();
+    }
+}
+
+static bool vectorizeBlock(Method& method, BasicBlock& block)
+{
+    if(block.size() > MAX_BLOCK_SIZE)
+        return false;
+    BlockInfo info;
+    std::vector<InstructionWalker> candidates;
+    std::size_t position = 0;
+    for(auto it = block.walk(); !it.isEndOfBlock(); it.nextInBlock(), ++position)
+    {
+        if(!it.has())
+            continue;
+        info.positions.emplace(it.get(), position);
+        info.walkers.resize(position + 1, it);
+        if(isCandidate(it.get()))
+            candidates.push_back(it);
+    }
+
+    // results only read by a single other candidate can be calculated by operand packs, all other candidates are roots
+    std::vector<InstructionWalker> rootCandidates;
+    for(auto candidate : candidates)
+    {
+        auto readers = candidate->getOutput()->local()->getUsers(LocalUse::Type::READER);
+        bool isOperand = readers.size() == 1 && info.getPosition(*readers.begin()) && isCandidate(*readers.begin());
+        // all usages within the block need to follow the definition
+        bool isOrdered = std::all_of(readers.begin(), readers.end(), [&](const LocalUser* reader) -> bool {
+            auto pos = info.getPosition(reader);
+            return !pos || *pos > info.positions.at(candidate.get());
+        });
+        if(!isOperand && isOrdered)
+            rootCandidates.push_back(candidate);
+    }
+    if(rootCandidates.size() < 2)
+        return false;
+
+    createRootPacks(info, rootCandidates);
+    std::vector<SuperwordPack*> roots;
+    for(auto& pack : info.packs)
+        roots.push_back(pack.get());
+
+    // all trees are rated before any modification, since the analysis relies on the original instruction positions
+    std::vector<std::vector<SuperwordPack*>> selectedTrees;
+    for(SuperwordPack* root : roots)
+    {
+        std::vector<SuperwordPack*> treePacks;
+        int rating = buildPackTree(info, *root, treePacks);
+        bool canInsert = std::all_of(treePacks.begin(), treePacks.end(),
+            [&](SuperwordPack* pack) -> bool { return canInsertOperands(info, *pack); });
+        if(rating <= 0 || !canInsert)
+        {
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "Skipping vectorization of " << root->members.size() << " operations '"
+                    << root->members.front()->to_string() << "' with rating " << rating << logging::endl);
+            continue;
+        }
+        selectedTrees.emplace_back(std::move(treePacks));
+    }
+
+    for(auto& treePacks : selectedTrees)
+    {
+        // vectorize the operand packs first, since their outputs are used as input by the following packs
+        std::sort(treePacks.begin(), treePacks.end(), [](const SuperwordPack* one, const SuperwordPack* other) -> bool {
+            return one->lastPosition < other->lastPosition;
+        });
+        for(SuperwordPack* pack : treePacks)
+            vectorizePack(method, info, *pack);
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_OPTIMIZATION + 500, "SLP packs vectorized", treePacks.size());
+    }
+    return !selectedTrees.empty();
+}
+
+bool optimizations::vectorizeSuperwords(const Module& module, Method& method, const Configuration& config)
+{
+    bool hasChanged = false;
+    for(BasicBlock& block : method)
+        hasChanged = vectorizeBlock(method, block) || hasChanged;
+    return hasChanged;
+}
@@ -0,0 +1,48 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_OPTIMIZATION_VECTORIZER_H
+#define VC4C_OPTIMIZATION_VECTORIZER_H
+
+namespace vc4c
+{
+    class Method;
+    class Module;
+    struct Configuration;
+
+    namespace optimizations
+    {
+        /*
+         * Packs isomorphic (same operation and types) independent scalar operations within a basic block into a single
+         * vector operation (superword-level parallelism).
+         *
+         * Starting from groups of isomorphic operations whose results are used by other instructions, the operands are
+         * followed to find further isomorphic operations calculating all the inputs of one lane. The resulting tree of
+         * packs is only vectorized, if the number of saved instructions is higher than the number of instructions
+         * required to assemble the input vectors for the leaves of the tree and to extract the scalar results.
+         *
+         * Input vectors can be assembled for free, if the inputs are all the same literal or the elements of the same
+         * vector extracted in order.
+         *
+         * Example:
+         *   %a0 = %a (element 0)
+         *   %a1 = %a >> 15 (element 1)
+         *   %1 = fmul %a0, 2.0
+         *   %2 = fmul %a1, 2.0
+         *   %3 = fadd %1, 1.0
+         *   %4 = fadd %2, 1.0
+         *
+         * is converted to (if there are enough lanes to make it profitable):
+         *   %slp_vector = fmul %a, 2.0
+         *   %slp_vector.1 = fadd %slp_vector, 1.0
+         *   %3 = %slp_vector.1 (element 0)
+         *   %4 = %slp_vector.1 >> 15 (element 1)
+         */
+        bool vectorizeSuperwords(const Module& module, Method& method, const Configuration& config);
+    } /* namespace optimizations */
+} /* namespace vc4c */
+
+#endif /* VC4C_OPTIMIZATION_VECTORIZER_H */
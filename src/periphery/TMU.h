@@ -43,6 +43,11 @@ namespace vc4c
         extern const TMU TMU0;
         extern const TMU TMU1;
 
+        /*
+         * The number of requests every QPU can queue to a single TMU before reading the result of the first request
+         */
+        static constexpr unsigned TMU_FIFO_DEPTH = 4;
+
         /*
          * TMU
          *
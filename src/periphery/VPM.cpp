@@ -810,6 +810,276 @@ InstructionWalker VPM::insertFillRAMDynamic(Method& method, InstructionWalker it
     return it;
 }
 
+InstructionWalker VPM::insertPrefetchRAM(Method& method, InstructionWalker it, const Value& memoryAddress,
+    const VPMArea& area, unsigned numBytes, bool useMutex, const Value& bufferOffset)
+{
+    static constexpr unsigned ROW_SIZE = VPM_NUM_COLUMNS * VPM_WORD_WIDTH;
+    if(!area.isPacked || area.perQPUStride != 0)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Can only prefetch into packed VPM areas shared by all QPUs", area.to_string());
+    area.checkAreaSize(numBytes);
+    if(numBytes % VPM_WORD_WIDTH != 0)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Can only prefetch whole words into VPM", std::to_string(numBytes));
+
+    if(auto local = memoryAddress.checkLocal())
+    {
+        if(auto param = local->as<Parameter>())
+            memoryAddress.local()->as<Parameter>()->decorations =
+                add_flag(param->decorations, ParameterDecorations::INPUT);
+    }
+
+    // the word address (row * 16 + column) is located at the lowest bits of the DMA setup
+    Value addressOffset = INT_ZERO;
+    if(bufferOffset != INT_ZERO)
+        addressOffset = assign(it, TYPE_INT32, "%vpr_buffer_offset") = as_unsigned{bufferOffset} >> 2_val;
+
+    it = insertLockMutex(it, useMutex);
+    // the memory-side pitch is always a whole row, since we copy the memory block as-is
+    const VPRSetup strideSetup(VPRStrideSetup(static_cast<uint16_t>(ROW_SIZE)));
+    it.emplace(new LoadImmediate(VPM_IN_SETUP_REGISTER, Literal(strideSetup.value)));
+    it->addDecorations(InstructionDecorations::VPM_READ_CONFIGURATION);
+    it.nextInBlock();
+
+    // a single DMA load can read up to 16 rows, so we might need to split the prefetch into several loads
+    for(unsigned offset = 0; offset < numBytes;)
+    {
+        const auto fullRows = std::min((numBytes - offset) / ROW_SIZE, 16u);
+        // the trailing partial row is loaded separately with a shorter row length
+        const auto numRows = fullRows == 0 ? 1u : fullRows;
+        const auto rowLength = fullRows == 0 ? (numBytes - offset) / VPM_WORD_WIDTH : VPM_NUM_COLUMNS;
+
+        VPRSetup dmaSetup(VPRDMASetup(getVPMDMAMode(TYPE_INT32), static_cast<uint8_t>(rowLength % 16) /* 0 => 16 */,
+            static_cast<uint8_t>(numRows % 16) /* 0 => 16 */, 1));
+        dmaSetup.dmaSetup.setWordRow(static_cast<uint8_t>(area.rowOffset + offset / ROW_SIZE));
+        if(addressOffset == INT_ZERO)
+        {
+            it.emplace(new LoadImmediate(VPM_IN_SETUP_REGISTER, Literal(dmaSetup.value)));
+            it->addDecorations(InstructionDecorations::VPM_READ_CONFIGURATION);
+            it.nextInBlock();
+        }
+        else
+            assign(it, VPM_IN_SETUP_REGISTER) =
+                (Value(Literal(dmaSetup.value), TYPE_INT32) + addressOffset,
+                    InstructionDecorations::VPM_READ_CONFIGURATION);
+
+        if(offset == 0)
+            assign(it, VPM_DMA_LOAD_ADDR_REGISTER) = memoryAddress;
+        else
+            assign(it, VPM_DMA_LOAD_ADDR_REGISTER) = memoryAddress + Value(Literal(offset), TYPE_INT32);
+
+        offset += numRows * static_cast<unsigned>(rowLength) * VPM_WORD_WIDTH;
+        //"A new DMA load or store operation cannot be started until the previous one is complete" (p. 56)
+        assign(it, NOP_REGISTER) = VPM_DMA_LOAD_WAIT_REGISTER;
+    }
+    it = insertUnlockMutex(it, useMutex);
+    return it;
+}
+
+InstructionWalker VPM::insertWriteBackRAM(Method& method, InstructionWalker it, const Value& memoryAddress,
+    const VPMArea& area, unsigned numBytes, bool useMutex, const Value& bufferOffset)
+{
+    static constexpr unsigned ROW_SIZE = VPM_NUM_COLUMNS * VPM_WORD_WIDTH;
+    if(!area.isPacked || area.perQPUStride != 0 || area.usageType == VPMUsage::READ_CACHE)
+        throw CompilationError(CompilationStep::GENERAL,
+            "Can only write back packed writable VPM areas shared by all QPUs", area.to_string());
+    area.checkAreaSize(numBytes);
+    if(numBytes % VPM_WORD_WIDTH != 0)
+        throw CompilationError(
+            CompilationStep::GENERAL, "Can only write back whole words from VPM", std::to_string(numBytes));
+
+    if(auto local = memoryAddress.checkLocal())
+    {
+        if(auto param = local->as<Parameter>())
+            memoryAddress.local()->as<Parameter>()->decorations =
+                add_flag(param->decorations, ParameterDecorations::OUTPUT);
+    }
+
+    // the word address (row * 16 + column) is located at bit 3 of the DMA setup, so the offset in words is shifted
+    // by 3 bits
+    Value addressOffset = INT_ZERO;
+    if(bufferOffset != INT_ZERO)
+        addressOffset = assign(it, TYPE_INT32, "%vpw_buffer_offset") = bufferOffset << 1_val;
+
+    it = insertLockMutex(it, useMutex);
+    // the rows are written consecutively into memory, so there is no gap (stride) between the end of one row and the
+    // start of the next one
+    const VPWSetup strideSetup(VPWStrideSetup(0));
+    it.emplace(new LoadImmediate(VPM_OUT_SETUP_REGISTER, Literal(strideSetup.value)));
+    it->addDecorations(InstructionDecorations::VPM_WRITE_CONFIGURATION);
+    it.nextInBlock();
+
+    for(unsigned offset = 0; offset < numBytes;)
+    {
+        // a single DMA store can write all full rows (the VPM has less than 128 rows), the trailing partial row is
+        // written separately with a shorter row length
+        const auto fullRows = (numBytes - offset) / ROW_SIZE;
+        const auto numRows = fullRows == 0 ? 1u : fullRows;
+        const auto rowLength = fullRows == 0 ? (numBytes - offset) / VPM_WORD_WIDTH : VPM_NUM_COLUMNS;
+
+        VPWSetup dmaSetup(VPWDMASetup(getVPMDMAMode(TYPE_INT32), static_cast<uint8_t>(rowLength),
+            static_cast<uint8_t>(numRows)));
+        dmaSetup.dmaSetup.setWordRow(static_cast<uint8_t>(area.rowOffset + offset / ROW_SIZE));
+        if(addressOffset == INT_ZERO)
+        {
+            it.emplace(new LoadImmediate(VPM_OUT_SETUP_REGISTER, Literal(dmaSetup.value)));
+            it->addDecorations(InstructionDecorations::VPM_WRITE_CONFIGURATION);
+            it.nextInBlock();
+        }
+        else
+            assign(it, VPM_OUT_SETUP_REGISTER) =
+                (Value(Literal(dmaSetup.value), TYPE_INT32) + addressOffset,
+                    InstructionDecorations::VPM_WRITE_CONFIGURATION);
+
+        if(offset == 0)
+            assign(it, VPM_DMA_STORE_ADDR_REGISTER) = memoryAddress;
+        else
+            assign(it, VPM_DMA_STORE_ADDR_REGISTER) = memoryAddress + Value(Literal(offset), TYPE_INT32);
+
+        offset += numRows * static_cast<unsigned>(rowLength) * VPM_WORD_WIDTH;
+        //"A new DMA load or store operation cannot be started until the previous one is complete" (p. 56)
+        assign(it, NOP_REGISTER) = VPM_DMA_STORE_WAIT_REGISTER;
+    }
+    it = insertUnlockMutex(it, useMutex);
+    return it;
+}
+
+InstructionWalker VPM::insertCalculatePackedIndices(Method& method, InstructionWalker it, const VPMArea& area,
+    const Value& inAreaOffset, Value& rowIndex, Value& laneIndex)
+{
+    // The data is stored packed in 32-bit words, 16 per row. So we need to access the whole row containing the word the
+    // value is located in and the lane (the word) within that row
+    if(auto lit = inAreaOffset.getLiteralValue())
+    {
+        rowIndex = Value(Literal(lit->unsignedInt() / (VPM_WORD_WIDTH * VPM_NUM_COLUMNS)), TYPE_INT8);
+        laneIndex = Value(Literal((lit->unsignedInt() / VPM_WORD_WIDTH) % VPM_NUM_COLUMNS), TYPE_INT8);
+    }
+    else
+    {
+        auto wordIndex = assign(it, TYPE_INT16, "%vpm_packed_word") = as_unsigned{inAreaOffset} >> 2_val;
+        rowIndex = assign(it, TYPE_INT8, "%vpm_packed_row") = as_unsigned{wordIndex} >> 4_val;
+        laneIndex = assign(it, TYPE_INT8, "%vpm_packed_lane") = wordIndex & 0xF_val;
+    }
+    if(area.perQPUStride != 0)
+    {
+        // every QPU accesses its own copy of the area
+        Value stride(Literal(static_cast<unsigned>(area.perQPUStride)), TYPE_INT8);
+        auto qpuOffset = assign(it, TYPE_INT8, "%vpm_qpu_offset") = mul24(stride, Value(REG_QPU_NUMBER, TYPE_INT8));
+        rowIndex = assign(it, TYPE_INT8, "%vpm_packed_row") = rowIndex + qpuOffset;
+    }
+    return it;
+}
+
+InstructionWalker VPM::insertReadPackedVPM(Method& method, InstructionWalker it, const Value& dest,
+    const VPMArea& area, bool useMutex, const Value& inAreaOffset)
+{
+    if(!area.isPacked)
+        throw CompilationError(CompilationStep::GENERAL, "Can only read single values from packed VPM areas",
+            area.to_string());
+    if(dest.type.getVectorWidth() != 1 || dest.type.getInMemoryWidth() > VPM_WORD_WIDTH)
+        throw CompilationError(CompilationStep::GENERAL,
+            "Can only read scalar values of up to 32-bit from packed VPM areas", dest.to_string());
+
+    Value rowIndex = UNDEFINED_VALUE;
+    Value laneIndex = UNDEFINED_VALUE;
+    it = insertCalculatePackedIndices(method, it, area, inAreaOffset, rowIndex, laneIndex);
+
+    const VPRSetup genericSetup(area.toReadSetup(TYPE_INT32.toVectorType(16)));
+    it = insertLockMutex(it, useMutex);
+    if(rowIndex == INT_ZERO)
+    {
+        it.emplace(new LoadImmediate(VPM_IN_SETUP_REGISTER, Literal(genericSetup.value)));
+        it->addDecorations(InstructionDecorations::VPM_READ_CONFIGURATION);
+        it.nextInBlock();
+    }
+    else
+        assign(it, VPM_IN_SETUP_REGISTER) = (Value(Literal(genericSetup.value), TYPE_INT32) + rowIndex,
+            InstructionDecorations::VPM_READ_CONFIGURATION);
+    auto row = assign(it, TYPE_INT32.toVectorType(16), "%vpm_packed_row") = VPM_IO_REGISTER;
+    it = insertUnlockMutex(it, useMutex);
+
+    if(dest.type.getInMemoryWidth() == VPM_WORD_WIDTH)
+        return insertVectorExtraction(it, method, row, laneIndex, dest);
+
+    auto word = method.addNewLocal(TYPE_INT32, "%vpm_packed_word");
+    it = insertVectorExtraction(it, method, row, laneIndex, word);
+    // like TMU and DMA reads, the sub-word values are zero-extended
+    const Value mask(Literal(dest.type.getScalarBitCount() == 8 ? 0xFFu : 0xFFFFu), TYPE_INT32);
+    if(auto lit = inAreaOffset.getLiteralValue())
+    {
+        auto shift = (lit->unsignedInt() % VPM_WORD_WIDTH) * 8;
+        if(shift != 0)
+            word = assign(it, TYPE_INT32, "%vpm_packed_word") = as_unsigned{word} >> Value(Literal(shift), TYPE_INT8);
+    }
+    else
+    {
+        auto shift = assign(it, TYPE_INT8, "%vpm_packed_shift") = inAreaOffset & 3_val;
+        shift = assign(it, TYPE_INT8, "%vpm_packed_shift") = shift << 3_val;
+        word = assign(it, TYPE_INT32, "%vpm_packed_word") = as_unsigned{word} >> shift;
+    }
+    assign(it, dest) = word & mask;
+    return it;
+}
+
+InstructionWalker VPM::insertWritePackedVPM(Method& method, InstructionWalker it, const Value& src,
+    const VPMArea& area, bool useMutex, const Value& inAreaOffset)
+{
+    if(!area.isPacked || area.usageType == VPMUsage::READ_CACHE)
+        throw CompilationError(CompilationStep::GENERAL, "Can only write single values into writable packed VPM areas",
+            area.to_string());
+    if(src.type.getVectorWidth() != 1 || src.type.getInMemoryWidth() > VPM_WORD_WIDTH)
+        throw CompilationError(CompilationStep::GENERAL,
+            "Can only write scalar values of up to 32-bit into packed VPM areas", src.to_string());
+
+    Value rowIndex = UNDEFINED_VALUE;
+    Value laneIndex = UNDEFINED_VALUE;
+    it = insertCalculatePackedIndices(method, it, area, inAreaOffset, rowIndex, laneIndex);
+
+    const VPRSetup readSetup(area.toReadSetup(TYPE_INT32.toVectorType(16)));
+    const VPWSetup writeSetup(area.toWriteSetup(TYPE_INT32.toVectorType(16)));
+    // the whole read-modify-write needs to be guarded to not loose modifications of other QPUs in the same row
+    it = insertLockMutex(it, useMutex);
+    Value readSetupBits(Literal(readSetup.value), TYPE_INT32);
+    Value writeSetupBits(Literal(writeSetup.value), TYPE_INT32);
+    if(rowIndex != INT_ZERO)
+    {
+        readSetupBits = assign(it, TYPE_INT32, "%vpr_setup") = readSetupBits + rowIndex;
+        writeSetupBits = assign(it, TYPE_INT32, "%vpw_setup") = writeSetupBits + rowIndex;
+    }
+    assign(it, VPM_IN_SETUP_REGISTER) = (readSetupBits, InstructionDecorations::VPM_READ_CONFIGURATION);
+    auto row = assign(it, TYPE_INT32.toVectorType(16), "%vpm_packed_row") = VPM_IO_REGISTER;
+
+    Value newWord = src;
+    if(src.type.getInMemoryWidth() != VPM_WORD_WIDTH)
+    {
+        // only replace the bytes/half-words of the value in the containing word
+        auto oldWord = method.addNewLocal(TYPE_INT32, "%vpm_packed_word");
+        it = insertVectorExtraction(it, method, row, laneIndex, oldWord);
+        const Value mask(Literal(src.type.getScalarBitCount() == 8 ? 0xFFu : 0xFFFFu), TYPE_INT32);
+        Value shift = INT_ZERO;
+        if(auto lit = inAreaOffset.getLiteralValue())
+            shift = Value(Literal((lit->unsignedInt() % VPM_WORD_WIDTH) * 8), TYPE_INT8);
+        else
+        {
+            shift = assign(it, TYPE_INT8, "%vpm_packed_shift") = inAreaOffset & 3_val;
+            shift = assign(it, TYPE_INT8, "%vpm_packed_shift") = shift << 3_val;
+        }
+        auto shiftedMask = assign(it, TYPE_INT32, "%vpm_packed_mask") = mask << shift;
+        auto maskedValue = assign(it, TYPE_INT32, "%vpm_packed_value") = src & mask;
+        maskedValue = assign(it, TYPE_INT32, "%vpm_packed_value") = maskedValue << shift;
+        auto invertedMask = assign(it, TYPE_INT32, "%vpm_packed_mask") = ~shiftedMask;
+        auto maskedWord = assign(it, TYPE_INT32, "%vpm_packed_word") = oldWord & invertedMask;
+        newWord = assign(it, TYPE_INT32, "%vpm_packed_word") = maskedWord | maskedValue;
+    }
+    auto newRow = assign(it, row.type, "%vpm_packed_row") = row;
+    it = insertVectorInsertion(it, method, newRow, laneIndex, newWord);
+
+    assign(it, VPM_OUT_SETUP_REGISTER) = (writeSetupBits, InstructionDecorations::VPM_WRITE_CONFIGURATION);
+    assign(it, VPM_IO_REGISTER) = newRow;
+    it = insertUnlockMutex(it, useMutex);
+    return it;
+}
+
 void VPMArea::checkAreaSize(const unsigned requestedSize) const
 {
     if(requestedSize > (numRows * VPM_NUM_COLUMNS * VPM_WORD_WIDTH)) // TODO rewrite packed/not packed!
@@ -829,6 +1099,9 @@ bool VPMArea::requiresSpacePerQPU() const
 
 DataType VPMArea::getElementType() const
 {
+    if(isPacked)
+        // the data is stored as packed rows of 32-bit words
+        return TYPE_INT32.toVectorType(16);
     switch(usageType)
     {
     case VPMUsage::SCRATCH:
@@ -843,6 +1116,9 @@ DataType VPMArea::getElementType() const
     case VPMUsage::STACK:
         // is not known
         return TYPE_UNKNOWN;
+    case VPMUsage::READ_CACHE:
+        // the cached data is stored as packed rows of 32-bit words
+        return TYPE_INT32.toVectorType(16);
     }
     return TYPE_UNKNOWN;
 }
@@ -982,23 +1258,34 @@ static std::string toUsageString(VPMUsage usage, const Local* local)
         return "scratch area";
     case VPMUsage::STACK:
         return "stack" + (local ? " " + local->to_string() : "");
+    case VPMUsage::READ_CACHE:
+        return (local ? local->to_string() : "(nullptr)") + " (cached)";
     }
     throw CompilationError(
         CompilationStep::GENERAL, "Unhandled VPM usage type", std::to_string(static_cast<unsigned>(usage)));
 }
 
+std::string VPMLiveRange::to_string() const
+{
+    if(last == WHOLE_KERNEL_LIVE_RANGE.last)
+        return "[" + std::to_string(first) + ", end]";
+    return "[" + std::to_string(first) + ", " + std::to_string(last) + "]";
+}
+
 std::string VPMArea::to_string() const
 {
     return toUsageString(usageType, originalAddress) + ", rows[" + std::to_string(static_cast<unsigned>(rowOffset)) +
-        ", " + std::to_string(static_cast<unsigned>(rowOffset + numRows)) + "[";
+        ", " + std::to_string(static_cast<unsigned>(rowOffset + numRows)) + "[" +
+        (perQPUStride != 0 ? " (" + std::to_string(static_cast<unsigned>(perQPUStride)) + " rows per QPU)" : "") +
+        (isPacked && usageType != VPMUsage::READ_CACHE ? " (packed)" : "");
 }
 LCOV_EXCL_STOP
 
-VPM::VPM(const unsigned totalVPMSize) : maximumVPMSize(std::min(VPM_DEFAULT_SIZE, totalVPMSize)), areas(VPM_NUM_ROWS)
+VPM::VPM(const unsigned totalVPMSize) : maximumVPMSize(std::min(VPM_DEFAULT_SIZE, totalVPMSize))
 {
     // set a size of at least 1 row, so if no scratch is used, the first area has an offset of != 0 and therefore is
     // different than the scratch-area
-    areas[0] = std::make_shared<VPMArea>(VPMUsage::SCRATCH, 0, 1, nullptr);
+    areas.emplace_back(std::make_shared<VPMArea>(VPMUsage::SCRATCH, 0, 1, nullptr));
 }
 
 const VPMArea& VPM::getScratchArea() const
@@ -1014,7 +1301,8 @@ const VPMArea* VPM::findArea(const Local* local)
     return nullptr;
 }
 
-const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isStackArea, unsigned numStacks)
+const VPMArea* VPM::addArea(
+    const Local* local, DataType elementType, bool isStackArea, unsigned numStacks, const VPMLiveRange& liveRange)
 {
     // Since we can only read/write in packages of 16-element vectors on the QPU-side, we need to reserve enough space
     // for 16-element vectors (even if we do not use all of the elements)
@@ -1024,58 +1312,86 @@ const VPMArea* VPM::addArea(const Local* local, DataType elementType, bool isSta
     if(requestedSize > maximumVPMSize)
         // does not fit, independent of packing of rows
         return nullptr;
-    uint8_t numRows = static_cast<unsigned char>(
-        requestedSize / (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) + (requestedSize % (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) != 0));
+    // the copies of a stack area all start at a new row, so the row of a QPU can be easily calculated
+    uint8_t rowsPerCopy = static_cast<unsigned char>(inVPMType.getLogicalWidth() / (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) +
+        (inVPMType.getLogicalWidth() % (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) != 0));
     const VPMArea* area = findArea(local);
-    if(area != nullptr && area->numRows >= numRows)
+    if(area != nullptr && area->numRows >= rowsPerCopy * (isStackArea ? numStacks : 1))
         return area;
 
-    // find free consecutive space in VPM with the requested size and return it
-    // to keep the remaining space free for scratch, we start allocating space from the end of the VPM
-    Optional<unsigned> rowOffset;
-    uint8_t numFreeRows = 0;
-    for(auto i = areas.size() - 1; i > 0 /* index 0 is always reserved for scratch */; --i)
-    {
-        if(areas[i])
-        {
-            // row is already reserved
-            numFreeRows = 0;
-            continue;
-        }
-        else
-            ++numFreeRows;
-        if(numFreeRows >= numRows)
-        {
-            rowOffset = static_cast<unsigned>(i);
-            break;
-        }
-    }
-    if(!rowOffset)
+    auto ptr = placeArea(isStackArea ? VPMUsage::STACK : VPMUsage::LOCAL_MEMORY, local, rowsPerCopy,
+        static_cast<uint8_t>(isStackArea ? numStacks : 0), liveRange, false);
+    if(!ptr)
         // no more (big enough) free space on VPM
         return nullptr;
-
-    // for now align all new VPM areas at the beginning of a row
-    auto ptr = std::make_shared<VPMArea>(isStackArea ? VPMUsage::STACK : VPMUsage::LOCAL_MEMORY,
-        static_cast<uint8_t>(rowOffset.value()), numRows, local);
-    for(auto i = rowOffset.value(); i < (rowOffset.value() + numRows); ++i)
-        areas[i] = ptr;
     CPPLOG_LAZY(logging::Level::DEBUG,
-        log << "Allocating " << numRows << " rows (per 64 byte) of VPM cache starting at row " << rowOffset.value()
+        log << "Allocating " << static_cast<unsigned>(ptr->numRows)
+            << " rows (per 64 byte) of VPM cache starting at row " << static_cast<unsigned>(ptr->rowOffset)
             << " for local: " << local->to_string(false)
-            << (isStackArea ? std::string(" (") + std::to_string(numStacks) + " stacks)" : "") << logging::endl);
+            << (isStackArea ? std::string(" (") + std::to_string(numStacks) + " stacks)" : "") << " with live range "
+            << liveRange.to_string() << logging::endl);
     PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 90, "VPM cache size", requestedSize);
-    return ptr.get();
+    return ptr;
+}
+
+const VPMArea* VPM::addReadCacheArea(const Local* local, unsigned numBytes)
+{
+    if(numBytes == 0 || numBytes > maximumVPMSize)
+        return nullptr;
+    auto numRows = static_cast<uint8_t>(
+        numBytes / (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) + (numBytes % (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) != 0));
+    const VPMArea* area = findArea(local);
+    if(area != nullptr && area->usageType == VPMUsage::READ_CACHE && area->numRows >= numRows)
+        return area;
+
+    // the cache is filled once at the start of the kernel and read by all QPUs, so it is used for the whole kernel
+    auto ptr = placeArea(VPMUsage::READ_CACHE, local, numRows, 0, WHOLE_KERNEL_LIVE_RANGE, true);
+    if(!ptr)
+        // no more (big enough) free space on VPM
+        return nullptr;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Allocating " << static_cast<unsigned>(numRows)
+            << " rows (per 64 byte) of VPM read cache starting at row " << static_cast<unsigned>(ptr->rowOffset)
+            << " for local: " << local->to_string(false) << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 91, "VPM read cache size", numBytes);
+    return ptr;
+}
+
+const VPMArea* VPM::addPackedArea(
+    const Local* local, unsigned numBytes, bool isStackArea, unsigned numStacks, const VPMLiveRange& liveRange)
+{
+    if(numBytes == 0 || numBytes * (isStackArea ? numStacks : 1) > maximumVPMSize)
+        return nullptr;
+    // the copies of a stack area all start at a new row, so the row of a QPU can be easily calculated
+    auto rowsPerCopy = static_cast<uint8_t>(
+        numBytes / (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) + (numBytes % (VPM_NUM_COLUMNS * VPM_WORD_WIDTH) != 0));
+    const VPMArea* area = findArea(local);
+    if(area != nullptr && area->isPacked && area->numRows >= rowsPerCopy * (isStackArea ? numStacks : 1))
+        return area;
+
+    auto ptr = placeArea(isStackArea ? VPMUsage::STACK : VPMUsage::LOCAL_MEMORY, local, rowsPerCopy,
+        static_cast<uint8_t>(isStackArea ? numStacks : 0), liveRange, true);
+    if(!ptr)
+        // no more (big enough) free space on VPM
+        return nullptr;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "Allocating " << static_cast<unsigned>(ptr->numRows)
+            << " rows (per 64 byte) of packed VPM cache starting at row " << static_cast<unsigned>(ptr->rowOffset)
+            << " for local: " << local->to_string(false)
+            << (isStackArea ? std::string(" (") + std::to_string(numStacks) + " stacks)" : "") << " with live range "
+            << liveRange.to_string() << logging::endl);
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_GENERAL + 92, "VPM packed cache size", numBytes);
+    return ptr;
 }
 
 unsigned VPM::getMaxCacheVectors(DataType type, bool writeAccess) const
 {
-    unsigned numFreeRows = 0;
+    unsigned numFreeRows = VPM_NUM_ROWS;
     // can possible use up all rows up to the first area
     for(const auto& area : areas)
     {
-        if(area && area->usageType != VPMUsage::SCRATCH)
-            break;
-        ++numFreeRows;
+        if(area->usageType != VPMUsage::SCRATCH)
+            numFreeRows = std::min(numFreeRows, static_cast<unsigned>(area->rowOffset));
     }
 
     if(writeAccess)
@@ -1098,9 +1414,6 @@ void VPM::updateScratchSize(unsigned char requestedRows)
             log << "Increased the scratch size to " << requestedRows << " rows (" << requestedRows * 64 << " bytes)"
                 << logging::endl);
         const_cast<unsigned char&>(getScratchArea().numRows) = requestedRows;
-        // fill areas with scratch
-        for(unsigned i = 1; i < requestedRows; ++i)
-            areas[i] = areas[0];
     }
 }
 
@@ -1126,6 +1439,71 @@ InstructionWalker VPM::insertUnlockMutex(InstructionWalker it, bool useMutex) co
     return it;
 }
 
+bool VPM::canPlaceArea(
+    unsigned rowOffset, unsigned numRows, unsigned perQPUStride, const VPMLiveRange& liveRange) const
+{
+    for(const auto& area : areas)
+    {
+        if(area->rowOffset >= rowOffset + numRows ||
+            rowOffset >= static_cast<unsigned>(area->rowOffset + area->numRows))
+            // no common rows
+            continue;
+        // the scratch area is used everywhere (and might still grow)
+        if(area->usageType == VPMUsage::SCRATCH || area->liveRange.overlaps(liveRange))
+            return false;
+        // Since the QPUs might execute different parts of the program at the same time, areas reserved per QPU can
+        // only share rows if every QPU accesses the same rows for both areas
+        if((perQPUStride != 0 || area->perQPUStride != 0) &&
+            (area->rowOffset != rowOffset || area->perQPUStride != perQPUStride))
+            return false;
+    }
+    return true;
+}
+
+const VPMArea* VPM::placeArea(VPMUsage usage, const Local* local, uint8_t rowsPerCopy, uint8_t numCopies,
+    const VPMLiveRange& liveRange, bool isPacked)
+{
+    Optional<unsigned> rowOffset;
+    unsigned perQPUStride = numCopies > 0 ? rowsPerCopy : 0;
+    unsigned numRows = rowsPerCopy * std::max(numCopies, uint8_t{1});
+
+    if(numCopies > 0)
+    {
+        // try to reuse the rows of another per-QPU area with a disjoint live range and a big enough per-QPU stride
+        for(const auto& area : areas)
+        {
+            if(area->perQPUStride < rowsPerCopy)
+                continue;
+            if(canPlaceArea(area->rowOffset, area->perQPUStride * numCopies, area->perQPUStride, liveRange))
+            {
+                rowOffset = area->rowOffset;
+                perQPUStride = area->perQPUStride;
+                numRows = area->perQPUStride * numCopies;
+                break;
+            }
+        }
+    }
+
+    if(numRows >= VPM_NUM_ROWS)
+        return nullptr;
+
+    // to keep the remaining space free for scratch, we start allocating space from the end of the VPM
+    // NOTE: index 0 is always reserved for scratch
+    for(unsigned offset = VPM_NUM_ROWS - numRows; !rowOffset && offset > 0; --offset)
+    {
+        if(canPlaceArea(offset, numRows, perQPUStride, liveRange))
+            rowOffset = offset;
+    }
+    if(!rowOffset)
+        return nullptr;
+
+    // for now align all new VPM areas at the beginning of a row
+    auto ptr = std::make_shared<VPMArea>(usage, static_cast<uint8_t>(rowOffset.value()), static_cast<uint8_t>(numRows),
+        local, static_cast<uint8_t>(perQPUStride), liveRange, isPacked);
+    areas.emplace_back(ptr);
+    return ptr.get();
+}
+
 VPMInstructions periphery::findRelatedVPMInstructions(InstructionWalker anyVPMInstruction, bool isVPMRead)
 {
     const auto predAddressWrite = [isVPMRead](const intermediate::IntermediateInstruction* inst) -> bool {
@@ -1259,8 +1637,20 @@ void VPM::dumpUsage() const
     static const unsigned outputWidth = 128;
 
     CPPLOG_LAZY_BLOCK(logging::Level::DEBUG, {
+        // areas with disjoint live ranges can share rows, for the overview we only show the first area of every row
+        std::vector<std::shared_ptr<VPMArea>> rows(VPM_NUM_ROWS);
+        for(const auto& area : areas)
+        {
+            const auto endRow = std::min(static_cast<unsigned>(area->rowOffset + area->numRows), VPM_NUM_ROWS);
+            for(unsigned i = area->rowOffset; i < endRow; ++i)
+            {
+                if(!rows[i])
+                    rows[i] = area;
+            }
+        }
+
         logging::debug() << "VPM usage: "
-                         << std::accumulate(areas.begin(), areas.end(), 0u,
+                         << std::accumulate(rows.begin(), rows.end(), 0u,
                                 [](unsigned sum, const std::shared_ptr<VPMArea>& area) -> unsigned {
                                     return sum + (area != nullptr);
                                 })
@@ -1269,7 +1659,7 @@ void VPM::dumpUsage() const
         std::shared_ptr<VPMArea> lastArea;
         unsigned numEmpty = 0;
         auto& stream = logging::debug() << "|";
-        for(const auto& area : areas)
+        for(const auto& area : rows)
         {
             if(area == lastArea)
                 continue;
@@ -1290,6 +1680,14 @@ void VPM::dumpUsage() const
         if(numEmpty > 0)
             writeArea(stream, "", (numEmpty * outputWidth) / VPM_NUM_ROWS);
         stream << logging::endl;
+
+        for(const auto& area : areas)
+        {
+            if(area->liveRange.first == 0 && area->liveRange.last == WHOLE_KERNEL_LIVE_RANGE.last)
+                continue;
+            logging::debug() << "\t" << area->to_string() << " is live in " << area->liveRange.to_string()
+                             << logging::endl;
+        }
     });
 }
 LCOV_EXCL_STOP
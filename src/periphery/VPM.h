@@ -11,6 +11,8 @@
 #include "../InstructionWalker.h"
 #include "../Method.h"
 
+#include <limits>
+
 namespace vc4c
 {
     const Value VPM_IN_SETUP_REGISTER(REG_VPM_IN_SETUP, TYPE_INT32);
@@ -656,16 +658,55 @@ namespace vc4c
              * NOTE:
              * Its size needs include the spilled locals for all available QPUs!
              */
-            STACK
+            STACK,
+            /*
+             * This area is used as read-only cache for a memory area which is loaded once at the start of the kernel
+             * execution and then accessed (read) from the VPM.
+             *
+             * NOTE:
+             * The data is stored packed (as 32-bit words, 16 words per row), so it can be loaded via DMA in a single
+             * block and any word can be accessed by its index.
+             */
+            READ_CACHE
         };
 
+        /*
+         * The range of the program (as positions of the instructions in the order of the method) in which the contents
+         * of a VPM area are used.
+         *
+         * VPM areas with disjoint live ranges can share the same rows in VPM, similar to how locals with disjoint
+         * live ranges can share the same register.
+         */
+        struct VPMLiveRange
+        {
+            // the position of the first instruction accessing the VPM area
+            unsigned first;
+            // the position of the last instruction accessing the VPM area (inclusive)
+            unsigned last;
+
+            inline bool overlaps(const VPMLiveRange& other) const
+            {
+                return first <= other.last && other.first <= last;
+            }
+
+            std::string to_string() const;
+        };
+
+        /*
+         * The live range of VPM areas whose contents are used throughout the whole kernel execution
+         */
+        constexpr VPMLiveRange WHOLE_KERNEL_LIVE_RANGE{0, std::numeric_limits<unsigned>::max()};
+
         /*
          * An area of the VPM used for a specific purpose (e.g. cache, register spilling, etc.)
          */
         struct VPMArea
         {
-            VPMArea(VPMUsage usage, uint8_t rowOffset, uint8_t numRows, const Local* basePointer = nullptr) :
-                usageType(usage), rowOffset(rowOffset), numRows(numRows), originalAddress(basePointer)
+            VPMArea(VPMUsage usage, uint8_t rowOffset, uint8_t numRows, const Local* basePointer = nullptr,
+                uint8_t perQPUStride = 0, VPMLiveRange liveRange = WHOLE_KERNEL_LIVE_RANGE, bool isPacked = false) :
+                usageType(usage),
+                rowOffset(rowOffset), numRows(numRows), originalAddress(basePointer), perQPUStride(perQPUStride),
+                liveRange(liveRange), isPacked(isPacked || usage == VPMUsage::READ_CACHE)
             {
             }
             VPMArea(const VPMArea&) = delete;
@@ -697,6 +738,22 @@ namespace vc4c
              * is lowered into VPM).
              */
             const Local* originalAddress;
+            /*
+             * For areas reserved separately for every QPU, the distance in rows between the first rows of the copies
+             * of two consecutive QPUs. For areas shared by all QPUs, this is zero.
+             */
+            const unsigned char perQPUStride;
+            /*
+             * The range of the program in which the contents of this area are used
+             */
+            const VPMLiveRange liveRange;
+            /*
+             * Whether the data is stored packed as 32-bit words (16 words per row) instead of one element per row.
+             *
+             * Packed areas need much less space, but can only be accessed via #insertReadPackedVPM and
+             * #insertWritePackedVPM.
+             */
+            const bool isPacked;
 
             void checkAreaSize(unsigned requestedSize) const;
 
@@ -801,8 +858,33 @@ namespace vc4c
 
             const VPMArea& getScratchArea() const;
             const VPMArea* findArea(const Local* local);
-            const VPMArea* addArea(
-                const Local* local, DataType elementType, bool isStackArea, unsigned numStacks = NUM_QPUS);
+            /*
+             * Reserves an area to store data of the given type for the given local.
+             *
+             * Stack areas are reserved once per QPU (up to the given number of stacks), all other areas are shared by
+             * all QPUs. The area may share rows with other areas whose live range does not overlap the given one.
+             *
+             * Returns nullptr if there is not enough free space left in VPM
+             */
+            const VPMArea* addArea(const Local* local, DataType elementType, bool isStackArea,
+                unsigned numStacks = NUM_QPUS, const VPMLiveRange& liveRange = WHOLE_KERNEL_LIVE_RANGE);
+            /*
+             * Reserves an area to cache the given number of bytes of the memory area referenced by the local.
+             *
+             * Returns nullptr if there is not enough free space left in VPM
+             */
+            const VPMArea* addReadCacheArea(const Local* local, unsigned numBytes);
+            /*
+             * Reserves an area to store the given number of bytes of the memory area referenced by the local packed
+             * into 32-bit words.
+             *
+             * Stack areas are reserved once per QPU (up to the given number of stacks), all other areas are shared by
+             * all QPUs.
+             *
+             * Returns nullptr if there is not enough free space left in VPM
+             */
+            const VPMArea* addPackedArea(const Local* local, unsigned numBytes, bool isStackArea,
+                unsigned numStacks = NUM_QPUS, const VPMLiveRange& liveRange = WHOLE_KERNEL_LIVE_RANGE);
 
             /*
              * The maximum number of vectors (of the given type) which can be cached in this VPM.
@@ -856,6 +938,49 @@ namespace vc4c
                 const Value& memoryAddress, DataType type, const Value& numCopies, const VPMArea* area = nullptr,
                 bool useMutex = true);
 
+            /*
+             * Inserts the loading of the given number of bytes from the memory address via DMA into the given
+             * packed (e.g. read-cache) area shared by all QPUs
+             *
+             * The optional buffer offset is the dynamic offset (in bytes, a multiple of the row size) into the area to
+             * load the data to.
+             *
+             * NOTE: The DMA load is always completed before the VPM mutex is released, since any other QPU might
+             * configure and start a DMA transfer of its own as soon as it holds the mutex.
+             */
+            NODISCARD InstructionWalker insertPrefetchRAM(Method& method, InstructionWalker it,
+                const Value& memoryAddress, const VPMArea& area, unsigned numBytes, bool useMutex,
+                const Value& bufferOffset = INT_ZERO);
+            /*
+             * Inserts the storing of the given number of bytes from the given packed area shared by all QPUs via DMA
+             * into the memory address.
+             *
+             * This is the counterpart to #insertPrefetchRAM
+             */
+            NODISCARD InstructionWalker insertWriteBackRAM(Method& method, InstructionWalker it,
+                const Value& memoryAddress, const VPMArea& area, unsigned numBytes, bool useMutex,
+                const Value& bufferOffset = INT_ZERO);
+            /*
+             * Inserts a read of a single scalar value from the given packed area into a QPU register
+             *
+             * For areas reserved per QPU, the copy of the executing QPU is accessed.
+             *
+             * NOTE: the inAreaOffset is the offset in bytes and needs to be aligned to the type of the destination
+             */
+            NODISCARD InstructionWalker insertReadPackedVPM(Method& method, InstructionWalker it, const Value& dest,
+                const VPMArea& area, bool useMutex, const Value& inAreaOffset);
+            /*
+             * Inserts a write of a single scalar value from a QPU register into the given packed area
+             *
+             * Since the QPU always writes whole rows, the row containing the value is read, modified and written back.
+             * For areas reserved per QPU, the copy of the executing QPU is accessed.
+             *
+             * NOTE: the inAreaOffset is the offset in bytes and needs to be aligned to the type of the source
+             * NOTE: For areas shared by several QPUs, the mutex needs to be locked to make the modification atomic!
+             */
+            NODISCARD InstructionWalker insertWritePackedVPM(Method& method, InstructionWalker it, const Value& src,
+                const VPMArea& area, bool useMutex, const Value& inAreaOffset);
+
             /*
              * Updates the maximum size used by the scratch area.
              * This can only be called until the scratch-area is locked!
@@ -876,10 +1001,17 @@ namespace vc4c
 
         private:
             const unsigned maximumVPMSize;
+            // all reserved areas, the scratch area is always the first entry
             std::vector<std::shared_ptr<VPMArea>> areas;
 
             InstructionWalker insertLockMutex(InstructionWalker it, bool useMutex) const;
             InstructionWalker insertUnlockMutex(InstructionWalker it, bool useMutex) const;
+            bool canPlaceArea(
+                unsigned rowOffset, unsigned numRows, unsigned perQPUStride, const VPMLiveRange& liveRange) const;
+            const VPMArea* placeArea(VPMUsage usage, const Local* local, uint8_t rowsPerCopy, uint8_t numCopies,
+                const VPMLiveRange& liveRange, bool isPacked);
+            NODISCARD InstructionWalker insertCalculatePackedIndices(Method& method, InstructionWalker it,
+                const VPMArea& area, const Value& inAreaOffset, Value& rowIndex, Value& laneIndex);
         };
 
         /*
@@ -0,0 +1,238 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "../ThreadPool.h"
+#include "CompilationError.h"
+#include "Compiler.h"
+#include "JSON.h"
+#include "Precompiler.h"
+#include "tools.h"
+
+#include "log.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+/*
+ * Compiles the input of the given configuration into the binary module, already compiled modules are returned as-is
+ */
+static std::string compileConfiguration(const BatchConfiguration& batchConfig)
+{
+    std::ifstream file(batchConfig.inputFile, std::ios_base::in | std::ios_base::binary);
+    if(!file)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open input file", batchConfig.inputFile);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string data = content.str();
+
+    std::istringstream typeStream(data);
+    if(Precompiler::getSourceType(typeStream) == SourceType::QPUASM_BIN)
+        return data;
+
+    // same distinction between compiler and pre-compiler options as the compiler executable
+    Configuration config{};
+    std::string options;
+    std::istringstream optionStream(batchConfig.compilationOptions);
+    std::string option;
+    while(optionStream >> option)
+    {
+        if(!parseConfigurationParameter(config, option) || option.find("-cl") == 0)
+            options.append(option).append(" ");
+    }
+    config.outputMode = OutputMode::BINARY;
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Compiling '" << batchConfig.inputFile << "' with options '" << batchConfig.compilationOptions
+            << "' for batch emulation..." << logging::endl);
+    std::istringstream input(data);
+    std::stringstream output;
+    Compiler::compile(input, output, config, options, batchConfig.inputFile);
+    return output.str();
+}
+
+static uint64_t calculateChecksum(const std::vector<uint32_t>& words)
+{
+    // 64-bit FNV-1a over the bytes of the words (in little endian)
+    uint64_t hash = 0xcbf29ce484222325;
+    for(uint32_t word : words)
+    {
+        for(unsigned i = 0; i < sizeof(uint32_t); ++i)
+        {
+            hash ^= (word >> (i * 8)) & 0xFF;
+            hash *= 0x100000001b3;
+        }
+    }
+    return hash;
+}
+
+static void runBatchEmulation(const std::string& module, const BatchConfiguration& config, BatchResult& result)
+{
+    std::istringstream moduleData(module);
+    EmulationData data(moduleData, config.kernelName, config.parameterSets[result.parameterSetIndex].second,
+        config.workGroups[result.workGroupIndex], config.maxEmulationCycles);
+    data.timing = config.timing;
+
+    auto emulationResult = emulate(data);
+    result.executionSuccessful = emulationResult.executionSuccessful;
+    result.numCycles = emulationResult.numCycles;
+    result.numInstructions = emulationResult.instrumentation.size();
+    for(const auto& instrumentation : emulationResult.instrumentation)
+    {
+        result.numExecutedInstructions += instrumentation.numExecutions - instrumentation.numStalls;
+        result.numStallCycles += instrumentation.numStalls;
+    }
+    result.checksums.reserve(emulationResult.results.size());
+    for(const auto& parameter : emulationResult.results)
+        result.checksums.emplace_back(parameter.second ? calculateChecksum(*parameter.second) : 0);
+}
+
+std::vector<BatchResult> tools::emulateBatch(const std::vector<BatchConfiguration>& configurations, uint32_t numThreads)
+{
+    std::vector<BatchResult> results;
+    for(std::size_t c = 0; c < configurations.size(); ++c)
+    {
+        for(std::size_t p = 0; p < configurations[c].parameterSets.size(); ++p)
+        {
+            for(std::size_t w = 0; w < configurations[c].workGroups.size(); ++w)
+            {
+                results.emplace_back();
+                results.back().configurationIndex = c;
+                results.back().parameterSetIndex = p;
+                results.back().workGroupIndex = w;
+            }
+        }
+    }
+
+    // compile every configuration only once, the compilation is not run in parallel, since it already uses multiple
+    // threads (and the pre-compiler processes) on its own
+    std::vector<std::string> modules(configurations.size());
+    std::vector<std::string> compilationErrors(configurations.size());
+    for(std::size_t c = 0; c < configurations.size(); ++c)
+    {
+        try
+        {
+            modules[c] = compileConfiguration(configurations[c]);
+        }
+        catch(const std::exception& e)
+        {
+            logging::error() << "Failed to compile '" << configurations[c].inputFile << "' with options '"
+                             << configurations[c].compilationOptions << "': " << e.what() << logging::endl;
+            compilationErrors[c] = std::string("Compilation failed: ") + e.what();
+        }
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Running " << results.size() << " emulations of " << configurations.size() << " configurations..."
+            << logging::endl);
+
+    // the single runs are completely independent and can be emulated in parallel
+    ThreadPool pool{"BatchEmulator", numThreads == 0 ? std::thread::hardware_concurrency() : numThreads};
+    std::vector<std::future<void>> futures;
+    futures.reserve(results.size());
+    for(auto& result : results)
+    {
+        if(!compilationErrors[result.configurationIndex].empty())
+        {
+            result.error = compilationErrors[result.configurationIndex];
+            continue;
+        }
+        futures.emplace_back(pool.schedule([&]() {
+            try
+            {
+                runBatchEmulation(modules[result.configurationIndex], configurations[result.configurationIndex],
+                    result);
+            }
+            catch(const std::exception& e)
+            {
+                result.error = std::string("Emulation failed: ") + e.what();
+            }
+        }));
+    }
+    for(auto& future : futures)
+        future.get();
+
+    return results;
+}
+
+static std::string toSizeString(const std::array<uint32_t, 3>& sizes)
+{
+    return std::to_string(sizes[0]) + "x" + std::to_string(sizes[1]) + "x" + std::to_string(sizes[2]);
+}
+
+static std::string toChecksumString(const std::vector<uint64_t>& checksums)
+{
+    std::stringstream s;
+    s << std::hex;
+    for(std::size_t i = 0; i < checksums.size(); ++i)
+        s << (i > 0 ? " " : "") << std::setfill('0') << std::setw(16) << checksums[i];
+    return s.str();
+}
+
+static std::string escapeCSV(const std::string& text)
+{
+    if(text.find_first_of(",\"\n") == std::string::npos)
+        return text;
+    std::string result = "\"";
+    for(char c : text)
+    {
+        if(c == '"')
+            result.push_back('"');
+        result.push_back(c);
+    }
+    return result + "\"";
+}
+
+void tools::writeBatchResultsCSV(
+    std::ostream& output, const std::vector<BatchConfiguration>& configurations,
+    const std::vector<BatchResult>& results)
+{
+    output << "input,kernel,options,parameters,local sizes,num groups,successful,cycles,instructions,executed "
+              "instructions,stall cycles,checksums,error"
+           << std::endl;
+    for(const auto& result : results)
+    {
+        const auto& config = configurations.at(result.configurationIndex);
+        const auto& workGroup = config.workGroups.at(result.workGroupIndex);
+        output << escapeCSV(config.inputFile) << ',' << escapeCSV(config.kernelName) << ','
+               << escapeCSV(config.compilationOptions) << ','
+               << escapeCSV(config.parameterSets.at(result.parameterSetIndex).first) << ','
+               << toSizeString(workGroup.localSizes) << ',' << toSizeString(workGroup.numGroups) << ','
+               << (result.executionSuccessful ? "true" : "false") << ',' << result.numCycles << ','
+               << result.numInstructions << ',' << result.numExecutedInstructions << ',' << result.numStallCycles
+               << ',' << toChecksumString(result.checksums) << ',' << escapeCSV(result.error) << std::endl;
+    }
+}
+
+void tools::writeBatchResultsJSON(
+    std::ostream& output, const std::vector<BatchConfiguration>& configurations,
+    const std::vector<BatchResult>& results)
+{
+    output << '[';
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto& config = configurations.at(result.configurationIndex);
+        const auto& workGroup = config.workGroups.at(result.workGroupIndex);
+        output << (i > 0 ? ",\n" : "\n") << "{\"input\":\"" << escapeJSON(config.inputFile) << "\",\"kernel\":\""
+               << escapeJSON(config.kernelName) << "\",\"options\":\"" << escapeJSON(config.compilationOptions)
+               << "\",\"parameters\":\"" << escapeJSON(config.parameterSets.at(result.parameterSetIndex).first)
+               << "\",\"localSizes\":[" << workGroup.localSizes[0] << ',' << workGroup.localSizes[1] << ','
+               << workGroup.localSizes[2] << "],\"numGroups\":[" << workGroup.numGroups[0] << ','
+               << workGroup.numGroups[1] << ',' << workGroup.numGroups[2]
+               << "],\"successful\":" << (result.executionSuccessful ? "true" : "false")
+               << ",\"cycles\":" << result.numCycles << ",\"instructions\":" << result.numInstructions
+               << ",\"executedInstructions\":" << result.numExecutedInstructions
+               << ",\"stallCycles\":" << result.numStallCycles << ",\"checksums\":[";
+        for(std::size_t k = 0; k < result.checksums.size(); ++k)
+            output << (k > 0 ? "," : "") << '"' << toChecksumString({result.checksums[k]}) << '"';
+        output << "],\"error\":\"" << escapeJSON(result.error) << "\"}";
+    }
+    output << "\n]" << std::endl;
+}
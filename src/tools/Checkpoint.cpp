@@ -0,0 +1,416 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "Checkpoint.h"
+
+#include "CompilationError.h"
+#include "log.h"
+
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+static constexpr char CHECKPOINT_MAGIC[8] = {'V', 'C', '4', 'C', 'C', 'H', 'K', 'P'};
+static constexpr uint32_t CHECKPOINT_VERSION = 1;
+// the offset of the cycle in the serialized data, directly after the magic number and the version
+static constexpr std::size_t CYCLE_OFFSET = sizeof(CHECKPOINT_MAGIC) + sizeof(CHECKPOINT_VERSION);
+
+template <typename T>
+static void write(std::string& out, T value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivial types can be written directly");
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static T read(const std::string& data, std::size_t& offset)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivial types can be read directly");
+    if(offset + sizeof(T) > data.size())
+        throw CompilationError(CompilationStep::GENERAL, "Checkpoint data is truncated");
+    T value;
+    memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+template <typename T>
+static void check(const std::string& data, std::size_t& offset, T expected, const std::string& what)
+{
+    auto value = read<T>(data, offset);
+    if(value != expected)
+        throw CompilationError(CompilationStep::GENERAL, "Checkpoint does not match the emulation", what);
+}
+
+static bool startsZeroRun(const Word* words, std::size_t index, std::size_t numWords)
+{
+    // skipping single zero words would take more space than storing them
+    for(std::size_t i = index; i < std::min(index + 4, numWords); ++i)
+    {
+        if(words[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Writes the words as alternating runs of zero words (only stored as their length) and other words
+ */
+static void writeWords(std::string& out, const Word* words, std::size_t numWords)
+{
+    write(out, static_cast<uint32_t>(numWords));
+    std::size_t index = 0;
+    while(index < numWords)
+    {
+        std::size_t numZeros = 0;
+        while(index + numZeros < numWords && words[index + numZeros] == 0)
+            ++numZeros;
+        index += numZeros;
+        std::size_t numValues = 0;
+        while(index + numValues < numWords && !startsZeroRun(words, index + numValues, numWords))
+            ++numValues;
+        write(out, static_cast<uint32_t>(numZeros));
+        write(out, static_cast<uint32_t>(numValues));
+        out.append(reinterpret_cast<const char*>(words + index), numValues * sizeof(Word));
+        index += numValues;
+    }
+}
+
+static void readWords(const std::string& data, std::size_t& offset, Word* words, std::size_t numWords)
+{
+    check(data, offset, static_cast<uint32_t>(numWords), "number of words");
+    std::size_t index = 0;
+    while(index < numWords)
+    {
+        auto numZeros = read<uint32_t>(data, offset);
+        auto numValues = read<uint32_t>(data, offset);
+        if(index + numZeros + numValues > numWords || offset + numValues * sizeof(Word) > data.size())
+            throw CompilationError(CompilationStep::GENERAL, "Checkpoint data is corrupted");
+        std::fill_n(words + index, numZeros, 0);
+        index += numZeros;
+        memcpy(words + index, data.data() + offset, numValues * sizeof(Word));
+        offset += numValues * sizeof(Word);
+        index += numValues;
+    }
+}
+
+static void writeVector(std::string& out, const SIMDVector& vector)
+{
+    for(const auto& element : vector)
+    {
+        write(out, element.type);
+        write(out, element.unsignedInt());
+    }
+}
+
+static SIMDVector readVector(const std::string& data, std::size_t& offset)
+{
+    SIMDVector vector;
+    for(std::size_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        auto type = read<LiteralType>(data, offset);
+        Literal element(read<uint32_t>(data, offset));
+        // the type only determines the interpretation of the stored bits
+        element.type = type;
+        vector[i] = element;
+    }
+    return vector;
+}
+
+static void writeOptionalVector(std::string& out, const Optional<SIMDVector>& vector)
+{
+    write(out, vector.has_value());
+    if(vector)
+        writeVector(out, vector.value());
+}
+
+static Optional<SIMDVector> readOptionalVector(const std::string& data, std::size_t& offset)
+{
+    if(read<bool>(data, offset))
+        return readVector(data, offset);
+    return {};
+}
+
+static void writeQueue(std::string& out, std::queue<std::pair<SIMDVector, uint32_t>> queue)
+{
+    write(out, static_cast<uint32_t>(queue.size()));
+    for(; !queue.empty(); queue.pop())
+    {
+        writeVector(out, queue.front().first);
+        write(out, queue.front().second);
+    }
+}
+
+static std::queue<std::pair<SIMDVector, uint32_t>> readQueue(const std::string& data, std::size_t& offset)
+{
+    std::queue<std::pair<SIMDVector, uint32_t>> queue;
+    auto size = read<uint32_t>(data, offset);
+    for(uint32_t i = 0; i < size; ++i)
+    {
+        auto vector = readVector(data, offset);
+        queue.emplace(std::move(vector), read<uint32_t>(data, offset));
+    }
+    return queue;
+}
+
+Checkpoint::Checkpoint(uint32_t cycle, std::bitset<NATIVE_VECTOR_SIZE> activeQPUs, const DecodedProgram& program,
+    const Memory& memory, const Mutex& mutex, const std::array<SFU, NUM_QPUS>& sfus, const VPM& vpm,
+    const Semaphores& semaphores, const std::vector<QPU>& qpus, const CacheModel& caches) :
+    cycle(cycle)
+{
+    data.append(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    write(data, CHECKPOINT_VERSION);
+    write(data, cycle);
+    write(data, static_cast<uint32_t>(program.size()));
+    write(data, static_cast<uint32_t>(qpus.size()));
+    write(data, static_cast<uint32_t>(activeQPUs.to_ulong()));
+
+    if(auto direct = VariantNamespace::get_if<Memory::DirectBuffer>(&memory.data))
+    {
+        write(data, false);
+        writeWords(data, direct->data(), direct->size());
+    }
+    else
+    {
+        const auto& buffers = VariantNamespace::get<Memory::MappedBuffers>(memory.data);
+        write(data, true);
+        write(data, static_cast<uint32_t>(buffers.size()));
+        for(const auto& buffer : buffers)
+        {
+            write(data, buffer.first);
+            write(data, static_cast<uint32_t>(buffer.second.get().size()));
+            data.append(reinterpret_cast<const char*>(buffer.second.get().data()), buffer.second.get().size());
+        }
+    }
+
+    write(data, mutex.locked);
+    write(data, mutex.lockOwner);
+    data.append(reinterpret_cast<const char*>(semaphores.counter.data()), semaphores.counter.size());
+
+    write(data, vpm.vpmReadSetup);
+    write(data, vpm.vpmWriteSetup);
+    write(data, vpm.dmaReadSetup);
+    write(data, vpm.dmaWriteSetup);
+    write(data, vpm.readStrideSetup);
+    write(data, vpm.writeStrideSetup);
+    write(data, vpm.lastReadSetup);
+    write(data, vpm.dmaReadFinished);
+    write(data, vpm.dmaWriteFinished);
+    write(data, vpm.dmaBusyUntil);
+    write(data, vpm.currentCycle);
+    writeWords(data, vpm.cache.front().data(), vpm.cache.size() * vpm.cache.front().size());
+
+    for(const SFU& sfu : sfus)
+    {
+        write(data, sfu.lastSFUWrite);
+        write(data, sfu.currentCycle);
+        writeOptionalVector(data, sfu.sfuResult);
+    }
+
+    write(data, static_cast<uint32_t>(caches.tmuCaches.size() + 1));
+    for(std::size_t i = 0; i <= caches.tmuCaches.size(); ++i)
+    {
+        const Cache& cache = i < caches.tmuCaches.size() ? caches.tmuCaches[i] : caches.l2Cache;
+        write(data, cache.lineSize);
+        write(data, cache.associativity);
+        write(data, static_cast<uint32_t>(cache.sets.size()));
+        for(const auto& set : cache.sets)
+        {
+            write(data, static_cast<uint32_t>(set.size()));
+            for(auto line : set)
+                write(data, line);
+        }
+    }
+
+    for(const QPU& qpu : qpus)
+    {
+        write(data, qpu.currentCycle);
+        write(data, qpu.pc);
+        write(data, qpu.stallCause);
+        write(data, qpu.repeatableStall);
+        write(data, qpu.flags);
+
+        write(data, static_cast<uint32_t>(qpu.registers.storageRegisters.size()));
+        for(const auto& reg : qpu.registers.storageRegisters)
+        {
+            write(data, reg.first.file);
+            write(data, reg.first.num);
+            writeVector(data, reg.second);
+        }
+        writeOptionalVector(data, qpu.registers.hostInterrupt);
+
+        write(data, qpu.uniforms.uniformAddress);
+        write(data, qpu.uniforms.lastAddressSetCycle);
+
+        write(data, qpu.tmus.tmuNoSwap);
+        write(data, qpu.tmus.lastTMUNoSwap);
+        writeQueue(data, qpu.tmus.tmu0RequestQueue);
+        writeQueue(data, qpu.tmus.tmu0ResponseQueue);
+        writeQueue(data, qpu.tmus.tmu1RequestQueue);
+        writeQueue(data, qpu.tmus.tmu1ResponseQueue);
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Created checkpoint of " << data.size() << " bytes at cycle " << cycle << logging::endl);
+}
+
+Checkpoint::Checkpoint(std::string&& data) : cycle(0), data(std::move(data))
+{
+    if(this->data.size() < CYCLE_OFFSET + sizeof(uint32_t) ||
+        memcmp(this->data.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+        throw CompilationError(CompilationStep::GENERAL, "Invalid emulation checkpoint");
+    std::size_t offset = sizeof(CHECKPOINT_MAGIC);
+    if(read<uint32_t>(this->data, offset) != CHECKPOINT_VERSION)
+        throw CompilationError(CompilationStep::GENERAL, "Unsupported version of emulation checkpoint");
+    cycle = read<uint32_t>(this->data, offset);
+}
+
+uint32_t Checkpoint::restore(std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs, const DecodedProgram& program,
+    Memory& memory, Mutex& mutex, std::array<SFU, NUM_QPUS>& sfus, VPM& vpm, Semaphores& semaphores,
+    std::vector<QPU>& qpus, CacheModel& caches) const
+{
+    std::size_t offset = CYCLE_OFFSET + sizeof(uint32_t);
+    check(data, offset, static_cast<uint32_t>(program.size()), "number of instructions");
+    check(data, offset, static_cast<uint32_t>(qpus.size()), "number of QPUs");
+    activeQPUs = std::bitset<NATIVE_VECTOR_SIZE>(read<uint32_t>(data, offset));
+
+    const bool isMapped = read<bool>(data, offset);
+    if(auto direct = VariantNamespace::get_if<Memory::DirectBuffer>(&memory.data))
+    {
+        if(isMapped)
+            throw CompilationError(CompilationStep::GENERAL, "Checkpoint does not match the emulation", "memory");
+        readWords(data, offset, direct->data(), direct->size());
+    }
+    else
+    {
+        auto& buffers = VariantNamespace::get<Memory::MappedBuffers>(memory.data);
+        if(!isMapped)
+            throw CompilationError(CompilationStep::GENERAL, "Checkpoint does not match the emulation", "memory");
+        check(data, offset, static_cast<uint32_t>(buffers.size()), "number of buffers");
+        for(auto& buffer : buffers)
+        {
+            check(data, offset, buffer.first, "buffer address");
+            check(data, offset, static_cast<uint32_t>(buffer.second.get().size()), "buffer size");
+            if(offset + buffer.second.get().size() > data.size())
+                throw CompilationError(CompilationStep::GENERAL, "Checkpoint data is truncated");
+            memcpy(buffer.second.get().data(), data.data() + offset, buffer.second.get().size());
+            offset += buffer.second.get().size();
+        }
+    }
+
+    mutex.locked = read<bool>(data, offset);
+    mutex.lockOwner = read<uint8_t>(data, offset);
+    for(auto& counter : semaphores.counter)
+        counter = read<uint8_t>(data, offset);
+
+    vpm.vpmReadSetup = read<uint32_t>(data, offset);
+    vpm.vpmWriteSetup = read<uint32_t>(data, offset);
+    vpm.dmaReadSetup = read<uint32_t>(data, offset);
+    vpm.dmaWriteSetup = read<uint32_t>(data, offset);
+    vpm.readStrideSetup = read<uint32_t>(data, offset);
+    vpm.writeStrideSetup = read<uint32_t>(data, offset);
+    vpm.lastReadSetup = read<uint32_t>(data, offset);
+    vpm.dmaReadFinished = read<std::array<uint32_t, NUM_QPUS>>(data, offset);
+    vpm.dmaWriteFinished = read<std::array<uint32_t, NUM_QPUS>>(data, offset);
+    vpm.dmaBusyUntil = read<uint32_t>(data, offset);
+    vpm.currentCycle = read<uint32_t>(data, offset);
+    readWords(data, offset, vpm.cache.front().data(), vpm.cache.size() * vpm.cache.front().size());
+
+    for(SFU& sfu : sfus)
+    {
+        sfu.lastSFUWrite = read<uint32_t>(data, offset);
+        sfu.currentCycle = read<uint32_t>(data, offset);
+        sfu.sfuResult = readOptionalVector(data, offset);
+    }
+
+    // the cache contents can only be restored if the cache configuration is the same, e.g. the checkpoint might have
+    // been taken with another timing model
+    bool cachesMatch = read<uint32_t>(data, offset) == caches.tmuCaches.size() + 1;
+    std::vector<std::vector<std::vector<MemoryAddress>>> cacheSets(caches.tmuCaches.size() + 1);
+    for(std::size_t i = 0; i <= caches.tmuCaches.size(); ++i)
+    {
+        const Cache& cache = i < caches.tmuCaches.size() ? caches.tmuCaches[i] : caches.l2Cache;
+        cachesMatch = read<uint32_t>(data, offset) == cache.lineSize && cachesMatch;
+        cachesMatch = read<uint32_t>(data, offset) == cache.associativity && cachesMatch;
+        auto numSets = read<uint32_t>(data, offset);
+        cachesMatch = numSets == cache.sets.size() && cachesMatch;
+        cacheSets[i].resize(numSets);
+        for(auto& set : cacheSets[i])
+        {
+            set.resize(read<uint32_t>(data, offset));
+            for(auto& line : set)
+                line = read<MemoryAddress>(data, offset);
+        }
+    }
+    for(std::size_t i = 0; i <= caches.tmuCaches.size(); ++i)
+    {
+        Cache& cache = i < caches.tmuCaches.size() ? caches.tmuCaches[i] : caches.l2Cache;
+        if(cachesMatch)
+            cache.sets = std::move(cacheSets[i]);
+        else
+        {
+            for(auto& set : cache.sets)
+                set.clear();
+        }
+    }
+    if(!cachesMatch)
+        logging::warn() << "Cache configuration of the checkpoint does not match the timing model, continuing with "
+                           "empty caches"
+                        << logging::endl;
+
+    for(QPU& qpu : qpus)
+    {
+        qpu.currentCycle = read<uint32_t>(data, offset);
+        qpu.pc = read<ProgramCounter>(data, offset);
+        qpu.stallCause = read<StallCause>(data, offset);
+        qpu.repeatableStall = read<bool>(data, offset);
+        qpu.flags = read<std::array<ElementFlags, NATIVE_VECTOR_SIZE>>(data, offset);
+
+        qpu.registers.storageRegisters.clear();
+        auto numRegisters = read<uint32_t>(data, offset);
+        for(uint32_t i = 0; i < numRegisters; ++i)
+        {
+            auto file = read<RegisterFile>(data, offset);
+            auto num = read<unsigned char>(data, offset);
+            qpu.registers.storageRegisters.emplace(Register{file, num}, readVector(data, offset));
+        }
+        qpu.registers.hostInterrupt = readOptionalVector(data, offset);
+        qpu.registers.clearReadCache();
+
+        qpu.uniforms.uniformAddress = read<MemoryAddress>(data, offset);
+        qpu.uniforms.lastAddressSetCycle = read<uint32_t>(data, offset);
+
+        qpu.tmus.tmuNoSwap = read<bool>(data, offset);
+        qpu.tmus.lastTMUNoSwap = read<uint32_t>(data, offset);
+        qpu.tmus.tmu0RequestQueue = readQueue(data, offset);
+        qpu.tmus.tmu0ResponseQueue = readQueue(data, offset);
+        qpu.tmus.tmu1RequestQueue = readQueue(data, offset);
+        qpu.tmus.tmu1ResponseQueue = readQueue(data, offset);
+    }
+
+    if(offset != data.size())
+        throw CompilationError(CompilationStep::GENERAL, "Checkpoint data is corrupted");
+    CPPLOG_LAZY(logging::Level::INFO, log << "Restored checkpoint at cycle " << cycle << logging::endl);
+    return cycle;
+}
+
+uint32_t Checkpoint::getCycle() const
+{
+    return cycle;
+}
+
+void Checkpoint::writeTo(std::ostream& out) const
+{
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+Checkpoint Checkpoint::readFrom(std::istream& in)
+{
+    return Checkpoint(std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+}
@@ -0,0 +1,61 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_TOOLS_CHECKPOINT_H
+#define VC4C_TOOLS_CHECKPOINT_H
+
+#include "Emulator.h"
+
+#include <iostream>
+#include <string>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * A snapshot of the complete state of a single emulation at the beginning of a cycle, i.e. all QPUs (with
+         * their registers, flags, program counters, UNIFORM pointers and TMU queues), the SFUs, the VPM, the
+         * semaphores, the mutex, the contents of the simulated caches and the memory.
+         *
+         * The state is stored in a compact binary form (e.g. runs of zero words in the memory are not stored), which
+         * can be written into and read from a file.
+         *
+         * Since the emulation is deterministic, continuing the emulation from a restored checkpoint gives the same
+         * result as continuing the original emulation, as long as the same timing model is used. The instrumentation
+         * results and the cache statistics are not part of the checkpoint, so an emulation continued from a checkpoint
+         * only reports the results of the cycles emulated after the checkpoint.
+         */
+        class Checkpoint
+        {
+        public:
+            Checkpoint(uint32_t cycle, std::bitset<NATIVE_VECTOR_SIZE> activeQPUs, const DecodedProgram& program,
+                const Memory& memory, const Mutex& mutex, const std::array<SFU, NUM_QPUS>& sfus, const VPM& vpm,
+                const Semaphores& semaphores, const std::vector<QPU>& qpus, const CacheModel& caches);
+
+            /*
+             * Restores the state of the given emulation objects (of the same program with the same number of QPUs
+             * and the same memory size) and returns the cycle of the checkpoint
+             */
+            uint32_t restore(std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs, const DecodedProgram& program,
+                Memory& memory, Mutex& mutex, std::array<SFU, NUM_QPUS>& sfus, VPM& vpm, Semaphores& semaphores,
+                std::vector<QPU>& qpus, CacheModel& caches) const;
+
+            uint32_t getCycle() const;
+
+            void writeTo(std::ostream& out) const;
+            static Checkpoint readFrom(std::istream& in);
+
+        private:
+            explicit Checkpoint(std::string&& data);
+
+            uint32_t cycle;
+            std::string data;
+        };
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_TOOLS_CHECKPOINT_H */
@@ -0,0 +1,219 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "EmulationTrace.h"
+
+#include "CompilationError.h"
+#include "JSON.h"
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+// the number of events buffered before they are written to the trace file
+static constexpr std::size_t MAX_BUFFERED_EVENTS = 4096;
+
+// the tracks (thread IDs) of the periphery, the QPUs use their ID as track
+static constexpr uint32_t TRACK_DMA = 100;
+static constexpr uint32_t TRACK_MUTEX = 101;
+
+// the names of the QPU states, compared by pointer
+static const char* const STATE_RUNNING = "running";
+static const char* const STATE_STALL_TMU = "stalled: TMU";
+static const char* const STATE_STALL_DMA_LOAD = "stalled: DMA load";
+static const char* const STATE_STALL_DMA_STORE = "stalled: DMA store";
+static const char* const STATE_STALL_VPM_READ = "stalled: VPM read";
+static const char* const STATE_STALL_MUTEX = "stalled: mutex";
+static const char* const STATE_STALL_SEMAPHORE = "stalled: semaphore";
+static const char* const STATE_FINISHED = "finished";
+
+static std::string toEvent(const char* phase, const std::string& name, const char* category, uint32_t processID,
+    uint32_t track, uint64_t timestamp, const std::string& extra = "")
+{
+    return std::string("{\"name\":\"") + escapeJSON(name) + "\",\"cat\":\"" + category + "\",\"ph\":\"" + phase +
+        "\",\"pid\":" + std::to_string(processID) + ",\"tid\":" + std::to_string(track) +
+        ",\"ts\":" + std::to_string(timestamp) + extra + "}";
+}
+
+static std::string toMetadataEvent(const char* name, uint32_t processID, uint32_t track, const std::string& args)
+{
+    return std::string("{\"name\":\"") + name + "\",\"ph\":\"M\",\"pid\":" + std::to_string(processID) +
+        ",\"tid\":" + std::to_string(track) + ",\"args\":{" + args + "}}";
+}
+
+TraceWriter::TraceWriter(const std::string& fileName) : output(fileName), firstEvent(true)
+{
+    if(!output)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open trace file", fileName);
+    output << "{\"otherData\":{\"timeUnit\":\"QPU cycles\"},\"traceEvents\":[";
+}
+
+TraceWriter::~TraceWriter()
+{
+    output << "\n]}" << std::endl;
+}
+
+void TraceWriter::writeEvents(const std::vector<std::string>& events)
+{
+    std::lock_guard<std::mutex> guard(writeLock);
+    for(const auto& event : events)
+    {
+        output << (firstEvent ? "\n" : ",\n") << event;
+        firstEvent = false;
+    }
+    // write the batch through, so the trace of an aborted emulation is not lost
+    output.flush();
+}
+
+EmulationTrace::EmulationTrace(TraceWriter& writer, uint32_t processID, const std::string& processName) :
+    writer(writer), processID(processID), baseCycle(0), currentCycle(0), qpuStates{}, mutexState{},
+    numNamedQPUs(0)
+{
+    events.reserve(MAX_BUFFERED_EVENTS);
+    addEvent(toMetadataEvent("process_name", processID, 0, "\"name\":\"" + escapeJSON(processName) + "\""));
+    addEvent(toMetadataEvent("process_sort_index", processID, 0, "\"sort_index\":" + std::to_string(processID)));
+    addEvent(toMetadataEvent("thread_name", processID, TRACK_DMA, "\"name\":\"DMA\""));
+    addEvent(toMetadataEvent("thread_name", processID, TRACK_MUTEX, "\"name\":\"Mutex\""));
+}
+
+EmulationTrace::~EmulationTrace()
+{
+    flush();
+}
+
+void EmulationTrace::startEmulation(std::size_t numQPUs)
+{
+    currentCycle = baseCycle;
+    for(; numNamedQPUs < numQPUs; ++numNamedQPUs)
+    {
+        addEvent(toMetadataEvent("thread_name", processID, static_cast<uint32_t>(numNamedQPUs),
+            "\"name\":\"QPU " + std::to_string(numNamedQPUs) + "\""));
+        addEvent(toMetadataEvent("thread_sort_index", processID, static_cast<uint32_t>(numNamedQPUs),
+            "\"sort_index\":" + std::to_string(numNamedQPUs)));
+    }
+}
+
+void EmulationTrace::finishEmulation(uint32_t numCycles)
+{
+    const uint64_t endCycle = baseCycle + numCycles;
+    for(uint8_t qpu = 0; qpu < qpuStates.size(); ++qpu)
+        closeSpan(qpuStates[qpu], qpu, endCycle);
+    closeSpan(mutexState, TRACK_MUTEX, endCycle);
+    baseCycle = endCycle;
+    currentCycle = endCycle;
+}
+
+void EmulationTrace::setCycle(uint32_t cycle)
+{
+    currentCycle = baseCycle + cycle;
+}
+
+void EmulationTrace::recordQPURunning(uint8_t qpu)
+{
+    setQPUState(qpu, STATE_RUNNING);
+}
+
+void EmulationTrace::recordQPUStall(uint8_t qpu, StallCause cause)
+{
+    switch(cause)
+    {
+    case StallCause::TMU:
+        setQPUState(qpu, STATE_STALL_TMU);
+        break;
+    case StallCause::DMA_LOAD:
+        setQPUState(qpu, STATE_STALL_DMA_LOAD);
+        break;
+    case StallCause::DMA_STORE:
+        setQPUState(qpu, STATE_STALL_DMA_STORE);
+        break;
+    case StallCause::VPM_READ:
+        setQPUState(qpu, STATE_STALL_VPM_READ);
+        break;
+    case StallCause::MUTEX:
+        setQPUState(qpu, STATE_STALL_MUTEX);
+        break;
+    case StallCause::SEMAPHORE:
+        setQPUState(qpu, STATE_STALL_SEMAPHORE);
+        break;
+    }
+}
+
+void EmulationTrace::recordQPUFinished(uint8_t qpu)
+{
+    setQPUState(qpu, STATE_FINISHED);
+}
+
+void EmulationTrace::recordDMATransfer(
+    uint8_t qpu, bool isLoad, uint32_t startCycle, uint32_t endCycle, uint32_t numRows, uint32_t rowBytes)
+{
+    addEvent(toEvent("X", isLoad ? "DMA load" : "DMA store", "dma", processID, TRACK_DMA, baseCycle + startCycle,
+        ",\"dur\":" + std::to_string(endCycle - startCycle) + ",\"args\":{\"qpu\":" + std::to_string(qpu) +
+            ",\"rows\":" + std::to_string(numRows) + ",\"row bytes\":" + std::to_string(rowBytes) + "}"));
+}
+
+void EmulationTrace::recordMutexLocked(uint8_t qpu)
+{
+    closeSpan(mutexState, TRACK_MUTEX, currentCycle);
+    mutexState.name = "locked";
+    mutexState.startCycle = currentCycle;
+    mutexState.qpu = qpu;
+}
+
+void EmulationTrace::recordMutexUnlocked()
+{
+    // the unlock takes effect after the writing instruction
+    closeSpan(mutexState, TRACK_MUTEX, currentCycle + 1);
+}
+
+void EmulationTrace::recordSemaphore(uint8_t qpu, uint8_t semaphore, bool increment, uint8_t value)
+{
+    const std::string name = "semaphore " + std::to_string(semaphore);
+    addEvent(toEvent("i", name + (increment ? " increment" : " decrement"), "semaphore", processID, qpu,
+        currentCycle, ",\"s\":\"t\""));
+    addEvent(toEvent("C", name, "semaphore", processID, 0, currentCycle,
+        ",\"args\":{\"value\":" + std::to_string(value) + "}"));
+}
+
+void EmulationTrace::setQPUState(uint8_t qpu, const char* state)
+{
+    auto& span = qpuStates.at(qpu);
+    if(span.name == state)
+        return;
+    closeSpan(span, qpu, currentCycle);
+    span.name = state;
+    span.startCycle = currentCycle;
+    span.qpu = qpu;
+}
+
+void EmulationTrace::closeSpan(Span& span, uint32_t track, uint64_t endCycle)
+{
+    if(span.name == nullptr)
+        return;
+    if(endCycle > span.startCycle)
+    {
+        std::string args;
+        if(track == TRACK_MUTEX)
+            args = ",\"args\":{\"qpu\":" + std::to_string(span.qpu) + "}";
+        addEvent(toEvent("X", track == TRACK_MUTEX ? "locked by QPU " + std::to_string(span.qpu) : span.name,
+            track == TRACK_MUTEX ? "mutex" : "qpu", processID, track, span.startCycle,
+            ",\"dur\":" + std::to_string(endCycle - span.startCycle) + args));
+    }
+    span.name = nullptr;
+}
+
+void EmulationTrace::addEvent(std::string&& event)
+{
+    events.emplace_back(std::move(event));
+    if(events.size() >= MAX_BUFFERED_EVENTS)
+        flush();
+}
+
+void EmulationTrace::flush()
+{
+    if(events.empty())
+        return;
+    writer.writeEvents(events);
+    events.clear();
+}
@@ -0,0 +1,112 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_TOOLS_EMULATION_TRACE_H
+#define VC4C_TOOLS_EMULATION_TRACE_H
+
+#include "Emulator.h"
+
+#include <fstream>
+#include <mutex>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * Writes the events of one or multiple emulation traces into a file in the Chrome trace-event format (JSON),
+         * which can be viewed e.g. in chrome://tracing or the Perfetto UI.
+         *
+         * Since the emulation has no notion of real time, the time-stamps of the events are given in QPU cycles, i.e.
+         * one microsecond in the trace viewer corresponds to one QPU cycle.
+         */
+        class TraceWriter : private NonCopyable
+        {
+        public:
+            explicit TraceWriter(const std::string& fileName);
+            ~TraceWriter();
+
+            /*
+             * Appends the given (already formatted) events to the trace file.
+             *
+             * NOTE: This function can be called concurrently by several traces
+             */
+            void writeEvents(const std::vector<std::string>& events);
+
+        private:
+            std::mutex writeLock;
+            std::ofstream output;
+            bool firstEvent;
+        };
+
+        /*
+         * Records the execution trace of a sequence of emulations (e.g. all work-groups emulated by a single host
+         * thread) as a single process with following tracks:
+         * - a track per QPU with spans of the QPU running, being stalled (split by cause) and having finished
+         * - a track for the DMA transfers between the VPM and the memory
+         * - a track for the hardware mutex with spans of the mutex being held by a QPU
+         * - counters for the values of the semaphores
+         *
+         * The QPU states are merged into spans of consecutive cycles and the events are buffered and written in
+         * batches of a bounded size, so the memory usage does not depend on the length of the emulation.
+         */
+        class EmulationTrace : private NonCopyable
+        {
+        public:
+            EmulationTrace(TraceWriter& writer, uint32_t processID, const std::string& processName);
+            ~EmulationTrace();
+
+            /*
+             * Starts/finishes a single emulation, the cycles of all following emulations are appended to the cycles
+             * of all previous emulations.
+             */
+            void startEmulation(std::size_t numQPUs);
+            void finishEmulation(uint32_t numCycles);
+            /*
+             * Sets the cycle (relative to the start of the current emulation) all following events happen in
+             */
+            void setCycle(uint32_t cycle);
+
+            void recordQPURunning(uint8_t qpu);
+            void recordQPUStall(uint8_t qpu, StallCause cause);
+            void recordQPUFinished(uint8_t qpu);
+            void recordDMATransfer(uint8_t qpu, bool isLoad, uint32_t startCycle, uint32_t endCycle,
+                uint32_t numRows, uint32_t rowBytes);
+            void recordMutexLocked(uint8_t qpu);
+            void recordMutexUnlocked();
+            void recordSemaphore(uint8_t qpu, uint8_t semaphore, bool increment, uint8_t value);
+
+        private:
+            /*
+             * A currently open span of a track
+             */
+            struct Span
+            {
+                // the name of the span, nullptr if there is no open span
+                const char* name = nullptr;
+                uint64_t startCycle = 0;
+                uint8_t qpu = 0;
+            };
+
+            TraceWriter& writer;
+            uint32_t processID;
+            // the cycle of the start of the current emulation and the current cycle (both absolute)
+            uint64_t baseCycle;
+            uint64_t currentCycle;
+            std::array<Span, NUM_QPUS> qpuStates;
+            Span mutexState;
+            std::size_t numNamedQPUs;
+            std::vector<std::string> events;
+
+            void setQPUState(uint8_t qpu, const char* state);
+            void closeSpan(Span& span, uint32_t track, uint64_t endCycle);
+            void addEvent(std::string&& event);
+            void flush();
+        };
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_TOOLS_EMULATION_TRACE_H */
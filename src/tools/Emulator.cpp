@@ -8,6 +8,7 @@
 
 #include "../GlobalValues.h"
 #include "../Profiler.h"
+#include "../ThreadPool.h"
 #include "../asm/ALUInstruction.h"
 #include "../asm/BranchInstruction.h"
 #include "../asm/Instruction.h"
@@ -15,6 +16,9 @@
 #include "../asm/LoadInstruction.h"
 #include "../asm/SemaphoreInstruction.h"
 #include "../periphery/VPM.h"
+#include "Checkpoint.h"
+#include "EmulationTrace.h"
+#include "HotSpotProfile.h"
 #include "CompilationError.h"
 #include "Compiler.h"
 
@@ -136,6 +140,24 @@ tools::Word Memory::readWord(MemoryAddress address) const
     return *getWordAddress(address);
 }
 
+void Memory::writeBytes(MemoryAddress address, const uint8_t* bytes, std::size_t numBytes)
+{
+    if(numBytes == 0)
+        return;
+    memcpy(reinterpret_cast<uint8_t*>(getWordAddress(address)) + address % sizeof(Word), bytes, numBytes);
+    const std::size_t lastWord = (address + numBytes - 1) / sizeof(Word);
+    if(writtenWords.size() <= lastWord)
+        writtenWords.resize(lastWord + 1, false);
+    for(std::size_t word = address / sizeof(Word); word <= lastWord; ++word)
+        writtenWords[word] = true;
+}
+
+bool Memory::isWordWritten(MemoryAddress address) const
+{
+    const std::size_t word = address / sizeof(Word);
+    return word < writtenWords.size() && writtenWords[word];
+}
+
 MemoryAddress Memory::incrementAddress(MemoryAddress address, DataType typeSize) const
 {
     return address + typeSize.getInMemoryWidth();
@@ -157,6 +179,16 @@ void Memory::setUniforms(const std::vector<Word>& uniforms, MemoryAddress addres
         VariantNamespace::get<DirectBuffer>(data).begin() + static_cast<std::vector<Word>::difference_type>(offset));
 }
 
+Memory Memory::copy() const
+{
+    auto direct = VariantNamespace::get_if<DirectBuffer>(&data);
+    if(!direct)
+        throw CompilationError(CompilationStep::GENERAL, "Copying mapped buffers is not supported");
+    Memory mem(direct->size());
+    VariantNamespace::get<DirectBuffer>(mem.data) = *direct;
+    return mem;
+}
+
 bool Mutex::isLocked() const
 {
     return locked;
@@ -175,6 +207,8 @@ bool Mutex::lock(uint8_t qpu)
     }
     locked = true;
     lockOwner = qpu;
+    if(trace)
+        trace->recordMutexLocked(qpu);
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 20, "lockMutex", 1);
     return true;
 }
@@ -186,6 +220,8 @@ void Mutex::unlock(uint8_t qpu)
     if(lockOwner != qpu)
         throw CompilationError(CompilationStep::GENERAL, "Cannot free mutex locked by another QPU!");
     locked = false;
+    if(trace)
+        trace->recordMutexUnlocked();
 }
 
 LCOV_EXCL_START
@@ -241,9 +277,9 @@ void Registers::writeRegister(Register reg, const SIMDVector& val, std::bitset<1
     else if(reg == REG_VPM_OUT_SETUP)
         qpu.vpm.setWriteSetup(val);
     else if(reg == REG_VPM_DMA_LOAD_ADDR)
-        qpu.vpm.setDMAReadAddress(val);
+        qpu.vpm.setDMAReadAddress(val, qpu.ID);
     else if(reg == REG_VPM_DMA_STORE_ADDR)
-        qpu.vpm.setDMAWriteAddress(val);
+        qpu.vpm.setDMAWriteAddress(val, qpu.ID);
     else if(reg.num == REG_MUTEX.num)
         qpu.mutex.unlock(qpu.ID);
     else if(reg.num == REG_SFU_RECIP.num)
@@ -344,18 +380,32 @@ std::pair<SIMDVector, bool> Registers::readRegister(Register reg)
     if(reg.num == REG_VPM_IO.num)
     {
         if(readCache.find(REG_VPM_IO) == readCache.end())
+        {
+            if(!qpu.vpm.waitRead())
+            {
+                qpu.stallCause = StallCause::VPM_READ;
+                return std::make_pair(SIMDVector{}, false);
+            }
             setReadCache(REG_VPM_IO, qpu.vpm.readValue());
+        }
         // cannot optimize to use iterator here, since we modify the element in cache!
         return std::make_pair(readCache.at(REG_VPM_IO), true);
     }
     if(reg == REG_VPM_DMA_LOAD_WAIT)
-        return std::make_pair(SIMDVector{}, qpu.vpm.waitDMARead());
+    {
+        qpu.stallCause = StallCause::DMA_LOAD;
+        return std::make_pair(SIMDVector{}, qpu.vpm.waitDMARead(qpu.ID));
+    }
     if(reg == REG_VPM_DMA_STORE_WAIT)
-        return std::make_pair(SIMDVector{}, qpu.vpm.waitDMAWrite());
+    {
+        qpu.stallCause = StallCause::DMA_STORE;
+        return std::make_pair(SIMDVector{}, qpu.vpm.waitDMAWrite(qpu.ID));
+    }
     if(reg.num == REG_MUTEX.num)
     {
         if(readCache.find(REG_MUTEX) == readCache.end())
             setReadCache(REG_MUTEX, qpu.mutex.lock(qpu.ID) ? SIMDVector(Literal(true)) : SIMDVector(Literal(false)));
+        qpu.stallCause = StallCause::MUTEX;
         // cannot optimize to use iterator here, since we modify the element in cache!
         return std::make_pair(readCache.at(REG_MUTEX), readCache.at(REG_MUTEX)[0].isTrue());
     }
@@ -375,6 +425,14 @@ void Registers::clearReadCache()
     readCache.clear();
 }
 
+bool Registers::hasSideEffectReads() const
+{
+    // all reads with side-effects are cached for the current instruction, failed mutex locks have no effect
+    return std::any_of(readCache.begin(), readCache.end(), [](const std::pair<const Register, SIMDVector>& entry) {
+        return entry.first.num != REG_MUTEX.num || entry.second[0].isTrue();
+    });
+}
+
 SIMDVector Registers::readStorageRegister(Register reg)
 {
     auto it = storageRegisters.find(reg);
@@ -482,6 +540,135 @@ void UniformCache::setUniformAddress(const SIMDVector& val)
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 50, "write UNIFORM address", 1);
 }
 
+Cache::Cache(uint32_t size, uint32_t lineSize, uint32_t associativity) :
+    lineSize(lineSize), associativity(associativity)
+{
+    if(lineSize == 0 || associativity == 0)
+        throw CompilationError(CompilationStep::GENERAL, "Invalid cache configuration with zero line size or ways");
+    sets.resize(std::max(1u, size / (lineSize * associativity)));
+}
+
+bool Cache::access(MemoryAddress address)
+{
+    auto line = address / lineSize;
+    auto& set = sets[line % sets.size()];
+    auto it = std::find(set.begin(), set.end(), line);
+    if(it != set.end())
+    {
+        // mark as most recently used
+        std::rotate(set.begin(), it, it + 1);
+        return true;
+    }
+    if(set.size() >= associativity)
+        // evict the least recently used line
+        set.pop_back();
+    set.insert(set.begin(), line);
+    return false;
+}
+
+CacheModel::CacheModel(const TimingModel& timing) :
+    timing(timing), l2Cache(timing.l2CacheSize, timing.cacheLineSize, timing.l2CacheAssociativity)
+{
+    // 2 TMUs per slice of 4 QPUs
+    tmuCaches.reserve((NUM_QPUS / 4) * 2);
+    for(uint32_t i = 0; i < (NUM_QPUS / 4) * 2; ++i)
+        tmuCaches.emplace_back(timing.tmuCacheSize, timing.cacheLineSize, timing.tmuCacheAssociativity);
+}
+
+void CacheModel::addBuffer(MemoryAddress start, MemoryAddress end)
+{
+    if(end > start)
+        bufferStatistics.emplace(start, std::make_pair(end, CacheStatistics{}));
+}
+
+CacheStatistics CacheModel::getBufferStatistics(MemoryAddress start) const
+{
+    auto it = bufferStatistics.find(start);
+    return it != bufferStatistics.end() ? it->second.second : CacheStatistics{};
+}
+
+std::vector<std::pair<MemoryAddress, MemoryAddress>> CacheModel::getBuffers() const
+{
+    std::vector<std::pair<MemoryAddress, MemoryAddress>> buffers;
+    buffers.reserve(bufferStatistics.size());
+    for(const auto& entry : bufferStatistics)
+        buffers.emplace_back(entry.first, entry.second.first);
+    return buffers;
+}
+
+void CacheModel::mergeStatistics(const CacheModel& other)
+{
+    for(const auto& entry : other.bufferStatistics)
+    {
+        auto it = bufferStatistics.find(entry.first);
+        if(it != bufferStatistics.end())
+            it->second.second += entry.second.second;
+    }
+}
+
+uint32_t CacheModel::loadTMU(
+    uint8_t qpu, uint8_t tmu, const SIMDVector& addresses, CacheStatistics& instructionStatistics)
+{
+    auto& tmuCache = tmuCaches.at((qpu / 4u) * 2u + tmu);
+
+    // every cache line is only accessed once per load, even if it is read by multiple elements
+    std::vector<MemoryAddress> lines;
+    lines.reserve(NATIVE_VECTOR_SIZE);
+    for(const auto& address : addresses)
+    {
+        auto line = (address.unsignedInt() / timing.cacheLineSize) * timing.cacheLineSize;
+        if(std::find(lines.begin(), lines.end(), line) == lines.end())
+            lines.emplace_back(line);
+    }
+
+    // the load takes as long as its slowest cache line
+    uint32_t penalty = 0;
+    std::vector<std::pair<CacheStatistics*, uint32_t>> bufferPenalties;
+    for(auto line : lines)
+    {
+        CacheStatistics* bufferStats = nullptr;
+        auto bufferIt = bufferStatistics.upper_bound(line);
+        if(bufferIt != bufferStatistics.begin() && line < std::prev(bufferIt)->second.first)
+            bufferStats = &std::prev(bufferIt)->second.second;
+
+        CacheStatistics lineStats{};
+        uint32_t linePenalty = 0;
+        if(tmuCache.access(line))
+            ++lineStats.numTMUCacheHits;
+        else
+        {
+            ++lineStats.numTMUCacheMisses;
+            linePenalty += timing.tmuCacheMissPenalty;
+            if(!l2Cache.access(line))
+            {
+                ++lineStats.numL2CacheMisses;
+                linePenalty += timing.l2CacheMissPenalty;
+            }
+        }
+        instructionStatistics += lineStats;
+        penalty = std::max(penalty, linePenalty);
+
+        if(bufferStats)
+        {
+            *bufferStats += lineStats;
+            auto it = std::find_if(bufferPenalties.begin(), bufferPenalties.end(),
+                [&](const std::pair<CacheStatistics*, uint32_t>& entry) -> bool { return entry.first == bufferStats; });
+            if(it == bufferPenalties.end())
+                bufferPenalties.emplace_back(bufferStats, linePenalty);
+            else
+                it->second = std::max(it->second, linePenalty);
+        }
+    }
+
+    instructionStatistics.numMissPenaltyCycles += penalty;
+    for(auto& entry : bufferPenalties)
+        entry.first->numMissPenaltyCycles += entry.second;
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "TMU load of " << lines.size() << " cache lines takes " << penalty
+            << " additional cycles due to cache misses" << logging::endl);
+    return penalty;
+}
+
 std::pair<SIMDVector, bool> TMUs::readTMU()
 {
     if(tmu0ResponseQueue.empty() && tmu1ResponseQueue.empty())
@@ -549,7 +736,9 @@ void TMUs::setTMURegisterS(uint8_t tmu, const SIMDVector& val)
 
     if(requestQueue.size() >= 8)
         throw CompilationError(CompilationStep::GENERAL, "TMU request queue is full!");
-    requestQueue.push(std::make_pair(readMemoryAddress(val), qpu.getCurrentCycle()));
+    auto data = readMemoryAddress(val);
+    auto penalty = caches.loadTMU(qpu.ID, tmu, val, qpu.instrumentation[qpu.pc].cacheStatistics);
+    requestQueue.push(std::make_pair(std::move(data), qpu.getCurrentCycle() + qpu.timing.tmuLatency + penalty));
 }
 
 void TMUs::setTMURegisterT(uint8_t tmu, const SIMDVector& val)
@@ -583,25 +772,29 @@ bool TMUs::triggerTMURead(uint8_t tmu)
         throw CompilationError(CompilationStep::GENERAL, "TMU response queue is full!");
 
     auto val = requestQueue.front();
+    bool dataAvailable = val.second <= qpu.getCurrentCycle();
     if(tmu == 0)
-        PROFILE_COUNTER(
-            vc4c::profiler::COUNTER_EMULATOR + 65, "TMU0 read trigger", val.second + 9 <= qpu.getCurrentCycle());
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 65, "TMU0 read trigger", dataAvailable);
     else
-        PROFILE_COUNTER(
-            vc4c::profiler::COUNTER_EMULATOR + 66, "TMU1 read trigger", val.second + 9 <= qpu.getCurrentCycle());
-    if(val.second + 9 > qpu.getCurrentCycle())
-        // block for at least 9 cycles
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 66, "TMU1 read trigger", dataAvailable);
+    if(!dataAvailable)
+        // block until the data is loaded, depending on the cache hits/misses
         return false;
-    else if(val.second + 20 > qpu.getCurrentCycle())
-        // blocks up to 20 cycles when reading from RAM
-        CPPLOG_LAZY(logging::Level::DEBUG,
-            log << "Distance between triggering of TMU read and read is " << (qpu.getCurrentCycle() - val.second)
-                << ", additional stalls may be introduced" << logging::endl);
     requestQueue.pop();
     responseQueue.push(std::make_pair(val.first, qpu.getCurrentCycle()));
     return true;
 }
 
+uint32_t TMUs::getNextLoadCycle() const
+{
+    uint32_t cycle = std::numeric_limits<uint32_t>::max();
+    if(!tmu0RequestQueue.empty())
+        cycle = std::min(cycle, tmu0RequestQueue.front().second);
+    if(!tmu1RequestQueue.empty())
+        cycle = std::min(cycle, tmu1RequestQueue.front().second);
+    return cycle == std::numeric_limits<uint32_t>::max() ? qpu.getCurrentCycle() : cycle;
+}
+
 void TMUs::checkTMUWriteCycle() const
 {
     // Broadcom specification, page 37
@@ -690,9 +883,9 @@ void SFU::startLog2(const SIMDVector& val)
     lastSFUWrite = currentCycle;
 }
 
-void SFU::incrementCycle()
+void SFU::incrementCycle(uint32_t numCycles)
 {
-    ++currentCycle;
+    currentCycle += numCycles;
 }
 
 template <typename T>
@@ -872,9 +1065,12 @@ void VPM::setReadSetup(const SIMDVector& val)
     if(setup.isDMASetup())
         dmaReadSetup = setup.value;
     else if(setup.isGenericSetup())
+    {
         // TODO warn/error if there is still VPM read pending from previous setup. TODO or create VPM read queue like
         // for TMU?
         vpmReadSetup = setup.value;
+        lastReadSetup = currentCycle;
+    }
     else if(setup.isStrideSetup())
         readStrideSetup = setup.value;
     else
@@ -883,7 +1079,7 @@ void VPM::setReadSetup(const SIMDVector& val)
     CPPLOG_LAZY(logging::Level::DEBUG, log << "Set VPM read setup: " << setup.to_string() << logging::endl);
 }
 
-void VPM::setDMAWriteAddress(const SIMDVector& val)
+void VPM::setDMAWriteAddress(const SIMDVector& val, uint8_t qpu)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -927,8 +1123,8 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
         if(address + typeSize * sizes.second >= memory.getMaximumAddress())
             throw CompilationError(CompilationStep::GENERAL,
                 "Memory address is out of bounds, consider using larger buffer", std::to_string(address));
-        memcpy(reinterpret_cast<uint8_t*>(memory.getWordAddress(address)) + address % sizeof(Word),
-            reinterpret_cast<uint8_t*>(&cache.at(vpmBaseAddress.first).at(vpmBaseAddress.second)) + byteOffset,
+        memory.writeBytes(address,
+            reinterpret_cast<const uint8_t*>(&cache.at(vpmBaseAddress.first).at(vpmBaseAddress.second)) + byteOffset,
             typeSize * sizes.second);
         logging::debug() << "\tVPM row: "
                          << to_string<unsigned, std::array<unsigned, 16>>(cache.at(vpmBaseAddress.first))
@@ -938,11 +1134,12 @@ void VPM::setDMAWriteAddress(const SIMDVector& val)
         address += stride + (typeSize * sizes.second);
     }
 
-    lastDMAWriteTrigger = currentCycle;
+    dmaWriteFinished.at(qpu) =
+        scheduleDMATransfer(timing.dmaStoreLatency, sizes.first, typeSize * sizes.second, qpu, false);
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 100, "write DMA write address", 1);
 }
 
-void VPM::setDMAReadAddress(const SIMDVector& val)
+void VPM::setDMAReadAddress(const SIMDVector& val, uint8_t qpu)
 {
     auto element0 = val[0];
     if(element0.isUndefined())
@@ -1000,27 +1197,68 @@ void VPM::setDMAReadAddress(const SIMDVector& val)
         address += pitch;
     }
 
-    lastDMAReadTrigger = currentCycle;
+    dmaReadFinished.at(qpu) =
+        scheduleDMATransfer(timing.dmaLoadLatency, sizes.first, typeSize * sizes.second, qpu, true);
     PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 110, "write DMA read address", 1);
 }
 
-bool VPM::waitDMAWrite() const
+bool VPM::waitDMAWrite(uint8_t qpu) const
 {
-    // XXX how many cycles?
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 120, "wait DMA write", lastDMAWriteTrigger + 12 < currentCycle);
-    return lastDMAWriteTrigger + 12 < currentCycle;
+    PROFILE_COUNTER(
+        vc4c::profiler::COUNTER_EMULATOR + 120, "wait DMA write", dmaWriteFinished.at(qpu) <= currentCycle);
+    return dmaWriteFinished.at(qpu) <= currentCycle;
 }
 
-bool VPM::waitDMARead() const
+bool VPM::waitDMARead(uint8_t qpu) const
 {
-    // XXX how many cycles?
-    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 130, "wait DMA read", lastDMAReadTrigger + 12 < currentCycle);
-    return lastDMAReadTrigger + 12 < currentCycle;
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 130, "wait DMA read", dmaReadFinished.at(qpu) <= currentCycle);
+    return dmaReadFinished.at(qpu) <= currentCycle;
 }
 
-void VPM::incrementCycle()
+bool VPM::waitRead() const
 {
-    ++currentCycle;
+    return lastReadSetup + timing.vpmReadLatency <= currentCycle;
+}
+
+uint32_t VPM::getDMAWriteEndCycle(uint8_t qpu) const
+{
+    return dmaWriteFinished.at(qpu);
+}
+
+uint32_t VPM::getDMAReadEndCycle(uint8_t qpu) const
+{
+    return dmaReadFinished.at(qpu);
+}
+
+uint32_t VPM::getReadEndCycle() const
+{
+    return lastReadSetup + timing.vpmReadLatency;
+}
+
+/*
+ * Returns the cycle the DMA transfer of the given number of rows triggered in this cycle finishes.
+ *
+ * The transfer takes the fixed latency plus the time required for each row, which is limited by the DMA bandwidth. If
+ * the transfers are serialized, the transfer only starts after all previously triggered transfers are finished.
+ */
+uint32_t VPM::scheduleDMATransfer(uint32_t latency, uint32_t numRows, uint32_t rowBytes, uint8_t qpu, bool isLoad)
+{
+    uint32_t rowCycles =
+        timing.dmaBytesPerCycle == 0 ? 0 : (rowBytes + timing.dmaBytesPerCycle - 1) / timing.dmaBytesPerCycle;
+    uint32_t duration = latency + numRows * std::max(timing.dmaCyclesPerRow, rowCycles);
+    uint32_t start = timing.serializeDMATransfers ? std::max(currentCycle, dmaBusyUntil) : currentCycle;
+    dmaBusyUntil = std::max(dmaBusyUntil, start + duration);
+    if(trace)
+        trace->recordDMATransfer(qpu, isLoad, start, start + duration, numRows, rowBytes);
+    CPPLOG_LAZY(logging::Level::DEBUG,
+        log << "DMA transfer of " << numRows << " rows scheduled for cycles " << start << " to " << (start + duration)
+            << logging::endl);
+    return start + duration;
+}
+
+void VPM::incrementCycle(uint32_t numCycles)
+{
+    currentCycle += numCycles;
 }
 
 LCOV_EXCL_START
@@ -1084,11 +1322,73 @@ void Semaphores::checkAllZero() const
     }
 }
 
+void QPU::countStall(StallCause cause, uint32_t numCycles)
+{
+    stallCause = cause;
+    auto& result = instrumentation[pc];
+    result.numStalls += numCycles;
+    switch(cause)
+    {
+    case StallCause::TMU:
+        result.numTMUStalls += numCycles;
+        break;
+    case StallCause::DMA_LOAD:
+        result.numDMALoadStalls += numCycles;
+        break;
+    case StallCause::DMA_STORE:
+        result.numDMAStoreStalls += numCycles;
+        break;
+    case StallCause::VPM_READ:
+        result.numVPMStalls += numCycles;
+        break;
+    case StallCause::MUTEX:
+        result.numMutexStalls += numCycles;
+        break;
+    case StallCause::SEMAPHORE:
+        result.numSemaphoreStalls += numCycles;
+        break;
+    }
+}
+
+uint32_t QPU::getStallEndCycle() const
+{
+    if(!repeatableStall)
+        return currentCycle;
+    switch(stallCause)
+    {
+    case StallCause::TMU:
+        return tmus.getNextLoadCycle();
+    case StallCause::DMA_LOAD:
+        return vpm.getDMAReadEndCycle(ID);
+    case StallCause::DMA_STORE:
+        return vpm.getDMAWriteEndCycle(ID);
+    case StallCause::VPM_READ:
+        return vpm.getReadEndCycle();
+    case StallCause::MUTEX:
+    case StallCause::SEMAPHORE:
+        // can only be released by another QPU
+        return std::numeric_limits<uint32_t>::max();
+    }
+    return currentCycle;
+}
+
+void QPU::skipStalledCycles(uint32_t numCycles)
+{
+    instrumentation[pc].numExecutions += numCycles;
+    countStall(stallCause, numCycles);
+    currentCycle += numCycles;
+}
+
 uint32_t QPU::getCurrentCycle() const
 {
     return currentCycle;
 }
 
+ProgramCounter QPU::getProgramCounter() const
+{
+    return pc;
+}
+
 std::pair<SIMDVector, bool> QPU::readR4()
 {
     if(tmus.hasValueOnR4())
@@ -1116,114 +1416,246 @@ static VectorFlags generateImmediateFlags(SIMDVector vector)
     return flags;
 }
 
-bool QPU::execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction)
+static void decodeALUInput(
+    DecodedInstruction& decoded, const qpu_asm::ALUInstruction* aluInst, uint8_t index, InputMultiplex mux)
 {
-    const qpu_asm::Instruction* inst = &(*(firstInstruction + pc));
-    ++instrumentation[inst].numExecutions;
-    CPPLOG_LAZY(logging::Level::INFO,
-        log << "QPU " << static_cast<unsigned>(ID) << " (0x" << std::hex << pc << std::dec
-            << "): " << inst->toASMString() << logging::endl);
-    ProgramCounter nextPC = pc;
-    if(inst->getSig() == SIGNAL_END_PROGRAM)
-        // end program
-        return false;
-    if(inst->getSig() == SIGNAL_NONE || executeSignal(inst->getSig()))
+    decoded.readInputs.set(index);
+    switch(mux)
     {
-        if(auto op = inst->as<qpu_asm::ALUInstruction>())
-        {
-            if(executeALU(op))
-                ++nextPC;
-            // otherwise the execution stalled and the PC stays the same
-        }
-        else if(auto br = inst->as<qpu_asm::BranchInstruction>())
+    case InputMultiplex::ACC0:
+        decoded.inputs[index] = REG_ACC0;
+        break;
+    case InputMultiplex::ACC1:
+        decoded.inputs[index] = REG_ACC1;
+        break;
+    case InputMultiplex::ACC2:
+        decoded.inputs[index] = REG_ACC2;
+        break;
+    case InputMultiplex::ACC3:
+        decoded.inputs[index] = REG_ACC3;
+        break;
+    case InputMultiplex::ACC4:
+        decoded.inputs[index] = REG_SFU_OUT;
+        break;
+    case InputMultiplex::ACC5:
+        decoded.inputs[index] = REG_ACC5;
+        break;
+    case InputMultiplex::REGA:
+        decoded.inputs[index] = Register{RegisterFile::PHYSICAL_A, aluInst->getInputA()};
+        break;
+    case InputMultiplex::REGB:
+        if(aluInst->getSig() == SIGNAL_ALU_IMMEDIATE)
         {
-            if(isConditionMet(br->getBranchCondition()))
-            {
-                ++instrumentation[inst].numBranchTaken;
-                int32_t offset = 4 /* Branch starts at PC + 4 */ +
-                    (br->getImmediate() / static_cast<int32_t>(sizeof(uint64_t))) /* immediate offset is in bytes */;
-                if(br->getAddRegister() == BranchReg::BRANCH_REG ||
-                    br->getBranchRelative() == BranchRel::BRANCH_ABSOLUTE)
-                    throw CompilationError(
-                        CompilationStep::GENERAL, "This kind of branch is not yet implemented", br->toASMString());
-                nextPC += static_cast<ProgramCounter>(offset);
-
-                // see Broadcom specification, page 34
-                registers.writeRegister(toRegister(br->getAddOut(), br->getWriteSwap() == WriteSwap::SWAP),
-                    SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF));
-                registers.writeRegister(toRegister(br->getMulOut(), br->getWriteSwap() == WriteSwap::DONT_SWAP),
-                    SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF));
-            }
+            decoded.immediateInputs.set(index);
+            if(auto lit = SmallImmediate{aluInst->getInputB()}.toLiteral())
+                decoded.immediate = SIMDVector(*lit);
             else
-                // simply skip to next PC
-                ++nextPC;
-            PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 160, "branches taken",
-                isConditionMet(br->getBranchCondition()) ? 1 : 0);
+                decoded.error = "Cannot read small immediate value";
         }
-        else if(auto load = inst->as<qpu_asm::LoadInstruction>())
+        else
+            decoded.inputs[index] = Register{RegisterFile::PHYSICAL_B, aluInst->getInputB()};
+        break;
+    default:
+        decoded.error = "Unhandled ALU input";
+    }
+
+    if(aluInst->getUnpack().hasEffect())
+    {
+        if(aluInst->getUnpack().isUnpackFromR4() ? mux == InputMultiplex::ACC4 : mux == InputMultiplex::REGA)
+            decoded.unpackedInputs.set(index);
+    }
+}
+
+static void decodeALU(DecodedInstruction& decoded, const qpu_asm::ALUInstruction* aluInst)
+{
+    decoded.addCondition = aluInst->getAddCondition();
+    decoded.mulCondition = aluInst->getMulCondition();
+    decoded.setFlags = aluInst->getSetFlag() == SetFlag::SET_FLAGS;
+    decoded.mulSetsFlags = isFlagSetByMulALU(aluInst->getAddition(), aluInst->getMultiplication());
+    decoded.addOut = toRegister(aluInst->getAddOut(), aluInst->getWriteSwap() == WriteSwap::SWAP);
+    decoded.mulOut = toRegister(aluInst->getMulOut(), aluInst->getWriteSwap() == WriteSwap::DONT_SWAP);
+    decoded.unpack = aluInst->getUnpack();
+    decoded.pack = aluInst->getPack();
+    decoded.packMulResult = aluInst->getWriteSwap() == WriteSwap::SWAP;
+
+    if(aluInst->getAddCondition() != COND_NEVER && aluInst->getAddition() != OP_NOP.opAdd)
+    {
+        decoded.addCode = &OpCode::toOpCode(aluInst->getAddition(), false);
+        decoded.addOperation = getVectorizedOperation(*decoded.addCode);
+        decodeALUInput(decoded, aluInst, 0, aluInst->getAddMultiplexA());
+        if(decoded.addCode->numOperands > 1)
+            decodeALUInput(decoded, aluInst, 1, aluInst->getAddMultiplexB());
+        if(!decoded.packMulResult && decoded.pack.hasEffect() && decoded.pack.supportsMulALU())
+            decoded.error = "Cannot apply mul pack mode on add result!";
+    }
+
+    if(aluInst->getMulCondition() != COND_NEVER && aluInst->getMultiplication() != OP_NOP.opMul)
+    {
+        decoded.mulCode = &OpCode::toOpCode(aluInst->getMultiplication(), true);
+        decoded.mulOperation = getVectorizedOperation(*decoded.mulCode);
+        decodeALUInput(decoded, aluInst, 2, aluInst->getMulMultiplexA());
+        if(decoded.mulCode->numOperands > 1)
+            decodeALUInput(decoded, aluInst, 3, aluInst->getMulMultiplexB());
+        if(decoded.packMulResult && decoded.pack.hasEffect() && !decoded.pack.supportsMulALU())
+            decoded.error = "Cannot apply add pack mode on mul result!";
+
+        SmallImmediate offset(aluInst->getInputB());
+        if(aluInst->isVectorRotation() && offset.isVectorRotation())
         {
-            auto type = load->getType();
-            SIMDVector loadedValues;
-            switch(type)
-            {
-            case OpLoad::LOAD_IMM_32:
-                loadedValues = SIMDVector(Literal(load->getImmediateInt()));
-                break;
-            case OpLoad::LOAD_SIGNED:
-                loadedValues = intermediate::LoadImmediate::toLoadedValues(
-                    load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_SIGNED);
-                break;
-            case OpLoad::LOAD_UNSIGNED:
-                loadedValues = intermediate::LoadImmediate::toLoadedValues(
-                    load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_UNSIGNED);
-                break;
-            }
+            if(aluInst->getMulMultiplexA() == InputMultiplex::REGB ||
+                aluInst->getMulMultiplexB() == InputMultiplex::REGB)
+                // XXX can't we actually?! See http://maazl.de/project/vc4asm/doc/VideoCoreIV-addendum.html
+                decoded.error = "Cannot read vector rotation offset";
+            decoded.isRotated = true;
+            decoded.isFullRangeRotation = aluInst->isFullRangeRotation();
+            decoded.rotateByR5 = offset == VECTOR_ROTATE_R5;
+            if(!decoded.rotateByR5)
+                decoded.rotationOffset = offset.getRotationOffset().value();
+        }
+    }
+}
 
-            auto flags = generateImmediateFlags(loadedValues);
-            if(load->getPack().hasEffect())
-                PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            SIMDVector imm = load->getPack()(loadedValues, flags, false);
-            writeConditional(
-                toRegister(load->getAddOut(), load->getWriteSwap() == WriteSwap::SWAP), imm, load->getAddCondition());
-            writeConditional(toRegister(load->getMulOut(), load->getWriteSwap() == WriteSwap::DONT_SWAP), imm,
-                load->getMulCondition());
-            if(load->getSetFlag() == SetFlag::SET_FLAGS)
-                setFlags(imm, load->getAddCondition() != COND_NEVER ? load->getAddCondition() : load->getMulCondition(),
-                    flags);
-            ++nextPC;
+static void decodeBranch(DecodedInstruction& decoded, const qpu_asm::BranchInstruction* br, ProgramCounter pc)
+{
+    if(br->getAddRegister() == BranchReg::BRANCH_REG || br->getBranchRelative() == BranchRel::BRANCH_ABSOLUTE)
+        decoded.error = "This kind of branch is not yet implemented";
+    decoded.branchCondition = br->getBranchCondition();
+    int32_t offset = 4 /* Branch starts at PC + 4 */ +
+        (br->getImmediate() / static_cast<int32_t>(sizeof(uint64_t))) /* immediate offset is in bytes */;
+    decoded.branchTarget = pc + static_cast<ProgramCounter>(offset);
+    decoded.addOut = toRegister(br->getAddOut(), br->getWriteSwap() == WriteSwap::SWAP);
+    decoded.mulOut = toRegister(br->getMulOut(), br->getWriteSwap() == WriteSwap::DONT_SWAP);
+}
+
+static void decodeLoad(DecodedInstruction& decoded, const qpu_asm::LoadInstruction* load)
+{
+    SIMDVector loadedValues;
+    switch(load->getType())
+    {
+    case OpLoad::LOAD_IMM_32:
+        loadedValues = SIMDVector(Literal(load->getImmediateInt()));
+        break;
+    case OpLoad::LOAD_SIGNED:
+        loadedValues = intermediate::LoadImmediate::toLoadedValues(
+            load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_SIGNED);
+        break;
+    case OpLoad::LOAD_UNSIGNED:
+        loadedValues = intermediate::LoadImmediate::toLoadedValues(
+            load->getImmediateInt(), intermediate::LoadType::PER_ELEMENT_UNSIGNED);
+        break;
+    }
+
+    // the loaded value is constant, so we can already apply the pack mode here
+    decoded.immediateFlags = generateImmediateFlags(loadedValues);
+    decoded.pack = load->getPack();
+    decoded.immediate = load->getPack()(loadedValues, decoded.immediateFlags, false);
+    decoded.addCondition = load->getAddCondition();
+    decoded.mulCondition = load->getMulCondition();
+    decoded.setFlags = load->getSetFlag() == SetFlag::SET_FLAGS;
+    decoded.addOut = toRegister(load->getAddOut(), load->getWriteSwap() == WriteSwap::SWAP);
+    decoded.mulOut = toRegister(load->getMulOut(), load->getWriteSwap() == WriteSwap::DONT_SWAP);
+}
+
+static void decodeSemaphore(DecodedInstruction& decoded, const qpu_asm::SemaphoreInstruction* semaphore)
+{
+    decoded.semaphore = static_cast<uint8_t>(semaphore->getSemaphore());
+    decoded.acquireSemaphore = semaphore->getAcquire();
+    decoded.pack = semaphore->getPack();
+    decoded.addCondition = semaphore->getAddCondition();
+    decoded.mulCondition = semaphore->getMulCondition();
+    decoded.setFlags = semaphore->getSetFlag() == SetFlag::SET_FLAGS;
+    decoded.addOut = toRegister(semaphore->getAddOut(), semaphore->getWriteSwap() == WriteSwap::SWAP);
+    decoded.mulOut = toRegister(semaphore->getMulOut(), semaphore->getWriteSwap() == WriteSwap::DONT_SWAP);
+}
+
+DecodedProgram tools::decodeProgram(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+    std::vector<qpu_asm::Instruction>::const_iterator lastInstruction)
+{
+    PROFILE_START(DecodeProgram);
+    DecodedProgram program;
+    program.reserve(static_cast<std::size_t>(std::distance(firstInstruction, lastInstruction)));
+    for(auto it = firstInstruction; it != lastInstruction; ++it)
+    {
+        const auto pc = static_cast<ProgramCounter>(program.size());
+        program.emplace_back();
+        DecodedInstruction& decoded = program.back();
+        decoded.instruction = &(*it);
+
+        auto signal = it->getSig();
+        if(signal == SIGNAL_END_PROGRAM)
+            // the end of the program is marked by having no handler
+            continue;
+        if(signal != SIGNAL_ALU_IMMEDIATE && signal != SIGNAL_BRANCH && signal != SIGNAL_LOAD_IMMEDIATE)
+            // all other signals are executed before the actual instruction
+            decoded.signal = signal;
+
+        if(auto aluInst = it->as<qpu_asm::ALUInstruction>())
+        {
+            decodeALU(decoded, aluInst);
+            decoded.handler = &QPU::executeALU;
         }
-        else if(auto semaphore = inst->as<qpu_asm::SemaphoreInstruction>())
+        else if(auto br = it->as<qpu_asm::BranchInstruction>())
         {
-            bool dontStall = true;
-            SIMDVector result{};
-            if(semaphore->getAcquire())
-                // NOTE: "acquire" is decrement, see SemaphoreInstruction#getAcquire() function documentation
-                std::tie(result, dontStall) = semaphores.decrement(static_cast<uint8_t>(semaphore->getSemaphore()));
-            else
-                std::tie(result, dontStall) = semaphores.increment(static_cast<uint8_t>(semaphore->getSemaphore()));
-
-            if(dontStall)
-            {
-                if(semaphore->getPack().hasEffect())
-                    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-                result = semaphore->getPack()(result, {}, false);
-                writeConditional(toRegister(semaphore->getAddOut(), semaphore->getWriteSwap() == WriteSwap::SWAP),
-                    result, semaphore->getAddCondition());
-                writeConditional(toRegister(semaphore->getMulOut(), semaphore->getWriteSwap() == WriteSwap::DONT_SWAP),
-                    result, semaphore->getMulCondition());
-                if(semaphore->getSetFlag() == SetFlag::SET_FLAGS)
-                    setFlags(result,
-                        semaphore->getAddCondition() != COND_NEVER ? semaphore->getAddCondition() :
-                                                                     semaphore->getMulCondition(),
-                        {});
-                ++nextPC;
-            }
-            else
-                ++instrumentation[inst].numStalls;
+            decodeBranch(decoded, br, pc);
+            decoded.handler = &QPU::executeBranch;
+        }
+        else if(auto load = it->as<qpu_asm::LoadInstruction>())
+        {
+            decodeLoad(decoded, load);
+            decoded.handler = &QPU::executeLoad;
+        }
+        else if(auto semaphore = it->as<qpu_asm::SemaphoreInstruction>())
+        {
+            decodeSemaphore(decoded, semaphore);
+            decoded.handler = &QPU::executeSemaphore;
         }
         else
-            throw CompilationError(CompilationStep::GENERAL, "Invalid assembler instruction", inst->toASMString());
+            decoded.error = "Invalid assembler instruction";
+
+        if(!decoded.error.empty())
+            // unsupported instructions only throw an error when they are actually executed
+            decoded.handler = &QPU::executeUnsupported;
+    }
+    PROFILE_END(DecodeProgram);
+    return program;
+}
+
+bool QPU::execute(const DecodedProgram& program)
+{
+    if(pc >= program.size())
+        throw CompilationError(
+            CompilationStep::GENERAL, "Program counter is out of bounds of the emulated program", std::to_string(pc));
+    const DecodedInstruction& inst = program[pc];
+    ++instrumentation[pc].numExecutions;
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "QPU " << static_cast<unsigned>(ID) << " (0x" << std::hex << pc << std::dec
+            << "): " << inst.instruction->toASMString() << logging::endl);
+    ProgramCounter nextPC = pc;
+    if(inst.handler == nullptr)
+    {
+        // end program
+        repeatableStall = false;
+        if(trace)
+            trace->recordQPUFinished(ID);
+        return false;
+    }
+    bool stalled = false;
+    if(inst.signal == SIGNAL_NONE || executeSignal(inst.signal))
+    {
+        // if the instruction stalls, the PC stays the same
+        stalled = !(this->*inst.handler)(inst, nextPC);
+    }
+    else
+    {
+        // only the TMU load signals stall
+        countStall(StallCause::TMU);
+        stalled = true;
     }
+    if(trace && stalled)
+        trace->recordQPUStall(ID, stallCause);
+    else if(trace)
+        trace->recordQPURunning(ID);
+    repeatableStall = stalled && !registers.hasSideEffectReads();
 
     // clear cache for registers already read this instruction
     registers.clearReadCache();
@@ -1233,255 +1665,283 @@ bool QPU::execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruc
     return true;
 }
 
-const qpu_asm::Instruction* QPU::getCurrentInstruction(
-    std::vector<qpu_asm::Instruction>::const_iterator firstInstruction) const
+const qpu_asm::Instruction* QPU::getCurrentInstruction(const DecodedProgram& program) const
 {
-    return &(*(firstInstruction + pc));
+    return pc < program.size() ? program[pc].instruction : nullptr;
 }
 
-static std::pair<SIMDVector, bool> toInputValue(
-    Registers& registers, InputMultiplex mux, Address addressA, Address addressB, bool regBIsImmediate)
+std::pair<SIMDVector, bool> QPU::readInput(const DecodedInstruction& inst, uint8_t index)
 {
-    switch(mux)
-    {
-    case InputMultiplex::ACC0:
-        return registers.readRegister(REG_ACC0);
-    case InputMultiplex::ACC1:
-        return registers.readRegister(REG_ACC1);
-    case InputMultiplex::ACC2:
-        return registers.readRegister(REG_ACC2);
-    case InputMultiplex::ACC3:
-        return registers.readRegister(REG_ACC3);
-    case InputMultiplex::ACC4:
-        return registers.readRegister(REG_SFU_OUT);
-    case InputMultiplex::ACC5:
-        return registers.readRegister(REG_ACC5);
-    case InputMultiplex::REGA:
-        return registers.readRegister(Register{RegisterFile::PHYSICAL_A, addressA});
-    case InputMultiplex::REGB:
-        if(regBIsImmediate)
-            return std::make_pair(SIMDVector(*SmallImmediate{addressB}.toLiteral()), true);
-        else
-            return registers.readRegister(Register{RegisterFile::PHYSICAL_B, addressB});
-    }
-    throw CompilationError(CompilationStep::GENERAL, "Unhandled ALU input");
+    if(inst.immediateInputs.test(index))
+        return std::make_pair(inst.immediate, true);
+    return registers.readRegister(inst.inputs[index]);
 }
 
 static std::pair<SIMDVector, bool> applyVectorRotation(
-    std::pair<SIMDVector, bool>&& input, const qpu_asm::ALUInstruction* ins, Registers& registers)
+    std::pair<SIMDVector, bool>&& input, const DecodedInstruction& inst, Registers& registers)
 {
     if(!input.second)
         // if we stall, do not rotate
         return std::move(input);
-    if(!ins->isVectorRotation())
+    if(!inst.isRotated)
         // no rotation set
         return std::move(input);
-    SmallImmediate offset(ins->getInputB());
-    if(!offset.isVectorRotation())
-        return std::move(input);
-    if(ins->getMulMultiplexA() == InputMultiplex::REGB || ins->getMulMultiplexB() == InputMultiplex::REGB)
-        // XXX can't we actually?! See http://maazl.de/project/vc4asm/doc/VideoCoreIV-addendum.html
-        throw CompilationError(CompilationStep::GENERAL, "Cannot read vector rotation offset", input.first.to_string());
 
     if(input.first.isAllSame())
         return std::move(input);
 
     unsigned char distance;
-    if(offset == VECTOR_ROTATE_R5)
+    if(inst.rotateByR5)
         //"Mul output vector rotation is taken from accumulator r5, element 0, bits [3:0]"
         // - Broadcom Specification, page 30
         distance = static_cast<uint8_t>(registers.readRegister(REG_ACC5).first[0].unsignedInt());
     else
-        distance = offset.getRotationOffset().value();
+        distance = inst.rotationOffset;
 
     SIMDVector result(std::move(input.first));
-    if(ins->isFullRangeRotation())
+    if(inst.isFullRangeRotation)
         result = std::move(result).rotate(distance & 0xF);
     else
         result = std::move(result).rotatePerQuad(distance & 0x3);
 
-    PROFILE_COUNTER(
-        vc4c::profiler::COUNTER_EMULATOR + 170, "vector rotations (full/total)", ins->isFullRangeRotation());
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 170, "vector rotations (full/total)", inst.isFullRangeRotation);
     return std::make_pair(result, true);
 }
 
-bool QPU::executeALU(const qpu_asm::ALUInstruction* aluInst)
+bool QPU::executeALU(const DecodedInstruction& inst, ProgramCounter& nextPC)
 {
     SIMDVector addIn0{};
     SIMDVector addIn1{};
     SIMDVector mulIn0{};
     SIMDVector mulIn1{};
 
-    const OpCode& addCode = OpCode::toOpCode(aluInst->getAddition(), false);
-    const OpCode& mulCode = OpCode::toOpCode(aluInst->getMultiplication(), true);
-
     // need to read both input before writing any registers
-    if(aluInst->getAddCondition() != COND_NEVER && aluInst->getAddition() != OP_NOP.opAdd)
+    if(inst.addCode != nullptr)
     {
         bool addIn0NotStall = true;
         bool addIn1NotStall = true;
-        std::tie(addIn0, addIn0NotStall) = toInputValue(registers, aluInst->getAddMultiplexA(), aluInst->getInputA(),
-            aluInst->getInputB(), aluInst->getSig() == SIGNAL_ALU_IMMEDIATE);
-        if(addCode.numOperands > 1)
-            std::tie(addIn1, addIn1NotStall) = toInputValue(registers, aluInst->getAddMultiplexB(),
-                aluInst->getInputA(), aluInst->getInputB(), aluInst->getSig() == SIGNAL_ALU_IMMEDIATE);
+        std::tie(addIn0, addIn0NotStall) = readInput(inst, 0);
+        if(inst.readInputs.test(1))
+            std::tie(addIn1, addIn1NotStall) = readInput(inst, 1);
 
         if(!addIn0NotStall || !addIn1NotStall)
         {
             // we stall on input, so do not calculate anything
-            ++instrumentation[aluInst].numStalls;
+            countStall(stallCause);
             return false;
         }
     }
 
-    if(aluInst->getMulCondition() != COND_NEVER && aluInst->getMultiplication() != OP_NOP.opMul)
+    if(inst.mulCode != nullptr)
     {
         bool mulIn0NotStall = true;
         bool mulIn1NotStall = true;
 
         PROFILE_START(EmulateVectorRotation);
-        std::tie(mulIn0, mulIn0NotStall) =
-            applyVectorRotation(toInputValue(registers, aluInst->getMulMultiplexA(), aluInst->getInputA(),
-                                    aluInst->getInputB(), aluInst->getSig() == SIGNAL_ALU_IMMEDIATE),
-                aluInst, registers);
-        if(mulCode.numOperands > 1)
-            std::tie(mulIn1, mulIn1NotStall) =
-                applyVectorRotation(toInputValue(registers, aluInst->getMulMultiplexB(), aluInst->getInputA(),
-                                        aluInst->getInputB(), aluInst->getSig() == SIGNAL_ALU_IMMEDIATE),
-                    aluInst, registers);
+        std::tie(mulIn0, mulIn0NotStall) = applyVectorRotation(readInput(inst, 2), inst, registers);
+        if(inst.readInputs.test(3))
+            std::tie(mulIn1, mulIn1NotStall) = applyVectorRotation(readInput(inst, 3), inst, registers);
         PROFILE_END(EmulateVectorRotation);
 
         if(!mulIn0NotStall || !mulIn1NotStall)
         {
             // we stall on input, so do not calculate anything
-            ++instrumentation[aluInst].numStalls;
+            countStall(stallCause);
             return false;
         }
     }
 
-    if(aluInst->getAddCondition() != COND_NEVER && aluInst->getAddition() != OP_NOP.opAdd)
+    auto& instrumentationResult = instrumentation[pc];
+    if(inst.addCode != nullptr)
     {
-        if(aluInst->getUnpack().hasEffect())
+        const OpCode& addCode = *inst.addCode;
+        if(inst.unpackedInputs.test(0) || inst.unpackedInputs.test(1))
         {
             PROFILE_START(EmulateUnpack);
-            if(aluInst->getUnpack().isUnpackFromR4())
-            {
-                if(aluInst->getAddMultiplexA() == InputMultiplex::ACC4)
-                    addIn0 = aluInst->getUnpack()(addIn0, addCode.acceptsFloat);
-                if(aluInst->getAddMultiplexB() == InputMultiplex::ACC4)
-                    addIn1 = aluInst->getUnpack()(addIn1, addCode.acceptsFloat);
-            }
-            else
-            {
-                if(aluInst->getAddMultiplexA() == InputMultiplex::REGA)
-                    addIn0 = aluInst->getUnpack()(addIn0, addCode.acceptsFloat);
-                if(aluInst->getAddMultiplexB() == InputMultiplex::REGA)
-                    addIn1 = aluInst->getUnpack()(addIn1, addCode.acceptsFloat);
-            }
+            if(inst.unpackedInputs.test(0))
+                addIn0 = inst.unpack(addIn0, addCode.acceptsFloat);
+            if(inst.unpackedInputs.test(1))
+                addIn1 = inst.unpack(addIn1, addCode.acceptsFloat);
             PROFILE_END(EmulateUnpack);
         }
 
         PROFILE_START(EmulateOpcode);
-        auto tmp = addCode(addIn0, addIn1);
+        auto tmp = inst.addOperation ? inst.addOperation(addCode, addIn0, addIn1) : addCode(addIn0, addIn1);
         PROFILE_END(EmulateOpcode);
         if(!tmp.first)
             logging::error() << "Failed to emulate ALU operation: " << addCode.name << " with "
                              << addIn0.to_string(true) << " and " << addIn1.to_string(true) << logging::endl;
         // fall-through for errors above on purpose so the next instruction throws an exception
         auto result = std::move(tmp.first).value();
-        if(aluInst->getWriteSwap() == WriteSwap::DONT_SWAP && aluInst->getPack().hasEffect())
+        if(!inst.packMulResult && inst.pack.hasEffect())
         {
             PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            if(aluInst->getPack().supportsMulALU())
-                throw CompilationError(CompilationStep::GENERAL, "Cannot apply mul pack mode on add result!");
-            result = aluInst->getPack()(result, tmp.second, addCode.returnsFloat);
+            result = inst.pack(result, tmp.second, addCode.returnsFloat);
         }
 
-        writeConditional(toRegister(aluInst->getAddOut(), aluInst->getWriteSwap() == WriteSwap::SWAP), result,
-            aluInst->getAddCondition(), aluInst, nullptr);
-        if(aluInst->getSetFlag() == SetFlag::SET_FLAGS)
-            setFlags(result, aluInst->getAddCondition(), tmp.second);
+        writeConditional(inst.addOut, result, inst.addCondition, &instrumentationResult.numAddALUExecuted,
+            &instrumentationResult.numAddALUSkipped);
+        if(inst.setFlags)
+            setFlags(result, inst.addCondition, tmp.second);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 180, "add instructions", 1);
     }
-    if(aluInst->getMulCondition() != COND_NEVER && aluInst->getMultiplication() != OP_NOP.opMul)
+    if(inst.mulCode != nullptr)
     {
-        if(aluInst->getUnpack().hasEffect())
+        const OpCode& mulCode = *inst.mulCode;
+        if(inst.unpackedInputs.test(2) || inst.unpackedInputs.test(3))
         {
             PROFILE_START(EmulateUnpack);
-            if(aluInst->getUnpack().isUnpackFromR4())
-            {
-                if(aluInst->getMulMultiplexA() == InputMultiplex::ACC4)
-                    mulIn0 = aluInst->getUnpack()(mulIn0, mulCode.acceptsFloat);
-                if(aluInst->getMulMultiplexB() == InputMultiplex::ACC4)
-                    mulIn1 = aluInst->getUnpack()(mulIn1, mulCode.acceptsFloat);
-            }
-            else
-            {
-                if(aluInst->getMulMultiplexA() == InputMultiplex::REGA)
-                    mulIn0 = aluInst->getUnpack()(mulIn0, mulCode.acceptsFloat);
-                if(aluInst->getMulMultiplexB() == InputMultiplex::REGA)
-                    mulIn1 = aluInst->getUnpack()(mulIn1, mulCode.acceptsFloat);
-            }
+            if(inst.unpackedInputs.test(2))
+                mulIn0 = inst.unpack(mulIn0, mulCode.acceptsFloat);
+            if(inst.unpackedInputs.test(3))
+                mulIn1 = inst.unpack(mulIn1, mulCode.acceptsFloat);
             PROFILE_END(EmulateUnpack);
         }
 
         PROFILE_START(EmulateOpcode);
-        auto tmp = mulCode(mulIn0, mulIn1);
+        auto tmp = inst.mulOperation ? inst.mulOperation(mulCode, mulIn0, mulIn1) : mulCode(mulIn0, mulIn1);
         PROFILE_END(EmulateOpcode);
         if(!tmp.first)
             logging::error() << "Failed to emulate ALU operation: " << mulCode.name << " with "
                              << mulIn0.to_string(true) << " and " << mulIn1.to_string(true) << logging::endl;
         auto result = std::move(tmp.first).value();
-        if(aluInst->getWriteSwap() == WriteSwap::SWAP && aluInst->getPack().hasEffect())
+        if(inst.packMulResult && inst.pack.hasEffect())
         {
             PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
-            if(!aluInst->getPack().supportsMulALU())
-                throw CompilationError(CompilationStep::GENERAL, "Cannot apply add pack mode on mul result!");
-            result = aluInst->getPack()(result, tmp.second, mulCode.returnsFloat);
+            result = inst.pack(result, tmp.second, mulCode.returnsFloat);
         }
 
         // FIXME these might depend on flags of add ALU set in same instruction (which is wrong)
-        writeConditional(toRegister(aluInst->getMulOut(), aluInst->getWriteSwap() == WriteSwap::DONT_SWAP), result,
-            aluInst->getMulCondition(), nullptr, aluInst);
-        if(aluInst->getSetFlag() == SetFlag::SET_FLAGS &&
-            isFlagSetByMulALU(aluInst->getAddition(), aluInst->getMultiplication()))
-            setFlags(result, aluInst->getMulCondition(), tmp.second);
+        writeConditional(inst.mulOut, result, inst.mulCondition, &instrumentationResult.numMulALUExecuted,
+            &instrumentationResult.numMulALUSkipped);
+        if(inst.setFlags && inst.mulSetsFlags)
+            setFlags(result, inst.mulCondition, tmp.second);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 190, "mul instructions", 1);
     }
 
-    if(aluInst->getUnpack().hasEffect())
+    if(inst.unpack.hasEffect())
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 220, "values unpacked", 1);
 
+    ++nextPC;
+    return true;
+}
+
+bool QPU::executeBranch(const DecodedInstruction& inst, ProgramCounter& nextPC)
+{
+    bool conditionMet = isConditionMet(inst.branchCondition);
+    if(conditionMet)
+    {
+        ++instrumentation[pc].numBranchTaken;
+        nextPC = inst.branchTarget;
+
+        // see Broadcom specification, page 34
+        registers.writeRegister(inst.addOut, SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF));
+        registers.writeRegister(inst.mulOut, SIMDVector(Literal(pc + 4)), std::bitset<16>(0xFFFF));
+    }
+    else
+        // simply skip to next PC
+        ++nextPC;
+    PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 160, "branches taken", conditionMet ? 1 : 0);
     return true;
 }
 
-void QPU::writeConditional(Register dest, const SIMDVector& in, ConditionCode cond,
-    const qpu_asm::ALUInstruction* addInst, const qpu_asm::ALUInstruction* mulInst)
+bool QPU::executeLoad(const DecodedInstruction& inst, ProgramCounter& nextPC)
+{
+    if(inst.pack.hasEffect())
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
+    writeConditional(inst.addOut, inst.immediate, inst.addCondition);
+    writeConditional(inst.mulOut, inst.immediate, inst.mulCondition);
+    if(inst.setFlags)
+        setFlags(inst.immediate, inst.addCondition != COND_NEVER ? inst.addCondition : inst.mulCondition,
+            inst.immediateFlags);
+    ++nextPC;
+    return true;
+}
+
+bool QPU::executeSemaphore(const DecodedInstruction& inst, ProgramCounter& nextPC)
+{
+    bool dontStall = true;
+    SIMDVector result{};
+    if(inst.acquireSemaphore)
+        // NOTE: "acquire" is decrement, see SemaphoreInstruction#getAcquire() function documentation
+        std::tie(result, dontStall) = semaphores.decrement(inst.semaphore);
+    else
+        std::tie(result, dontStall) = semaphores.increment(inst.semaphore);
+
+    if(!dontStall)
+    {
+        countStall(StallCause::SEMAPHORE);
+        return false;
+    }
+    if(trace)
+        trace->recordSemaphore(
+            ID, inst.semaphore, !inst.acquireSemaphore, static_cast<uint8_t>(result[0].unsignedInt() & 0xF));
+
+    if(inst.pack.hasEffect())
+        PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 210, "values packed", 1);
+    result = inst.pack(result, {}, false);
+    writeConditional(inst.addOut, result, inst.addCondition);
+    writeConditional(inst.mulOut, result, inst.mulCondition);
+    if(inst.setFlags)
+        setFlags(result, inst.addCondition != COND_NEVER ? inst.addCondition : inst.mulCondition, {});
+    ++nextPC;
+    return true;
+}
+
+bool QPU::executeUnsupported(const DecodedInstruction& inst, ProgramCounter& nextPC)
+{
+    throw CompilationError(CompilationStep::GENERAL, inst.error, inst.instruction->toASMString());
+}
+
+/*
+ * Returns the index of the lowest set element of the given mask or NATIVE_VECTOR_SIZE if no element is set
+ */
+static uint8_t getFirstElement(std::bitset<NATIVE_VECTOR_SIZE> mask)
+{
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        if(mask.test(i))
+            return i;
+    }
+    return NATIVE_VECTOR_SIZE;
+}
+
+/*
+ * Throws the error for reading the undefined flags of the given element
+ */
+static void throwUndefinedFlags(const ElementFlags& flags, ConditionCode cond)
+{
+    // the element-wise check generates the exact error message for the flag read
+    static_cast<void>(flags.matchesCondition(cond));
+    throw CompilationError(CompilationStep::GENERAL, "Reading undefined flags", cond.to_string());
+}
+
+void QPU::writeConditional(
+    Register dest, const SIMDVector& in, ConditionCode cond, unsigned* executedCounter, unsigned* skippedCounter)
 {
     if(cond == COND_ALWAYS)
     {
         registers.writeRegister(dest, in, std::bitset<16>(0xFFFF));
-        if(addInst)
-            ++instrumentation[addInst].numAddALUExecuted;
-        if(mulInst)
-            ++instrumentation[mulInst].numMulALUExecuted;
+        if(executedCounter)
+            ++*executedCounter;
         return;
     }
     else if(cond == COND_NEVER)
     {
-        if(addInst)
-            ++instrumentation[addInst].numAddALUSkipped;
-        if(mulInst)
-            ++instrumentation[mulInst].numMulALUSkipped;
+        if(skippedCounter)
+            ++*skippedCounter;
         return;
     }
 
     std::bitset<16> elementMask{};
+    auto masks = evaluateCondition(flags, cond);
     if(in.isUndefined())
     {
-        if(std::any_of(flags.begin(), flags.end(),
-               [&](const ElementFlags& flag) -> bool { return flag.matchesCondition(cond); }))
+        auto firstElement = getFirstElement(masks.first | masks.second);
+        if(firstElement < NATIVE_VECTOR_SIZE)
         {
+            if(masks.second.test(firstElement))
+                throwUndefinedFlags(flags[firstElement], cond);
             // we would write an undefined value
             throw CompilationError(
                 CompilationStep::GENERAL, "Cannot write an undefined value", dest.to_string(true, false));
@@ -1490,28 +1950,16 @@ void QPU::writeConditional(Register dest, const SIMDVector& in, ConditionCode co
     }
     else
     {
-        for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
-        {
-            if(flags[i].matchesCondition(cond))
-                elementMask.set(i);
-        }
+        if(masks.second.any())
+            throwUndefinedFlags(flags[getFirstElement(masks.second)], cond);
+        elementMask = masks.first;
         registers.writeRegister(dest, in, elementMask);
     }
 
-    if(addInst != nullptr)
-    {
-        if(elementMask.any())
-            ++instrumentation[addInst].numAddALUExecuted;
-        else
-            ++instrumentation[addInst].numAddALUSkipped;
-    }
-    if(mulInst != nullptr)
-    {
-        if(elementMask.any())
-            ++instrumentation[mulInst].numMulALUExecuted;
-        else
-            ++instrumentation[mulInst].numMulALUSkipped;
-    }
+    if(elementMask.any() && executedCounter)
+        ++*executedCounter;
+    else if(!elementMask.any() && skippedCounter)
+        ++*skippedCounter;
 }
 
 bool QPU::isConditionMet(BranchCond cond) const
@@ -1573,11 +2021,14 @@ bool QPU::isConditionMet(BranchCond cond) const
     default:
         throw CompilationError(CompilationStep::GENERAL, "Unhandled branch condition", toString(cond));
     }
-    if(checkAll)
-        return std::all_of(flags.begin(), flags.end(),
-            [singleCond](ElementFlags flags) -> bool { return flags.matchesCondition(singleCond); });
-    return std::any_of(flags.begin(), flags.end(),
-        [singleCond](ElementFlags flags) -> bool { return flags.matchesCondition(singleCond); });
+    auto masks = evaluateCondition(flags, singleCond);
+    // find the first element deciding the result, the same element the element-wise std::all_of/std::any_of would stop
+    auto firstElement = getFirstElement(checkAll ? ~masks.first : (masks.first | masks.second));
+    if(firstElement == NATIVE_VECTOR_SIZE)
+        return checkAll;
+    if(masks.second.test(firstElement))
+        throwUndefinedFlags(flags[firstElement], singleCond);
+    return !checkAll;
 }
 
 bool QPU::executeSignal(Signaling signal)
@@ -1619,7 +2070,7 @@ void QPU::setFlags(const SIMDVector& output, ConditionCode cond, const VectorFla
 
 std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress baseAddress,
     const std::vector<MemoryAddress>& parameter, const WorkGroupConfig& config, MemoryAddress globalData,
-    const KernelUniforms& uniformsUsed)
+    const KernelUniforms& uniformsUsed, const Optional<std::array<Word, 3>>& groupIDs)
 {
     std::vector<MemoryAddress> res;
 
@@ -1629,10 +2080,11 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
     std::vector<Word> qpuUniforms;
     qpuUniforms.resize(uniformsUsed.countUniforms() + parameter.size());
 
-    if((config.numGroups[0] > 1 || config.numGroups[1] > 1 || config.numGroups[2] > 1) &&
+    if((config.numGroups[0] > 1 || config.numGroups[1] > 1 || config.numGroups[2] > 1) && !groupIDs &&
         !(uniformsUsed.getMaxGroupIDXUsed() && uniformsUsed.getMaxGroupIDYUsed() && uniformsUsed.getMaxGroupIDZUsed()))
         throw CompilationError(CompilationStep::GENERAL,
-            "Emulator of multiple work-groups requires work-group-loop optimization to be enabled!");
+            "Emulator of multiple work-groups requires work-group-loop optimization to be enabled or the group IDs to "
+            "be set!");
 
     for(uint8_t q = 0; q < numQPUs; ++q)
     {
@@ -1653,11 +2105,11 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
         if(uniformsUsed.getNumGroupsZUsed())
             qpuUniforms[i++] = config.numGroups[2];
         if(uniformsUsed.getGroupIDXUsed())
-            qpuUniforms[i++] = 0; // is only set for single work-groups
+            qpuUniforms[i++] = groupIDs ? (*groupIDs)[0] : 0;
         if(uniformsUsed.getGroupIDYUsed())
-            qpuUniforms[i++] = 0; // is only set for single work-groups
+            qpuUniforms[i++] = groupIDs ? (*groupIDs)[1] : 0;
         if(uniformsUsed.getGroupIDZUsed())
-            qpuUniforms[i++] = 0; // is only set for single work-groups
+            qpuUniforms[i++] = groupIDs ? (*groupIDs)[2] : 0;
         if(uniformsUsed.getGlobalOffsetXUsed())
             qpuUniforms[i++] = config.globalOffsets[0];
         if(uniformsUsed.getGlobalOffsetYUsed())
@@ -1685,8 +2137,37 @@ std::vector<MemoryAddress> tools::buildUniforms(Memory& memory, MemoryAddress ba
     return res;
 }
 
-static void emulateStep(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, std::vector<QPU>& qpus,
-    std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs)
+/*
+ * Returns whether the emulation is stopped before emulating the given cycle
+ */
+static bool isStopped(EmulationControl& control, const DecodedProgram& program, const std::vector<QPU>& qpus,
+    std::bitset<NATIVE_VECTOR_SIZE> activeQPUs, uint32_t cycle, uint32_t startCycle)
+{
+    if(cycle >= control.stopCycle)
+        control.stopped = true;
+    else if(control.stopInstruction && cycle != startCycle)
+    {
+        for(const QPU& qpu : qpus)
+        {
+            if(activeQPUs.test(qpu.ID) && qpu.getProgramCounter() == *control.stopInstruction)
+            {
+                CPPLOG_LAZY(logging::Level::INFO,
+                    log << "QPU " << static_cast<unsigned>(qpu.ID) << " reached instruction "
+                        << (qpu.getCurrentInstruction(program) ? qpu.getCurrentInstruction(program)->toASMString() :
+                                                                 "(out of bounds)")
+                        << logging::endl);
+                control.stopped = true;
+                break;
+            }
+        }
+    }
+    if(control.stopped)
+        CPPLOG_LAZY(logging::Level::INFO, log << "Stopping emulation before cycle " << cycle << logging::endl);
+    return control.stopped;
+}
+
+static void emulateStep(
+    const DecodedProgram& program, std::vector<QPU>& qpus, std::bitset<NATIVE_VECTOR_SIZE>& activeQPUs)
 {
     for(unsigned i = 0; i < qpus.size(); ++i)
     {
@@ -1694,32 +2175,48 @@ static void emulateStep(std::vector<qpu_asm::Instruction>::const_iterator firstI
             continue;
         try
         {
-            bool continueRunning = qpus[i].execute(firstInstruction);
+            bool continueRunning = qpus[i].execute(program);
             if(!continueRunning)
                 // this QPU has finished
                 activeQPUs.reset(i);
         }
         catch(const std::exception&)
         {
+            auto inst = qpus[i].getCurrentInstruction(program);
             logging::error() << "Emulation threw exception execution in following instruction on QPU "
                              << static_cast<unsigned>(qpus[i].ID) << ": "
-                             << qpus[i].getCurrentInstruction(firstInstruction)->toHexString(true) << logging::endl;
+                             << (inst ? inst->toHexString(true) : "(out of bounds)") << logging::endl;
             // re-throw error
             throw;
         }
     }
 }
 
-bool tools::emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, Memory& memory,
-    const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation, uint32_t maxCycles)
+EmulationControl::EmulationControl() = default;
+
+EmulationControl::~EmulationControl() = default;
+
+bool tools::emulate(const DecodedProgram& program, Memory& memory, const std::vector<MemoryAddress>& uniformAddresses,
+    InstrumentationResults& instrumentation, uint32_t maxCycles, const TimingModel& timing, CacheModel* caches,
+    EmulationTrace* trace, uint32_t* numCycles, EmulationControl* control)
 {
     if(uniformAddresses.size() > NUM_QPUS)
         throw CompilationError(CompilationStep::GENERAL, "Cannot use more than 12 QPUs!");
+    // counters of the instrumentation are indexed by the program counter
+    instrumentation.resize(program.size());
 
-    Mutex mutex;
+    // the cache contents are kept between executions if the cache model is passed in
+    std::unique_ptr<CacheModel> localCaches;
+    if(caches == nullptr)
+    {
+        localCaches.reset(new CacheModel(timing));
+        caches = localCaches.get();
+    }
+
+    Mutex mutex(trace);
     // FIXME is SFU execution per QPU or need SFUs be locked?
     std::array<SFU, NUM_QPUS> sfus;
-    VPM vpm(memory);
+    VPM vpm(memory, timing, trace);
     Semaphores semaphores;
 
     std::vector<QPU> qpus;
@@ -1728,56 +2225,108 @@ bool tools::emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstr
     uint8_t numQPU = 0;
     for(MemoryAddress uniformPointer : uniformAddresses)
     {
-        qpus.emplace_back(numQPU, mutex, sfus.at(numQPU), vpm, semaphores, memory, uniformPointer, instrumentation);
+        qpus.emplace_back(numQPU, mutex, sfus.at(numQPU), vpm, semaphores, memory, uniformPointer, instrumentation,
+            timing, *caches, trace);
         ++numQPU;
     }
 
     uint32_t cycle = 0;
+    if(control && control->restore)
+        cycle = control->restore->restore(activeQPUs, program, memory, mutex, sfus, vpm, semaphores, qpus, *caches);
+    const uint32_t startCycle = cycle;
+    // the emulation stops before the stop cycle, so do not fast-forward beyond it
+    const uint32_t endCycle = control ? std::min(maxCycles, control->stopCycle) : maxCycles;
+    if(trace)
+        trace->startEmulation(qpus.size());
+
     bool success = true;
     PROFILE_START(Emulation);
     while(activeQPUs.any())
     {
+        if(control && isStopped(*control, program, qpus, activeQPUs, cycle, startCycle))
+        {
+            if(control->checkpointOnStop)
+                control->checkpoint.reset(new Checkpoint(
+                    cycle, activeQPUs, program, memory, mutex, sfus, vpm, semaphores, qpus, *caches));
+            success = false;
+            break;
+        }
         CPPLOG_LAZY(logging::Level::DEBUG, log << "Emulating cycle: " << cycle << logging::endl);
+        if(trace)
+            trace->setCycle(cycle);
         PROFILE_COUNTER(vc4c::profiler::COUNTER_EMULATOR + 250, "emulation cycles (utilization)", qpus.size());
-        emulateStep(firstInstruction, qpus, activeQPUs);
+        emulateStep(program, qpus, activeQPUs);
         for(SFU& sfu : sfus)
             sfu.incrementCycle();
         vpm.incrementCycle();
 
         ++cycle;
 
-        if(cycle == maxCycles)
+        // if all running QPUs are stalled, jump directly to the first cycle any of them can continue. Since the
+        // stalled instructions are repeated without any effect, this gives the same result as emulating every cycle
+        uint32_t nextCycle = endCycle;
+        for(const QPU& qpu : qpus)
+        {
+            if(activeQPUs.test(qpu.ID))
+                nextCycle = std::min(nextCycle, qpu.getStallEndCycle());
+        }
+        if(nextCycle > cycle && activeQPUs.any() && (!control || control->skipStalledCycles))
+        {
+            const uint32_t numSkipped = nextCycle - cycle;
+            CPPLOG_LAZY(logging::Level::DEBUG,
+                log << "All QPUs are stalled, skipping " << numSkipped << " cycles" << logging::endl);
+            for(QPU& qpu : qpus)
+            {
+                if(activeQPUs.test(qpu.ID))
+                    qpu.skipStalledCycles(numSkipped);
+            }
+            for(SFU& sfu : sfus)
+                sfu.incrementCycle(numSkipped);
+            vpm.incrementCycle(numSkipped);
+            cycle = nextCycle;
+        }
+
+        if(cycle >= maxCycles)
         {
             logging::error() << "After the maximum number of execution cycles, following QPUs are still running: "
                              << logging::endl;
             for(const QPU& qpu : qpus)
+            {
+                auto inst = qpu.getCurrentInstruction(program);
                 logging::error() << "QPU " << static_cast<unsigned>(qpu.ID) << ": "
-                                 << qpu.getCurrentInstruction(firstInstruction)->toASMString() << logging::endl;
+                                 << (inst ? inst->toASMString() : "(out of bounds)") << logging::endl;
+            }
             success = false;
             break;
         }
     }
     PROFILE_END(Emulation);
+    if(trace)
+        trace->finishEmulation(cycle);
+    if(numCycles)
+        *numCycles = cycle;
 
-    // Run some sanity checks
-    semaphores.checkAllZero();
-    if(mutex.isLocked())
+    // Run some sanity checks, a stopped emulation might still hold the semaphores and the mutex
+    if(!control || !control->stopped)
     {
-        CPPLOG_LAZY(logging::Level::ERROR, log << "Hardware mutex was not unlocked!" << logging::endl);
+        semaphores.checkAllZero();
+        if(mutex.isLocked())
+        {
+            CPPLOG_LAZY(logging::Level::ERROR, log << "Hardware mutex was not unlocked!" << logging::endl);
+        }
     }
 
     CPPLOG_LAZY(logging::Level::INFO,
-        log << "Emulation " << (success ? "finished" : "timed out") << " for " << uniformAddresses.size()
-            << " QPUs after " << cycle << " cycles" << logging::endl);
+        log << "Emulation " << (success ? "finished" : (control && control->stopped ? "stopped" : "timed out"))
+            << " for " << uniformAddresses.size() << " QPUs after " << cycle << " cycles" << logging::endl);
 
     vpm.dumpContents();
     return success;
 }
 
-bool tools::emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
-    const std::vector<MemoryAddress>& parameter, Memory& memory, MemoryAddress uniformBaseAddress,
-    MemoryAddress globalData, const KernelUniforms& uniformsUsed, InstrumentationResults& instrumentation,
-    uint32_t maxCycles)
+bool tools::emulateTask(const DecodedProgram& program, const std::vector<MemoryAddress>& parameter, Memory& memory,
+    MemoryAddress uniformBaseAddress, MemoryAddress globalData, const KernelUniforms& uniformsUsed,
+    InstrumentationResults& instrumentation, uint32_t maxCycles, const TimingModel& timing)
 {
     WorkGroupConfig config;
     config.dimensions = 1;
@@ -1786,7 +2335,159 @@ bool tools::emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstI
     config.numGroups = {1, 1, 1};
     const auto uniformAddresses =
         buildUniforms(memory, uniformBaseAddress, parameter, config, globalData, uniformsUsed);
-    return emulate(firstInstruction, memory, uniformAddresses, instrumentation, maxCycles);
+    return emulate(program, memory, uniformAddresses, instrumentation, maxCycles, timing);
+}
+
+/*
+ * The state of a range of work-groups emulated independently from all other work-groups
+ */
+struct WorkGroupPartition
+{
+    // the linear IDs of the first and one past the last work-group in this partition
+    uint32_t firstGroup;
+    uint32_t lastGroup;
+    // the private memory image or nullptr to directly use the shared memory
+    std::unique_ptr<Memory> memory;
+    // the private cache model or nullptr to directly use the shared cache model
+    std::unique_ptr<CacheModel> caches;
+    // the execution trace of this partition or nullptr if no trace is recorded
+    std::unique_ptr<EmulationTrace> trace;
+    InstrumentationResults instrumentation;
+    // the sum of the cycles of all work-groups in this partition
+    uint64_t numCycles = 0;
+    bool success = true;
+};
+
+static void emulateWorkGroupPartition(const DecodedProgram& program, WorkGroupPartition& partition,
+    Memory& memory, CacheModel& caches, MemoryAddress uniformBaseAddress, const std::vector<MemoryAddress>& parameter,
+    MemoryAddress globalData, const WorkGroupConfig& config, const qpu_asm::KernelInfo& kernelInfo,
+    uint32_t maxCycles, const TimingModel& timing)
+{
+    for(uint32_t group = partition.firstGroup; group < partition.lastGroup && partition.success; ++group)
+    {
+        std::array<tools::Word, 3> groupIDs = {group % config.numGroups[0],
+            (group / config.numGroups[0]) % config.numGroups[1], group / (config.numGroups[0] * config.numGroups[1])};
+        CPPLOG_LAZY(logging::Level::DEBUG,
+            log << "Emulating work-group " << groupIDs[0] << ", " << groupIDs[1] << ", " << groupIDs[2]
+                << logging::endl);
+        // the UNIFORMs are rewritten for every work-group, since they are located in the (private) memory image
+        const auto uniformAddresses = buildUniforms(memory, uniformBaseAddress, parameter, config, globalData,
+            kernelInfo.uniformsUsed, groupIDs);
+        uint32_t groupCycles = 0;
+        partition.success = emulate(program, memory, uniformAddresses, partition.instrumentation, maxCycles, timing,
+            &caches, partition.trace.get(), &groupCycles);
+        partition.numCycles += groupCycles;
+    }
+}
+
+/*
+ * Emulates all work-groups of a kernel reading its group IDs from the UNIFORMs as independent executions.
+ *
+ * The work-groups are split into contiguous ranges (in the order of sequential execution), which are emulated on the
+ * given number of host threads. Each range uses its own QPU, VPM, SFU and semaphore state as well as a private copy of
+ * the memory image. Afterwards, the words written by the ranges are copied back in the order of the ranges, so if
+ * several ranges write to the same word, the value of the last work-group wins - same as for sequential execution.
+ * Writes of different values to the same word are reported as warnings.
+ */
+static bool emulateWorkGroups(const DecodedProgram& program, Memory& memory, CacheModel& caches,
+    MemoryAddress uniformBaseAddress,
+    const std::vector<MemoryAddress>& parameter, MemoryAddress globalData, const WorkGroupConfig& config,
+    const qpu_asm::KernelInfo& kernelInfo, InstrumentationResults& instrumentation, uint32_t maxCycles,
+    const TimingModel& timing, uint32_t numThreads, TraceWriter* traceWriter, uint64_t& numCycles)
+{
+    const uint32_t numGroups = config.numGroups[0] * config.numGroups[1] * config.numGroups[2];
+    const uint32_t numPartitions = std::max(1u, std::min(numThreads, numGroups));
+
+    std::vector<WorkGroupPartition> partitions;
+    partitions.reserve(numPartitions);
+    for(uint32_t i = 0; i < numPartitions; ++i)
+    {
+        partitions.emplace_back();
+        partitions.back().firstGroup =
+            static_cast<uint32_t>((static_cast<uint64_t>(numGroups) * i) / numPartitions);
+        partitions.back().lastGroup =
+            static_cast<uint32_t>((static_cast<uint64_t>(numGroups) * (i + 1)) / numPartitions);
+        if(traceWriter)
+            partitions.back().trace.reset(new EmulationTrace(*traceWriter, i,
+                kernelInfo.name + " (work-groups " + std::to_string(partitions.back().firstGroup) + " to " +
+                    std::to_string(partitions.back().lastGroup - 1) + ")"));
+        if(numPartitions > 1)
+        {
+            partitions.back().memory.reset(new Memory(memory.copy()));
+            partitions.back().caches.reset(new CacheModel(timing));
+            for(const auto& buffer : caches.getBuffers())
+                partitions.back().caches->addBuffer(buffer.first, buffer.second);
+        }
+    }
+
+    CPPLOG_LAZY(logging::Level::INFO,
+        log << "Emulating " << numGroups << " work-groups in " << numPartitions << " partitions" << logging::endl);
+
+    if(numPartitions == 1)
+        emulateWorkGroupPartition(program, partitions.front(), memory, caches, uniformBaseAddress, parameter,
+            globalData, config, kernelInfo, maxCycles, timing);
+    else
+    {
+        ThreadPool pool{"Emulator", numPartitions};
+        std::vector<std::future<void>> futures;
+        futures.reserve(partitions.size());
+        for(auto& partition : partitions)
+        {
+            futures.emplace_back(pool.schedule([&]() {
+                emulateWorkGroupPartition(program, partition, *partition.memory, *partition.caches,
+                    uniformBaseAddress, parameter, globalData, config, kernelInfo, maxCycles, timing);
+            }));
+        }
+        // wait for all partitions to finish before (re-)throwing any error, since they access the shared state
+        for(auto& future : futures)
+            future.wait();
+        for(auto& future : futures)
+            future.get();
+
+        // merge the words written by the partitions (excluding the UNIFORMs) back into the shared memory. A word is
+        // also copied back if the written value is the same as the original one, since a previous work-group might
+        // have written another value to the same word
+        std::size_t numConflicts = 0;
+        for(MemoryAddress address = 0; address < uniformBaseAddress;
+            address += static_cast<MemoryAddress>(sizeof(tools::Word)))
+        {
+            Optional<tools::Word> writtenValue{};
+            for(const auto& partition : partitions)
+            {
+                if(!partition.memory->isWordWritten(address))
+                    continue;
+                auto value = partition.memory->readWord(address);
+                if(writtenValue && *writtenValue != value)
+                {
+                    ++numConflicts;
+                    CPPLOG_LAZY(logging::Level::DEBUG,
+                        log << "Conflicting write of work-groups " << partition.firstGroup << " to "
+                            << (partition.lastGroup - 1) << " to address 0x" << std::hex << address << std::dec
+                            << logging::endl);
+                }
+                writtenValue = value;
+            }
+            if(writtenValue)
+                *memory.getWordAddress(address) = *writtenValue;
+        }
+        if(numConflicts > 0)
+            logging::warn() << "Independently emulated work-groups wrote different values to the same memory "
+                            << numConflicts << " times, using the value of the last work-group" << logging::endl;
+    }
+
+    instrumentation.resize(program.size());
+    bool success = true;
+    for(const auto& partition : partitions)
+    {
+        success = success && partition.success;
+        // the hardware would execute the work-groups one after the other
+        numCycles += partition.numCycles;
+        if(partition.caches)
+            caches.mergeStatistics(*partition.caches);
+        for(std::size_t i = 0; i < partition.instrumentation.size(); ++i)
+            instrumentation[i] += partition.instrumentation[i];
+    }
+    return success;
 }
 
 static Memory fillMemory(const StableList<Global>& globalData, const EmulationData& settings,
@@ -1888,6 +2589,43 @@ static void dumpMemory(const Memory& memory, const std::string& fileName, Memory
         log << std::dec << "Dumped " << addr << " words of memory into " << fileName << logging::endl);
 }
 
+CacheStatistics& CacheStatistics::operator+=(const CacheStatistics& other)
+{
+    numTMUCacheHits += other.numTMUCacheHits;
+    numTMUCacheMisses += other.numTMUCacheMisses;
+    numL2CacheMisses += other.numL2CacheMisses;
+    numMissPenaltyCycles += other.numMissPenaltyCycles;
+    return *this;
+}
+
+InstrumentationResult& InstrumentationResult::operator+=(const InstrumentationResult& other)
+{
+    numAddALUExecuted += other.numAddALUExecuted;
+    numAddALUSkipped += other.numAddALUSkipped;
+    numMulALUExecuted += other.numMulALUExecuted;
+    numMulALUSkipped += other.numMulALUSkipped;
+    numBranchTaken += other.numBranchTaken;
+    numStalls += other.numStalls;
+    numTMUStalls += other.numTMUStalls;
+    numDMALoadStalls += other.numDMALoadStalls;
+    numDMAStoreStalls += other.numDMAStoreStalls;
+    numVPMStalls += other.numVPMStalls;
+    numMutexStalls += other.numMutexStalls;
+    numSemaphoreStalls += other.numSemaphoreStalls;
+    cacheStatistics += other.cacheStatistics;
+    numExecutions += other.numExecutions;
+    return *this;
+}
+
+std::string CacheStatistics::to_string() const
+{
+    auto numAccesses = numTMUCacheHits + numTMUCacheMisses;
+    std::stringstream s;
+    s << "hits " << numTMUCacheHits << "/" << numAccesses << ", L2 misses " << numL2CacheMisses << ", penalty "
+      << numMissPenaltyCycles;
+    return s.str();
+}
+
 std::string InstrumentationResult::to_string() const
 {
     std::vector<std::string> parts;
@@ -1918,6 +2656,27 @@ std::string InstrumentationResult::to_string() const
     if(numStalls > 0)
     {
         tmp << "stall: " << numStalls;
+        std::vector<std::string> causes;
+        if(numTMUStalls > 0)
+            causes.emplace_back("tmu " + std::to_string(numTMUStalls));
+        if(numDMALoadStalls > 0)
+            causes.emplace_back("dma-load " + std::to_string(numDMALoadStalls));
+        if(numDMAStoreStalls > 0)
+            causes.emplace_back("dma-store " + std::to_string(numDMAStoreStalls));
+        if(numVPMStalls > 0)
+            causes.emplace_back("vpm " + std::to_string(numVPMStalls));
+        if(numMutexStalls > 0)
+            causes.emplace_back("mutex " + std::to_string(numMutexStalls));
+        if(numSemaphoreStalls > 0)
+            causes.emplace_back("semaphore " + std::to_string(numSemaphoreStalls));
+        if(!causes.empty())
+            tmp << " (" << vc4c::to_string<std::string>(causes) << ")";
+        parts.emplace_back(tmp.str());
+        tmp.str("");
+    }
+    if(cacheStatistics.numTMUCacheHits + cacheStatistics.numTMUCacheMisses > 0)
+    {
+        tmp << "cache: " << cacheStatistics.to_string();
         parts.emplace_back(tmp.str());
         tmp.str("");
     }
@@ -1926,6 +2685,23 @@ std::string InstrumentationResult::to_string() const
 }
 LCOV_EXCL_STOP
 
+static void writeHotSpotProfile(const std::string& kernelName,
+    std::vector<qpu_asm::DecoratedInstruction>&& instructions, const InstrumentationResults& instrumentation,
+    const std::string& reportFile, const std::string& callgrindFile)
+{
+    HotSpotProfile profile(kernelName, std::move(instructions), instrumentation);
+    if(!reportFile.empty())
+    {
+        std::ofstream report(reportFile);
+        profile.writeReport(report);
+    }
+    if(!callgrindFile.empty())
+    {
+        std::ofstream callgrind(callgrindFile);
+        profile.writeCallgrind(callgrind);
+    }
+}
+
 EmulationResult tools::emulate(const EmulationData& data)
 {
     qpu_asm::ModuleInfo module;
@@ -1963,27 +2739,115 @@ EmulationResult tools::emulate(const EmulationData& data)
     std::vector<MemoryAddress> paramAddresses;
     Memory mem(fillMemory(globals, data, uniformAddress, globalDataAddress, paramAddresses));
 
-    auto uniformAddresses =
-        buildUniforms(mem, uniformAddress, paramAddresses, data.workGroup, globalDataAddress, kernelInfo->uniformsUsed);
+    // with the work-group loop, all work-groups are run by a single execution. Otherwise the work-groups are
+    // independent executions, each reading its group IDs from the UNIFORMs
+    const bool hasWorkGroupLoop = kernelInfo->uniformsUsed.getMaxGroupIDXUsed() &&
+        kernelInfo->uniformsUsed.getMaxGroupIDYUsed() && kernelInfo->uniformsUsed.getMaxGroupIDZUsed();
+    const bool hasMultipleGroups =
+        data.workGroup.numGroups[0] > 1 || data.workGroup.numGroups[1] > 1 || data.workGroup.numGroups[2] > 1;
+    // collect the cache statistics separately for the global data and all parameter buffers
+    CacheModel caches(data.timing);
+    MemoryAddress globalDataEnd = uniformAddress;
+    for(std::size_t i = 0; i < data.parameter.size(); ++i)
+    {
+        if(!data.parameter[i].second)
+            continue;
+        globalDataEnd = std::min(globalDataEnd, paramAddresses[i]);
+        caches.addBuffer(paramAddresses[i],
+            paramAddresses[i] + static_cast<MemoryAddress>(data.parameter[i].second->size() * sizeof(uint32_t)));
+    }
+    caches.addBuffer(globalDataAddress, globalDataEnd);
+
+    std::vector<MemoryAddress> uniformAddresses;
+    if(hasWorkGroupLoop || !hasMultipleGroups)
+        uniformAddresses = buildUniforms(
+            mem, uniformAddress, paramAddresses, data.workGroup, globalDataAddress, kernelInfo->uniformsUsed);
+    if(hasWorkGroupLoop && hasMultipleGroups && data.numEmulationThreads != 1)
+        CPPLOG_LAZY(logging::Level::INFO,
+            log << "Kernel runs all work-groups in a single execution, ignoring the number of emulation threads"
+                << logging::endl);
 
     if(!data.memoryDump.empty())
         dumpMemory(mem, data.memoryDump, uniformAddress, true);
 
+    auto firstInstruction = instructions.cbegin() +
+        static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
+            (kernelInfo->getOffset() - module.kernelInfos.front().getOffset()).getValue());
+    auto lastInstruction = std::distance(firstInstruction, instructions.cend()) >
+            static_cast<std::vector<qpu_asm::Instruction>::difference_type>(kernelInfo->getLength().getValue()) ?
+        firstInstruction +
+            static_cast<std::vector<qpu_asm::Instruction>::difference_type>(kernelInfo->getLength().getValue()) :
+        instructions.cend();
+    const auto program = decodeProgram(firstInstruction, lastInstruction);
+
+    std::unique_ptr<TraceWriter> traceWriter;
+    if(!data.traceFile.empty())
+        traceWriter.reset(new TraceWriter(data.traceFile));
+
+    const bool usesControl = !data.restoreCheckpoint.empty() || !data.checkpointFile.empty() ||
+        data.stopCycle != std::numeric_limits<uint32_t>::max() || data.stopInstruction || !data.skipStalledCycles;
+    EmulationControl control;
+    std::unique_ptr<Checkpoint> restoredCheckpoint;
+    if(!data.restoreCheckpoint.empty())
+    {
+        std::ifstream in(data.restoreCheckpoint, std::ios_base::in | std::ios_base::binary);
+        if(!in)
+            throw CompilationError(CompilationStep::GENERAL, "Failed to open checkpoint file", data.restoreCheckpoint);
+        restoredCheckpoint.reset(new Checkpoint(Checkpoint::readFrom(in)));
+        control.restore = restoredCheckpoint.get();
+    }
+    control.stopCycle = data.stopCycle;
+    control.stopInstruction = data.stopInstruction;
+    control.checkpointOnStop = !data.checkpointFile.empty();
+    control.skipStalledCycles = data.skipStalledCycles;
+
     InstrumentationResults instrumentation;
-    bool status = emulate(instructions.begin() +
-            static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
-                (kernelInfo->getOffset() - module.kernelInfos.front().getOffset()).getValue()),
-        mem, uniformAddresses, instrumentation, data.maxEmulationCycles);
+    bool status = false;
+    uint64_t numCycles = 0;
+    if(hasWorkGroupLoop || !hasMultipleGroups)
+    {
+        std::unique_ptr<EmulationTrace> trace;
+        if(traceWriter)
+            trace.reset(new EmulationTrace(*traceWriter, 0, kernelInfo->name));
+        uint32_t cycles = 0;
+        status = emulate(program, mem, uniformAddresses, instrumentation, data.maxEmulationCycles, data.timing,
+            &caches, trace.get(), &cycles, usesControl ? &control : nullptr);
+        numCycles = cycles;
+    }
+    else if(usesControl)
+        throw CompilationError(CompilationStep::GENERAL,
+            "Checkpoints, stopping the emulation and emulating all stalled cycles are not supported for independently "
+            "emulated work-groups");
+    else
+        status = emulateWorkGroups(program, mem, caches, uniformAddress, paramAddresses, globalDataAddress,
+            data.workGroup, *kernelInfo, instrumentation, data.maxEmulationCycles, data.timing,
+            data.numEmulationThreads == 0 ? std::thread::hardware_concurrency() : data.numEmulationThreads,
+            traceWriter.get(), numCycles);
 
     if(!data.memoryDump.empty())
         dumpMemory(mem, data.memoryDump, uniformAddress, false);
 
+    if(control.checkpoint)
+    {
+        std::ofstream out(data.checkpointFile, std::ios_base::out | std::ios_base::binary);
+        control.checkpoint->writeTo(out);
+        CPPLOG_LAZY(logging::Level::INFO,
+            log << "Checkpoint at cycle " << control.checkpoint->getCycle() << " written to: " << data.checkpointFile
+                << logging::endl);
+    }
+
     EmulationResult result{data};
     result.executionSuccessful = status;
+    result.executionStopped = control.stopped;
+    result.numCycles = numCycles;
 
+    result.globalDataCacheStatistics = caches.getBufferStatistics(globalDataAddress);
     result.results.reserve(data.parameter.size());
+    result.parameterCacheStatistics.reserve(data.parameter.size());
     for(std::size_t i = 0; i < data.parameter.size(); ++i)
     {
+        result.parameterCacheStatistics.emplace_back(
+            data.parameter[i].second ? caches.getBufferStatistics(paramAddresses[i]) : CacheStatistics{});
         if(!data.parameter[i].second)
             result.results.emplace_back(std::make_pair(data.parameter[i].first, Optional<std::vector<uint32_t>>{}));
         else
@@ -1998,19 +2862,28 @@ EmulationResult tools::emulate(const EmulationData& data)
     std::unique_ptr<std::ofstream> dumpInstrumentation;
     if(!data.instrumentationDump.empty())
         dumpInstrumentation.reset(new std::ofstream(data.instrumentationDump));
-    auto it = instructions.begin() +
-        static_cast<std::vector<qpu_asm::Instruction>::difference_type>(
-            (kernelInfo->getOffset() - module.kernelInfos.front().getOffset()).getValue());
-    result.instrumentation.reserve(kernelInfo->getLength().getValue());
-    while(true)
+    result.instrumentation.reserve(program.size());
+    for(std::size_t i = 0; i < program.size(); ++i)
     {
-        result.instrumentation.emplace_back(instrumentation[&(*it)]);
+        result.instrumentation.emplace_back(instrumentation[i]);
         if(dumpInstrumentation)
-            *dumpInstrumentation << std::left << std::setw(80) << it->toASMString() << "//"
-                                 << instrumentation[&(*it)].to_string() << std::endl;
-        if(it->getSig() == SIGNAL_END_PROGRAM)
+            *dumpInstrumentation << std::left << std::setw(80) << program[i].instruction->toASMString() << "//"
+                                 << instrumentation[i].to_string() << std::endl;
+        if(program[i].instruction->getSig() == SIGNAL_END_PROGRAM)
             break;
-        ++it;
+    }
+
+    if(!data.profileReport.empty() || !data.profileCallgrind.empty())
+    {
+        std::unique_ptr<std::ifstream> compilerOutput;
+        if(!data.decoratedModule.empty())
+            compilerOutput.reset(new std::ifstream(data.decoratedModule));
+        auto decoratedInstructions = decorateInstructions(instructions, compilerOutput.get());
+        std::vector<qpu_asm::DecoratedInstruction> kernelInstructions(
+            decoratedInstructions.begin() + std::distance(instructions.cbegin(), firstInstruction),
+            decoratedInstructions.begin() + std::distance(instructions.cbegin(), lastInstruction));
+        writeHotSpotProfile(kernelInfo->name, std::move(kernelInstructions), result.instrumentation,
+            data.profileReport, data.profileCallgrind);
     }
 
     return result;
@@ -2040,28 +2913,43 @@ LowLevelEmulationResult tools::emulate(const LowLevelEmulationData& data)
     auto instructions = extractInstructions(data.kernelAddress, data.numInstructions);
     Memory mem(data.buffers);
 
+    const auto program = decodeProgram(instructions.cbegin(), instructions.cend());
+
+    std::unique_ptr<TraceWriter> traceWriter;
+    std::unique_ptr<EmulationTrace> trace;
+    if(!data.traceFile.empty())
+    {
+        traceWriter.reset(new TraceWriter(data.traceFile));
+        trace.reset(new EmulationTrace(*traceWriter, 0, "kernel"));
+    }
+
     InstrumentationResults instrumentation;
-    bool status = emulate(instructions.begin(), mem, data.uniformAddresses, instrumentation, data.maxEmulationCycles);
+    uint32_t numCycles = 0;
+    bool status = emulate(program, mem, data.uniformAddresses, instrumentation, data.maxEmulationCycles, data.timing,
+        nullptr, trace.get(), &numCycles);
 
     LowLevelEmulationResult result{data};
     result.executionSuccessful = status;
+    result.numCycles = numCycles;
 
     // Map and dump instrumentation results
     std::unique_ptr<std::ofstream> dumpInstrumentation;
     if(!data.instrumentationDump.empty())
         dumpInstrumentation.reset(new std::ofstream(data.instrumentationDump));
-    auto it = instructions.begin();
-    result.instrumentation.reserve(data.numInstructions);
-    while(true)
+    result.instrumentation.reserve(program.size());
+    for(std::size_t i = 0; i < program.size(); ++i)
     {
-        result.instrumentation.emplace_back(instrumentation[&(*it)]);
+        result.instrumentation.emplace_back(instrumentation[i]);
         if(dumpInstrumentation)
-            *dumpInstrumentation << std::left << std::setw(80) << it->toASMString() << "//"
-                                 << instrumentation[&(*it)].to_string() << std::endl;
-        if(it->getSig() == SIGNAL_END_PROGRAM)
+            *dumpInstrumentation << std::left << std::setw(80) << program[i].instruction->toASMString() << "//"
+                                 << instrumentation[i].to_string() << std::endl;
+        if(program[i].instruction->getSig() == SIGNAL_END_PROGRAM)
             break;
-        ++it;
     }
 
+    if(!data.profileReport.empty() || !data.profileCallgrind.empty())
+        writeHotSpotProfile("kernel", decorateInstructions(instructions, nullptr), result.instrumentation,
+            data.profileReport, data.profileCallgrind);
+
     return result;
 }
@@ -10,11 +10,13 @@
 #include "../Values.h"
 #include "../asm/OpCodes.h"
 #include "../performance.h"
+#include "VectorizedALU.h"
 #include "config.h"
 #include "tools.h"
 
 #include <bitset>
 #include <limits>
+#include <memory>
 #include <queue>
 
 namespace vc4c
@@ -24,11 +26,12 @@ namespace vc4c
     namespace qpu_asm
     {
         class Instruction;
-        class ALUInstruction;
     } // namespace qpu_asm
 
     namespace tools
     {
+        class Checkpoint;
+        class EmulationTrace;
         class QPU;
 
         using MemoryAddress = uint32_t;
@@ -56,27 +59,49 @@ namespace vc4c
             const Word* getWordAddress(MemoryAddress address) const;
 
             Word readWord(MemoryAddress address) const;
+            /*
+             * Writes the given bytes into the memory at the given address and records the words written
+             */
+            void writeBytes(MemoryAddress address, const uint8_t* bytes, std::size_t numBytes);
+            /*
+             * Returns whether the word at the given address was written via #writeBytes
+             */
+            bool isWordWritten(MemoryAddress address) const;
             MemoryAddress incrementAddress(MemoryAddress address, DataType typeSize) const;
 
             MemoryAddress getMaximumAddress() const;
             void setUniforms(const std::vector<Word>& uniforms, MemoryAddress address);
 
+            /*
+             * Creates an independent copy of the contents of this memory.
+             *
+             * NOTE: This is only supported for direct buffers, since mapped buffers are owned by the caller.
+             */
+            Memory copy() const;
+
         private:
+            friend class Checkpoint;
             using DirectBuffer = std::vector<Word>;
             using MappedBuffers = std::map<uint32_t, std::reference_wrapper<std::vector<uint8_t>>>;
             Variant<DirectBuffer, MappedBuffers> data;
+            // the indices of the words written via #writeBytes
+            std::vector<bool> writtenWords;
         };
 
         class Mutex : private NonCopyable
         {
         public:
+            explicit Mutex(EmulationTrace* trace = nullptr) : trace(trace) {}
+
             bool isLocked() const;
             NODISCARD bool lock(uint8_t qpu);
             void unlock(uint8_t qpu);
 
         private:
+            friend class Checkpoint;
             bool locked{false};
             uint8_t lockOwner{255};
+            EmulationTrace* trace;
         };
 
         class Registers : private NonCopyable
@@ -90,8 +115,14 @@ namespace vc4c
             SIMDVector getInterruptValue() const;
 
             void clearReadCache();
+            /*
+             * Returns whether the current instruction read any register with side-effects (e.g. UNIFORM, r4, VPM or a
+             * successful mutex lock), i.e. whether its execution cannot be repeated without changing the state
+             */
+            bool hasSideEffectReads() const;
 
         private:
+            friend class Checkpoint;
             QPU& qpu;
             FastMap<Register, SIMDVector> storageRegisters;
             Optional<SIMDVector> hostInterrupt;
@@ -114,16 +145,79 @@ namespace vc4c
             void setUniformAddress(const SIMDVector& val);
 
         private:
+            friend class Checkpoint;
             QPU& qpu;
             Memory& memory;
             MemoryAddress uniformAddress;
             uint32_t lastAddressSetCycle;
         };
 
+        /*
+         * A set-associative cache with least-recently-used replacement.
+         *
+         * Only the cached addresses are tracked, the data is always read from the memory.
+         */
+        class Cache
+        {
+        public:
+            Cache(uint32_t size, uint32_t lineSize, uint32_t associativity);
+
+            /*
+             * Accesses the cache line containing the given address and returns whether it was cached
+             */
+            NODISCARD bool access(MemoryAddress address);
+
+        private:
+            friend class Checkpoint;
+            uint32_t lineSize;
+            uint32_t associativity;
+            // the cache lines per set, ordered from most to least recently used
+            std::vector<std::vector<MemoryAddress>> sets;
+        };
+
+        /*
+         * Simulates the TMU caches (one per TMU per slice) and the L2 cache shared by all QPUs for the TMU loads
+         */
+        class CacheModel : private NonCopyable
+        {
+        public:
+            explicit CacheModel(const TimingModel& timing);
+
+            /*
+             * Registers the buffer in the range [start, end) to collect separate cache statistics for
+             */
+            void addBuffer(MemoryAddress start, MemoryAddress end);
+            CacheStatistics getBufferStatistics(MemoryAddress start) const;
+            std::vector<std::pair<MemoryAddress, MemoryAddress>> getBuffers() const;
+            /*
+             * Adds the per-buffer statistics of the other cache model (e.g. of independently emulated work-groups)
+             */
+            void mergeStatistics(const CacheModel& other);
+
+            /*
+             * Simulates the TMU load of the given addresses via the given (physical) TMU of the given QPU.
+             *
+             * Returns the additional cycles the load takes due to cache misses.
+             */
+            uint32_t loadTMU(
+                uint8_t qpu, uint8_t tmu, const SIMDVector& addresses, CacheStatistics& instructionStatistics);
+
+        private:
+            friend class Checkpoint;
+            const TimingModel& timing;
+            std::vector<Cache> tmuCaches;
+            Cache l2Cache;
+            // the statistics per buffer, indexed by the start address and also containing the end address
+            std::map<MemoryAddress, std::pair<MemoryAddress, CacheStatistics>> bufferStatistics;
+        };
+
         class TMUs : private NonCopyable
         {
         public:
-            TMUs(QPU& qpu, Memory& memory) : qpu(qpu), tmuNoSwap(false), lastTMUNoSwap(0), memory(memory) {}
+            TMUs(QPU& qpu, Memory& memory, CacheModel& caches) :
+                qpu(qpu), tmuNoSwap(false), lastTMUNoSwap(0), memory(memory), caches(caches)
+            {
+            }
 
             std::pair<SIMDVector, bool> readTMU();
             bool hasValueOnR4() const;
@@ -135,12 +229,19 @@ namespace vc4c
             void setTMURegisterB(uint8_t tmu, const SIMDVector& val);
 
             NODISCARD bool triggerTMURead(uint8_t tmu);
+            /*
+             * Returns the first cycle the data of any of the pending TMU loads is available
+             */
+            uint32_t getNextLoadCycle() const;
 
         private:
+            friend class Checkpoint;
             QPU& qpu;
             bool tmuNoSwap;
             uint32_t lastTMUNoSwap;
             Memory& memory;
+            CacheModel& caches;
+            // the loaded data and the cycle it is available
             std::queue<std::pair<SIMDVector, uint32_t>> tmu0RequestQueue;
             std::queue<std::pair<SIMDVector, uint32_t>> tmu0ResponseQueue;
             std::queue<std::pair<SIMDVector, uint32_t>> tmu1RequestQueue;
@@ -162,9 +263,10 @@ namespace vc4c
             void startExp2(const SIMDVector& val);
             void startLog2(const SIMDVector& val);
 
-            void incrementCycle();
+            void incrementCycle(uint32_t numCycles = 1);
 
         private:
+            friend class Checkpoint;
             // FIXME is SFU calculation per QPU? Or do QPUs need to lock the SFU access?
             // XXX per QPU cycle??
             uint32_t lastSFUWrite{0};
@@ -175,10 +277,10 @@ namespace vc4c
         class VPM : private NonCopyable
         {
         public:
-            explicit VPM(Memory& memory) :
-                memory(memory), vpmReadSetup(0), vpmWriteSetup(0), dmaReadSetup(0), dmaWriteSetup(0),
-                readStrideSetup(0), writeStrideSetup(0), lastDMAReadTrigger(0), lastDMAWriteTrigger(0), currentCycle(0),
-                cache({})
+            VPM(Memory& memory, const TimingModel& timing, EmulationTrace* trace = nullptr) :
+                memory(memory), timing(timing), trace(trace), vpmReadSetup(0), vpmWriteSetup(0), dmaReadSetup(0),
+                dmaWriteSetup(0), readStrideSetup(0), writeStrideSetup(0), lastReadSetup(0), dmaReadFinished({}),
+                dmaWriteFinished({}), dmaBusyUntil(0), currentCycle(0), cache({})
             {
             }
 
@@ -188,29 +290,46 @@ namespace vc4c
             void setWriteSetup(const SIMDVector& val);
             void setReadSetup(const SIMDVector& val);
 
-            void setDMAWriteAddress(const SIMDVector& val);
-            void setDMAReadAddress(const SIMDVector& val);
+            void setDMAWriteAddress(const SIMDVector& val, uint8_t qpu);
+            void setDMAReadAddress(const SIMDVector& val, uint8_t qpu);
 
-            NODISCARD bool waitDMAWrite() const;
-            NODISCARD bool waitDMARead() const;
+            NODISCARD bool waitDMAWrite(uint8_t qpu) const;
+            NODISCARD bool waitDMARead(uint8_t qpu) const;
+            NODISCARD bool waitRead() const;
+            /*
+             * Returns the cycles the waits for the DMA write/read of the given QPU and for the VPM read finish
+             */
+            uint32_t getDMAWriteEndCycle(uint8_t qpu) const;
+            uint32_t getDMAReadEndCycle(uint8_t qpu) const;
+            uint32_t getReadEndCycle() const;
 
-            void incrementCycle();
+            void incrementCycle(uint32_t numCycles = 1);
 
             void dumpContents() const;
 
         private:
+            friend class Checkpoint;
             Memory& memory;
+            const TimingModel& timing;
+            EmulationTrace* trace;
             uint32_t vpmReadSetup;
             uint32_t vpmWriteSetup;
             uint32_t dmaReadSetup;
             uint32_t dmaWriteSetup;
             uint32_t readStrideSetup;
             uint32_t writeStrideSetup;
-            uint32_t lastDMAReadTrigger;
-            uint32_t lastDMAWriteTrigger;
+            uint32_t lastReadSetup;
+            // the cycles the last DMA transfer triggered by the QPU with the given index finishes
+            std::array<uint32_t, NUM_QPUS> dmaReadFinished;
+            std::array<uint32_t, NUM_QPUS> dmaWriteFinished;
+            // the cycle the DMA engine finishes all currently scheduled transfers
+            uint32_t dmaBusyUntil;
             uint32_t currentCycle;
 
             std::array<std::array<Word, 16>, 64> cache;
+
+            uint32_t scheduleDMATransfer(
+                uint32_t latency, uint32_t numRows, uint32_t rowBytes, uint8_t qpu, bool isLoad);
         };
 
         class Semaphores : private NonCopyable
@@ -227,33 +346,173 @@ namespace vc4c
             void checkAllZero() const;
 
         private:
+            friend class Checkpoint;
             std::array<uint8_t, 16> counter;
         };
 
         using ProgramCounter = uint32_t;
 
-        using InstrumentationResults = FastMap<const qpu_asm::Instruction*, InstrumentationResult>;
+        /*
+         * The reason for a QPU to stall
+         */
+        enum class StallCause : uint8_t
+        {
+            // waiting for the TMU to load the requested data
+            TMU,
+            // waiting for a DMA load into the VPM to finish
+            DMA_LOAD,
+            // waiting for a DMA store from the VPM to finish
+            DMA_STORE,
+            // waiting for the VPM read FIFO to be filled
+            VPM_READ,
+            // waiting for the hardware mutex to be released by another QPU
+            MUTEX,
+            // waiting for a semaphore to be increased/decreased by another QPU
+            SEMAPHORE
+        };
+
+        /*
+         * The instrumentation results, indexed by the position of the instruction within the emulated program
+         */
+        using InstrumentationResults = std::vector<InstrumentationResult>;
+
+        /*
+         * A single instruction decoded once before the emulation starts.
+         *
+         * All the information which would otherwise be extracted from the 64-bit instruction in every emulated cycle
+         * (e.g. op-codes, input and output registers, conditions, pack and unpack modes) is resolved ahead of time and
+         * the type of instruction is mapped to the QPU member function executing it.
+         */
+        struct DecodedInstruction
+        {
+            /*
+             * Executes the decoded instruction and updates the next program counter, if the instruction did not stall
+             */
+            using Handler = bool (QPU::*)(const DecodedInstruction& inst, ProgramCounter& nextPC);
+
+            /*
+             * The original instruction, used for logging and error messages
+             */
+            const qpu_asm::Instruction* instruction = nullptr;
+            /*
+             * The handler executing this instruction, nullptr for the end of the program
+             */
+            Handler handler = nullptr;
+            /*
+             * The signal to execute before the instruction, SIGNAL_NONE if there is no signal with an effect
+             */
+            Signaling signal = SIGNAL_NONE;
+            ConditionCode addCondition = COND_NEVER;
+            ConditionCode mulCondition = COND_NEVER;
+            bool setFlags = false;
+            Register addOut = REG_NOP;
+            Register mulOut = REG_NOP;
+            Pack pack = PACK_NOP;
+            Unpack unpack = UNPACK_NOP;
+            /*
+             * Whether the pack mode is applied to the mul ALU result instead of the add ALU result
+             */
+            bool packMulResult = false;
+
+            /*
+             * The op-codes executed by the ALUs, nullptr if the ALU does not execute anything
+             */
+            const OpCode* addCode = nullptr;
+            const OpCode* mulCode = nullptr;
+            /*
+             * The vectorized implementations of the op-codes, nullptr to use the generic element-wise calculation
+             */
+            VectorizedOperation addOperation = nullptr;
+            VectorizedOperation mulOperation = nullptr;
+            /*
+             * The registers read for the operands, in the order: add A, add B, mul A, mul B
+             */
+            std::array<Register, 4> inputs{{REG_NOP, REG_NOP, REG_NOP, REG_NOP}};
+            /*
+             * Whether the operands are read at all, use the small immediate value or are unpacked
+             */
+            std::bitset<4> readInputs;
+            std::bitset<4> immediateInputs;
+            std::bitset<4> unpackedInputs;
+            /*
+             * Whether the flags are set by the mul ALU result
+             */
+            bool mulSetsFlags = false;
+            /*
+             * The vector rotation applied to the mul ALU inputs, if any
+             */
+            bool isRotated = false;
+            bool isFullRangeRotation = false;
+            bool rotateByR5 = false;
+            uint8_t rotationOffset = 0;
+
+            /*
+             * The small immediate value for ALU instructions or the (already packed) loaded value for load
+             * instructions
+             */
+            SIMDVector immediate;
+            VectorFlags immediateFlags;
+
+            /*
+             * The branch condition and the absolute target of the branch
+             */
+            BranchCond branchCondition = BranchCond::ALWAYS;
+            ProgramCounter branchTarget = 0;
+
+            /*
+             * The semaphore accessed and whether it is acquired (decremented)
+             */
+            uint8_t semaphore = 0;
+            bool acquireSemaphore = false;
+
+            /*
+             * The error to throw for unsupported instructions, only executed when the instruction is actually reached
+             */
+            std::string error;
+        };
+
+        using DecodedProgram = std::vector<DecodedInstruction>;
+
+        /*
+         * Decodes the instructions in the range [firstInstruction, lastInstruction) into the program to emulate
+         */
+        DecodedProgram decodeProgram(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+            std::vector<qpu_asm::Instruction>::const_iterator lastInstruction);
 
         class QPU : private NonCopyable
         {
         public:
             QPU(uint8_t id, Mutex& mutex, SFU& sfu, VPM& vpm, Semaphores& semaphores, Memory& memory,
-                MemoryAddress uniformAddress, InstrumentationResults& instrumentation) :
+                MemoryAddress uniformAddress, InstrumentationResults& instrumentation, const TimingModel& timing,
+                CacheModel& caches, EmulationTrace* trace = nullptr) :
                 ID(id),
-                mutex(mutex), registers(*this), uniforms(*this, memory, uniformAddress), tmus(*this, memory), sfu(sfu),
-                vpm(vpm), semaphores(semaphores), currentCycle(0), pc(0), instrumentation(instrumentation)
+                mutex(mutex), registers(*this), uniforms(*this, memory, uniformAddress), tmus(*this, memory, caches),
+                sfu(sfu),
+                vpm(vpm), semaphores(semaphores), currentCycle(0), pc(0), instrumentation(instrumentation),
+                timing(timing), stallCause(StallCause::TMU), repeatableStall(false), trace(trace)
             {
             }
 
             const uint8_t ID;
 
             uint32_t getCurrentCycle() const;
+            ProgramCounter getProgramCounter() const;
             std::pair<SIMDVector, bool> readR4();
 
-            NODISCARD bool execute(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction);
+            NODISCARD bool execute(const DecodedProgram& program);
+            /*
+             * Returns the first cycle the instruction stalled in the last cycle can continue, assuming no other QPU
+             * executes anything in the meantime. This is the current cycle if the last instruction did not stall (or
+             * cannot be repeated without side-effects) and the maximum value for stalls on the mutex or a semaphore,
+             * which only another QPU can release.
+             */
+            uint32_t getStallEndCycle() const;
+            /*
+             * Repeats the stall of the last cycle for the given number of cycles without executing the instruction
+             */
+            void skipStalledCycles(uint32_t numCycles);
 
-            const qpu_asm::Instruction* getCurrentInstruction(
-                std::vector<qpu_asm::Instruction>::const_iterator firstInstruction) const;
+            const qpu_asm::Instruction* getCurrentInstruction(const DecodedProgram& program) const;
 
         private:
             Mutex& mutex;
@@ -267,31 +526,83 @@ namespace vc4c
             std::array<ElementFlags, vc4c::NATIVE_VECTOR_SIZE> flags;
             ProgramCounter pc;
             InstrumentationResults& instrumentation;
-
+            const TimingModel& timing;
+            // the cause of the last stall reported by the periphery
+            StallCause stallCause;
+            // whether the last instruction stalled and can be repeated without side-effects
+            bool repeatableStall;
+            EmulationTrace* trace;
+
+            friend class Checkpoint;
             friend class Registers;
             friend class UniformCache;
             friend class TMUs;
             friend class SFU;
             friend class VPM;
-
-            NODISCARD bool executeALU(const qpu_asm::ALUInstruction* aluInst);
+            friend DecodedProgram decodeProgram(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
+                std::vector<qpu_asm::Instruction>::const_iterator lastInstruction);
+
+            NODISCARD bool executeALU(const DecodedInstruction& inst, ProgramCounter& nextPC);
+            NODISCARD bool executeBranch(const DecodedInstruction& inst, ProgramCounter& nextPC);
+            NODISCARD bool executeLoad(const DecodedInstruction& inst, ProgramCounter& nextPC);
+            NODISCARD bool executeSemaphore(const DecodedInstruction& inst, ProgramCounter& nextPC);
+            NODISCARD bool executeUnsupported(const DecodedInstruction& inst, ProgramCounter& nextPC);
+            NODISCARD std::pair<SIMDVector, bool> readInput(const DecodedInstruction& inst, uint8_t index);
             void writeConditional(Register dest, const SIMDVector& in, ConditionCode cond,
-                const qpu_asm::ALUInstruction* addInst = nullptr, const qpu_asm::ALUInstruction* mulInst = nullptr);
+                unsigned* executedCounter = nullptr, unsigned* skippedCounter = nullptr);
             bool isConditionMet(BranchCond cond) const;
             NODISCARD bool executeSignal(Signaling signal);
             void setFlags(const SIMDVector& output, ConditionCode cond, const VectorFlags& newFlags);
+            void countStall(StallCause cause, uint32_t numCycles = 1);
         };
 
         std::vector<MemoryAddress> buildUniforms(Memory& memory, MemoryAddress baseAddress,
             const std::vector<MemoryAddress>& parameter, const WorkGroupConfig& config, MemoryAddress globalData,
-            const KernelUniforms& uniformsUsed);
-        bool emulate(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction, Memory& memory,
-            const std::vector<MemoryAddress>& uniformAddresses, InstrumentationResults& instrumentation,
-            uint32_t maxCycles = std::numeric_limits<uint32_t>::max());
-        bool emulateTask(std::vector<qpu_asm::Instruction>::const_iterator firstInstruction,
-            const std::vector<MemoryAddress>& parameter, Memory& memory, MemoryAddress uniformBaseAddress,
-            MemoryAddress globalData, const KernelUniforms& uniformsUsed, InstrumentationResults& instrumentation,
-            uint32_t maxCycles = std::numeric_limits<uint32_t>::max());
+            const KernelUniforms& uniformsUsed, const Optional<std::array<Word, 3>>& groupIDs = {});
+
+        /*
+         * Controls the start and the end of a single emulation, e.g. to replay only a part of the emulation
+         */
+        struct EmulationControl
+        {
+            /*
+             * The checkpoint to restore the emulation state from before starting the emulation, the emulation then
+             * continues at the cycle of the checkpoint
+             */
+            const Checkpoint* restore = nullptr;
+            /*
+             * Stops the emulation before emulating the given cycle or before any QPU executes the instruction with
+             * the given index (not checked for the first emulated cycle to be able to continue a stopped emulation)
+             */
+            uint32_t stopCycle = std::numeric_limits<uint32_t>::max();
+            Optional<ProgramCounter> stopInstruction;
+            /*
+             * Whether to take a checkpoint of the emulation state when the emulation is stopped
+             */
+            bool checkpointOnStop = false;
+            /*
+             * Whether to skip the cycles all QPUs are stalled for at once instead of emulating them one by one
+             */
+            bool skipStalledCycles = true;
+
+            /*
+             * Whether the emulation was stopped before finishing and the checkpoint taken when stopping
+             */
+            bool stopped = false;
+            std::unique_ptr<Checkpoint> checkpoint;
+
+            EmulationControl();
+            ~EmulationControl();
+        };
+
+        bool emulate(const DecodedProgram& program, Memory& memory, const std::vector<MemoryAddress>& uniformAddresses,
+            InstrumentationResults& instrumentation, uint32_t maxCycles = std::numeric_limits<uint32_t>::max(),
+            const TimingModel& timing = TimingModel{}, CacheModel* caches = nullptr, EmulationTrace* trace = nullptr,
+            uint32_t* numCycles = nullptr, EmulationControl* control = nullptr);
+        bool emulateTask(const DecodedProgram& program, const std::vector<MemoryAddress>& parameter, Memory& memory,
+            MemoryAddress uniformBaseAddress, MemoryAddress globalData, const KernelUniforms& uniformsUsed,
+            InstrumentationResults& instrumentation, uint32_t maxCycles = std::numeric_limits<uint32_t>::max(),
+            const TimingModel& timing = TimingModel{});
     } // namespace tools
 } // namespace vc4c
 
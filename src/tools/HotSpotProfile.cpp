@@ -0,0 +1,286 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "HotSpotProfile.h"
+
+#include "../asm/BranchInstruction.h"
+
+#include "log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+static std::string toPercent(uint64_t part, uint64_t whole)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << (whole == 0 ? 0.0 : static_cast<double>(part) * 100.0 / static_cast<double>(whole)) << '%';
+    return ss.str();
+}
+
+static uint64_t getALUUtilization(const InstrumentationResult& result)
+{
+    return static_cast<uint64_t>(result.numAddALUExecuted) + static_cast<uint64_t>(result.numMulALUExecuted);
+}
+
+static std::string toStallsString(const InstrumentationResult& result)
+{
+    std::vector<std::string> causes;
+    if(result.numTMUStalls > 0)
+        causes.emplace_back("tmu " + std::to_string(result.numTMUStalls));
+    if(result.numDMALoadStalls > 0)
+        causes.emplace_back("dma-load " + std::to_string(result.numDMALoadStalls));
+    if(result.numDMAStoreStalls > 0)
+        causes.emplace_back("dma-store " + std::to_string(result.numDMAStoreStalls));
+    if(result.numVPMStalls > 0)
+        causes.emplace_back("vpm " + std::to_string(result.numVPMStalls));
+    if(result.numMutexStalls > 0)
+        causes.emplace_back("mutex " + std::to_string(result.numMutexStalls));
+    if(result.numSemaphoreStalls > 0)
+        causes.emplace_back("semaphore " + std::to_string(result.numSemaphoreStalls));
+    return vc4c::to_string<std::string>(causes);
+}
+
+HotSpotProfile::HotSpotProfile(const std::string& kernelName, std::vector<qpu_asm::DecoratedInstruction>&& instructions,
+    const std::vector<InstrumentationResult>& instrumentation) :
+    kernelName(kernelName),
+    instructions(std::move(instructions)), instrumentation(instrumentation), total{}
+{
+    // the instrumentation results are cut off after the end of the program
+    if(this->instructions.size() > this->instrumentation.size())
+        this->instructions.erase(this->instructions.begin() +
+                static_cast<std::vector<qpu_asm::DecoratedInstruction>::difference_type>(this->instrumentation.size()),
+            this->instructions.end());
+    this->instrumentation.resize(this->instructions.size());
+
+    // if the instructions are decorated with the label comments of the compiler, use its basic blocks. Otherwise
+    // reconstruct the basic blocks from the branch instructions
+    const bool hasLabels = std::any_of(this->instructions.begin(), this->instructions.end(),
+        [](const qpu_asm::DecoratedInstruction& instr) -> bool { return !instr.previousComment.empty(); });
+    std::vector<bool> isBlockStart(this->instructions.size(), false);
+    for(std::size_t i = 0; i < this->instructions.size(); ++i)
+    {
+        if(hasLabels)
+        {
+            if(!this->instructions[i].previousComment.empty())
+                isBlockStart[i] = true;
+        }
+        else if(auto branch = this->instructions[i].instruction.as<qpu_asm::BranchInstruction>())
+        {
+            // the branch takes effect after its 3 delay slots and is relative to the instruction following them
+            auto target = static_cast<int64_t>(i) + 4 +
+                static_cast<int64_t>(branch->getImmediate() / static_cast<int32_t>(sizeof(uint64_t)));
+            if(target >= 0 && static_cast<std::size_t>(target) < isBlockStart.size())
+                isBlockStart[static_cast<std::size_t>(target)] = true;
+            if(i + 4 < isBlockStart.size())
+                isBlockStart[i + 4] = true;
+        }
+    }
+
+    for(std::size_t i = 0; i < this->instructions.size(); ++i)
+    {
+        if(i == 0 || isBlockStart[i])
+        {
+            const auto& label = this->instructions[i].previousComment;
+            blocks.emplace_back(BlockProfile{
+                label.empty() ? "block at instruction " + std::to_string(i) : label, i, i, InstrumentationResult{}});
+        }
+        blocks.back().endInstruction = i + 1;
+        blocks.back().total += this->instrumentation[i];
+        total += this->instrumentation[i];
+    }
+}
+
+void HotSpotProfile::writeReport(std::ostream& out, std::size_t maxInstructions) const
+{
+    const uint64_t numCycles = total.numExecutions;
+    out << "Hot-spot profile of kernel '" << kernelName << "'" << std::endl;
+    out << "QPU cycles: " << numCycles << " (" << (numCycles - total.numStalls) << " issued, " << total.numStalls
+        << " stalled)" << std::endl;
+    out << "ALU utilization: " << toPercent(getALUUtilization(total), 2 * numCycles) << " (add "
+        << toPercent(total.numAddALUExecuted, numCycles) << ", mul " << toPercent(total.numMulALUExecuted, numCycles)
+        << ")" << std::endl;
+    if(total.numStalls > 0)
+        out << "Stalls: " << toStallsString(total) << std::endl;
+    out << "TMU cache: " << total.cacheStatistics.to_string() << std::endl;
+
+    std::vector<std::size_t> blockIndices(blocks.size());
+    std::iota(blockIndices.begin(), blockIndices.end(), 0);
+    std::stable_sort(blockIndices.begin(), blockIndices.end(), [this](std::size_t a, std::size_t b) -> bool {
+        return blocks[a].total.numExecutions > blocks[b].total.numExecutions;
+    });
+    out << std::endl << "Basic blocks by cycles:" << std::endl;
+    out << std::right << std::setw(12) << "cycles" << std::setw(8) << "share" << std::setw(12) << "stalls"
+        << std::setw(8) << "ALU" << "  block" << std::endl;
+    for(auto index : blockIndices)
+    {
+        const auto& block = blocks[index];
+        if(block.total.numExecutions == 0)
+            break;
+        out << std::right << std::setw(12) << block.total.numExecutions << std::setw(8)
+            << toPercent(block.total.numExecutions, numCycles) << std::setw(12) << block.total.numStalls
+            << std::setw(8) << toPercent(getALUUtilization(block.total), 2 * block.total.numExecutions) << "  "
+            << block.name << " [" << block.firstInstruction << ", " << block.endInstruction << ")";
+        if(block.total.numStalls > 0)
+            out << " (stalls: " << toStallsString(block.total) << ")";
+        out << std::endl;
+    }
+
+    std::vector<std::size_t> instructionIndices(instructions.size());
+    std::iota(instructionIndices.begin(), instructionIndices.end(), 0);
+    std::stable_sort(
+        instructionIndices.begin(), instructionIndices.end(), [this](std::size_t a, std::size_t b) -> bool {
+            return instrumentation[a].numExecutions > instrumentation[b].numExecutions;
+        });
+    if(instructionIndices.size() > maxInstructions)
+        instructionIndices.resize(maxInstructions);
+    out << std::endl << "Instructions by cycles:" << std::endl;
+    out << std::right << std::setw(12) << "cycles" << std::setw(8) << "share" << std::setw(8) << "index"
+        << "  instruction" << std::endl;
+    for(auto index : instructionIndices)
+    {
+        const auto& result = instrumentation[index];
+        if(result.numExecutions == 0)
+            break;
+        out << std::right << std::setw(12) << result.numExecutions << std::setw(8)
+            << toPercent(result.numExecutions, numCycles) << std::setw(8) << index << "  " << std::left
+            << std::setw(80) << instructions[index].instruction.toASMString() << "// " << result.to_string()
+            << std::endl;
+    }
+
+    out << std::endl << "Annotated disassembly:" << std::endl;
+    auto blockIt = blocks.begin();
+    for(std::size_t i = 0; i < instructions.size(); ++i)
+    {
+        if(blockIt != blocks.end() && blockIt->firstInstruction == i)
+        {
+            out << "// " << blockIt->name << " (" << blockIt->total.numExecutions << " cycles, "
+                << toPercent(blockIt->total.numExecutions, numCycles) << ")" << std::endl;
+            ++blockIt;
+        }
+        const auto& instr = instructions[i];
+        auto asmString = instr.instruction.toASMString();
+        if(!instr.comment.empty())
+            asmString.append(" // ").append(instr.comment);
+        out << std::right << std::setw(12) << instrumentation[i].numExecutions << std::setw(8)
+            << toPercent(instrumentation[i].numExecutions, numCycles) << "  " << std::left << std::setw(80)
+            << asmString << "// " << instrumentation[i].to_string() << std::endl;
+    }
+}
+
+void HotSpotProfile::writeCallgrind(std::ostream& out) const
+{
+    out << "# callgrind format" << std::endl;
+    out << "version: 1" << std::endl;
+    out << "creator: VC4C emulator" << std::endl;
+    out << "cmd: " << kernelName << std::endl;
+    out << "positions: line" << std::endl;
+    out << "event: Cycles : QPU cycles" << std::endl;
+    out << "event: Stalls : Stalled cycles" << std::endl;
+    out << "event: AddALU : Add ALU operations executed" << std::endl;
+    out << "event: MulALU : Mul ALU operations executed" << std::endl;
+    out << "event: Branches : Branches taken" << std::endl;
+    out << "event: TMUMisses : TMU cache misses" << std::endl;
+    out << "events: Cycles Stalls AddALU MulALU Branches TMUMisses" << std::endl;
+    out << "summary: " << total.numExecutions << " " << total.numStalls << " " << total.numAddALUExecuted << " "
+        << total.numMulALUExecuted << " " << total.numBranchTaken << " " << total.cacheStatistics.numTMUCacheMisses
+        << std::endl;
+    out << std::endl << "fl=" << kernelName << std::endl;
+    for(const auto& block : blocks)
+    {
+        out << "fn=" << block.name << std::endl;
+        for(std::size_t i = block.firstInstruction; i < block.endInstruction; ++i)
+        {
+            const auto& result = instrumentation[i];
+            if(result.numExecutions == 0)
+                continue;
+            out << (i + 1) << " " << result.numExecutions << " " << result.numStalls << " " << result.numAddALUExecuted
+                << " " << result.numMulALUExecuted << " " << result.numBranchTaken << " "
+                << result.cacheStatistics.numTMUCacheMisses << std::endl;
+        }
+    }
+}
+
+/*
+ * Parses a line of the hexadecimal output of the form "0x01234567, 0x89abcdef, <rest>" with the lower half of the
+ * 64-bit word first.
+ */
+static bool parseHexLine(const std::string& line, uint64_t& binaryCode, std::string& rest)
+{
+    if(line.compare(0, 2, "0x") != 0)
+        return false;
+    char* end = nullptr;
+    auto lower = std::strtoull(line.c_str(), &end, 16);
+    if(end == nullptr || end[0] != ',' || end[1] != ' ')
+        return false;
+    auto upper = std::strtoull(end + 2, &end, 16);
+    if(end == nullptr || end[0] != ',')
+        return false;
+    binaryCode = (static_cast<uint64_t>(upper) << 32) | (static_cast<uint64_t>(lower) & 0xFFFFFFFFULL);
+    rest = std::string(end[1] == ' ' ? end + 2 : end + 1);
+    return true;
+}
+
+std::vector<qpu_asm::DecoratedInstruction> tools::decorateInstructions(
+    const std::vector<qpu_asm::Instruction>& instructions, std::istream* compilerOutput)
+{
+    std::vector<qpu_asm::DecoratedInstruction> plainInstructions(instructions.begin(), instructions.end());
+    if(compilerOutput == nullptr)
+        return plainInstructions;
+
+    std::vector<qpu_asm::DecoratedInstruction> decoratedInstructions;
+    decoratedInstructions.reserve(instructions.size());
+    std::string pendingComment;
+    std::string line;
+    while(std::getline(*compilerOutput, line))
+    {
+        if(line.compare(0, 2, "//") == 0)
+        {
+            // the comments preceding an instruction, e.g. the basic block label
+            auto commentStart = line.find_first_not_of("/ ");
+            if(commentStart == std::string::npos)
+                continue;
+            auto comment = line.substr(commentStart);
+            pendingComment = pendingComment.empty() ? comment : pendingComment + ", " + comment;
+            continue;
+        }
+        uint64_t binaryCode = 0;
+        std::string assembler;
+        if(!parseHexLine(line, binaryCode, assembler) || assembler.compare(0, 2, "//") != 0)
+        {
+            // module header, kernel info or global data, the comments do not belong to any instruction
+            pendingComment.clear();
+            continue;
+        }
+        if(decoratedInstructions.size() >= instructions.size() ||
+            instructions[decoratedInstructions.size()].toBinaryCode() != binaryCode)
+        {
+            logging::warn() << "Compiler output does not match the emulated module, ignoring its decorations"
+                            << logging::endl;
+            return plainInstructions;
+        }
+        qpu_asm::DecoratedInstruction instr(instructions[decoratedInstructions.size()]);
+        auto commentPos = assembler.find(" // ");
+        if(commentPos != std::string::npos)
+            instr.comment = assembler.substr(commentPos + 4);
+        instr.previousComment = std::move(pendingComment);
+        pendingComment.clear();
+        decoratedInstructions.emplace_back(std::move(instr));
+    }
+    if(decoratedInstructions.size() != instructions.size())
+    {
+        logging::warn() << "Compiler output does not match the emulated module, ignoring its decorations"
+                        << logging::endl;
+        return plainInstructions;
+    }
+    return decoratedInstructions;
+}
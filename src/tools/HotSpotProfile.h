@@ -0,0 +1,89 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_TOOLS_HOT_SPOT_PROFILE_H
+#define VC4C_TOOLS_HOT_SPOT_PROFILE_H
+
+#include "../asm/Instruction.h"
+#include "tools.h"
+
+#include <iostream>
+#include <vector>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * The accumulated instrumentation results of a basic block of the emulated program
+         */
+        struct BlockProfile
+        {
+            /*
+             * The name of the block, the label comment of the compiler or the position of the block
+             */
+            std::string name;
+            /*
+             * The index of the first instruction of the block and the index after the last instruction of the block
+             */
+            std::size_t firstInstruction;
+            std::size_t endInstruction;
+            /*
+             * The sum of the instrumentation results of all instructions of the block
+             */
+            InstrumentationResult total;
+        };
+
+        /*
+         * Hot-spot profile of an emulated kernel, joining the instrumentation results with the disassembled
+         * instructions and their decorations.
+         *
+         * Since the instrumentation counts an execution for every cycle the instruction is issued or stalled, the
+         * number of executions of an instruction are the QPU cycles spent on it (summed over all QPUs).
+         */
+        class HotSpotProfile
+        {
+        public:
+            HotSpotProfile(const std::string& kernelName, std::vector<qpu_asm::DecoratedInstruction>&& instructions,
+                const std::vector<InstrumentationResult>& instrumentation);
+
+            /*
+             * Writes the hot-spot report into the given stream.
+             *
+             * The report contains the totals (cycles, ALU utilization, stall breakdown), the basic blocks and the
+             * given maximum number of instructions sorted by the cycles spent and the complete annotated disassembly.
+             */
+            void writeReport(std::ostream& out, std::size_t maxInstructions = 32) const;
+
+            /*
+             * Writes the profile in the callgrind format (e.g. for KCachegrind).
+             *
+             * The basic blocks are written as functions of the kernel, the instructions as their lines with the line
+             * number being the index of the instruction plus one.
+             */
+            void writeCallgrind(std::ostream& out) const;
+
+        private:
+            std::string kernelName;
+            std::vector<qpu_asm::DecoratedInstruction> instructions;
+            std::vector<InstrumentationResult> instrumentation;
+            std::vector<BlockProfile> blocks;
+            InstrumentationResult total;
+        };
+
+        /*
+         * Decorates the given instructions of a whole module with the comments of the hexadecimal compiler output
+         * (with assembler code) for the same module, e.g. the basic block labels.
+         *
+         * If the compiler output is not given or does not match the instructions, the undecorated instructions are
+         * returned and the basic blocks are reconstructed from the branches by the HotSpotProfile.
+         */
+        std::vector<qpu_asm::DecoratedInstruction> decorateInstructions(
+            const std::vector<qpu_asm::Instruction>& instructions, std::istream* compilerOutput);
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_TOOLS_HOT_SPOT_PROFILE_H */
@@ -0,0 +1,25 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "JSON.h"
+
+using namespace vc4c;
+
+std::string tools::escapeJSON(const std::string& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for(char c : text)
+    {
+        if(c == '"' || c == '\\')
+            result.push_back('\\');
+        if(static_cast<unsigned char>(c) < 0x20)
+            result.push_back(' ');
+        else
+            result.push_back(c);
+    }
+    return result;
+}
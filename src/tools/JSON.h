@@ -0,0 +1,26 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_TOOLS_JSON_H
+#define VC4C_TOOLS_JSON_H
+
+#include <string>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * Escapes the given text to be written as the content of a JSON string.
+         *
+         * Quotes and backslashes are escaped, all other control characters (e.g. line breaks) are replaced with
+         * spaces.
+         */
+        std::string escapeJSON(const std::string& text);
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_TOOLS_JSON_H */
@@ -0,0 +1,515 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#include "VectorizedALU.h"
+
+#include "CompilationError.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace vc4c;
+using namespace vc4c::tools;
+
+using Words = std::array<uint32_t, NATIVE_VECTOR_SIZE>;
+using Statuses = std::array<FlagStatus, NATIVE_VECTOR_SIZE>;
+
+static bool toWords(const SIMDVector& vector, Words& words)
+{
+    bool anyUndefined = false;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        anyUndefined |= vector[i].isUndefined();
+        words[i] = vector[i].unsignedInt();
+    }
+    return !anyUndefined;
+}
+
+static float toFloat(uint32_t word) noexcept
+{
+    return bit_cast<uint32_t, float>(word);
+}
+
+static uint32_t fromFloat(float val) noexcept
+{
+    return bit_cast<float, uint32_t>(val);
+}
+
+static FlagStatus toStatus(bool isSet) noexcept
+{
+    return isSet ? FlagStatus::SET : FlagStatus::CLEAR;
+}
+
+/*
+ * Runs the given element-wise calculation for all 16 elements.
+ *
+ * The calculation takes both input words and writes the result word as well as the carry and overflow flags. Since
+ * it is in-lined into the loop over plain arrays, the compiler can vectorize the whole loop.
+ */
+template <typename Func>
+static PrecalculatedVector calculate(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand, Func&& func)
+{
+    Words first{};
+    Words second{};
+    if(!toWords(firstOperand, first) || (code.numOperands > 1 && !toWords(secondOperand, second)))
+        // let the generic implementation handle undefined values
+        return code(firstOperand, secondOperand);
+
+    Words result{};
+    Statuses carry{};
+    Statuses overflow{};
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        func(first[i], second[i], result[i], carry[i], overflow[i]);
+
+    SIMDVector res;
+    VectorFlags flags;
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        res[i] = code.returnsFloat ? Literal(toFloat(result[i])) : Literal(result[i]);
+        // for both unsigned and float, the MSB is the sign and for all types zero is all bits zero
+        flags[i].negative = toStatus(static_cast<int32_t>(result[i]) < 0);
+        flags[i].zero = toStatus(result[i] == 0);
+        flags[i].carry = carry[i];
+        flags[i].overflow = overflow[i];
+    }
+    return std::make_pair(res, flags);
+}
+
+static PrecalculatedVector calcAdd(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = a + b;
+            carry = toStatus(out < a);
+            overflow = toStatus(((a ^ out) & (b ^ out)) >> 31);
+        });
+}
+
+static PrecalculatedVector calcSub(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = a - b;
+            // the carry flag is set for negative signed results, see OpCode::operator()
+            carry = toStatus(
+                static_cast<int64_t>(static_cast<int32_t>(a)) - static_cast<int64_t>(static_cast<int32_t>(b)) < 0);
+            overflow = toStatus(((a ^ b) & (a ^ out)) >> 31);
+        });
+}
+
+static PrecalculatedVector calcAnd(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = a & b;
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcOr(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = a | b;
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcXor(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = a ^ b;
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcNot(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t /* b */, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = ~a;
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcShl(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            // Tests have shown that on VC4 all shifts (asr, shr, shl) only take the last 5 bits of the offset
+            auto offset = b & 0x1F;
+            out = a << offset;
+            carry = toStatus(((static_cast<uint64_t>(a) << offset) >> 32) != 0);
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcShr(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto offset = b & 0x1F;
+            out = a >> offset;
+            // carry is set if bits set are shifted out of the register
+            carry = toStatus((a & ((1u << offset) - 1u)) != 0);
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcAsr(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    if(std::any_of(secondOperand.begin(), secondOperand.end(), [](Literal lit) -> bool { return lit.signedInt() < 0; }))
+        // let the generic implementation handle (throw for) negative offsets
+        return code(firstOperand, secondOperand);
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto offset = b & 0x1F;
+            out = static_cast<uint32_t>(static_cast<int32_t>(a) >> offset);
+            carry = toStatus((a & ((1u << offset) - 1u)) != 0);
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcRor(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto offset = b & 0x1F;
+            out = offset == 0 ? a : ((a >> offset) | (a << (32 - offset)));
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcMin(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto signedA = static_cast<int32_t>(a);
+            auto signedB = static_cast<int32_t>(b);
+            out = static_cast<uint32_t>(std::min(signedA, signedB));
+            carry = toStatus(signedA > signedB);
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcMax(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto signedA = static_cast<int32_t>(a);
+            auto signedB = static_cast<int32_t>(b);
+            out = static_cast<uint32_t>(std::max(signedA, signedB));
+            carry = toStatus(signedA > signedB);
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcClz(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t /* b */, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            // Tests show that VC4 returns 32 for clz(0)
+            uint32_t count = 0;
+            for(uint32_t mask = 0x80000000u; mask != 0 && (a & mask) == 0; mask >>= 1)
+                ++count;
+            out = count;
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcMul24(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto extendedVal = static_cast<uint64_t>(a & 0xFFFFFFu) * static_cast<uint64_t>(b & 0xFFFFFFu);
+            out = (a & 0xFFFFFFu) * (b & 0xFFFFFFu);
+            carry = toStatus(extendedVal > static_cast<uint64_t>(0xFFFFFFFFul));
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+/*
+ * Runs the given calculation for each of the 4 bytes in every element
+ */
+template <typename Func>
+static PrecalculatedVector calculateBytes(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand, Func&& func)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [&func](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = 0;
+            for(uint32_t shift = 0; shift < 32; shift += 8)
+                out |= (func((a >> shift) & 0xFF, (b >> shift) & 0xFF) & 0xFF) << shift;
+            carry = FlagStatus::UNDEFINED;
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcV8Adds(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculateBytes(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b) -> uint32_t { return std::min(a + b, 255u); });
+}
+
+static PrecalculatedVector calcV8Subs(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculateBytes(code, firstOperand, secondOperand, [](uint32_t a, uint32_t b) -> uint32_t {
+        return static_cast<uint32_t>(std::max(std::min(static_cast<int32_t>(a - b), 255), 0));
+    });
+}
+
+static PrecalculatedVector calcV8Min(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculateBytes(
+        code, firstOperand, secondOperand, [](uint32_t a, uint32_t b) -> uint32_t { return std::min(a, b); });
+}
+
+static PrecalculatedVector calcV8Max(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculateBytes(
+        code, firstOperand, secondOperand, [](uint32_t a, uint32_t b) -> uint32_t { return std::max(a, b); });
+}
+
+static PrecalculatedVector calcV8Muld(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculateBytes(
+        code, firstOperand, secondOperand, [](uint32_t a, uint32_t b) -> uint32_t { return (a * b + 127) / 255; });
+}
+
+static PrecalculatedVector calcFadd(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto result = toFloat(a) + toFloat(b);
+            out = fromFloat(result);
+            carry = toStatus(result > 0.0f);
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcFsub(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto result = toFloat(a) - toFloat(b);
+            out = fromFloat(result);
+            carry = toStatus(result > 0.0f);
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcFmul(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(toFloat(a) * toFloat(b));
+            carry = FlagStatus::UNDEFINED;
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcItof(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t /* b */, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(static_cast<float>(static_cast<int32_t>(a)));
+            carry = FlagStatus::CLEAR;
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+static PrecalculatedVector calcFtoi(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t /* b */, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            auto val = toFloat(a);
+            if(std::isnan(val) || std::isinf(val) ||
+                std::abs(static_cast<int64_t>(val)) > std::numeric_limits<int32_t>::max())
+            {
+                out = 0;
+                carry = FlagStatus::UNDEFINED;
+            }
+            else
+            {
+                out = static_cast<uint32_t>(static_cast<int32_t>(val));
+                carry = FlagStatus::CLEAR;
+            }
+            overflow = FlagStatus::UNDEFINED;
+        });
+}
+
+/*
+ * Whether any element of the given vector is NaN (or infinite, if set)
+ */
+static bool hasSpecialFloat(const SIMDVector& vector, bool checkInfinity)
+{
+    return std::any_of(vector.begin(), vector.end(), [&](Literal lit) -> bool {
+        return std::isnan(lit.real()) || (checkInfinity && std::isinf(lit.real()));
+    });
+}
+
+static PrecalculatedVector calcFmin(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    if(hasSpecialFloat(firstOperand, false) || hasSpecialFloat(secondOperand, false))
+        // let the generic implementation handle the special NaN semantics
+        return code(firstOperand, secondOperand);
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(std::min(toFloat(a), toFloat(b)));
+            carry = toStatus(toFloat(a) > toFloat(b));
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcFmax(const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    if(hasSpecialFloat(firstOperand, false) || hasSpecialFloat(secondOperand, false))
+        // let the generic implementation handle the special NaN semantics
+        return code(firstOperand, secondOperand);
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(std::max(toFloat(a), toFloat(b)));
+            carry = toStatus(toFloat(a) > toFloat(b));
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcFminabs(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    if(hasSpecialFloat(firstOperand, false) || hasSpecialFloat(secondOperand, false))
+        // let the generic implementation handle the special NaN semantics
+        return code(firstOperand, secondOperand);
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(std::min(std::fabs(toFloat(a)), std::fabs(toFloat(b))));
+            carry = toStatus(std::fabs(toFloat(a)) > std::fabs(toFloat(b)));
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+static PrecalculatedVector calcFmaxabs(
+    const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand)
+{
+    if(hasSpecialFloat(firstOperand, true) || hasSpecialFloat(secondOperand, true))
+        // let the generic implementation handle the special NaN and infinity semantics
+        return code(firstOperand, secondOperand);
+    return calculate(code, firstOperand, secondOperand,
+        [](uint32_t a, uint32_t b, uint32_t& out, FlagStatus& carry, FlagStatus& overflow) {
+            out = fromFloat(std::max(std::fabs(toFloat(a)), std::fabs(toFloat(b))));
+            carry = toStatus(std::fabs(toFloat(a)) > std::fabs(toFloat(b)));
+            overflow = FlagStatus::CLEAR;
+        });
+}
+
+VectorizedOperation tools::getVectorizedOperation(const OpCode& code)
+{
+    if(code == OP_ADD)
+        return calcAdd;
+    if(code == OP_SUB)
+        return calcSub;
+    if(code == OP_AND)
+        return calcAnd;
+    if(code == OP_OR)
+        return calcOr;
+    if(code == OP_XOR)
+        return calcXor;
+    if(code == OP_NOT)
+        return calcNot;
+    if(code == OP_SHL)
+        return calcShl;
+    if(code == OP_SHR)
+        return calcShr;
+    if(code == OP_ASR)
+        return calcAsr;
+    if(code == OP_ROR)
+        return calcRor;
+    if(code == OP_MIN)
+        return calcMin;
+    if(code == OP_MAX)
+        return calcMax;
+    if(code == OP_CLZ)
+        return calcClz;
+    if(code == OP_MUL24)
+        return calcMul24;
+    if(code == OP_V8ADDS)
+        return calcV8Adds;
+    if(code == OP_V8SUBS)
+        return calcV8Subs;
+    if(code == OP_V8MIN)
+        return calcV8Min;
+    if(code == OP_V8MAX)
+        return calcV8Max;
+    if(code == OP_V8MULD)
+        return calcV8Muld;
+    if(code == OP_FADD)
+        return calcFadd;
+    if(code == OP_FSUB)
+        return calcFsub;
+    if(code == OP_FMUL)
+        return calcFmul;
+    if(code == OP_ITOF)
+        return calcItof;
+    if(code == OP_FTOI)
+        return calcFtoi;
+    if(code == OP_FMIN)
+        return calcFmin;
+    if(code == OP_FMAX)
+        return calcFmax;
+    if(code == OP_FMINABS)
+        return calcFminabs;
+    if(code == OP_FMAXABS)
+        return calcFmaxabs;
+    return nullptr;
+}
+
+std::pair<std::bitset<NATIVE_VECTOR_SIZE>, std::bitset<NATIVE_VECTOR_SIZE>> tools::evaluateCondition(
+    const std::array<ElementFlags, NATIVE_VECTOR_SIZE>& flags, ConditionCode cond)
+{
+    std::bitset<NATIVE_VECTOR_SIZE> matches{};
+    std::bitset<NATIVE_VECTOR_SIZE> undefined{};
+    if(cond == COND_ALWAYS)
+        return std::make_pair(matches.set(), undefined);
+    if(cond == COND_NEVER)
+        return std::make_pair(matches, undefined);
+
+    // select the flag and the status to check once for all elements
+    FlagStatus ElementFlags::*flag = nullptr;
+    if(cond == COND_CARRY_CLEAR || cond == COND_CARRY_SET)
+        flag = &ElementFlags::carry;
+    else if(cond == COND_NEGATIVE_CLEAR || cond == COND_NEGATIVE_SET)
+        flag = &ElementFlags::negative;
+    else if(cond == COND_ZERO_CLEAR || cond == COND_ZERO_SET)
+        flag = &ElementFlags::zero;
+    else
+        throw CompilationError(CompilationStep::GENERAL, "Unhandled condition code", cond.to_string());
+    const FlagStatus expected =
+        (cond == COND_CARRY_SET || cond == COND_NEGATIVE_SET || cond == COND_ZERO_SET) ? FlagStatus::SET :
+                                                                                         FlagStatus::CLEAR;
+
+    for(uint8_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+    {
+        auto status = flags[i].*flag;
+        matches.set(i, status == expected);
+        undefined.set(i, status == FlagStatus::UNDEFINED);
+    }
+    return std::make_pair(matches, undefined);
+}
@@ -0,0 +1,48 @@
+/*
+ * Author: doe300
+ *
+ * See the file "LICENSE" for the full license governing this code.
+ */
+
+#ifndef VC4C_TOOLS_VECTORIZED_ALU_H
+#define VC4C_TOOLS_VECTORIZED_ALU_H
+
+#include "../Values.h"
+#include "../asm/OpCodes.h"
+
+#include <bitset>
+
+namespace vc4c
+{
+    namespace tools
+    {
+        /*
+         * An ALU operation calculating all 16 elements of a QPU register at once
+         */
+        using VectorizedOperation = PrecalculatedVector (*)(
+            const OpCode& code, const SIMDVector& firstOperand, const SIMDVector& secondOperand);
+
+        /*
+         * Returns the vectorized implementation of the given op-code, or nullptr if there is none.
+         *
+         * The vectorized implementations operate on the plain 32-bit words of all 16 elements in branch-free loops,
+         * which the host compiler can map to the host's SIMD instructions (e.g. SSE/AVX on x86 or NEON on ARM).
+         * The results (values and flags) are bit-exact to the generic element-wise calculation of OpCode#operator().
+         *
+         * NOTE: For inputs not handled by the vectorized implementation (e.g. undefined elements or NaN operands for
+         * the floating-point minimum/maximum), the generic implementation is used.
+         */
+        VectorizedOperation getVectorizedOperation(const OpCode& code);
+
+        /*
+         * Evaluates the given condition for all elements of the given flags.
+         *
+         * Returns the mask of the elements matching the condition and the mask of the elements whose flags required
+         * to evaluate the condition are undefined.
+         */
+        std::pair<std::bitset<NATIVE_VECTOR_SIZE>, std::bitset<NATIVE_VECTOR_SIZE>> evaluateCondition(
+            const std::array<ElementFlags, NATIVE_VECTOR_SIZE>& flags, ConditionCode cond);
+    } // namespace tools
+} // namespace vc4c
+
+#endif /* VC4C_TOOLS_VECTORIZED_ALU_H */
@@ -187,6 +187,23 @@ bool tools::parseConfigurationParameter(Configuration& config, const std::string
                 config.additionalOptions.maxOptimizationIterations = static_cast<unsigned>(intValue);
             else if(paramName == "common-subexpression-threshold")
                 config.additionalOptions.maxCommonExpressionDinstance = static_cast<unsigned>(intValue);
+            else if(paramName == "combine-window")
+            {
+                // the optimal pairing is searched exhaustively, which is only feasible for small windows
+                if(intValue < 0 || intValue > 16)
+                {
+                    std::cerr << "Window size for combining instructions needs to be within [0, 16]: " << value
+                              << std::endl;
+                    return false;
+                }
+                config.additionalOptions.combineWindowSize = static_cast<unsigned>(intValue);
+            }
+            else if(paramName == "vpm-read-cache-size")
+                config.additionalOptions.vpmReadCacheSize = static_cast<unsigned>(intValue);
+            else if(paramName == "vpm-work-group-cache-size")
+                config.additionalOptions.vpmWorkGroupCacheSize = static_cast<unsigned>(intValue);
+            else if(paramName == "vpm-work-group-buffers")
+                config.additionalOptions.vpmWorkGroupBuffers = static_cast<unsigned>(intValue);
             else
             {
                 std::cerr << "Cannot set unknown optimization parameter: " << paramName << " to " << value << std::endl;
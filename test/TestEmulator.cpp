@@ -9,14 +9,24 @@
 #include "../src/Profiler.h"
 #include "Compiler.h"
 #include "Locals.h"
+#include "asm/ALUInstruction.h"
+#include "asm/BranchInstruction.h"
 #include "asm/Instruction.h"
 #include "asm/KernelInfo.h"
+#include "asm/LoadInstruction.h"
 #include "helper.h"
+#include "tools/EmulationTrace.h"
+#include "tools/Emulator.h"
+#include "tools/VectorizedALU.h"
 
 #include "test_cases.h"
 
+#include <cctype>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <functional>
+#include <random>
 #include <sstream>
 
 #define __kernel static
@@ -50,6 +60,16 @@ TestEmulator::TestEmulator(const vc4c::Configuration& config) : config(config),
     TEST_ADD(TestEmulator::testPartialMD5);
     TEST_ADD(TestEmulator::testCRC16);
     TEST_ADD(TestEmulator::testPearson16);
+    TEST_ADD(TestEmulator::testParallelWorkGroups);
+    TEST_ADD(TestEmulator::testTMUTiming);
+    TEST_ADD(TestEmulator::testVectorizedALU);
+    TEST_ADD(TestEmulator::testSkipStalledCycles);
+    TEST_ADD(TestEmulator::testCheckpoint);
+    TEST_ADD(TestEmulator::testDecodeProgram);
+    TEST_ADD(TestEmulator::testCacheModel);
+    TEST_ADD(TestEmulator::testHotSpotProfile);
+    TEST_ADD(TestEmulator::testEmulationTrace);
+    TEST_ADD(TestEmulator::testBatchEmulation);
     TEST_ADD(TestEmulator::printProfilingInfo);
 }
 
@@ -578,6 +598,756 @@ void TestEmulator::testPearson16()
     }
 }
 
+static const std::string PARALLEL_WORK_GROUPS_FUNCTION = R"(
+__kernel void test(__global int* out) {
+  uint gid = get_group_id(0);
+  if(get_local_id(0) == 0) {
+    // the last work-group writes the initial value back into the first word
+    out[0] = gid == get_num_groups(0) - 1 ? 7 : 100 + gid;
+    out[gid + 1] = gid * 3;
+  }
+}
+)";
+
+void TestEmulator::testParallelWorkGroups()
+{
+    // the work-groups can only be emulated independently if they read their group IDs from the UNIFORMs
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    copy.additionalDisabledOptimizations.emplace("loop-work-groups");
+    std::stringstream buffer;
+    std::istringstream source(PARALLEL_WORK_GROUPS_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+    const auto module = buffer.str();
+
+    // same result as the sequential execution, even if the last work-group writes the initial value of a word
+    // previously overwritten by another work-group
+    const std::vector<uint32_t> expected{7, 0, 3, 6, 9};
+    for(uint32_t numThreads : {1u, 2u, 4u})
+    {
+        std::istringstream moduleBuffer(module);
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &moduleBuffer);
+        data.workGroup.localSizes = {4, 1, 1};
+        data.workGroup.numGroups = {4, 1, 1};
+        data.numEmulationThreads = numThreads;
+        data.parameter.emplace_back(0u, std::vector<uint32_t>{7, 42, 42, 42, 42});
+
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(1u, result.results.size())
+        if(result.results.size() == 1)
+            TEST_ASSERT_EQUALS(to_string<uint32_t>(expected), to_string<uint32_t>(*result.results.front().second))
+    }
+}
+
+static const std::string TMU_LOAD_FUNCTION = R"(
+__kernel void test(__global int* out, const __global int* in) {
+  uint gid = get_global_id(0);
+  out[gid] = in[gid] + in[gid + 16] * 3;
+}
+)";
+
+void TestEmulator::testTMUTiming()
+{
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    std::stringstream buffer;
+    std::istringstream source(TMU_LOAD_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+    const auto module = buffer.str();
+
+    std::vector<uint32_t> input(32);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 5 + 1;
+    std::vector<uint32_t> expected(16);
+    for(uint32_t i = 0; i < expected.size(); ++i)
+        expected[i] = input[i] + input[i + 16] * 3;
+
+    auto run = [&](const TimingModel& timing) -> EmulationResult {
+        std::istringstream moduleBuffer(module);
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &moduleBuffer);
+        data.workGroup.localSizes = {16, 1, 1};
+        data.timing = timing;
+        data.parameter.emplace_back(0u, std::vector<uint32_t>(16));
+        data.parameter.emplace_back(0u, input);
+        return emulate(data);
+    };
+    auto countTMUStalls = [](const EmulationResult& result) -> unsigned {
+        unsigned numStalls = 0;
+        for(const auto& instrumentation : result.instrumentation)
+            numStalls += instrumentation.numTMUStalls;
+        return numStalls;
+    };
+
+    // the latency of TMU loads (from RAM) is completely determined by the timing model
+    const TimingModel defaultTiming{};
+    TimingModel slowTiming{};
+    slowTiming.tmuLatency += 40;
+    slowTiming.l2CacheMissPenalty += 40;
+    const auto defaultResult = run(defaultTiming);
+    const auto slowResult = run(slowTiming);
+    TEST_ASSERT(defaultResult.executionSuccessful)
+    TEST_ASSERT(slowResult.executionSuccessful)
+    TEST_ASSERT(slowResult.numCycles > defaultResult.numCycles)
+    TEST_ASSERT(countTMUStalls(slowResult) > countTMUStalls(defaultResult))
+    TEST_ASSERT_EQUALS(2u, slowResult.results.size())
+    if(slowResult.results.size() == 2)
+        TEST_ASSERT_EQUALS(to_string<uint32_t>(expected), to_string<uint32_t>(*slowResult.results.front().second))
+}
+
+static std::string toString(const PrecalculatedVector& result)
+{
+    std::string s = result.first ? result.first->to_string() : "(none)";
+    for(const auto& flags : result.second)
+        s.append(" ").append(flags.to_string());
+    return s;
+}
+
+void TestEmulator::testVectorizedALU()
+{
+    static const std::vector<OpCode> opCodes = {OP_FADD, OP_FSUB, OP_FMIN, OP_FMAX, OP_FMINABS, OP_FMAXABS, OP_FTOI,
+        OP_ITOF, OP_ADD, OP_SUB, OP_SHR, OP_ASR, OP_ROR, OP_SHL, OP_MIN, OP_MAX, OP_AND, OP_OR, OP_XOR, OP_NOT, OP_CLZ,
+        OP_V8ADDS, OP_V8SUBS, OP_FMUL, OP_MUL24, OP_V8MULD, OP_V8MIN, OP_V8MAX};
+    static const std::vector<Unpack> unpackModes = {UNPACK_NOP, UNPACK_16A_32, UNPACK_16B_32, UNPACK_8888_32,
+        UNPACK_8A_32, UNPACK_8B_32, UNPACK_8C_32, UNPACK_8D_32};
+    static const std::vector<Pack> packModes = {PACK_NOP, PACK_32_16A, PACK_32_16B, PACK_32_8888, PACK_32_8A,
+        PACK_32_8D, PACK_32_32, PACK_32_16A_S, PACK_32_16B_S, PACK_32_8888_S, PACK_32_8A_S, PACK_32_8D_S};
+    static const std::vector<ConditionCode> conditions = {COND_ALWAYS, COND_NEVER, COND_ZERO_SET, COND_ZERO_CLEAR,
+        COND_NEGATIVE_SET, COND_NEGATIVE_CLEAR, COND_CARRY_SET, COND_CARRY_CLEAR};
+    // zero, negative zero, one, minus one, the signed extremes, infinities, NaN, a denormal and float one/minus one
+    static const std::vector<uint32_t> specialValues = {0x00000000, 0x80000000, 0x00000001, 0xFFFFFFFF, 0x7FFFFFFF,
+        0x7F800000, 0xFF800000, 0x7FC00000, 0x00000010, 0x3F800000, 0xBF800000, 0x00FFFFFF, 0xFF000000};
+
+    // the vectorized implementations need to produce the same values and flags as the generic calculation for random
+    // inputs, also after applying any of the unpack and pack modes the emulator applies around the calculation
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> distribution;
+    auto randomElement = [&]() -> Literal {
+        auto val = distribution(generator);
+        switch(val % 4)
+        {
+        case 0:
+            return Literal(specialValues[(val >> 2) % specialValues.size()]);
+        case 1:
+            // small (positive or negative) integers
+            return Literal(static_cast<int32_t>((val >> 2) % 128) - 64);
+        default:
+            return Literal(val);
+        }
+    };
+
+    for(const auto& code : opCodes)
+    {
+        auto vectorized = getVectorizedOperation(code);
+        TEST_ASSERT(vectorized != nullptr)
+        if(!vectorized)
+            continue;
+        std::string firstMismatch;
+        for(unsigned iteration = 0; iteration < 256 && firstMismatch.empty(); ++iteration)
+        {
+            SIMDVector first;
+            SIMDVector second;
+            for(std::size_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+            {
+                first[i] = randomElement();
+                second[i] = randomElement();
+            }
+            const auto& unpack = unpackModes[iteration % unpackModes.size()];
+            first = unpack(first, code.acceptsFloat);
+            second = unpack(second, code.acceptsFloat);
+
+            const auto expected = code(first, second);
+            const auto result = vectorized(code, first, second);
+            if(toString(expected) != toString(result))
+            {
+                firstMismatch = std::string(code.name) + " " + first.to_string() + ", " + second.to_string() + ": " +
+                    toString(expected) + " != " + toString(result);
+                break;
+            }
+
+            for(const auto& cond : conditions)
+            {
+                auto evaluated = evaluateCondition(result.second, cond);
+                for(std::size_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+                {
+                    if(!evaluated.second.test(i) && evaluated.first.test(i) != result.second[i].matchesCondition(cond))
+                        firstMismatch = std::string(code.name) + " condition " + cond.to_string() + " for flags " +
+                            result.second[i].to_string();
+                }
+            }
+
+            if(!expected.first || !result.first)
+                continue;
+            const auto& pack = packModes[iteration % packModes.size()];
+            if(pack(*expected.first, expected.second, code.returnsFloat) !=
+                pack(*result.first, result.second, code.returnsFloat))
+                firstMismatch = std::string(code.name) + " with pack mode " + pack.to_string();
+        }
+        TEST_ASSERT_EQUALS(std::string{}, firstMismatch)
+    }
+}
+
+void TestEmulator::testSkipStalledCycles()
+{
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    std::stringstream buffer;
+    std::istringstream source(TMU_LOAD_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+    const auto module = buffer.str();
+
+    std::vector<uint32_t> input(32);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 7 + 3;
+
+    auto run = [&](bool skipStalledCycles) -> EmulationResult {
+        std::istringstream moduleBuffer(module);
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &moduleBuffer);
+        data.workGroup.localSizes = {16, 1, 1};
+        data.skipStalledCycles = skipStalledCycles;
+        data.parameter.emplace_back(0u, std::vector<uint32_t>(16));
+        data.parameter.emplace_back(0u, input);
+        return emulate(data);
+    };
+
+    // skipping the cycles all QPUs are stalled in (here for the TMU loads and the DMA writes) gives the same results
+    // as emulating every single cycle
+    const auto skippedResult = run(true);
+    const auto fullResult = run(false);
+    TEST_ASSERT(skippedResult.executionSuccessful)
+    TEST_ASSERT(fullResult.executionSuccessful)
+    TEST_ASSERT_EQUALS(fullResult.numCycles, skippedResult.numCycles)
+    TEST_ASSERT_EQUALS(2u, skippedResult.results.size())
+    TEST_ASSERT_EQUALS(2u, fullResult.results.size())
+    if(skippedResult.results.size() == 2 && fullResult.results.size() == 2)
+        TEST_ASSERT_EQUALS(to_string<uint32_t>(*fullResult.results.front().second),
+            to_string<uint32_t>(*skippedResult.results.front().second))
+
+    InstrumentationResult skippedTotal{};
+    InstrumentationResult fullTotal{};
+    TEST_ASSERT_EQUALS(fullResult.instrumentation.size(), skippedResult.instrumentation.size())
+    for(std::size_t i = 0; i < std::min(fullResult.instrumentation.size(), skippedResult.instrumentation.size()); ++i)
+    {
+        TEST_ASSERT_EQUALS(fullResult.instrumentation[i].to_string(), skippedResult.instrumentation[i].to_string())
+        skippedTotal += skippedResult.instrumentation[i];
+        fullTotal += fullResult.instrumentation[i];
+    }
+    TEST_ASSERT(skippedTotal.numTMUStalls > 0)
+    TEST_ASSERT(skippedTotal.numDMALoadStalls + skippedTotal.numDMAStoreStalls > 0)
+    TEST_ASSERT_EQUALS(fullTotal.numStalls, skippedTotal.numStalls)
+}
+
+static std::string readFile(const std::string& fileName)
+{
+    std::ifstream in(fileName, std::ios_base::in | std::ios_base::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void TestEmulator::testCheckpoint()
+{
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    std::stringstream buffer;
+    std::istringstream source(TMU_LOAD_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+    const auto module = buffer.str();
+
+    std::vector<uint32_t> input(32);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 11 + 5;
+
+    const std::string checkpointFile = "testCheckpoint.checkpoint";
+    const std::string fullMemoryFile = "testCheckpoint_full.dump";
+    const std::string restoredMemoryFile = "testCheckpoint_restored.dump";
+
+    auto run = [&](const std::function<void(EmulationData&)>& setup) -> EmulationResult {
+        std::istringstream moduleBuffer(module);
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &moduleBuffer);
+        data.workGroup.localSizes = {16, 1, 1};
+        data.parameter.emplace_back(0u, std::vector<uint32_t>(16));
+        data.parameter.emplace_back(0u, input);
+        setup(data);
+        return emulate(data);
+    };
+
+    // continuing the emulation from a checkpoint taken in the middle of the kernel gives the same final state and
+    // cycle count as the uninterrupted emulation
+    const auto fullResult = run([&](EmulationData& data) { data.memoryDump = fullMemoryFile; });
+    TEST_ASSERT(fullResult.executionSuccessful)
+    const auto stopCycle = static_cast<uint32_t>(fullResult.numCycles / 2);
+    const auto stoppedResult = run([&](EmulationData& data) {
+        data.stopCycle = stopCycle;
+        data.checkpointFile = checkpointFile;
+    });
+    TEST_ASSERT(stoppedResult.executionStopped)
+    TEST_ASSERT_EQUALS(static_cast<uint64_t>(stopCycle), stoppedResult.numCycles)
+    const auto restoredResult = run([&](EmulationData& data) {
+        data.restoreCheckpoint = checkpointFile;
+        data.memoryDump = restoredMemoryFile;
+    });
+    TEST_ASSERT(restoredResult.executionSuccessful)
+    TEST_ASSERT(!restoredResult.executionStopped)
+    TEST_ASSERT_EQUALS(fullResult.numCycles, restoredResult.numCycles)
+    TEST_ASSERT_EQUALS(2u, restoredResult.results.size())
+    if(fullResult.results.size() == 2 && restoredResult.results.size() == 2)
+        TEST_ASSERT_EQUALS(to_string<uint32_t>(*fullResult.results.front().second),
+            to_string<uint32_t>(*restoredResult.results.front().second))
+    const auto fullMemory = readFile(fullMemoryFile);
+    TEST_ASSERT(!fullMemory.empty())
+    TEST_ASSERT(fullMemory == readFile(restoredMemoryFile))
+
+    std::remove(checkpointFile.data());
+    std::remove(fullMemoryFile.data());
+    std::remove(restoredMemoryFile.data());
+}
+
+void TestEmulator::testDecodeProgram()
+{
+    std::vector<qpu_asm::Instruction> instructions;
+    instructions.emplace_back(qpu_asm::LoadInstruction(PACK_NOP, COND_ALWAYS, COND_NEVER, SetFlag::SET_FLAGS,
+        WriteSwap::SWAP, 5, REG_NOP.num, static_cast<uint32_t>(-16)));
+    instructions.emplace_back(qpu_asm::BranchInstruction(BranchCond::ALWAYS, BranchRel::BRANCH_RELATIVE,
+        BranchReg::NONE, 0, REG_NOP.num, REG_NOP.num, 2 * static_cast<int32_t>(sizeof(uint64_t))));
+    instructions.emplace_back(qpu_asm::BranchInstruction(
+        BranchCond::ALWAYS, BranchRel::BRANCH_ABSOLUTE, BranchReg::NONE, 0, REG_NOP.num, REG_NOP.num, 0));
+    instructions.emplace_back(qpu_asm::ALUInstruction(SIGNAL_END_PROGRAM, UNPACK_NOP, PACK_NOP, COND_NEVER, COND_NEVER,
+        SetFlag::DONT_SET, WriteSwap::DONT_SWAP, REG_NOP.num, REG_NOP.num, OP_NOP, OP_NOP, REG_NOP.num, REG_NOP.num,
+        InputMultiplex::ACC0, InputMultiplex::ACC0, InputMultiplex::ACC0, InputMultiplex::ACC0));
+
+    const auto program = decodeProgram(instructions.cbegin(), instructions.cend());
+    TEST_ASSERT_EQUALS(instructions.size(), program.size())
+    if(program.size() != instructions.size())
+        return;
+
+    // the loaded value (and the flags it sets) and the output register (with write-swap) are resolved ahead of time
+    const auto& load = program[0];
+    TEST_ASSERT(load.handler != nullptr)
+    TEST_ASSERT(load.error.empty())
+    TEST_ASSERT(load.setFlags)
+    TEST_ASSERT_EQUALS((Register{RegisterFile::PHYSICAL_B, 5}).to_string(), load.addOut.to_string())
+    TEST_ASSERT_EQUALS(-16, load.immediate[NATIVE_VECTOR_SIZE - 1].signedInt())
+    TEST_ASSERT(load.immediateFlags[0].negative == FlagStatus::SET)
+    TEST_ASSERT(load.immediateFlags[0].zero == FlagStatus::CLEAR)
+
+    // relative branches are resolved to the absolute target: PC + 4 + offset
+    TEST_ASSERT(program[1].handler != nullptr)
+    TEST_ASSERT(program[1].error.empty())
+    TEST_ASSERT_EQUALS(1u + 4u + 2u, program[1].branchTarget)
+
+    // unsupported instructions are decoded without an error, the error is only thrown when they are executed
+    TEST_ASSERT(program[2].handler != nullptr)
+    TEST_ASSERT(!program[2].error.empty())
+
+    // the end of the program has no handler
+    TEST_ASSERT(program[3].handler == nullptr)
+    TEST_ASSERT(program[3].instruction == &instructions[3])
+}
+
+void TestEmulator::testCacheModel()
+{
+    const TimingModel timing{};
+    CacheModel caches(timing);
+    caches.addBuffer(0, 4096);
+
+    // 16 consecutive words
+    SIMDVector addresses;
+    for(uint32_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        addresses[i] = Literal(i * 4u);
+    const auto numLines = (NATIVE_VECTOR_SIZE * 4u + timing.cacheLineSize - 1u) / timing.cacheLineSize;
+
+    // the first load misses both caches
+    CacheStatistics firstLoad{};
+    TEST_ASSERT_EQUALS(
+        timing.tmuCacheMissPenalty + timing.l2CacheMissPenalty, caches.loadTMU(0, 0, addresses, firstLoad))
+    TEST_ASSERT_EQUALS(0u, firstLoad.numTMUCacheHits)
+    TEST_ASSERT_EQUALS(numLines, firstLoad.numTMUCacheMisses)
+    TEST_ASSERT_EQUALS(numLines, firstLoad.numL2CacheMisses)
+
+    // repeating the load hits the TMU cache and has no penalty
+    CacheStatistics repeatedLoad{};
+    TEST_ASSERT_EQUALS(0u, caches.loadTMU(0, 0, addresses, repeatedLoad))
+    TEST_ASSERT_EQUALS(numLines, repeatedLoad.numTMUCacheHits)
+    TEST_ASSERT_EQUALS(0u, repeatedLoad.numTMUCacheMisses)
+
+    // the same load via the TMU of another slice misses its TMU cache, but hits the shared L2 cache
+    CacheStatistics otherSliceLoad{};
+    TEST_ASSERT_EQUALS(timing.tmuCacheMissPenalty, caches.loadTMU(4, 0, addresses, otherSliceLoad))
+    TEST_ASSERT_EQUALS(numLines, otherSliceLoad.numTMUCacheMisses)
+    TEST_ASSERT_EQUALS(0u, otherSliceLoad.numL2CacheMisses)
+
+    // the buffer statistics contain all loads
+    const auto bufferStatistics = caches.getBufferStatistics(0);
+    TEST_ASSERT_EQUALS(numLines, bufferStatistics.numTMUCacheHits)
+    TEST_ASSERT_EQUALS(2 * numLines, bufferStatistics.numTMUCacheMisses)
+    TEST_ASSERT_EQUALS(numLines, bufferStatistics.numL2CacheMisses)
+}
+
+void TestEmulator::testHotSpotProfile()
+{
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    std::stringstream buffer;
+    std::istringstream source(TMU_LOAD_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+
+    const std::string reportFile = "testHotSpotProfile.txt";
+    const std::string callgrindFile = "testHotSpotProfile.callgrind";
+    EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes = {16, 1, 1};
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(16));
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(32, 1));
+    data.profileReport = reportFile;
+    data.profileCallgrind = callgrindFile;
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+
+    InstrumentationResult expectedTotal{};
+    for(const auto& instrumentation : result.instrumentation)
+        expectedTotal += instrumentation;
+    TEST_ASSERT(expectedTotal.numExecutions > 0)
+
+    // the cost lines are "<instruction index + 1> <cycles> <stalls> <add ALU> <mul ALU> <branches> <TMU misses>" and
+    // need to match the instrumentation of the single instructions as well as the summary line
+    std::ifstream callgrind(callgrindFile);
+    TEST_ASSERT(callgrind.is_open())
+    std::string line;
+    std::vector<uint64_t> summary;
+    std::vector<uint64_t> sums(6, 0);
+    bool inFunction = false;
+    std::size_t numCostLines = 0;
+    while(std::getline(callgrind, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        if(line.find("summary: ") == 0)
+        {
+            ss.ignore(static_cast<std::streamsize>(std::string("summary: ").size()));
+            uint64_t value = 0;
+            while(ss >> value)
+                summary.push_back(value);
+        }
+        else if(line.find("fn=") == 0)
+            inFunction = true;
+        else if(std::isdigit(static_cast<unsigned char>(line[0])))
+        {
+            // the cost lines are listed within the basic blocks
+            TEST_ASSERT(inFunction)
+            std::size_t lineNumber = 0;
+            std::vector<uint64_t> costs(6, 0);
+            ss >> lineNumber >> costs[0] >> costs[1] >> costs[2] >> costs[3] >> costs[4] >> costs[5];
+            TEST_ASSERT(!ss.fail())
+            TEST_ASSERT(lineNumber >= 1 && lineNumber <= result.instrumentation.size())
+            const auto& instrumentation = result.instrumentation.at(lineNumber - 1);
+            TEST_ASSERT_EQUALS(instrumentation.numExecutions, costs[0])
+            TEST_ASSERT_EQUALS(instrumentation.numStalls, costs[1])
+            TEST_ASSERT_EQUALS(instrumentation.numAddALUExecuted, costs[2])
+            TEST_ASSERT_EQUALS(instrumentation.numMulALUExecuted, costs[3])
+            TEST_ASSERT_EQUALS(instrumentation.numBranchTaken, costs[4])
+            TEST_ASSERT_EQUALS(instrumentation.cacheStatistics.numTMUCacheMisses, costs[5])
+            for(std::size_t i = 0; i < costs.size(); ++i)
+                sums[i] += costs[i];
+            ++numCostLines;
+        }
+    }
+    TEST_ASSERT(numCostLines > 0)
+    TEST_ASSERT_EQUALS(6u, summary.size())
+    TEST_ASSERT_EQUALS(expectedTotal.numExecutions, summary.at(0))
+    TEST_ASSERT_EQUALS(expectedTotal.numStalls, summary.at(1))
+    TEST_ASSERT_EQUALS(expectedTotal.cacheStatistics.numTMUCacheMisses, summary.at(5))
+    for(std::size_t i = 0; i < sums.size(); ++i)
+        TEST_ASSERT_EQUALS(summary.at(i), sums[i])
+
+    // the report lists the same total number of cycles
+    std::ifstream report(reportFile);
+    TEST_ASSERT(report.is_open())
+    bool hasCycles = false;
+    while(std::getline(report, line))
+    {
+        if(line.find("QPU cycles: ") == 0)
+        {
+            std::istringstream ss(line.substr(std::string("QPU cycles: ").size()));
+            uint64_t numCycles = 0;
+            ss >> numCycles;
+            TEST_ASSERT_EQUALS(expectedTotal.numExecutions, numCycles)
+            hasCycles = true;
+        }
+    }
+    TEST_ASSERT(hasCycles)
+
+    report.close();
+    callgrind.close();
+    std::remove(reportFile.data());
+    std::remove(callgrindFile.data());
+}
+
+/*
+ * Checks the syntax of the given JSON value (without any escape sequences other than \" and \\ in strings) and
+ * advances the position behind it
+ */
+static bool skipJSONValue(const std::string& text, std::size_t& pos)
+{
+    auto skipWhitespace = [&]() {
+        while(pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+    };
+    auto skipString = [&]() -> bool {
+        if(pos >= text.size() || text[pos] != '"')
+            return false;
+        for(++pos; pos < text.size() && text[pos] != '"'; ++pos)
+        {
+            if(static_cast<unsigned char>(text[pos]) < 0x20)
+                return false;
+            if(text[pos] == '\\' && (++pos >= text.size() || (text[pos] != '"' && text[pos] != '\\')))
+                return false;
+        }
+        return pos++ < text.size();
+    };
+
+    skipWhitespace();
+    if(pos >= text.size())
+        return false;
+    if(text[pos] == '"')
+        return skipString();
+    if(text[pos] == '{' || text[pos] == '[')
+    {
+        const char end = text[pos] == '{' ? '}' : ']';
+        const bool isObject = text[pos] == '{';
+        ++pos;
+        skipWhitespace();
+        if(pos < text.size() && text[pos] == end)
+        {
+            ++pos;
+            return true;
+        }
+        while(true)
+        {
+            if(isObject)
+            {
+                skipWhitespace();
+                if(!skipString())
+                    return false;
+                skipWhitespace();
+                if(pos >= text.size() || text[pos++] != ':')
+                    return false;
+            }
+            if(!skipJSONValue(text, pos))
+                return false;
+            skipWhitespace();
+            if(pos >= text.size())
+                return false;
+            if(text[pos] == end)
+            {
+                ++pos;
+                return true;
+            }
+            if(text[pos++] != ',')
+                return false;
+        }
+    }
+    const auto start = pos;
+    while(pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '-' ||
+              text[pos] == '.' || text[pos] == '+'))
+        ++pos;
+    return pos > start;
+}
+
+static bool isWellFormedJSON(const std::string& text)
+{
+    std::size_t pos = 0;
+    if(!skipJSONValue(text, pos))
+        return false;
+    while(pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+    return pos == text.size();
+}
+
+// the events are written one per line
+static std::size_t countTraceEvents(const std::string& trace)
+{
+    std::size_t numEvents = 0;
+    std::istringstream ss(trace);
+    std::string line;
+    while(std::getline(ss, line))
+    {
+        if(!line.empty() && line[0] == '{' && line.find("\"traceEvents\"") == std::string::npos)
+            ++numEvents;
+    }
+    return numEvents;
+}
+
+void TestEmulator::testEmulationTrace()
+{
+    const std::string traceFile = "testEmulationTrace.json";
+    {
+        // the trace of an emulated kernel is well-formed
+        Configuration copy = config;
+        copy.outputMode = OutputMode::BINARY;
+        copy.writeKernelInfo = true;
+        std::stringstream buffer;
+        std::istringstream source(TMU_LOAD_FUNCTION);
+        Compiler::compile(source, buffer, copy, "");
+
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.workGroup.localSizes = {16, 1, 1};
+        data.parameter.emplace_back(0u, std::vector<uint32_t>(16));
+        data.parameter.emplace_back(0u, std::vector<uint32_t>(32, 1));
+        data.traceFile = traceFile;
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+
+        const auto trace = readFile(traceFile);
+        TEST_ASSERT(isWellFormedJSON(trace))
+        TEST_ASSERT(countTraceEvents(trace) > 0)
+        TEST_ASSERT(trace.find("\"ph\":\"X\"") != std::string::npos)
+    }
+
+    {
+        // the events are buffered up to the limit of 4096 events and the trace stays well-formed across the batches
+        const std::size_t maxBufferedEvents = 4096;
+        // 4 metadata events for the process and 2 events per semaphore access
+        const std::size_t numEvents = 4 + 2 * 5000;
+        TraceWriter writer(traceFile);
+        {
+            EmulationTrace trace(writer, 0, "name with \"quotes\", \\ and\nnewline");
+            for(uint32_t cycle = 0; cycle < 5000; ++cycle)
+            {
+                trace.setCycle(cycle);
+                trace.recordSemaphore(0, 1, cycle % 2 == 0, static_cast<uint8_t>(cycle % 2));
+            }
+            const auto numWrittenEvents = countTraceEvents(readFile(traceFile));
+            TEST_ASSERT(numWrittenEvents > 0)
+            TEST_ASSERT(numEvents - numWrittenEvents < maxBufferedEvents)
+        }
+        // all buffered events are written on destruction of the trace
+        const auto numWrittenEvents = countTraceEvents(readFile(traceFile));
+        TEST_ASSERT_EQUALS(numEvents, numWrittenEvents)
+    }
+    // the trace file is finished on destruction of the writer
+    TEST_ASSERT(isWellFormedJSON(readFile(traceFile)))
+
+    std::remove(traceFile.data());
+}
+
+void TestEmulator::testBatchEmulation()
+{
+    Configuration copy = config;
+    copy.outputMode = OutputMode::BINARY;
+    copy.writeKernelInfo = true;
+    std::stringstream buffer;
+    std::istringstream source(TMU_LOAD_FUNCTION);
+    Compiler::compile(source, buffer, copy, "");
+    const auto module = buffer.str();
+
+    // already compiled modules are emulated as-is, so the batch and the single runs emulate the same code
+    const std::string moduleFile = "testBatchEmulation.bin";
+    {
+        std::ofstream out(moduleFile, std::ios_base::out | std::ios_base::binary);
+        out << module;
+    }
+
+    BatchConfiguration batchConfig;
+    batchConfig.inputFile = moduleFile;
+    batchConfig.kernelName = "test";
+    batchConfig.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    for(uint32_t factor = 1; factor <= 2; ++factor)
+    {
+        std::vector<uint32_t> input(48);
+        for(uint32_t i = 0; i < input.size(); ++i)
+            input[i] = i * factor + 7;
+        batchConfig.parameterSets.emplace_back("set" + std::to_string(factor),
+            std::vector<std::pair<uint32_t, Optional<std::vector<uint32_t>>>>{
+                {0u, std::vector<uint32_t>(32)}, {0u, std::move(input)}});
+    }
+    WorkGroupConfig singleGroup;
+    singleGroup.localSizes = {16, 1, 1};
+    WorkGroupConfig twoGroups = singleGroup;
+    twoGroups.numGroups = {2, 1, 1};
+    batchConfig.workGroups = {singleGroup, twoGroups};
+
+    const std::vector<BatchConfiguration> configurations{batchConfig};
+    const auto results = emulateBatch(configurations, 2);
+    TEST_ASSERT_EQUALS(4u, results.size())
+
+    // 64-bit FNV-1a over the bytes of the words
+    auto calculateChecksum = [](const std::vector<uint32_t>& words) -> uint64_t {
+        uint64_t hash = 0xcbf29ce484222325;
+        for(uint32_t word : words)
+        {
+            for(unsigned i = 0; i < sizeof(uint32_t); ++i)
+            {
+                hash ^= (word >> (i * 8)) & 0xFF;
+                hash *= 0x100000001b3;
+            }
+        }
+        return hash;
+    };
+
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& batchResult = results[i];
+        // the results are in the order of the parameter sets and work-group configurations
+        TEST_ASSERT_EQUALS(0u, batchResult.configurationIndex)
+        TEST_ASSERT_EQUALS(i / 2, batchResult.parameterSetIndex)
+        TEST_ASSERT_EQUALS(i % 2, batchResult.workGroupIndex)
+        TEST_ASSERT(batchResult.error.empty())
+        TEST_ASSERT(batchResult.executionSuccessful)
+
+        std::istringstream moduleBuffer(module);
+        EmulationData data(moduleBuffer, batchConfig.kernelName,
+            batchConfig.parameterSets[batchResult.parameterSetIndex].second,
+            batchConfig.workGroups[batchResult.workGroupIndex], batchConfig.maxEmulationCycles);
+        const auto singleResult = emulate(data);
+        TEST_ASSERT(singleResult.executionSuccessful)
+
+        TEST_ASSERT_EQUALS(singleResult.numCycles, batchResult.numCycles)
+        TEST_ASSERT_EQUALS(singleResult.instrumentation.size(), batchResult.numInstructions)
+        uint64_t numStallCycles = 0;
+        for(const auto& instrumentation : singleResult.instrumentation)
+            numStallCycles += instrumentation.numStalls;
+        TEST_ASSERT_EQUALS(numStallCycles, batchResult.numStallCycles)
+        TEST_ASSERT_EQUALS(singleResult.results.size(), batchResult.checksums.size())
+        for(std::size_t p = 0; p < singleResult.results.size(); ++p)
+        {
+            TEST_ASSERT(!!singleResult.results[p].second)
+            TEST_ASSERT_EQUALS(calculateChecksum(*singleResult.results[p].second), batchResult.checksums[p])
+        }
+    }
+    // different inputs give different outputs
+    TEST_ASSERT(results[0].checksums.front() != results[2].checksums.front())
+
+    std::stringstream json;
+    writeBatchResultsJSON(json, configurations, results);
+    TEST_ASSERT(isWellFormedJSON(json.str()))
+
+    std::remove(moduleFile.data());
+}
+
 void TestEmulator::printProfilingInfo()
 {
 #if DEBUG_MODE
@@ -43,6 +43,16 @@ public:
     void testPartialMD5();
     void testCRC16();
     void testPearson16();
+    void testParallelWorkGroups();
+    void testTMUTiming();
+    void testVectorizedALU();
+    void testSkipStalledCycles();
+    void testCheckpoint();
+    void testDecodeProgram();
+    void testCacheModel();
+    void testHotSpotProfile();
+    void testEmulationTrace();
+    void testBatchEmulation();
 
     void printProfilingInfo();
 
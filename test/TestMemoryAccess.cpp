@@ -6,7 +6,11 @@
 
 #include "TestMemoryAccess.h"
 
+#include "Method.h"
+#include "Module.h"
 #include "emulation_helper.h"
+#include "normalization/MemoryAccess.h"
+#include "periphery/VPM.h"
 #include "test_cases.h"
 
 #include <numeric>
@@ -115,6 +119,17 @@ TestMemoryAccess::TestMemoryAccess(const Configuration& config) : TestEmulator(f
     TEST_ADD(TestMemoryAccess::testVectorLoadStorePrivateVPMPartial);
     TEST_ADD(TestMemoryAccess::testVectorLoadStoreLocalParameter);
     TEST_ADD(TestMemoryAccess::testVectorLoadStoreGlobalParameter);
+
+    TEST_ADD(TestMemoryAccess::testVPMReadCache);
+    TEST_ADD(TestMemoryAccess::testVPMLiveRanges);
+    TEST_ADD(TestMemoryAccess::testVPMPackedAreas);
+    TEST_ADD(TestMemoryAccess::testScalarReplacement);
+    TEST_ADD(TestMemoryAccess::testWorkGroupBlockAccess);
+    TEST_ADD(TestMemoryAccess::testAsynchronousCopy);
+    TEST_ADD(TestMemoryAccess::testDoubleBufferedWorkGroupBlocks);
+    TEST_ADD(TestMemoryAccess::testReadOnlyWorkGroupBlocks);
+    TEST_ADD(TestMemoryAccess::testAliasedReadCache);
+    TEST_ADD(TestMemoryAccess::testGlobalDataCompaction);
 }
 
 TestMemoryAccess::~TestMemoryAccess() = default;
@@ -641,3 +656,718 @@ void TestMemoryAccess::testVectorLoadStoreGlobalParameter()
         }
     }
 }
+
+static const std::string READ_CACHE_FUNCTION = R"(
+__constant int table[64] = {
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28,
+  29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57,
+  58, 59, 60, 61, 62, 63
+};
+
+__attribute__((reqd_work_group_size(4, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  size_t gid = get_global_id(0);
+  int sum = 0;
+  for(int i = 0; i < 8; ++i) {
+    sum += table[(in[gid] + i * 7) & 63];
+  }
+  out[gid] = sum;
+}
+)";
+
+static EmulationResult runReadCacheFunction(
+    const Configuration& config, OptimizationLevel level, unsigned cacheSize, const std::vector<uint32_t>& input)
+{
+    Configuration copy = config;
+    copy.optimizationLevel = level;
+    copy.additionalOptions.vpmReadCacheSize = cacheSize;
+    std::stringstream buffer;
+    compileBuffer(copy, buffer, READ_CACHE_FUNCTION, "");
+
+    EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.dimensions = 1;
+    data.workGroup.globalOffsets = {0, 0, 0};
+    data.workGroup.localSizes = {4, 1, 1};
+    data.workGroup.numGroups = {1, 1, 1};
+    data.parameter.emplace_back(0, std::vector<uint32_t>(input.size()));
+    data.parameter.emplace_back(0, input);
+    return emulate(data);
+}
+
+void TestMemoryAccess::testVPMReadCache()
+{
+    const std::vector<uint32_t> input{3, 17, 42, 63};
+    std::vector<uint32_t> expected;
+    for(auto val : input)
+    {
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i < 8; ++i)
+            sum += (val + i * 7) & 63;
+        expected.push_back(sum);
+    }
+
+    // the table is only cached in VPM for full optimizations, otherwise it is read via TMU
+    for(auto level : {OptimizationLevel::MEDIUM, OptimizationLevel::FULL})
+    {
+        for(unsigned cacheSize : {0u, 2048u})
+        {
+            const auto result = runReadCacheFunction(config, level, cacheSize, input);
+            TEST_ASSERT(result.executionSuccessful)
+            TEST_ASSERT_EQUALS(2u, result.results.size())
+            if(result.results.size() != 2)
+                continue;
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+
+            const auto& stats = result.globalDataCacheStatistics;
+            const bool isCached = level == OptimizationLevel::FULL && cacheSize != 0;
+            TEST_ASSERT_EQUALS(isCached, stats.numTMUCacheHits + stats.numTMUCacheMisses == 0)
+        }
+    }
+}
+
+static const std::string VPM_LIVE_RANGE_FUNCTION = R"(
+__attribute__((reqd_work_group_size(1, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  __local int first[64];
+  __local int second[64];
+  for(int i = 0; i < 64; ++i) {
+    first[i] = in[i] * 2;
+  }
+  int sum = 0;
+  for(int i = 0; i < 64; ++i) {
+    sum += first[63 - i] * i;
+  }
+  // the second array is only used after the last access of the first one
+  for(int i = 0; i < 64; ++i) {
+    second[i] = in[i] + sum;
+  }
+  for(int i = 0; i < 64; ++i) {
+    out[i] = second[i] - second[63 - i];
+  }
+}
+)";
+
+void TestMemoryAccess::testVPMLiveRanges()
+{
+    using namespace vc4c::periphery;
+    Configuration config{};
+    Module mod{config};
+    Method method{mod};
+    auto first = method.addNewLocal(TYPE_VOID_POINTER, "%first").local();
+    auto second = method.addNewLocal(TYPE_VOID_POINTER, "%second").local();
+    auto third = method.addNewLocal(TYPE_VOID_POINTER, "%third").local();
+    auto stack0 = method.addNewLocal(TYPE_VOID_POINTER, "%stack0").local();
+    auto stack1 = method.addNewLocal(TYPE_VOID_POINTER, "%stack1").local();
+    auto shared = method.addNewLocal(TYPE_VOID_POINTER, "%shared").local();
+
+    {
+        // areas with disjoint live ranges share the same rows, overlapping areas do not
+        VPM vpm;
+        auto firstArea = vpm.addPackedArea(first, 256, false, NUM_QPUS, VPMLiveRange{0, 10});
+        auto secondArea = vpm.addPackedArea(second, 256, false, NUM_QPUS, VPMLiveRange{11, 20});
+        auto thirdArea = vpm.addPackedArea(third, 256, false, NUM_QPUS, VPMLiveRange{5, 15});
+        TEST_ASSERT(firstArea != nullptr)
+        TEST_ASSERT(secondArea != nullptr)
+        TEST_ASSERT(thirdArea != nullptr)
+        if(firstArea && secondArea && thirdArea)
+        {
+            TEST_ASSERT_EQUALS(firstArea->rowOffset, secondArea->rowOffset)
+            TEST_ASSERT(thirdArea->rowOffset >= firstArea->rowOffset + firstArea->numRows ||
+                thirdArea->rowOffset + thirdArea->numRows <= firstArea->rowOffset)
+        }
+    }
+
+    {
+        // areas used for the whole kernel never share rows
+        VPM vpm;
+        auto firstArea = vpm.addPackedArea(first, 256, false);
+        auto secondArea = vpm.addPackedArea(second, 256, false, NUM_QPUS, VPMLiveRange{11, 20});
+        TEST_ASSERT(firstArea != nullptr)
+        TEST_ASSERT(secondArea != nullptr)
+        if(firstArea && secondArea)
+            TEST_ASSERT(secondArea->rowOffset >= firstArea->rowOffset + firstArea->numRows)
+    }
+
+    {
+        // per-QPU areas only share rows with other per-QPU areas with the same layout, never with shared areas
+        VPM vpm;
+        auto stackArea0 = vpm.addPackedArea(stack0, 64, true, 4, VPMLiveRange{0, 10});
+        auto stackArea1 = vpm.addPackedArea(stack1, 64, true, 4, VPMLiveRange{11, 20});
+        auto sharedArea = vpm.addPackedArea(shared, 64, false, NUM_QPUS, VPMLiveRange{21, 30});
+        TEST_ASSERT(stackArea0 != nullptr)
+        TEST_ASSERT(stackArea1 != nullptr)
+        TEST_ASSERT(sharedArea != nullptr)
+        if(stackArea0 && stackArea1 && sharedArea)
+        {
+            TEST_ASSERT_EQUALS(stackArea0->rowOffset, stackArea1->rowOffset)
+            TEST_ASSERT_EQUALS(stackArea0->perQPUStride, stackArea1->perQPUStride)
+            TEST_ASSERT(sharedArea->rowOffset >= stackArea0->rowOffset + stackArea0->numRows ||
+                sharedArea->rowOffset + sharedArea->numRows <= stackArea0->rowOffset)
+        }
+    }
+
+    {
+        // two local arrays with disjoint live ranges (and therefore possibly sharing the same VPM rows) keep their
+        // contents while used
+        std::stringstream buffer;
+        Configuration copy = this->config;
+        compileBuffer(copy, buffer, VPM_LIVE_RANGE_FUNCTION, "");
+
+        std::vector<uint32_t> input(64);
+        for(uint32_t i = 0; i < input.size(); ++i)
+            input[i] = i * 3 + 5;
+        int32_t sum = 0;
+        for(int32_t i = 0; i < 64; ++i)
+            sum += static_cast<int32_t>(input[static_cast<std::size_t>(63 - i)]) * 2 * i;
+        std::vector<uint32_t> expected(64);
+        for(uint32_t i = 0; i < expected.size(); ++i)
+            expected[i] = (input[i] + static_cast<uint32_t>(sum)) - (input[63 - i] + static_cast<uint32_t>(sum));
+
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.parameter.emplace_back(0, std::vector<uint32_t>(64));
+        data.parameter.emplace_back(0, input);
+
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(2u, result.results.size())
+        if(result.results.size() == 2)
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+    }
+}
+
+static const std::string VPM_PACKED_FUNCTION = R"(
+__attribute__((reqd_work_group_size(8, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  __local int words[256];
+  __local uchar bytes[256];
+  int tmp[32];
+  uint lid = get_local_id(0);
+  for(uint i = lid; i < 256; i += 8) {
+    words[i] = in[i];
+    // neighbouring bytes of the same word are written by different work-items
+    bytes[i] = (uchar) in[i];
+  }
+  for(uint i = 0; i < 32; ++i)
+    tmp[i] = in[(i * 7 + lid) % 256];
+  barrier(CLK_LOCAL_MEM_FENCE);
+  for(uint i = lid; i < 256; i += 8)
+    out[i] = words[255 - i] + bytes[i] + tmp[(i + lid) % 32];
+}
+)";
+
+void TestMemoryAccess::testVPMPackedAreas()
+{
+    std::stringstream buffer;
+    Configuration copy = this->config;
+    compileBuffer(copy, buffer, VPM_PACKED_FUNCTION, "");
+
+    std::vector<uint32_t> input(256);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 13 + 200;
+    std::vector<uint32_t> expected(256);
+    for(uint32_t i = 0; i < expected.size(); ++i)
+    {
+        auto lid = i % 8;
+        auto tmpIndex = (i + lid) % 32;
+        expected[i] = input[255 - i] + (input[i] & 0xFF) + input[(tmpIndex * 7 + lid) % 256];
+    }
+
+    EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes[0] = 8;
+    data.parameter.emplace_back(0, std::vector<uint32_t>(256));
+    data.parameter.emplace_back(0, input);
+
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+    TEST_ASSERT_EQUALS(2u, result.results.size())
+    if(result.results.size() == 2)
+        TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+}
+
+static const std::string SCALAR_REPLACEMENT_FUNCTION = R"(
+struct Data {
+  int a;
+  int values[20];
+  int b;
+};
+
+__attribute__((reqd_work_group_size(4, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  uint gid = get_global_id(0);
+  // only accessed with constant offsets, can be split
+  struct Data plain;
+  plain.a = in[gid];
+  plain.values[3] = in[gid] * 2;
+  plain.b = plain.a + plain.values[3];
+  // initialized via memory fill, the filled values must not be lost
+  int filled[20] = {0};
+  filled[7] = in[gid] + 1;
+  filled[11] = in[gid] + 3;
+  // copied as a whole via memory copy, the copied values must not be lost
+  struct Data copy;
+  copy = plain;
+  copy.values[5] = 17;
+  out[gid * 4 + 0] = plain.b;
+  out[gid * 4 + 1] = filled[7] + filled[11] + filled[19];
+  out[gid * 4 + 2] = copy.a + copy.values[3] + copy.b;
+  out[gid * 4 + 3] = copy.values[5] + filled[0];
+}
+)";
+
+void TestMemoryAccess::testScalarReplacement()
+{
+    std::vector<uint32_t> input{5, 100, 1000, 42};
+    std::vector<uint32_t> expected(16);
+    for(uint32_t i = 0; i < input.size(); ++i)
+    {
+        expected[i * 4 + 0] = input[i] * 3;
+        expected[i * 4 + 1] = (input[i] + 1) + (input[i] + 3);
+        expected[i * 4 + 2] = input[i] + input[i] * 2 + input[i] * 3;
+        expected[i * 4 + 3] = 17;
+    }
+
+    // the splitting is only applied for full optimizations, make sure both variants produce the same result
+    for(auto level : {OptimizationLevel::MEDIUM, OptimizationLevel::FULL})
+    {
+        std::stringstream buffer;
+        Configuration copy = this->config;
+        copy.optimizationLevel = level;
+        compileBuffer(copy, buffer, SCALAR_REPLACEMENT_FUNCTION, "");
+
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.workGroup.localSizes[0] = 4;
+        data.parameter.emplace_back(0, std::vector<uint32_t>(16));
+        data.parameter.emplace_back(0, input);
+
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(2u, result.results.size())
+        if(result.results.size() == 2)
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+    }
+}
+
+static const std::string WORK_GROUP_BLOCK_FUNCTION = R"(
+__attribute__((reqd_work_group_size(8, 1, 1)))
+__kernel void test(__global int* restrict data, const __global int* restrict in) {
+  uint base = get_group_id(0) * 32;
+  uint lid = get_local_id(0);
+  // only the second row of the block is written
+  data[base + lid + 16] = data[base + lid] * 3 + in[base + lid];
+}
+)";
+
+void TestMemoryAccess::testWorkGroupBlockAccess()
+{
+    static constexpr uint32_t NUM_GROUPS = 3;
+    std::vector<uint32_t> data(NUM_GROUPS * 32);
+    std::vector<uint32_t> input(NUM_GROUPS * 32);
+    for(uint32_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = i * 7 + 1;
+        input[i] = 1000 + i;
+    }
+    auto expected = data;
+    for(uint32_t group = 0; group < NUM_GROUPS; ++group)
+    {
+        for(uint32_t lid = 0; lid < 8; ++lid)
+            expected[group * 32 + lid + 16] = data[group * 32 + lid] * 3 + input[group * 32 + lid];
+    }
+
+    // the coalescing is only applied for full optimizations, make sure all variants produce the same result
+    for(auto level : {OptimizationLevel::MEDIUM, OptimizationLevel::FULL})
+    {
+        for(auto cacheSize : {0u, 1024u})
+        {
+            std::stringstream buffer;
+            Configuration copy = this->config;
+            copy.optimizationLevel = level;
+            copy.additionalOptions.vpmWorkGroupCacheSize = cacheSize;
+            compileBuffer(copy, buffer, WORK_GROUP_BLOCK_FUNCTION, "");
+
+            EmulationData emulationData;
+            emulationData.kernelName = "test";
+            emulationData.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+            emulationData.module = std::make_pair("", &buffer);
+            emulationData.workGroup.localSizes[0] = 8;
+            emulationData.workGroup.numGroups[0] = NUM_GROUPS;
+            emulationData.parameter.emplace_back(0, data);
+            emulationData.parameter.emplace_back(0, input);
+
+            const auto result = emulate(emulationData);
+            TEST_ASSERT(result.executionSuccessful)
+            TEST_ASSERT_EQUALS(2u, result.results.size())
+            if(result.results.size() == 2)
+            {
+                TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+                // the read-only input is never written back
+                TEST_ASSERT_EQUALS(toString(input), toString(result.results[1].second.value()))
+            }
+        }
+    }
+}
+
+static const std::string ASYNC_COPY_FUNCTION = R"(
+__attribute__((reqd_work_group_size(8, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  __local int buf[8];
+  uint lid = get_local_id(0);
+  uint offset = get_group_id(0) * 8;
+  event_t event = async_work_group_copy(buf, in + offset, 8, 0);
+  // some calculations the DMA transfer could run in the background of
+  int factor = lid * 3 + 7;
+  wait_group_events(1, &event);
+  int val = buf[lid] * factor;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  buf[lid] = val;
+  barrier(CLK_LOCAL_MEM_FENCE);
+  event = async_work_group_copy(out + offset, buf, 8, 0);
+  wait_group_events(1, &event);
+}
+)";
+
+/*
+ * Returns whether the (linear) assembler code releases the hardware mutex while a DMA transfer is still running, i.e.
+ * after a DMA load/store is started by writing the memory address and before the waiting for its completion
+ */
+static bool releasesMutexDuringDMA(const std::string& assembly)
+{
+    std::istringstream input(assembly);
+    std::string line;
+    bool pendingDMA = false;
+    while(std::getline(input, line))
+    {
+        line = line.substr(0, line.find("//"));
+        if(line.find("vpr_addr") != std::string::npos || line.find("vpw_addr") != std::string::npos)
+            pendingDMA = true;
+        if(line.find("vpr_wait") != std::string::npos || line.find("vpw_wait") != std::string::npos)
+            pendingDMA = false;
+        if(line.find("mutex_rel") != std::string::npos && pendingDMA)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Returns the maximum number of (non-nop) instructions executed in the (linear) assembler code while a DMA transfer is
+ * running, i.e. after a DMA load/store is started and before the waiting for its completion
+ */
+static unsigned countInstructionsDuringDMA(const std::string& assembly)
+{
+    std::istringstream input(assembly);
+    std::string line;
+    bool pendingDMA = false;
+    unsigned numInstructions = 0;
+    unsigned maxInstructions = 0;
+    while(std::getline(input, line))
+    {
+        line = line.substr(0, line.find("//"));
+        line.erase(0, line.find_first_not_of(" \t"));
+        if(line.empty() || line.find("nop") == 0)
+            continue;
+        if(line.find("vpr_wait") != std::string::npos || line.find("vpw_wait") != std::string::npos)
+        {
+            if(pendingDMA)
+                maxInstructions = std::max(maxInstructions, numInstructions);
+            pendingDMA = false;
+        }
+        else if(pendingDMA)
+            ++numInstructions;
+        if(line.find("vpr_addr") != std::string::npos || line.find("vpw_addr") != std::string::npos)
+        {
+            pendingDMA = true;
+            numInstructions = 0;
+        }
+    }
+    return maxInstructions;
+}
+
+void TestMemoryAccess::testAsynchronousCopy()
+{
+    {
+        std::stringstream assembly;
+        Configuration copy = this->config;
+        copy.outputMode = OutputMode::ASSEMBLER;
+        copy.writeKernelInfo = false;
+        std::istringstream source(ASYNC_COPY_FUNCTION);
+        Compiler::compile(source, assembly, copy, "");
+        TEST_ASSERT(!releasesMutexDuringDMA(assembly.str()))
+        // the calculations following the asynchronous copy run while the DMA transfer is still running
+        TEST_ASSERT(countInstructionsDuringDMA(assembly.str()) > 0)
+    }
+
+    std::stringstream buffer;
+    Configuration copy = this->config;
+    compileBuffer(copy, buffer, ASYNC_COPY_FUNCTION, "");
+
+    std::vector<uint32_t> input(16);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 5 + 2;
+    std::vector<uint32_t> expected(16);
+    for(uint32_t i = 0; i < expected.size(); ++i)
+        expected[i] = input[i] * ((i % 8) * 3 + 7);
+
+    EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes[0] = 8;
+    data.workGroup.numGroups[0] = 2;
+    data.parameter.emplace_back(0, std::vector<uint32_t>(16));
+    data.parameter.emplace_back(0, input);
+
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+    TEST_ASSERT_EQUALS(2u, result.results.size())
+    if(result.results.size() == 2)
+        TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+}
+
+static const std::string DOUBLE_BUFFERED_BLOCK_FUNCTION = R"(
+__attribute__((reqd_work_group_size(8, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  uint base = get_group_id(0) * 16;
+  uint lid = get_local_id(0);
+  out[get_group_id(0) * 8 + lid] = in[base + lid] * 3 + in[base + lid + 8];
+}
+)";
+
+void TestMemoryAccess::testDoubleBufferedWorkGroupBlocks()
+{
+    static constexpr uint32_t NUM_GROUPS = 5;
+    Configuration copy = this->config;
+    copy.optimizationLevel = OptimizationLevel::FULL;
+    copy.additionalOptions.vpmWorkGroupBuffers = 2;
+    copy.additionalEnabledOptimizations.emplace("loop-work-groups");
+
+    {
+        // the next work-group's block is loaded in the same mutex-guarded section it is waited for
+        std::stringstream assembly;
+        Configuration asmConfig = copy;
+        asmConfig.outputMode = OutputMode::ASSEMBLER;
+        asmConfig.writeKernelInfo = false;
+        std::istringstream source(DOUBLE_BUFFERED_BLOCK_FUNCTION);
+        Compiler::compile(source, assembly, asmConfig, "");
+        TEST_ASSERT(!releasesMutexDuringDMA(assembly.str()))
+    }
+
+    std::vector<uint32_t> input(NUM_GROUPS * 16);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 11 + 3;
+    std::vector<uint32_t> expected(NUM_GROUPS * 8);
+    for(uint32_t group = 0; group < NUM_GROUPS; ++group)
+    {
+        for(uint32_t lid = 0; lid < 8; ++lid)
+            expected[group * 8 + lid] = input[group * 16 + lid] * 3 + input[group * 16 + lid + 8];
+    }
+
+    std::stringstream buffer;
+    compileBuffer(copy, buffer, DOUBLE_BUFFERED_BLOCK_FUNCTION, "");
+
+    EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.localSizes[0] = 8;
+    data.workGroup.numGroups[0] = NUM_GROUPS;
+    data.parameter.emplace_back(0, std::vector<uint32_t>(NUM_GROUPS * 8));
+    data.parameter.emplace_back(0, input);
+
+    // all work-groups are executed in a single loop, so each group uses the block prefetched by the previous one
+    const auto result = emulate(data);
+    TEST_ASSERT(result.executionSuccessful)
+    TEST_ASSERT_EQUALS(2u, result.results.size())
+    if(result.results.size() == 2)
+    {
+        TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+        TEST_ASSERT_EQUALS(toString(input), toString(result.results[1].second.value()))
+    }
+}
+
+void TestMemoryAccess::testGlobalDataCompaction()
+{
+    using namespace vc4c::intermediate;
+    Configuration config{};
+    Module mod{config};
+    mod.methods.emplace_back(new Method(mod));
+    Method& kernel = *mod.methods.back();
+    kernel.isKernel = true;
+    kernel.appendToEnd(new BranchLabel(*kernel.addNewLocal(TYPE_LABEL, "%start").local()));
+
+    auto type = kernel.createPointerType(TYPE_INT32, AddressSpace::CONSTANT);
+    auto addGlobal = [&](const std::string& name, uint32_t value) -> const Global* {
+        mod.globalData.emplace_back(Global(name, type, CompoundConstant(TYPE_INT32, Literal(value)), true));
+        return &mod.globalData.back();
+    };
+    auto first = addGlobal("@first", 42);
+    auto duplicate = addGlobal("@duplicate", 42);
+    auto compared = addGlobal("@compared", 42);
+    auto unused = addGlobal("@unused", 42);
+    auto different = addGlobal("@different", 17);
+
+    // the addresses of these globals are only used to load their contents
+    kernel.appendToEnd(new MoveOperation(Value(REG_TMU0_ADDRESS, TYPE_INT32), first->createReference()));
+    auto offset = kernel.addNewLocal(type, "%offset");
+    kernel.appendToEnd(new Operation(OP_ADD, offset, duplicate->createReference(), Value(Literal(4u), TYPE_INT32)));
+    kernel.appendToEnd(new MoveOperation(Value(REG_TMU0_ADDRESS, TYPE_INT32), offset));
+    kernel.appendToEnd(new MoveOperation(Value(REG_VPM_DMA_LOAD_ADDR, TYPE_INT32), different->createReference()));
+    // the address of this global is compared, so it needs to stay distinct
+    kernel.appendToEnd(new Operation(OP_XOR, NOP_REGISTER, compared->createReference(), Value(Literal(4u), TYPE_INT32),
+        COND_ALWAYS, SetFlag::SET_FLAGS));
+    kernel.appendToEnd(new MoveOperation(Value(REG_TMU0_ADDRESS, TYPE_INT32), compared->createReference()));
+
+    normalization::compactGlobalData(mod);
+
+    FastSet<const Global*> remaining;
+    for(const auto& global : mod.globalData)
+        remaining.emplace(&global);
+    FastSet<const Global*> discarded;
+    for(const auto& global : mod.discardedGlobalData)
+        discarded.emplace(&global);
+    TEST_ASSERT_EQUALS(3u, remaining.size())
+    TEST_ASSERT(remaining.find(first) != remaining.end())
+    TEST_ASSERT(remaining.find(compared) != remaining.end())
+    TEST_ASSERT(remaining.find(different) != remaining.end())
+    TEST_ASSERT(discarded.find(duplicate) != discarded.end())
+    TEST_ASSERT(discarded.find(unused) != discarded.end())
+
+    // the access to the duplicate global is redirected to the merged global
+    bool accessesDuplicate = false;
+    bool accessesMerged = false;
+    for(auto it = kernel.walkAllInstructions(); !it.isEndOfMethod(); it.nextInMethod())
+    {
+        if(it.has() && it->getOutput() && it->getOutput()->hasLocal(offset.local()))
+        {
+            accessesDuplicate = it->assertArgument(0).hasLocal(duplicate);
+            accessesMerged = it->assertArgument(0).hasLocal(first);
+        }
+    }
+    TEST_ASSERT(!accessesDuplicate)
+    TEST_ASSERT(accessesMerged)
+}
+
+static const std::string READ_ONLY_BLOCK_FUNCTION = R"(
+__attribute__((reqd_work_group_size(8, 1, 1)))
+__kernel void test(__global int* out, const __global int* in) {
+  uint base = get_group_id(0) * 16;
+  uint lid = get_local_id(0);
+  // the index is loaded from memory, so the output is not accessed as a work-group block
+  out[in[base + lid]] = in[base + lid + 8] * 3;
+}
+)";
+
+void TestMemoryAccess::testReadOnlyWorkGroupBlocks()
+{
+    static constexpr uint32_t NUM_GROUPS = 5;
+    std::vector<uint32_t> input(NUM_GROUPS * 16);
+    std::vector<uint32_t> expected(NUM_GROUPS * 8);
+    for(uint32_t group = 0; group < NUM_GROUPS; ++group)
+    {
+        for(uint32_t lid = 0; lid < 8; ++lid)
+        {
+            // the work-items of every group write the outputs of their group in reverse order
+            input[group * 16 + lid] = group * 8 + (7 - lid);
+            input[group * 16 + lid + 8] = group * 100 + lid * 7 + 1;
+            expected[group * 8 + (7 - lid)] = input[group * 16 + lid + 8] * 3;
+        }
+    }
+
+    // the next work-group must not (pre-)load its blocks while the work-items of the previous group still read them
+    for(auto numBuffers : {1u, 2u})
+    {
+        std::stringstream buffer;
+        Configuration copy = this->config;
+        copy.optimizationLevel = OptimizationLevel::FULL;
+        copy.additionalOptions.vpmWorkGroupBuffers = numBuffers;
+        copy.additionalEnabledOptimizations.emplace("loop-work-groups");
+        compileBuffer(copy, buffer, READ_ONLY_BLOCK_FUNCTION, "");
+
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.workGroup.localSizes[0] = 8;
+        data.workGroup.numGroups[0] = NUM_GROUPS;
+        data.parameter.emplace_back(0, std::vector<uint32_t>(NUM_GROUPS * 8));
+        data.parameter.emplace_back(0, input);
+
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(2u, result.results.size())
+        if(result.results.size() == 2)
+        {
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+            TEST_ASSERT_EQUALS(toString(input), toString(result.results[1].second.value()))
+        }
+    }
+}
+
+static const std::string ALIASED_READ_CACHE_FUNCTION = R"(
+#ifdef CONSTANT_INPUT
+#define INPUT_QUALIFIER __constant
+#else
+#define INPUT_QUALIFIER const __global
+#endif
+
+__attribute__((reqd_work_group_size(1, 1, 1)))
+__kernel void test(__global int* out, INPUT_QUALIFIER int* in) {
+  out[0] = in[0] * 2;
+  out[1] = in[1] + in[2];
+  out[2] = in[3] - in[0];
+  out[3] = in[2] * in[1];
+}
+)";
+
+void TestMemoryAccess::testAliasedReadCache()
+{
+    const std::vector<uint32_t> input{5, 11, 17, 3};
+    const std::vector<uint32_t> expected{10, 28, static_cast<uint32_t>(-2), 187};
+
+    // "in" could point into the same buffer as "out", so only the __constant input can be cached in VPM
+    for(const bool isCached : {false, true})
+    {
+        Configuration copy = this->config;
+        copy.optimizationLevel = OptimizationLevel::FULL;
+        const std::string options = isCached ? "-DCONSTANT_INPUT" : "";
+
+        {
+            // the read cache is the only memory loaded via DMA, since the output can be aliased too
+            std::stringstream assembly;
+            Configuration asmConfig = copy;
+            asmConfig.outputMode = OutputMode::ASSEMBLER;
+            asmConfig.writeKernelInfo = false;
+            std::istringstream source(ALIASED_READ_CACHE_FUNCTION);
+            Compiler::compile(source, assembly, asmConfig, options);
+            TEST_ASSERT_EQUALS(isCached, assembly.str().find("vpr_addr") != std::string::npos)
+        }
+
+        std::stringstream buffer;
+        compileBuffer(copy, buffer, ALIASED_READ_CACHE_FUNCTION, options);
+
+        EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.workGroup.localSizes[0] = 1;
+        data.parameter.emplace_back(0, std::vector<uint32_t>(4));
+        data.parameter.emplace_back(0, input);
+
+        const auto result = emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(2u, result.results.size())
+        if(result.results.size() == 2)
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+    }
+}
@@ -45,6 +45,27 @@ public:
     void testVectorLoadStoreLocalParameter();
     void testVectorLoadStoreGlobalParameter();
 
+    // test caching of read-only memory in VPM
+    void testVPMReadCache();
+    // test the sharing of VPM rows by areas with disjoint live ranges
+    void testVPMLiveRanges();
+    // test the packed VPM layout for arrays too large for one row per element
+    void testVPMPackedAreas();
+    // test the splitting of private aggregates into separate registers
+    void testScalarReplacement();
+    // test the coalescing of the global memory accesses of a work-group into block DMA loads and stores
+    void testWorkGroupBlockAccess();
+    // test that the waiting for asynchronous DMA copies is not moved out of the mutex-guarded section
+    void testAsynchronousCopy();
+    // test the double-buffering of the work-group blocks across the iterations of the work-group loop
+    void testDoubleBufferedWorkGroupBlocks();
+    // test the synchronization of the work-items of a work-group accessing only read-only work-group blocks
+    void testReadOnlyWorkGroupBlocks();
+    // test that read-only memory which could be written via another pointer is not cached in VPM
+    void testAliasedReadCache();
+    // test the removal of unused and the merging of duplicate constant globals
+    void testGlobalDataCompaction();
+
 private:
     void onMismatch(const std::string& expected, const std::string& result);
 };
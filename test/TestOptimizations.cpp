@@ -6,11 +6,16 @@
 
 #include "TestOptimizations.h"
 
+#include "emulation_helper.h"
+#include "test_cases.h"
+
 #include "InstructionWalker.h"
 #include "Method.h"
 #include "Module.h"
 #include "intermediate/IntermediateInstruction.h"
 #include "optimization/Optimizer.h"
+#include "periphery/TMU.h"
+#include "tools.h"
 
 using namespace vc4c;
 
@@ -65,6 +70,14 @@ TestOptimizations::TestOptimizations() : TestEmulator(true)
         TEST_ADD_WITH_STRING(TestOptimizations::testClamp, pass.parameterName);
         TEST_ADD_WITH_STRING(TestOptimizations::testCross, pass.parameterName);
     }
+
+    // test the transformations of single optimizations
+    TEST_ADD(TestOptimizations::testTraceScheduling);
+    TEST_ADD(TestOptimizations::testCombineWindow);
+    TEST_ADD(TestOptimizations::testSuperwordVectorization);
+    TEST_ADD(TestOptimizations::testRuntimeLoopVectorization);
+    TEST_ADD(TestOptimizations::testMutexSections);
+    TEST_ADD(TestOptimizations::testTMULoadScheduling);
     // TODO the profiling info is wrong, since all optimization counters get merged!
     // TEST_ADD(TestEmulator::printProfilingInfo);
     // TODO the test failures are not printed anymore for some reason (neither is the summary line), iff no other test
@@ -265,3 +278,620 @@ void TestOptimizations::testCross(std::string passParamName)
 
     TestEmulator::testFloatEmulations(11, "test_cross");
 }
+
+static bool isWrittenInBlock(const BasicBlock& block, const Local* local)
+{
+    for(const auto& inst : block)
+    {
+        if(inst && inst->writesLocal(local))
+            return true;
+    }
+    return false;
+}
+
+void TestOptimizations::testTraceScheduling()
+{
+    {
+        /*
+         * The NOP at the end of the loop latch is replaced by the calculation from the start of the loop header, the
+         * other predecessor of the header (outside of the loop and thus executed more rarely) receives a copy:
+         *
+         * %entry:
+         *   %x = 3
+         *   br %head
+         * %latch:
+         *   %e = %r + 1
+         *   nop
+         * %head:
+         *   %b = %x + 2
+         *   %r = %b + %x
+         *   %c = 1
+         *   br.zc %c, %latch
+         * %exit:
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto entryLabel = method.addNewLocal(TYPE_LABEL, "%entry").local();
+        auto latchLabel = method.addNewLocal(TYPE_LABEL, "%latch").local();
+        auto headLabel = method.addNewLocal(TYPE_LABEL, "%head").local();
+        auto exitLabel = method.addNewLocal(TYPE_LABEL, "%exit").local();
+        auto x = method.addNewLocal(TYPE_INT32, "%x");
+        auto b = method.addNewLocal(TYPE_INT32, "%b");
+        auto e = method.addNewLocal(TYPE_INT32, "%e");
+        auto r = method.addNewLocal(TYPE_INT32, "%r");
+        auto c = method.addNewLocal(TYPE_BOOL, "%c");
+
+        method.appendToEnd(new intermediate::BranchLabel(*entryLabel));
+        method.appendToEnd(new intermediate::MoveOperation(x, Value(Literal(3u), TYPE_INT32)));
+        method.appendToEnd(new intermediate::Branch(headLabel, COND_ALWAYS, BOOL_TRUE));
+        method.appendToEnd(new intermediate::BranchLabel(*latchLabel));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, e, r, INT_ONE));
+        method.appendToEnd(new intermediate::Nop(intermediate::DelayType::WAIT_REGISTER));
+        method.appendToEnd(new intermediate::BranchLabel(*headLabel));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, b, x, Value(Literal(2u), TYPE_INT32)));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, r, b, x));
+        method.appendToEnd(new intermediate::MoveOperation(c, BOOL_TRUE));
+        method.appendToEnd(new intermediate::Branch(latchLabel, COND_ZERO_CLEAR, c));
+        method.appendToEnd(new intermediate::BranchLabel(*exitLabel));
+
+        TEST_ASSERT(getPass("schedule-traces")(mod, method, config))
+
+        auto latchBlock = method.findBasicBlock(latchLabel);
+        TEST_ASSERT(isWrittenInBlock(*latchBlock, b.local()))
+        TEST_ASSERT(!latchBlock->walkEnd().previousInBlock().get<intermediate::Nop>())
+        TEST_ASSERT(!isWrittenInBlock(*method.findBasicBlock(headLabel), b.local()))
+        // compensation code
+        TEST_ASSERT(isWrittenInBlock(*method.findBasicBlock(entryLabel), b.local()))
+    }
+
+    {
+        /*
+         * The calculation cannot be moved into the first block, since its result is live in the other successor of the
+         * block:
+         *
+         * %start:
+         *   %c = 1
+         *   nop
+         *   br.zc %c, %end
+         * %next:
+         *   %y = 5
+         * %end:
+         *   %r = %y + 1
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto startLabel = method.addNewLocal(TYPE_LABEL, "%start").local();
+        auto nextLabel = method.addNewLocal(TYPE_LABEL, "%next").local();
+        auto endLabel = method.addNewLocal(TYPE_LABEL, "%end").local();
+        auto y = method.addNewLocal(TYPE_INT32, "%y");
+        auto r = method.addNewLocal(TYPE_INT32, "%r");
+        auto c = method.addNewLocal(TYPE_BOOL, "%c");
+
+        method.appendToEnd(new intermediate::BranchLabel(*startLabel));
+        method.appendToEnd(new intermediate::MoveOperation(c, BOOL_TRUE));
+        method.appendToEnd(new intermediate::Nop(intermediate::DelayType::WAIT_REGISTER));
+        method.appendToEnd(new intermediate::Branch(endLabel, COND_ZERO_CLEAR, c));
+        method.appendToEnd(new intermediate::BranchLabel(*nextLabel));
+        method.appendToEnd(new intermediate::MoveOperation(y, Value(Literal(5u), TYPE_INT32)));
+        method.appendToEnd(new intermediate::BranchLabel(*endLabel));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, r, y, INT_ONE));
+
+        TEST_ASSERT(!getPass("schedule-traces")(mod, method, config))
+        TEST_ASSERT(!isWrittenInBlock(*method.findBasicBlock(startLabel), y.local()))
+        TEST_ASSERT(isWrittenInBlock(*method.findBasicBlock(nextLabel), y.local()))
+    }
+}
+
+static unsigned countCombinedOperations(const BasicBlock& block)
+{
+    unsigned count = 0;
+    for(const auto& inst : block)
+    {
+        if(dynamic_cast<const intermediate::CombinedOperation*>(inst.get()))
+            ++count;
+    }
+    return count;
+}
+
+void TestOptimizations::testCombineWindow()
+{
+    {
+        /*
+         * The instructions directly following each other cannot be combined (dependency, too many inputs), but the
+         * first and the third instruction can:
+         *
+         * %a = add %x, %y
+         * %b = add %a, %y
+         * %c = mul24 %x, %y
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto x = method.addNewLocal(TYPE_INT32, "%x");
+        auto y = method.addNewLocal(TYPE_INT32, "%y");
+        auto a = method.addNewLocal(TYPE_INT32, "%a");
+        auto b = method.addNewLocal(TYPE_INT32, "%b");
+        auto c = method.addNewLocal(TYPE_INT32, "%c");
+
+        method.appendToEnd(new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, a, x, y));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, b, a, y));
+        method.appendToEnd(new intermediate::Operation(OP_MUL24, c, x, y));
+
+        TEST_ASSERT(getPass("combine")(mod, method, config))
+        TEST_ASSERT_EQUALS(1u, countCombinedOperations(*method.begin()))
+        // label, combined instruction and the second addition
+        TEST_ASSERT_EQUALS(3u, method.countInstructions())
+        auto it = method.begin()->walk().nextInBlock();
+        TEST_ASSERT(it.get<intermediate::CombinedOperation>() != nullptr)
+        TEST_ASSERT(it->writesLocal(a.local()))
+        TEST_ASSERT(it->writesLocal(c.local()))
+        TEST_ASSERT(it.nextInBlock()->writesLocal(b.local()))
+    }
+
+    {
+        /*
+         * The third instruction cannot be moved over the access of the periphery to be combined with the first one:
+         *
+         * %a = add %x, %y
+         * tmu0_s = %z
+         * %c = mul24 %x, %y
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto x = method.addNewLocal(TYPE_INT32, "%x");
+        auto y = method.addNewLocal(TYPE_INT32, "%y");
+        auto z = method.addNewLocal(TYPE_INT32, "%z");
+        auto a = method.addNewLocal(TYPE_INT32, "%a");
+        auto c = method.addNewLocal(TYPE_INT32, "%c");
+
+        method.appendToEnd(new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, a, x, y));
+        method.appendToEnd(new intermediate::MoveOperation(Value(REG_TMU0_ADDRESS, TYPE_INT32), z));
+        method.appendToEnd(new intermediate::Operation(OP_MUL24, c, x, y));
+
+        TEST_ASSERT(!getPass("combine")(mod, method, config))
+        TEST_ASSERT_EQUALS(0u, countCombinedOperations(*method.begin()))
+        TEST_ASSERT_EQUALS(4u, method.countInstructions())
+    }
+
+    {
+        // the exhaustive search is limited to small windows
+        Configuration config{};
+        TEST_ASSERT(tools::parseConfigurationParameter(config, "--fcombine-window=16"))
+        TEST_ASSERT_EQUALS(16u, config.additionalOptions.combineWindowSize)
+        TEST_ASSERT(!tools::parseConfigurationParameter(config, "--fcombine-window=17"))
+        TEST_ASSERT_EQUALS(16u, config.additionalOptions.combineWindowSize)
+    }
+}
+
+static const intermediate::Operation* findVectorOperation(const BasicBlock& block, OpCode code)
+{
+    for(const auto& inst : block)
+    {
+        auto op = dynamic_cast<const intermediate::Operation*>(inst.get());
+        if(op && op->op == code && op->getOutput() && op->getOutput()->type.isVectorType())
+            return op;
+    }
+    return nullptr;
+}
+
+void TestOptimizations::testSuperwordVectorization()
+{
+    {
+        /*
+         * The 16 independent scalar calculations are replaced with two vector operations, the scalar results are
+         * extracted from the vector result:
+         *
+         * %u = 7
+         * %t.i = add %u, i (for i = 0..15)
+         * %r.i = mul24 %t.i, 3 (for i = 0..15)
+         *
+         * The vector operations only keep the decorations common to all scalar operations.
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto u = method.addNewLocal(TYPE_INT32, "%u");
+        method.appendToEnd(new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new intermediate::MoveOperation(u, Value(Literal(7u), TYPE_INT32)));
+        std::vector<Value> temporaries;
+        std::vector<Value> results;
+        for(uint32_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            temporaries.push_back(method.addNewLocal(TYPE_INT32, "%t"));
+            auto decorations = i % 2 == 0 ?
+                add_flag(intermediate::InstructionDecorations::UNSIGNED_RESULT,
+                    intermediate::InstructionDecorations::NO_NAN) :
+                intermediate::InstructionDecorations::UNSIGNED_RESULT;
+            method.appendToEnd(
+                (new intermediate::Operation(OP_ADD, temporaries.back(), u, Value(Literal(i), TYPE_INT32)))
+                    ->addDecorations(decorations));
+        }
+        for(uint32_t i = 0; i < NATIVE_VECTOR_SIZE; ++i)
+        {
+            results.push_back(method.addNewLocal(TYPE_INT32, "%r"));
+            method.appendToEnd(
+                new intermediate::Operation(OP_MUL24, results.back(), temporaries[i], Value(Literal(3u), TYPE_INT32)));
+        }
+
+        TEST_ASSERT(getPass("vectorize-superwords")(mod, method, config))
+        auto vectorAdd = findVectorOperation(*method.begin(), OP_ADD);
+        TEST_ASSERT(vectorAdd != nullptr)
+        if(vectorAdd)
+        {
+            TEST_ASSERT(vectorAdd->hasDecoration(intermediate::InstructionDecorations::UNSIGNED_RESULT))
+            TEST_ASSERT(!vectorAdd->hasDecoration(intermediate::InstructionDecorations::NO_NAN))
+        }
+        TEST_ASSERT(findVectorOperation(*method.begin(), OP_MUL24) != nullptr)
+        for(const auto& tmp : temporaries)
+            TEST_ASSERT(!isWrittenInBlock(*method.begin(), tmp.local()))
+        // the scalar results are still written, since they are used outside of the vectorized operations
+        for(const auto& res : results)
+            TEST_ASSERT(isWrittenInBlock(*method.begin(), res.local()))
+    }
+
+    {
+        /*
+         * Vectorizing two scalar operations with independent operands does not pay off, since all operands need to be
+         * inserted into the vectors:
+         *
+         * %r0 = add %x0, %y0
+         * %r1 = add %x1, %y1
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto x0 = method.addNewLocal(TYPE_INT32, "%x0");
+        auto x1 = method.addNewLocal(TYPE_INT32, "%x1");
+        auto y0 = method.addNewLocal(TYPE_INT32, "%y0");
+        auto y1 = method.addNewLocal(TYPE_INT32, "%y1");
+        auto r0 = method.addNewLocal(TYPE_INT32, "%r0");
+        auto r1 = method.addNewLocal(TYPE_INT32, "%r1");
+        method.appendToEnd(new intermediate::BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, r0, x0, y0));
+        method.appendToEnd(new intermediate::Operation(OP_ADD, r1, x1, y1));
+
+        TEST_ASSERT(!getPass("vectorize-superwords")(mod, method, config))
+        TEST_ASSERT(findVectorOperation(*method.begin(), OP_ADD) == nullptr)
+        TEST_ASSERT_EQUALS(3u, method.countInstructions())
+    }
+}
+
+static const std::string RUNTIME_LOOP_STORE = R"(
+__kernel void test(__global int* out, __global const int* in, unsigned count) {
+  for(unsigned i = 0; i < count; ++i) {
+    out[i] = in[i] * 3 + 1;
+  }
+}
+)";
+
+static const std::string RUNTIME_LOOP_ACCUMULATORS = R"(
+__kernel void test(__global int* out, __global const int* in, unsigned count) {
+  int sum = 0;
+  int diff = 7;
+  for(unsigned i = 0; i < count; ++i) {
+    sum += in[i];
+    diff -= in[i] * 2;
+  }
+  out[0] = sum;
+  out[1] = diff;
+}
+)";
+
+// the induction variable crosses 2^31 for iteration counts of 16 and more
+static const std::string RUNTIME_LOOP_UNSIGNED = R"(
+__kernel void test(__global int* out, __global const int* in, unsigned bound) {
+  for(unsigned i = 0x7FFFFFF0u; i < bound; ++i) {
+    out[i - 0x7FFFFFF0u] = in[i - 0x7FFFFFF0u] * 3 + 1;
+  }
+}
+)";
+
+static std::vector<uint32_t> runRuntimeLoop(
+    const Configuration& config, const std::string& source, const std::vector<uint32_t>& input, uint32_t count)
+{
+    Configuration copy = config;
+    std::stringstream buffer;
+    compileBuffer(copy, buffer, source, "");
+
+    tools::EmulationData data;
+    data.kernelName = "test";
+    data.maxEmulationCycles = 1 << 16;
+    data.module = std::make_pair("", &buffer);
+    data.workGroup.globalOffsets = {0, 0, 0};
+    data.workGroup.localSizes = {1, 1, 1};
+    data.workGroup.numGroups = {1, 1, 1};
+    // the output buffer is pre-filled to check that no element after the iteration count is written
+    data.parameter.emplace_back(0u, std::vector<uint32_t>(input.size(), 0x42));
+    data.parameter.emplace_back(0u, input);
+    data.parameter.emplace_back(count, Optional<std::vector<uint32_t>>{});
+
+    const auto result = tools::emulate(data);
+    if(!result.executionSuccessful)
+        return {};
+    return *result.results.front().second;
+}
+
+void TestOptimizations::testRuntimeLoopVectorization()
+{
+    config.additionalEnabledOptimizations = {"vectorize-loops"};
+    config.optimizationLevel = OptimizationLevel::NONE;
+
+    std::vector<uint32_t> input(32);
+    for(uint32_t i = 0; i < input.size(); ++i)
+        input[i] = i * 5 + 3;
+
+    // iteration counts which are no multiple of the vectorization factor need to handle the remaining elements (or
+    // exit the loop immediately), the loop exits via an explicit branch to its successor
+    for(uint32_t count : {0u, 1u, 13u, 16u, 29u})
+    {
+        auto out = runRuntimeLoop(config, RUNTIME_LOOP_STORE, input, count);
+        TEST_ASSERT_EQUALS(input.size(), out.size())
+        if(out.size() != input.size())
+            continue;
+        for(uint32_t i = 0; i < input.size(); ++i)
+        {
+            auto expected = i < count ? input[i] * 3 + 1 : 0x42u;
+            TEST_ASSERT_EQUALS(expected, out[i])
+        }
+    }
+
+    // both accumulators keep their previous values for the SIMD elements exceeding the iteration count
+    for(uint32_t count : {0u, 1u, 13u, 16u, 29u})
+    {
+        auto out = runRuntimeLoop(config, RUNTIME_LOOP_ACCUMULATORS, input, count);
+        TEST_ASSERT_EQUALS(input.size(), out.size())
+        if(out.size() != input.size())
+            continue;
+        int32_t sum = 0;
+        int32_t diff = 7;
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            sum += static_cast<int32_t>(input[i]);
+            diff -= static_cast<int32_t>(input[i]) * 2;
+        }
+        TEST_ASSERT_EQUALS(sum, static_cast<int32_t>(out[0]))
+        TEST_ASSERT_EQUALS(diff, static_cast<int32_t>(out[1]))
+    }
+
+    // unsigned bounds are compared unsigned, also if they do not fit into a signed integer
+    for(uint32_t count : {0u, 13u, 16u, 29u})
+    {
+        auto out = runRuntimeLoop(config, RUNTIME_LOOP_UNSIGNED, input, 0x7FFFFFF0u + count);
+        TEST_ASSERT_EQUALS(input.size(), out.size())
+        if(out.size() != input.size())
+            continue;
+        for(uint32_t i = 0; i < input.size(); ++i)
+        {
+            auto expected = i < count ? input[i] * 3 + 1 : 0x42u;
+            TEST_ASSERT_EQUALS(expected, out[i])
+        }
+    }
+}
+
+static unsigned countMutexAccesses(const BasicBlock& block, intermediate::MutexAccess access)
+{
+    unsigned count = 0;
+    for(const auto& inst : block)
+    {
+        auto mutex = dynamic_cast<const intermediate::MutexLock*>(inst.get());
+        if(mutex && (access == intermediate::MutexAccess::LOCK ? mutex->locksMutex() : mutex->releasesMutex()))
+            ++count;
+    }
+    return count;
+}
+
+void TestOptimizations::testMutexSections()
+{
+    using namespace vc4c::intermediate;
+    {
+        /*
+         * The two critical sections are merged and the independent multiplication is moved before the mutex acquire:
+         *
+         * mutex_acq
+         * vpr_setup = %s
+         * %1 = vpm
+         * mutex_rel
+         * %2 = add %1, 4
+         * mutex_acq
+         * %3 = mul24 %a, %b
+         * vpm = %2
+         * mutex_rel
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto s = method.addNewLocal(TYPE_INT32, "%s");
+        auto a = method.addNewLocal(TYPE_INT32, "%a");
+        auto b = method.addNewLocal(TYPE_INT32, "%b");
+        auto v1 = method.addNewLocal(TYPE_INT32, "%1");
+        auto v2 = method.addNewLocal(TYPE_INT32, "%2");
+        auto v3 = method.addNewLocal(TYPE_INT32, "%3");
+
+        method.appendToEnd(new BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new MutexLock(MutexAccess::LOCK));
+        method.appendToEnd(new MoveOperation(Value(REG_VPM_IN_SETUP, TYPE_INT32), s));
+        method.appendToEnd(new MoveOperation(v1, Value(REG_VPM_IO, TYPE_INT32)));
+        method.appendToEnd(new MutexLock(MutexAccess::RELEASE));
+        method.appendToEnd(new Operation(OP_ADD, v2, v1, Value(Literal(4u), TYPE_INT32)));
+        method.appendToEnd(new MutexLock(MutexAccess::LOCK));
+        method.appendToEnd(new Operation(OP_MUL24, v3, a, b));
+        method.appendToEnd(new MoveOperation(Value(REG_VPM_IO, TYPE_INT32), v2));
+        method.appendToEnd(new MutexLock(MutexAccess::RELEASE));
+
+        TEST_ASSERT(getPass("minimize-mutex-sections")(mod, method, config))
+        auto& block = *method.begin();
+        TEST_ASSERT_EQUALS(1u, countMutexAccesses(block, MutexAccess::LOCK))
+        TEST_ASSERT_EQUALS(1u, countMutexAccesses(block, MutexAccess::RELEASE))
+        // label, multiplication, acquire, setup, read, addition, write, release
+        TEST_ASSERT_EQUALS(8u, method.countInstructions())
+        auto it = method.begin()->walk().nextInBlock();
+        TEST_ASSERT(it->writesLocal(v3.local()))
+        TEST_ASSERT(it.nextInBlock().get<MutexLock>() != nullptr)
+        it = block.walkEnd().previousInBlock();
+        TEST_ASSERT(it.get<MutexLock>() != nullptr && it.get<MutexLock>()->releasesMutex())
+        TEST_ASSERT(it.previousInBlock()->getOutput() && it->getOutput()->hasRegister(REG_VPM_IO))
+    }
+
+    {
+        // critical sections separated by a semaphore access or too many instructions are not merged
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto v1 = method.addNewLocal(TYPE_INT32, "%1");
+        auto v2 = method.addNewLocal(TYPE_INT32, "%2");
+
+        method.appendToEnd(new BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        method.appendToEnd(new MutexLock(MutexAccess::LOCK));
+        method.appendToEnd(new MoveOperation(v1, Value(REG_VPM_IO, TYPE_INT32)));
+        method.appendToEnd(new MutexLock(MutexAccess::RELEASE));
+        method.appendToEnd(new SemaphoreAdjustment(Semaphore::BARRIER_SFU_SLICE_0, true));
+        method.appendToEnd(new MutexLock(MutexAccess::LOCK));
+        method.appendToEnd(new MoveOperation(Value(REG_VPM_IO, TYPE_INT32), v1));
+        method.appendToEnd(new MutexLock(MutexAccess::RELEASE));
+        for(unsigned i = 0; i < 9; ++i)
+            method.appendToEnd(new Operation(OP_ADD, v2, v1, Value(Literal(i), TYPE_INT32)));
+        method.appendToEnd(new MutexLock(MutexAccess::LOCK));
+        method.appendToEnd(new MoveOperation(Value(REG_VPM_IO, TYPE_INT32), v2));
+        method.appendToEnd(new MutexLock(MutexAccess::RELEASE));
+
+        TEST_ASSERT(!getPass("minimize-mutex-sections")(mod, method, config))
+        TEST_ASSERT_EQUALS(3u, countMutexAccesses(*method.begin(), MutexAccess::LOCK))
+        TEST_ASSERT_EQUALS(3u, countMutexAccesses(*method.begin(), MutexAccess::RELEASE))
+    }
+}
+
+static void appendTMULoad(Method& method, const Value& address, const Value& result)
+{
+    method.appendToEnd(new intermediate::MoveOperation(periphery::TMU0.getAddress(address.type), address));
+    method.appendToEnd(new intermediate::Nop(intermediate::DelayType::WAIT_TMU, periphery::TMU0.signal));
+    method.appendToEnd(new intermediate::MoveOperation(result, periphery::TMU_READ_REGISTER));
+}
+
+static const std::string TMU_LOADS_FUNCTION = R"(
+__kernel void test(__global int* out, const __global int* in) {
+  uint gid = get_global_id(0);
+  int sum = 0;
+  // more independent loads than fit into the queues of both TMUs
+  sum += in[gid] * 1;
+  sum += in[gid + 8] * 2;
+  sum += in[gid + 16] * 3;
+  sum += in[gid + 24] * 4;
+  sum += in[gid + 32] * 5;
+  sum += in[gid + 40] * 6;
+  sum += in[gid + 48] * 7;
+  sum += in[gid + 56] * 8;
+  sum += in[gid + 64] * 9;
+  sum += in[gid + 72] * 10;
+  out[gid] = sum;
+}
+)";
+
+void TestOptimizations::testTMULoadScheduling()
+{
+    using namespace vc4c::intermediate;
+    {
+        /*
+         * The independent loads are distributed over both TMUs and all results are read after the last address write:
+         *
+         * tmu0_s = %a0, load_tmu0, %r0 = r4
+         * tmu0_s = %a1, load_tmu0, %r1 = r4
+         * tmu0_s = %a2, load_tmu0, %r2 = r4
+         */
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        std::vector<Value> addresses;
+        std::vector<Value> results;
+        for(unsigned i = 0; i < 3; ++i)
+        {
+            addresses.emplace_back(method.addNewLocal(TYPE_VOID_POINTER, "%a"));
+            results.emplace_back(method.addNewLocal(TYPE_INT32, "%r"));
+        }
+
+        method.appendToEnd(new BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        for(unsigned i = 0; i < 3; ++i)
+            appendTMULoad(method, addresses[i], results[i]);
+
+        TEST_ASSERT(getPass("schedule-tmu-loads")(mod, method, config))
+        TEST_ASSERT_EQUALS(10u, method.countInstructions())
+        auto it = method.begin()->walk().nextInBlock();
+        TEST_ASSERT(it->writesRegister(REG_TMU0_ADDRESS))
+        TEST_ASSERT(it.nextInBlock()->writesRegister(REG_TMU1_ADDRESS))
+        TEST_ASSERT(it.nextInBlock()->writesRegister(REG_TMU0_ADDRESS))
+        // the results are read in the order of the address writes
+        for(unsigned i = 0; i < 3; ++i)
+        {
+            const auto& tmu = i % 2 == 0 ? periphery::TMU0 : periphery::TMU1;
+            TEST_ASSERT(it.nextInBlock().get<Nop>() != nullptr)
+            TEST_ASSERT(it->signal == tmu.signal)
+            TEST_ASSERT(it.nextInBlock()->writesLocal(results[i].local()))
+        }
+    }
+
+    {
+        // the address of the second load depends on the result of the first load, so they cannot be pipelined
+        Configuration config{};
+        Module mod{config};
+        Method method{mod};
+
+        auto address = method.addNewLocal(TYPE_VOID_POINTER, "%a");
+        auto pointer = method.addNewLocal(TYPE_VOID_POINTER, "%p");
+        auto result = method.addNewLocal(TYPE_INT32, "%r");
+
+        method.appendToEnd(new BranchLabel(*method.addNewLocal(TYPE_LABEL).local()));
+        appendTMULoad(method, address, pointer);
+        appendTMULoad(method, pointer, result);
+
+        TEST_ASSERT(!getPass("schedule-tmu-loads")(mod, method, config))
+        auto it = method.begin()->walk().nextInBlock();
+        TEST_ASSERT(it->writesRegister(REG_TMU0_ADDRESS))
+        TEST_ASSERT(it.nextInBlock().get<Nop>() != nullptr)
+        TEST_ASSERT(it.nextInBlock()->writesLocal(pointer.local()))
+    }
+
+    {
+        // the result is the same with more loads than can be queued at once
+        std::stringstream buffer;
+        Configuration copy = this->config;
+        copy.additionalEnabledOptimizations.emplace("schedule-tmu-loads");
+        compileBuffer(copy, buffer, TMU_LOADS_FUNCTION, "");
+
+        std::vector<uint32_t> input(80);
+        for(uint32_t i = 0; i < input.size(); ++i)
+            input[i] = i * 17 + 3;
+        std::vector<uint32_t> expected(8);
+        for(uint32_t i = 0; i < expected.size(); ++i)
+        {
+            for(uint32_t k = 0; k < 10; ++k)
+                expected[i] += input[i + k * 8] * (k + 1);
+        }
+
+        tools::EmulationData data;
+        data.kernelName = "test";
+        data.maxEmulationCycles = vc4c::test::maxExecutionCycles;
+        data.module = std::make_pair("", &buffer);
+        data.workGroup.localSizes[0] = 8;
+        data.parameter.emplace_back(0, std::vector<uint32_t>(8));
+        data.parameter.emplace_back(0, input);
+
+        const auto result = tools::emulate(data);
+        TEST_ASSERT(result.executionSuccessful)
+        TEST_ASSERT_EQUALS(2u, result.results.size())
+        if(result.results.size() == 2)
+            TEST_ASSERT_EQUALS(toString(expected), toString(result.results[0].second.value()))
+    }
+}
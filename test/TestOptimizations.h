@@ -42,6 +42,13 @@ public:
     void testArithmetic(std::string passParamName);
     void testClamp(std::string passParamName);
     void testCross(std::string passParamName);
+
+    void testTraceScheduling();
+    void testCombineWindow();
+    void testSuperwordVectorization();
+    void testRuntimeLoopVectorization();
+    void testMutexSections();
+    void testTMULoadScheduling();
 };
 
 #endif /* VC4C_TEST_OPTIMIZATIONS_H */
@@ -5,6 +5,7 @@
  */
 
 #include "tools/Emulator.h"
+#include "CompilationError.h"
 #include "Compiler.h"
 #include "Locals.h"
 #include "Profiler.h"
@@ -13,6 +14,8 @@
 
 #include "log.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -146,6 +149,239 @@ static std::vector<tools::Word> readDirectBuffer(std::string data)
     return words;
 }
 
+/*
+ * Reads the buffer parameter for the given flag and its value, returns whether the flag is a buffer parameter flag
+ */
+static bool readBufferParameter(const std::string& flag, const std::string& value,
+    std::vector<std::pair<uint32_t, Optional<std::vector<uint32_t>>>>& parameter, std::vector<BufferType>& bufferTypes)
+{
+    if(flag == "-f")
+    {
+        parameter.emplace_back(0u, readBinaryFile(value));
+        bufferTypes.push_back(BufferType::BINARY);
+    }
+    else if(flag == "-s")
+    {
+        parameter.emplace_back(0u, readDirectData(value));
+        bufferTypes.push_back(BufferType::CHARACTER);
+    }
+    else if(flag == "-b")
+    {
+        parameter.emplace_back(
+            0u, std::vector<tools::Word>(static_cast<std::size_t>(std::strtol(value.data(), nullptr, 0)), 0x0));
+        bufferTypes.push_back(BufferType::BINARY);
+    }
+    else if(flag == "-ib")
+    {
+        parameter.emplace_back(0u, readDirectBuffer<int>(value));
+        bufferTypes.push_back(BufferType::INT);
+    }
+    else if(flag == "-fb")
+    {
+        parameter.emplace_back(0u, readDirectBuffer<float>(value));
+        bufferTypes.push_back(BufferType::FLOAT);
+    }
+    else
+        return false;
+    return true;
+}
+
+/*
+ * Splits the line into its white-space separated tokens, tokens can be quoted with double-quotes
+ */
+static std::vector<std::string> splitManifestLine(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::string token;
+    bool inQuotes = false;
+    bool hasToken = false;
+    for(char c : line)
+    {
+        if(c == '"')
+        {
+            inQuotes = !inQuotes;
+            hasToken = true;
+        }
+        else if(!inQuotes && std::isspace(static_cast<unsigned char>(c)))
+        {
+            if(hasToken)
+                tokens.emplace_back(std::move(token));
+            token.clear();
+            hasToken = false;
+        }
+        else
+        {
+            token.push_back(c);
+            hasToken = true;
+        }
+    }
+    if(hasToken)
+        tokens.emplace_back(std::move(token));
+    return tokens;
+}
+
+static std::array<uint32_t, 3> readSizes(const std::vector<std::string>& tokens, const std::string& line)
+{
+    if(tokens.size() != 4)
+        throw CompilationError(CompilationStep::GENERAL, "Expected 3 sizes in the manifest line", line);
+    std::array<uint32_t, 3> sizes{};
+    for(std::size_t i = 0; i < sizes.size(); ++i)
+        sizes[i] = static_cast<uint32_t>(std::strtol(tokens[i + 1].data(), nullptr, 0));
+    return sizes;
+}
+
+/*
+ * Reads the manifest of a batch emulation.
+ *
+ * Every "kernel <input-file> [kernel-name]" line starts a new kernel, all following lines up to the next kernel line
+ * apply to this kernel:
+ * - "options <compilation-options>" adds a set of compilation options, every set is compiled separately
+ * - "args <args>" adds a set of parameters in the same format as the [args] of the single emulation
+ * - "local <x> <y> <z>" and "groups <x> <y> <z>" add the local sizes and the number of work-groups
+ * - "cycles <max-cycles>" sets the maximum number of cycles of a single run
+ * All combinations of the compilation options, parameter sets, local sizes and numbers of work-groups are emulated.
+ * Empty lines and lines starting with '#' are ignored.
+ */
+static std::vector<BatchConfiguration> readBatchManifest(const std::string& fileName)
+{
+    std::ifstream manifest(fileName);
+    if(!manifest)
+        throw CompilationError(CompilationStep::GENERAL, "Failed to open batch manifest", fileName);
+
+    struct KernelEntry
+    {
+        BatchConfiguration base;
+        std::vector<std::string> options;
+        std::vector<std::array<uint32_t, 3>> localSizes;
+        std::vector<std::array<uint32_t, 3>> numGroups;
+    };
+    std::vector<KernelEntry> kernels;
+
+    std::string line;
+    while(std::getline(manifest, line))
+    {
+        auto tokens = splitManifestLine(line);
+        if(tokens.empty() || tokens.front().front() == '#')
+            continue;
+        const auto& command = tokens.front();
+        if(command == "kernel")
+        {
+            if(tokens.size() < 2 || tokens.size() > 3)
+                throw CompilationError(CompilationStep::GENERAL, "Invalid kernel line in the manifest", line);
+            kernels.emplace_back();
+            kernels.back().base.inputFile = tokens[1];
+            if(tokens.size() == 3)
+                kernels.back().base.kernelName = tokens[2];
+            continue;
+        }
+        if(kernels.empty())
+            throw CompilationError(CompilationStep::GENERAL, "Manifest line is not preceded by a kernel line", line);
+        auto& kernel = kernels.back();
+        if(command == "options")
+        {
+            std::string options;
+            for(std::size_t i = 1; i < tokens.size(); ++i)
+                options.append(i > 1 ? " " : "").append(tokens[i]);
+            kernel.options.emplace_back(std::move(options));
+        }
+        else if(command == "args")
+        {
+            std::vector<std::pair<uint32_t, Optional<std::vector<uint32_t>>>> parameter;
+            std::vector<BufferType> bufferTypes;
+            std::string name;
+            for(std::size_t i = 1; i < tokens.size(); ++i)
+            {
+                name.append(i > 1 ? " " : "").append(tokens[i]);
+                if(i + 1 < tokens.size() && readBufferParameter(tokens[i], tokens[i + 1], parameter, bufferTypes))
+                    name.append(" ").append(tokens[++i]);
+                else
+                    parameter.emplace_back(static_cast<tools::Word>(std::strtol(tokens[i].data(), nullptr, 0)),
+                        Optional<std::vector<uint32_t>>{});
+            }
+            kernel.base.parameterSets.emplace_back(std::move(name), std::move(parameter));
+        }
+        else if(command == "local")
+            kernel.localSizes.emplace_back(readSizes(tokens, line));
+        else if(command == "groups")
+            kernel.numGroups.emplace_back(readSizes(tokens, line));
+        else if(command == "cycles" && tokens.size() == 2)
+            kernel.base.maxEmulationCycles = static_cast<uint32_t>(std::strtoul(tokens[1].data(), nullptr, 0));
+        else
+            throw CompilationError(CompilationStep::GENERAL, "Invalid line in the manifest", line);
+    }
+
+    std::vector<BatchConfiguration> configurations;
+    for(auto& kernel : kernels)
+    {
+        if(kernel.options.empty())
+            kernel.options.emplace_back();
+        if(kernel.localSizes.empty())
+            kernel.localSizes.push_back({{1, 1, 1}});
+        if(kernel.numGroups.empty())
+            kernel.numGroups.push_back({{1, 1, 1}});
+        if(kernel.base.parameterSets.empty())
+            kernel.base.parameterSets.emplace_back();
+        for(const auto& localSizes : kernel.localSizes)
+        {
+            for(const auto& numGroups : kernel.numGroups)
+            {
+                WorkGroupConfig workGroup;
+                workGroup.localSizes = localSizes;
+                workGroup.numGroups = numGroups;
+                kernel.base.workGroups.emplace_back(workGroup);
+            }
+        }
+        for(const auto& options : kernel.options)
+        {
+            configurations.emplace_back(kernel.base);
+            configurations.back().compilationOptions = options;
+        }
+    }
+    return configurations;
+}
+
+static int runBatch(int argc, char** argv)
+{
+    uint32_t numThreads = 0;
+    bool writeJSON = false;
+    std::string outputFile;
+    for(int i = 2; i < argc - 1; ++i)
+    {
+        if(std::string("-t") == argv[i] && i + 1 < argc - 1)
+            numThreads = static_cast<uint32_t>(std::strtol(argv[++i], nullptr, 0));
+        else if(std::string("--json") == argv[i])
+            writeJSON = true;
+        else if(std::string("-o") == argv[i] && i + 1 < argc - 1)
+            outputFile = argv[++i];
+        else if(std::string("-q") == argv[i] || std::string("--quiet") == argv[i])
+            setLogger(std::wcout, true, LogLevel::WARNING);
+        else if(std::string("--verbose") == argv[i])
+            setLogger(std::wcout, true, LogLevel::DEBUG);
+        else
+        {
+            std::cerr << "Unknown batch option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    const auto configurations = readBatchManifest(argv[argc - 1]);
+    const auto results = emulateBatch(configurations, numThreads);
+
+    std::ofstream file;
+    if(!outputFile.empty())
+        file.open(outputFile);
+    std::ostream& output = outputFile.empty() ? std::cout : file;
+    if(writeJSON)
+        writeBatchResultsJSON(output, configurations, results);
+    else
+        writeBatchResultsCSV(output, configurations, results);
+
+    return std::all_of(results.begin(), results.end(),
+               [](const BatchResult& result) -> bool { return result.error.empty(); }) ?
+        0 :
+        1;
+}
+
 static void printHelp()
 {
     std::cout << "Usage: emulator [-k <kernel-name>] [-d <dump-file>] [-l <local-sizes>] [-g <global-sizes>] [args] "
@@ -162,7 +398,32 @@ static void printHelp()
     std::cout << "\t-g <num-groups>\t\tUses the given number of work-groups in the format x y z (3 parameter), "
                  "defaults to single execution"
               << std::endl;
+    std::cout << "\t-t <num-threads>\tEmulates independent work-groups on the given number of host threads, 0 for "
+                 "all hardware threads, defaults to 1"
+              << std::endl;
     std::cout << "\t-i <dump-file>\t\tWrites the result of the instrumentation into the file specified" << std::endl;
+    std::cout << "\t-p <report-file>\tWrites the hot-spot report with the annotated disassembly into the file specified"
+              << std::endl;
+    std::cout << "\t-c <callgrind-file>\tWrites the profile in the callgrind format into the file specified"
+              << std::endl;
+    std::cout << "\t--trace <trace-file>\tWrites the execution trace in the Chrome trace-event format into the file "
+                 "specified"
+              << std::endl;
+    std::cout << "\t-a <hex-file>\t\tUses the comments of the hexadecimal compiler output for the module to decorate "
+                 "the hot-spot profile"
+              << std::endl;
+    std::cout << "\t--stop-cycle <cycle>\tStops the emulation before the given cycle" << std::endl;
+    std::cout << "\t--stop-instruction <index>\tStops the emulation before any QPU executes the instruction with the "
+                 "given index"
+              << std::endl;
+    std::cout << "\t--checkpoint <file>\tWrites the checkpoint of the emulation state into the file specified, when "
+                 "the emulation is stopped"
+              << std::endl;
+    std::cout << "\t--restore <file>\tRestores the emulation state from the checkpoint file specified and continues "
+                 "the emulation from there"
+              << std::endl;
+    std::cout << "\t--no-skip-stalls\tEmulates every cycle all QPUs are stalled instead of skipping them at once"
+              << std::endl;
     std::cout << "\t-o <number>\t\tSpecifies the given parameter index as output and prints it when finished"
               << std::endl;
     std::cout << "\t-h, --help\t\tPrint this help message" << std::endl;
@@ -179,6 +440,23 @@ static void printHelp()
                  "space-separated inside a string (double-quotes, e.g. \"0.0 1.0 2.0 3.0 ...\")"
               << std::endl;
     std::cout << "\t<data>\t\t\tUse <data> as input word" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Usage: emulator --batch [-t <num-threads>] [--json] [-o <output-file>] manifest-file" << std::endl;
+    std::cout << "\tRuns all combinations of the kernels, compilation options, arguments, local sizes and numbers of "
+                 "work-groups given in the manifest and prints a table of the results (CSV or JSON)"
+              << std::endl;
+    std::cout << "\t-t <num-threads>\tRuns the emulations on the given number of host threads, defaults to 0 for all "
+                 "hardware threads"
+              << std::endl;
+    std::cout << "\t-o <output-file>\tWrites the table into the given file instead of the standard output"
+              << std::endl;
+    std::cout << "manifest lines (all lines after a kernel line apply to this kernel):" << std::endl;
+    std::cout << "\tkernel <input-file> [<kernel-name>]\tThe OpenCL C source or compiled module to run" << std::endl;
+    std::cout << "\toptions <options>\tAdds a set of compilation options" << std::endl;
+    std::cout << "\targs <args>\t\tAdds a set of [args]" << std::endl;
+    std::cout << "\tlocal <x> <y> <z>\tAdds the local sizes" << std::endl;
+    std::cout << "\tgroups <x> <y> <z>\tAdds the number of work-groups" << std::endl;
+    std::cout << "\tcycles <max-cycles>\tSets the maximum number of cycles of a single run" << std::endl;
 }
 
 int main(int argc, char** argv)
@@ -195,6 +473,16 @@ int main(int argc, char** argv)
         return 0;
     }
 
+    if(std::string("--batch") == argv[1])
+    {
+        if(argc < 3)
+        {
+            printHelp();
+            return 1;
+        }
+        return runBatch(argc, argv);
+    }
+
     EmulationData data;
 
     data.workGroup.dimensions = 1;
@@ -232,6 +520,11 @@ int main(int argc, char** argv)
             data.workGroup.numGroups.at(2) = static_cast<tools::Word>(std::strtol(argv[i], nullptr, 0));
             data.workGroup.dimensions = 3;
         }
+        else if(std::string("-t") == argv[i])
+        {
+            ++i;
+            data.numEmulationThreads = static_cast<uint32_t>(std::strtol(argv[i], nullptr, 0));
+        }
         else if(std::string("-d") == argv[i])
         {
             ++i;
@@ -247,37 +540,52 @@ int main(int argc, char** argv)
             ++i;
             data.instrumentationDump = argv[i];
         }
-        else if(std::string("-f") == argv[i])
+        else if(std::string("-p") == argv[i])
         {
             ++i;
-            data.parameter.emplace_back(0u, readBinaryFile(argv[i]));
-            bufferTypes.push_back(BufferType::BINARY);
+            data.profileReport = argv[i];
         }
-        else if(std::string("-s") == argv[i])
+        else if(std::string("-c") == argv[i])
         {
             ++i;
-            data.parameter.emplace_back(0u, readDirectData(argv[i]));
-            bufferTypes.push_back(BufferType::CHARACTER);
+            data.profileCallgrind = argv[i];
         }
-        else if(std::string("-b") == argv[i])
+        else if(std::string("--trace") == argv[i])
         {
             ++i;
-            data.parameter.emplace_back(
-                0u, std::vector<tools::Word>(static_cast<std::size_t>(std::strtol(argv[i], nullptr, 0)), 0x0));
-            bufferTypes.push_back(BufferType::BINARY);
+            data.traceFile = argv[i];
+        }
+        else if(std::string("-a") == argv[i])
+        {
+            ++i;
+            data.decoratedModule = argv[i];
         }
-        else if(std::string("-ib") == argv[i])
+        else if(std::string("--restore") == argv[i])
         {
             ++i;
-            data.parameter.emplace_back(0u, readDirectBuffer<int>(argv[i]));
-            bufferTypes.push_back(BufferType::INT);
+            data.restoreCheckpoint = argv[i];
         }
-        else if(std::string("-fb") == argv[i])
+        else if(std::string("--checkpoint") == argv[i])
         {
             ++i;
-            data.parameter.emplace_back(0u, readDirectBuffer<float>(argv[i]));
-            bufferTypes.push_back(BufferType::FLOAT);
+            data.checkpointFile = argv[i];
         }
+        else if(std::string("--stop-cycle") == argv[i])
+        {
+            ++i;
+            data.stopCycle = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("--stop-instruction") == argv[i])
+        {
+            ++i;
+            data.stopInstruction = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 0));
+        }
+        else if(std::string("--no-skip-stalls") == argv[i])
+        {
+            data.skipStalledCycles = false;
+        }
+        else if(i + 1 < argc - 1 && readBufferParameter(argv[i], argv[i + 1], data.parameter, bufferTypes))
+            ++i;
         else if(std::string("-o") == argv[i])
         {
             ++i;
@@ -303,6 +611,8 @@ int main(int argc, char** argv)
     logging::info() << "Running emulator with " << data.parameter.size() << " parameters on kernel " << data.kernelName
                     << logging::endl;
     auto result = emulate(data);
+    if(result.executionStopped)
+        std::cout << "Emulation stopped after " << result.numCycles << " cycles" << std::endl;
     if(outParam >= 0 && static_cast<unsigned>(outParam) < result.results.size())
     {
         std::cout << "Result (buffer " << outParam << "): ";
@@ -322,6 +632,15 @@ int main(int argc, char** argv)
         }
     }
 
+    logging::info() << "TMU cache statistics for global data: " << result.globalDataCacheStatistics.to_string()
+                    << logging::endl;
+    for(std::size_t i = 0; i < result.parameterCacheStatistics.size(); ++i)
+    {
+        if(result.results[i].second)
+            logging::info() << "TMU cache statistics for buffer " << i << ": "
+                            << result.parameterCacheStatistics[i].to_string() << logging::endl;
+    }
+
 #ifdef DEBUG_MODE
     vc4c::profiler::dumpProfileResults(true);
 #endif